@@ -1,7 +1,75 @@
 #include "EventBucket.h"
+#include <algorithm>
+#include <typeindex>
+#include <unordered_map>
+#include <memory>
 
 unsigned long EventBucket::m_GlobalMTime = 1;
 
+namespace
+{
+
+/**
+ * Global registry of the event types seen by event buckets. Each type is
+ * assigned a slot and a prototype instance, and the results of checking
+ * whether one type is a child of another are cached.
+ */
+class EventTypeRegistry
+{
+public:
+
+  static EventTypeRegistry &Instance()
+  {
+    static EventTypeRegistry registry;
+    return registry;
+  }
+
+  unsigned int GetSlot(const itk::EventObject &evt)
+  {
+    std::lock_guard<std::mutex> guard(m_Mutex);
+    std::type_index key(typeid(evt));
+    auto it = m_SlotMap.find(key);
+    if(it != m_SlotMap.end())
+      return it->second;
+
+    unsigned int slot = (unsigned int) m_Prototypes.size();
+    m_Prototypes.push_back(std::unique_ptr<itk::EventObject>(evt.MakeObject()));
+    m_SlotMap[key] = slot;
+    return slot;
+  }
+
+  /** Whether events in slot 'stored' are of the type in slot 'query' or its child */
+  bool IsA(unsigned int stored, unsigned int query)
+  {
+    if(stored == query)
+      return true;
+
+    std::lock_guard<std::mutex> guard(m_Mutex);
+    unsigned long long key = ((unsigned long long) query << 32) | stored;
+    auto it = m_IsACache.find(key);
+    if(it != m_IsACache.end())
+      return it->second;
+
+    bool isa = m_Prototypes[query]->CheckEvent(m_Prototypes[stored].get());
+    m_IsACache[key] = isa;
+    return isa;
+  }
+
+  const char *GetEventName(unsigned int slot)
+  {
+    std::lock_guard<std::mutex> guard(m_Mutex);
+    return m_Prototypes[slot]->GetEventName();
+  }
+
+private:
+  std::mutex m_Mutex;
+  std::unordered_map<std::type_index, unsigned int> m_SlotMap;
+  std::vector<std::unique_ptr<itk::EventObject> > m_Prototypes;
+  std::unordered_map<unsigned long long, bool> m_IsACache;
+};
+
+}
+
 EventBucket::EventBucket()
 {
   m_MTime = m_GlobalMTime++;
@@ -9,7 +77,6 @@ EventBucket::EventBucket()
 
 EventBucket::~EventBucket()
 {
-  Clear();
 }
 
 void EventBucket::Clear()
@@ -17,35 +84,52 @@ void EventBucket::Clear()
   // Prevent parallel access by multiple threads
   std::lock_guard<std::recursive_mutex> guard(m_Mutex);
 
-  // Remove all the event objects
-  for(BucketIt it = m_Bucket.begin(); it != m_Bucket.end(); ++it)
-    {
-    delete(it->first);
-    }
+  // Storage is kept for reuse
   m_Bucket.clear();
+  std::fill(m_TypeMask.begin(), m_TypeMask.end(), 0ull);
   m_MTime = m_GlobalMTime++;
 }
 
-bool EventBucket::HasEvent(const itk::EventObject &evt, const itk::Object *source) const
+bool EventBucket::HasEventType(unsigned int slot, const itk::Object *source) const
 {
-  // Prevent parallel access by multiple threads
-  std::lock_guard<std::recursive_mutex> guard(m_Mutex);
+  EventTypeRegistry &reg = EventTypeRegistry::Instance();
 
-  // Search for the event. Buckets are never too large so a linear search is fine
-  for(BucketIt it = m_Bucket.begin(); it != m_Bucket.end(); ++it)
+  // Without a source, only the event types need to be checked
+  if(source == NULL)
     {
-    const BucketEntry &entry = *it;
-    std::string echeck = evt.GetEventName();
-    std::string eentry = entry.first->GetEventName();
-    if(evt.CheckEvent(entry.first) && (source == NULL || source == entry.second))
+    for(unsigned int w = 0; w < m_TypeMask.size(); w++)
       {
-      return true;
+      for(unsigned long long bits = m_TypeMask[w]; bits; bits &= bits - 1)
+        {
+        unsigned int bit = 0;
+        while(!((bits >> bit) & 1ull))
+          ++bit;
+        if(reg.IsA(w * 64 + bit, slot))
+          return true;
+        }
       }
+    return false;
     }
 
+  // Buckets are never too large so a linear search is fine
+  for(BucketIt it = m_Bucket.begin(); it != m_Bucket.end(); ++it)
+    if(it->second == source && reg.IsA(it->first, slot))
+      return true;
+
   return false;
 }
 
+bool EventBucket::HasEvent(const itk::EventObject &evt, const itk::Object *source) const
+{
+  // Prevent parallel access by multiple threads
+  std::lock_guard<std::recursive_mutex> guard(m_Mutex);
+
+  if(m_Bucket.empty())
+    return false;
+
+  return HasEventType(EventTypeRegistry::Instance().GetSlot(evt), source);
+}
+
 bool EventBucket::IsEmpty() const
 {
   return m_Bucket.size() == 0;
@@ -56,26 +140,27 @@ void EventBucket::PutEvent(const itk::EventObject &evt, const itk::Object *sourc
   // Prevent parallel access by multiple threads
   std::lock_guard<std::recursive_mutex> guard(m_Mutex);
 
-  if(!this->HasEvent(evt, source))
+  unsigned int slot = EventTypeRegistry::Instance().GetSlot(evt);
+  if(!this->HasEventType(slot, source))
     {
-    BucketEntry entry;
-    entry.first = evt.MakeObject();
-    entry.second = source;
-    m_Bucket.insert(entry);
+    m_Bucket.push_back(std::make_pair(slot, source));
+    if(m_TypeMask.size() <= slot / 64)
+      m_TypeMask.resize(slot / 64 + 1, 0ull);
+    m_TypeMask[slot / 64] |= (1ull << (slot % 64));
     m_MTime = m_GlobalMTime++;
     }
 }
 
 std::ostream& operator<<(std::ostream& sink, const EventBucket& eb)
 {
+  EventTypeRegistry &reg = EventTypeRegistry::Instance();
   sink << "EventBucket[";
   for(EventBucket::BucketIt it = eb.m_Bucket.begin(); it != eb.m_Bucket.end();)
     {
-    sink << it->first->GetEventName() << "(" << it->second << ")";
+    sink << reg.GetEventName(it->first) << "(" << it->second << ")";
     if(++it != eb.m_Bucket.end())
       sink << ", ";
     }
   sink << "]";
   return sink;
 }
-
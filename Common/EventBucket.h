@@ -3,7 +3,7 @@
 
 #include "SNAPEvents.h"
 #include <mutex>
-#include <set>
+#include <vector>
 #include <iostream>
 
 namespace itk
@@ -15,8 +15,13 @@ class Object;
   A simple 'bucket' that stores events. You can easily add events to
   the bucket and check if events are present there.
 
-  TODO: the bucket should keep track of objects that fired the event,
-  not only the event types!
+  Events are not copied into the bucket. Instead, each event class is
+  assigned a slot in a global registry the first time it is seen, and the
+  bucket records the slots of the events it holds (as a bit mask, used to
+  answer source-independent queries) together with the originating objects.
+  Repeated events of the same type from the same source are coalesced, so
+  filling and clearing a bucket does not allocate memory once the bucket
+  has reached its working size.
   */
 class EventBucket
 {
@@ -50,16 +55,21 @@ public:
 protected:
 
   /**
-   * The bucket entry consists of a pointer to the event, which the
-   * bucket owns and destroys when it is destroyed or cleared, and the
-   * pointer to the originator the event.
+   * The bucket entry consists of the registry slot of the event type and
+   * the pointer to the originator the event.
    */
-  typedef std::pair<itk::EventObject *, const itk::Object *> BucketEntry;
-  typedef std::set<BucketEntry> BucketType;
-  typedef BucketType::iterator BucketIt;
+  typedef std::pair<unsigned int, const itk::Object *> BucketEntry;
+  typedef std::vector<BucketEntry> BucketType;
+  typedef BucketType::const_iterator BucketIt;
 
   BucketType m_Bucket;
 
+  // Bit mask of the event type slots present in the bucket
+  std::vector<unsigned long long> m_TypeMask;
+
+  // Check if the bucket has an event of a type (given by slot) or its child
+  bool HasEventType(unsigned int slot, const itk::Object *source) const;
+
   // A mutex to prevent simultaneous access to the bucket from multiple threads
   mutable std::recursive_mutex m_Mutex;
 
@@ -2,6 +2,7 @@
 #include "SNAPEventListenerCallbacks.h"
 #include "SNAPCommon.h"
 #include "EventBucket.h"
+#include "TraceRecorder.h"
 
 Rebroadcaster::DispatchMap Rebroadcaster::m_SourceMap;
 Rebroadcaster::DispatchMap Rebroadcaster::m_TargetMap;
@@ -204,6 +205,8 @@ void Rebroadcaster::Association::Callback(itk::Object *source, const itk::EventO
 
 void Rebroadcaster::Association::ConstCallback(const itk::Object *source, const itk::EventObject &evt)
 {
+  SNAP_TRACE_SCOPE("event", evt.GetEventName());
+
   // Decide what to do
   const itk::EventObject *firedEvent = m_RefireSource ? &evt : m_TargetEvent;
 
@@ -0,0 +1,183 @@
+#include "TraceRecorder.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> TraceRecorder::m_Enabled(false);
+std::atomic<size_t> TraceRecorder::m_MaxEventsPerThread(1 << 20);
+
+namespace
+{
+
+typedef std::chrono::steady_clock TraceClock;
+
+/** A recorded span */
+struct TraceEvent
+{
+  const char *Category, *Name;
+  double Start, Duration;
+  std::string Detail;
+};
+
+/**
+ * Events recorded by one thread. The buffer is only locked by its own thread
+ * while recording and by Stop() while writing, so the lock is uncontended
+ * in normal operation.
+ */
+struct TraceThreadBuffer
+{
+  std::mutex Mutex;
+  std::vector<TraceEvent> Events;
+  size_t Dropped = 0;
+  double LastTime = 0.0;
+  unsigned int ThreadId;
+};
+
+/** State shared by all threads */
+struct TraceState
+{
+  std::mutex Mutex;
+  std::vector<std::unique_ptr<TraceThreadBuffer> > Buffers;
+  std::string Filename;
+  TraceClock::time_point StartTime;
+};
+
+TraceState &GetTraceState()
+{
+  static TraceState state;
+  return state;
+}
+
+TraceThreadBuffer *GetThreadBuffer()
+{
+  // Buffers belong to the global state, so that events recorded by threads
+  // that have since exited are still written out
+  thread_local TraceThreadBuffer *buffer = NULL;
+  if(!buffer)
+    {
+    TraceState &state = GetTraceState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    state.Buffers.push_back(std::unique_ptr<TraceThreadBuffer>(new TraceThreadBuffer()));
+    buffer = state.Buffers.back().get();
+    buffer->ThreadId = (unsigned int) state.Buffers.size();
+    }
+  return buffer;
+}
+
+void WriteJSONString(FILE *f, const char *s)
+{
+  fputc('"', f);
+  for(; *s; ++s)
+    {
+    unsigned char c = (unsigned char) *s;
+    if(c == '"' || c == '\\')
+      fprintf(f, "\\%c", c);
+    else if(c < 0x20)
+      fprintf(f, "\\u%04x", c);
+    else
+      fputc(c, f);
+    }
+  fputc('"', f);
+}
+
+}
+
+void TraceRecorder::Start(const std::string &filename)
+{
+  TraceState &state = GetTraceState();
+  {
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    state.Filename = filename;
+    state.StartTime = TraceClock::now();
+  }
+  m_Enabled.store(true);
+}
+
+double TraceRecorder::GetTimestamp()
+{
+  std::chrono::duration<double, std::micro> t =
+      TraceClock::now() - GetTraceState().StartTime;
+  return t.count();
+}
+
+void TraceRecorder::RecordSpan(const char *category, const char *name,
+                               double t_start, double t_end,
+                               const std::string &detail)
+{
+  TraceThreadBuffer *buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer->Mutex);
+
+  // Once the buffer is full, events are only counted
+  buffer->LastTime = t_end;
+  if(buffer->Events.size() >= GetMaxEventsPerThread())
+    {
+    buffer->Dropped++;
+    return;
+    }
+
+  TraceEvent ev;
+  ev.Category = category;
+  ev.Name = name;
+  ev.Start = t_start;
+  ev.Duration = t_end - t_start;
+  ev.Detail = detail;
+  buffer->Events.push_back(ev);
+}
+
+bool TraceRecorder::Stop()
+{
+  if(!m_Enabled.exchange(false))
+    return false;
+
+  TraceState &state = GetTraceState();
+  std::lock_guard<std::mutex> lock(state.Mutex);
+
+  FILE *f = fopen(state.Filename.c_str(), "wt");
+  if(!f)
+    return false;
+
+  fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  bool first = true;
+  for(auto &buffer : state.Buffers)
+    {
+    std::lock_guard<std::mutex> buffer_lock(buffer->Mutex);
+    for(const TraceEvent &ev : buffer->Events)
+      {
+      fprintf(f, first ? "\n{\"name\":" : ",\n{\"name\":");
+      WriteJSONString(f, ev.Name);
+      fprintf(f, ",\"cat\":");
+      WriteJSONString(f, ev.Category);
+      fprintf(f, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+              ev.Start, ev.Duration, buffer->ThreadId);
+      if(ev.Detail.size())
+        {
+        fprintf(f, ",\"args\":{\"detail\":");
+        WriteJSONString(f, ev.Detail.c_str());
+        fprintf(f, "}");
+        }
+      fprintf(f, "}");
+      first = false;
+      }
+
+    // Report the events that did not fit in the buffer
+    if(buffer->Dropped)
+      {
+      fprintf(f, first ? "\n" : ",\n");
+      fprintf(f, "{\"name\":\"DroppedEvents\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                 "\"pid\":1,\"tid\":%u,\"args\":{\"count\":%zu}}",
+              buffer->LastTime, buffer->ThreadId, buffer->Dropped);
+      first = false;
+      }
+
+    buffer->Events.clear();
+    buffer->Events.shrink_to_fit();
+    buffer->Dropped = 0;
+    }
+  fprintf(f, "\n]}\n");
+
+  bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
@@ -0,0 +1,112 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <atomic>
+#include <string>
+
+/**
+ * @brief Low-overhead recorder of timed spans for performance tracing.
+ *
+ * Code sections of interest (slicing, display mapping, rendering, event
+ * rebroadcasting, mesh generation, I/O) are marked with SNAP_TRACE_SCOPE.
+ * When tracing is off, which is the default, each span costs a single
+ * atomic load. When tracing has been started (e.g., with the --trace option
+ * of the main program), each span is appended to a buffer owned by the
+ * calling thread, and the buffers are written out as Chrome trace-event JSON
+ * when tracing stops. The resulting file can be loaded into chrome://tracing
+ * or https://ui.perfetto.dev.
+ *
+ * Span names and categories must be string literals or otherwise remain
+ * valid until tracing stops. Variable information, such as a filename, can
+ * be attached to a span as a detail string, which is only evaluated when
+ * tracing is on.
+ *
+ * Each thread records at most GetMaxEventsPerThread() events per tracing
+ * session. Later events of that thread are counted but not stored, and the
+ * count is reported in the trace file.
+ */
+class TraceRecorder
+{
+public:
+
+  /** Start recording. The events will be written to the given file */
+  static void Start(const std::string &filename);
+
+  /**
+   * Stop recording and write all recorded events to the file passed to
+   * Start(). Returns false if the file could not be written.
+   */
+  static bool Stop();
+
+  /** Whether recording is currently on */
+  static bool IsEnabled()
+    { return m_Enabled.load(std::memory_order_relaxed); }
+
+  /** Current time in microseconds since tracing started */
+  static double GetTimestamp();
+
+  /** Maximum number of events stored per thread (1M by default) */
+  static void SetMaxEventsPerThread(size_t n)
+    { m_MaxEventsPerThread.store(n, std::memory_order_relaxed); }
+
+  static size_t GetMaxEventsPerThread()
+    { return m_MaxEventsPerThread.load(std::memory_order_relaxed); }
+
+  /** Record a completed span */
+  static void RecordSpan(const char *category, const char *name,
+                         double t_start, double t_end,
+                         const std::string &detail = std::string());
+
+private:
+
+  static std::atomic<bool> m_Enabled;
+  static std::atomic<size_t> m_MaxEventsPerThread;
+};
+
+/**
+ * A span that starts when this object is created and ends when it goes out
+ * of scope. Use via the SNAP_TRACE_SCOPE macros.
+ */
+class TraceScope
+{
+public:
+  TraceScope(const char *category, const char *name)
+    : m_Category(category), m_Name(name),
+      m_Start(TraceRecorder::IsEnabled() ? TraceRecorder::GetTimestamp() : -1.0) {}
+
+  /** Whether this span is being recorded */
+  bool IsActive() const { return m_Start >= 0.0; }
+
+  /** Attach a detail string to the span */
+  void SetDetail(const std::string &detail) { m_Detail = detail; }
+
+  ~TraceScope()
+    {
+    if(m_Start >= 0.0)
+      TraceRecorder::RecordSpan(m_Category, m_Name, m_Start,
+                                TraceRecorder::GetTimestamp(), m_Detail);
+    }
+
+private:
+  const char *m_Category, *m_Name;
+  double m_Start;
+  std::string m_Detail;
+};
+
+#define SNAP_TRACE_CONCAT_IMPL(a, b) a##b
+#define SNAP_TRACE_CONCAT(a, b) SNAP_TRACE_CONCAT_IMPL(a, b)
+
+/** Trace the remainder of the enclosing scope */
+#define SNAP_TRACE_SCOPE(category, name) \
+  TraceScope SNAP_TRACE_CONCAT(snap_trace_scope_, __LINE__)(category, name)
+
+/**
+ * Trace the remainder of the enclosing scope, with a detail string. The
+ * detail expression is not evaluated when tracing is off
+ */
+#define SNAP_TRACE_SCOPE_DETAIL(category, name, detail) \
+  TraceScope SNAP_TRACE_CONCAT(snap_trace_scope_, __LINE__)(category, name); \
+  if(SNAP_TRACE_CONCAT(snap_trace_scope_, __LINE__).IsActive()) \
+    SNAP_TRACE_CONCAT(snap_trace_scope_, __LINE__).SetDetail(detail)
+
+#endif // TRACERECORDER_H
@@ -5,6 +5,7 @@
 #include "ImageAnnotationData.h"
 #include "GlobalUIModel.h"
 #include <limits>
+#include <algorithm>
 
 void AnnotationModel::SetParent(GenericSliceModel *model)
 {
@@ -59,8 +60,6 @@ double AnnotationModel::GetAngleWithCurrentLine(const annot::LineSegmentAnnotati
 
 void AnnotationModel::AdjustAngleToRoundDegree(LineSegment &line, int n_degrees)
 {
-  ImageAnnotationData *adata = this->GetAnnotations();
-
   // Map the line segment from slice coordinates to window physical, where angles are
   // computed
   Vector2d p1 = m_Parent->MapSliceToPhysicalWindow(line.first);
@@ -74,13 +73,14 @@ void AnnotationModel::AdjustAngleToRoundDegree(LineSegment &line, int n_degrees)
   Vector2d p2_rot_best = p2;
   double rot_best = std::numeric_limits<double>::infinity();
 
-  // Loop over all the lines
-  for(ImageAnnotationData::AnnotationConstIterator it = adata->GetAnnotations().begin();
-      it != adata->GetAnnotations().end(); ++it)
+  // Loop over all the lines in this slice
+  ImageAnnotationData::AnnotationVector visible;
+  this->GetVisibleAnnotations(visible);
+  for(AbstractAnnotation *a : visible)
     {
     const annot::LineSegmentAnnotation *lsa =
-        dynamic_cast<const annot::LineSegmentAnnotation *>(it->GetPointer());
-    if(lsa && this->IsAnnotationVisible(lsa))
+        dynamic_cast<const annot::LineSegmentAnnotation *>(a);
+    if(lsa)
       {
       // Normalize the annotated line
       Vector2d q1 = m_Parent->MapSliceToPhysicalWindow(
@@ -172,6 +172,48 @@ bool AnnotationModel::IsAnnotationVisible(const AnnotationModel::AbstractAnnotat
         m_Parent->GetSliceIndex());
 }
 
+void AnnotationModel::GetVisibleAnnotations(ImageAnnotationData::AnnotationVector &out) const
+{
+  this->GetAnnotations()->GetAnnotationsInSlice(
+        m_Parent->GetSliceDirectionInImageSpace(),
+        m_Parent->GetSliceIndex(), out);
+}
+
+void AnnotationModel::GetVisibleAnnotationsNear(
+    const Vector3d &xSlice, double radius, ImageAnnotationData::AnnotationVector &out) const
+{
+  ImageAnnotationData *adata = this->GetAnnotations();
+
+  // The search extends by the radius, plus the largest offset of a landmark
+  // text from its position, since landmarks are indexed by their position
+  double lm_offset = adata->GetMaximumLandmarkOffset();
+  Vector3d r_click = m_Parent->MapWindowOffsetToSliceOffset(Vector2d(radius, radius));
+  Vector3d r_text = m_Parent->MapPhysicalWindowToSlice(
+                      m_Parent->MapSliceToPhysicalWindow(xSlice) + Vector2d(lm_offset, lm_offset))
+                    - xSlice;
+
+  Vector3d x0 = xSlice, x1 = xSlice;
+  for(int d = 0; d < 2; d++)
+    {
+    double r = fabs(r_click[d]) + fabs(r_text[d]);
+    x0[d] -= r;
+    x1[d] += r;
+    }
+
+  // Map the search box to image coordinates
+  Vector3d y0 = m_Parent->MapSliceToImage(x0), y1 = m_Parent->MapSliceToImage(x1);
+  Vector3d ymin, ymax;
+  for(int d = 0; d < 3; d++)
+    {
+    ymin[d] = std::min(y0[d], y1[d]);
+    ymax[d] = std::max(y0[d], y1[d]);
+    }
+
+  adata->GetAnnotationsInSliceNear(
+        m_Parent->GetSliceDirectionInImageSpace(),
+        m_Parent->GetSliceIndex(), ymin, ymax, out);
+}
+
 double AnnotationModel
 ::GetPixelDistanceToAnnotation(
     const AbstractAnnotation *annot,
@@ -201,28 +243,21 @@ double AnnotationModel
 AnnotationModel::AbstractAnnotation *
 AnnotationModel::GetAnnotationUnderCursor(const Vector3d &xSlice)
 {
-  ImageAnnotationData *adata = this->GetAnnotations();
-
   // Current best annotation
   AbstractAnnotation *asel = NULL;
   double dist_min = std::numeric_limits<double>::infinity();
   double dist_thresh = 5 * m_Parent->GetSizeReporter()->GetViewportPixelRatio();
 
-  // Loop over all annotations
-  for(ImageAnnotationData::AnnotationConstIterator it = adata->GetAnnotations().begin();
-      it != adata->GetAnnotations().end(); ++it)
+  // Loop over the annotations near the cursor
+  ImageAnnotationData::AnnotationVector nearby;
+  this->GetVisibleAnnotationsNear(xSlice, dist_thresh, nearby);
+  for(AbstractAnnotation *a : nearby)
     {
-    AbstractAnnotation *a = *it;
-
-    // Test if annotation is visible in this plane
-    if(this->IsAnnotationVisible(a))
+    double dist = GetPixelDistanceToAnnotation(a, xSlice);
+    if(dist < dist_thresh && dist < dist_min)
       {
-      double dist = GetPixelDistanceToAnnotation(a, xSlice);
-      if(dist < dist_thresh && dist < dist_min)
-        {
-        asel = a;
-        dist_min = dist;
-        }
+      asel = a;
+      dist_min = dist;
       }
     }
 
@@ -309,7 +344,6 @@ bool AnnotationModel::ProcessPushEvent(const Vector3d &xSlice, bool shift_mod)
 
 bool AnnotationModel::ProcessMoveEvent(const Vector3d &xSlice, bool shift_mod, bool drag)
 {
-  ImageAnnotationData *adata = this->GetAnnotations();
   bool handled = false;
   if(this->GetAnnotationMode() == ANNOTATION_RULER || this->GetAnnotationMode() == ANNOTATION_LANDMARK)
     {
@@ -336,14 +370,12 @@ bool AnnotationModel::ProcessMoveEvent(const Vector3d &xSlice, bool shift_mod, b
     Vector3d p_now = m_Parent->MapSliceToImage(xSlice);
     Vector3d p_delta = p_now - p_last;
 
-    // Process the move command on selected annotations
-    for(ImageAnnotationData::AnnotationIterator it = adata->GetAnnotations().begin();
-        it != adata->GetAnnotations().end(); ++it)
+    // Process the move command on selected annotations in this slice
+    ImageAnnotationData::AnnotationVector visible;
+    this->GetVisibleAnnotations(visible);
+    for(AbstractAnnotation *a : visible)
       {
-      AbstractAnnotation *a = *it;
-
-      // Test if annotation is visible in this plane
-      if(m_MovingSelectionHandle < 0 && a->GetSelected() && this->IsAnnotationVisible(a))
+      if(m_MovingSelectionHandle < 0 && a->GetSelected())
         {
         // Move the annotation by this amount
         a->MoveBy(p_delta);
@@ -453,18 +485,10 @@ void AnnotationModel::CancelLine()
 
 void AnnotationModel::SelectAllOnSlice()
 {
-  ImageAnnotationData *adata = this->GetAnnotations();
-  for(ImageAnnotationData::AnnotationIterator it = adata->GetAnnotations().begin();
-      it != adata->GetAnnotations().end(); ++it)
-    {
-    AbstractAnnotation *a = *it;
-
-    // Test if annotation is visible in this plane
-    if(this->IsAnnotationVisible(a))
-      {
-      a->SetSelected(true);
-      }
-    }
+  ImageAnnotationData::AnnotationVector visible;
+  this->GetVisibleAnnotations(visible);
+  for(AbstractAnnotation *a : visible)
+    a->SetSelected(true);
 
   this->InvokeEvent(ModelUpdateEvent());
 }
@@ -486,20 +510,22 @@ void AnnotationModel::DeleteSelectedOnSlice()
       ++it;
     }
 
+  // The list was edited directly, so the annotation index must be updated
+  adata->Modified();
+
   this->InvokeEvent(ModelUpdateEvent());
 }
 
 AnnotationModel::AbstractAnnotation *
 AnnotationModel::GetSingleSelectedAnnotation() const
 {
-  ImageAnnotationData *adata = this->GetAnnotations();
   AbstractAnnotation *last_sel = NULL;
   unsigned int n_found = 0;
-  for(ImageAnnotationData::AnnotationIterator it = adata->GetAnnotations().begin();
-      it != adata->GetAnnotations().end(); it++)
+  ImageAnnotationData::AnnotationVector visible;
+  this->GetVisibleAnnotations(visible);
+  for(AbstractAnnotation *a : visible)
     {
-    AbstractAnnotation *a = *it;
-    if(a->GetSelected() && this->IsAnnotationVisible(a))
+    if(a->GetSelected())
       {
       n_found++;
       last_sel = a;
@@ -787,18 +813,19 @@ void AnnotationModel::SetSelectedAnnotationColorValue(Vector3ui value)
 annot::AbstractAnnotation *
 AnnotationModel::GetSelectedHandleUnderCusror(const Vector3d &xSlice, int &out_handle)
 {
-  // Get the annotation data
-  ImageAnnotationData *adata = this->GetAnnotations();
+  // Get the annotations near the cursor
+  ImageAnnotationData::AnnotationVector nearby;
+  this->GetVisibleAnnotationsNear(
+        xSlice, 5 * m_Parent->GetSizeReporter()->GetViewportPixelRatio(), nearby);
 
   out_handle = -1;
-  for(ImageAnnotationData::AnnotationConstIterator it = adata->GetAnnotations().begin();
-      it != adata->GetAnnotations().end(); ++it)
+  for(AbstractAnnotation *a : nearby)
     {
-    if(this->IsAnnotationVisible(*it) && (*it)->GetSelected())
+    if(a->GetSelected())
       {
       // Draw all the line segments
       annot::LineSegmentAnnotation *lsa =
-          dynamic_cast<annot::LineSegmentAnnotation *>(it->GetPointer());
+          dynamic_cast<annot::LineSegmentAnnotation *>(a);
       if(lsa)
         {
         // Draw the line
@@ -813,7 +840,7 @@ AnnotationModel::GetSelectedHandleUnderCusror(const Vector3d &xSlice, int &out_h
         }
 
       annot::LandmarkAnnotation *lma =
-          dynamic_cast<annot::LandmarkAnnotation *>(it->GetPointer());
+          dynamic_cast<annot::LandmarkAnnotation *>(a);
       if(lma)
         {
         Vector3d xHeadSlice, xTailSlice;
@@ -828,7 +855,7 @@ AnnotationModel::GetSelectedHandleUnderCusror(const Vector3d &xSlice, int &out_h
         }
 
       if(out_handle >= 0)
-        return it->GetPointer();
+        return a;
       }
     }
 
@@ -91,6 +91,9 @@ public:
   /** Test if an annotation is visible in this slice */
   bool IsAnnotationVisible(const AbstractAnnotation *annot) const;
 
+  /** Get the annotations visible in this slice */
+  void GetVisibleAnnotations(ImageAnnotationData::AnnotationVector &out) const;
+
 
   bool ProcessPushEvent(const Vector3d &xSlice, bool shift_mod);
 
@@ -157,6 +160,10 @@ protected:
   double GetPixelDistanceToAnnotation(const AbstractAnnotation *annot, const Vector3d &point);
   void AdjustAngleToRoundDegree(LineSegment &ls, int n_degrees);
   AbstractAnnotation *GetAnnotationUnderCursor(const Vector3d &xSlice);
+
+  // Get the visible annotations that may be within a radius (in window pixels) of a point
+  void GetVisibleAnnotationsNear(const Vector3d &xSlice, double radius,
+                                 ImageAnnotationData::AnnotationVector &out) const;
   void GoToNextOrPrevAnnotation(int direction);
 
   annot::AbstractAnnotation *GetSelectedHandleUnderCusror(const Vector3d &xSlice, int &out_handle);
@@ -31,6 +31,7 @@
 #include <GenericImageData.h>
 #include <SNAPAppearanceSettings.h>
 #include <DisplayLayoutModel.h>
+#include <TraceRecorder.h>
 #include <vtkContourTriangulator.h>
 #include "DeformationGridModel.h"
 #include "DrawTriangles.h"
@@ -148,6 +149,8 @@ void GenericSliceModel
 
 void GenericSliceModel::OnUpdate()
 {
+  SNAP_TRACE_SCOPE("model", "GenericSliceModel::OnUpdate");
+
   // Has there been a change in the image dimensions?
   if(m_EventBucket->HasEvent(MainImageDimensionsChangeEvent()))
     {
@@ -11,6 +11,14 @@
 #include "itkBWAandRFinterpolation.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkExtractImageFilter.h"
+#include "itkImageAlgorithm.h"
+#include "itkPlatformMultiThreader.h"
+#include "LabelOccupancyIndex.h"
+#include "LabelInterpolationSlicePlan.h"
+#include <algorithm>
+#include <mutex>
 
 void InterpolateLabelModel::SetParentModel(GlobalUIModel *parent)
 {
@@ -131,128 +139,449 @@ void InterpolateLabelModel::Interpolate()
   }
 
   // If Binary Weighted Averaging ...
-  // TODO: this can become a memory hog - should crop around the region of interest
-  // TODO: label mapping code should be parallelized
   else if(method == BINARY_WEIGHTED_AVERAGE)
     {
-    // Inputs to the filter will be floating point images
-    typedef ImageWrapperBase::FloatImageType ImageType;
-    typedef ImageWrapperBase::FloatVectorImageType VectorImageType;
+    this->InterpolateBinaryWeightedAverage(liw);
+    }
 
-    // Copy label image to short type from RLE
-    ShortType::Pointer SegmentationImageShortType = ShortType::New();
+  // Iterate through all of the relevant layers and release the pipelines we created
+  for(LayerIterator it = m_CurrentImageData->GetLayers(MAIN_ROLE | OVERLAY_ROLE);
+      !it.IsAtEnd(); ++it)
+    {
+    it.GetLayer()->ReleaseInternalPipeline("BinaryWeightedAverage");
+    }
 
-    ShortType::RegionType ShortRegion = liw->GetImage()->GetBufferedRegion();
-    SegmentationImageShortType->CopyInformation(liw->GetImage());
-    SegmentationImageShortType->SetRegions( ShortRegion );
-    SegmentationImageShortType->Allocate();
 
-    itk::ImageRegionIterator< ShortType > itO( SegmentationImageShortType, SegmentationImageShortType->GetBufferedRegion() );
-    itk::ImageRegionConstIterator< GenericImageData::LabelImageType > itI( liw->GetImage(), liw->GetImage()->GetBufferedRegion() );
+  // Fire event to inform GUI that segmentation has changed
+  this->m_Parent->GetDriver()->InvokeEvent(SegmentationChangeEvent());
+}
 
-    while ( !itI.IsAtEnd() )
-      {
-      typename GenericImageData::LabelImageType::PixelType val = itI.Get();
-      itO.Set( val );
-      ++itI;
-      ++itO;
-      }
 
-    using BinaryWeightedAverageType = itk::CombineBWAandRFFilter<ImageType,VectorImageType,ShortType>;
-    typename BinaryWeightedAverageType::Pointer bwa =  BinaryWeightedAverageType::New();
+// Hash of a run of voxels, summed into the checksum of the slice
+inline unsigned long HashLabelRun(long x0, long x1, long y, long z)
+{
+  unsigned long long h =
+      (unsigned long long) x0 ^ ((unsigned long long) x1 << 16)
+      ^ ((unsigned long long) y << 32) ^ ((unsigned long long) z << 48);
+  h += 0x9e3779b97f4a7c15ull;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  return (unsigned long) (h ^ (h >> 31));
+}
 
-    // Iterate through all of the relevant layers to get the main image
-    for(LayerIterator it = m_CurrentImageData->GetLayers(MAIN_ROLE | OVERLAY_ROLE);
-        !it.IsAtEnd(); ++it)
+// Compute the checksum and the number of voxels of a label in each slice
+// along an axis, from the runs of the segmentation lines within a region
+static void ComputeSliceProfile(const GenericImageData::LabelImageType *seg,
+                                const itk::ImageRegion<3> &region,
+                                LabelType label, int axis,
+                                std::vector<unsigned long> &signature,
+                                std::vector<unsigned long> &count)
+{
+  typedef GenericImageData::LabelImageType LabelImageType;
+  const itk::ImageRegion<3> &bufRegion = seg->GetBufferedRegion();
+  const LabelImageType::BufferType *buffer = seg->GetBuffer();
+  size_t n = bufRegion.GetSize(axis);
+  signature.assign(n, 0);
+  count.assign(n, 0);
+
+  // Each plane of lines is scanned separately and added to the totals
+  long x0 = region.GetIndex(0) - bufRegion.GetIndex(0), x1 = x0 + region.GetSize(0);
+  long y0 = region.GetIndex(1), y1 = y0 + region.GetSize(1);
+  std::mutex mutex;
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+  mt->ParallelizeArray(0, region.GetSize(2), [&](itk::SizeValueType k)
+    {
+    std::vector<unsigned long> plane_signature(n, 0), plane_count(n, 0);
+    long z = region.GetIndex(2) + k;
+    for(long y = y0; y < y1; y++)
       {
-      if(it.GetLayerAsScalar())
+      LabelImageType::BufferType::IndexType lineIndex = {{ y, z }};
+      const LabelImageType::RLLine &line = buffer->GetPixel(lineIndex);
+      long t = 0;
+      for(size_t i = 0; i < line.size() && t < x1; i++)
         {
-        // Critical that these pipelines be released later
-        auto src = it.GetLayer()->CreateCastToFloatPipeline("BinaryWeightedAverage");
-        bwa->AddScalarImage(src);
+        long r0 = std::max(t, x0), r1 = std::min(t + (long) line[i].first, x1);
+        t += line[i].first;
+        if(r0 >= r1 || line[i].second != label)
+          continue;
+
+        if(axis == 0)
+          {
+          for(long r = r0; r < r1; r++)
+            {
+            plane_signature[r] += HashLabelRun(r, r, y, z);
+            plane_count[r]++;
+            }
+          }
+        else
+          {
+          size_t s = (axis == 1 ? y : z) - bufRegion.GetIndex(axis);
+          plane_signature[s] += HashLabelRun(r0, r1 - 1, y, z);
+          plane_count[s] += r1 - r0;
+          }
         }
-      else if (it.GetLayerAsVector())
+      }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for(size_t s = 0; s < n; s++)
+      {
+      signature[s] += plane_signature[s];
+      count[s] += plane_count[s];
+      }
+    }, nullptr);
+}
+
+// Decode a region of the segmentation into a short image, in parallel over the
+// lines. If label is non-zero, all other labels are cleared, and if keep is not
+// empty, the slices along the axis that are not flagged in it are cleared too.
+static InterpolateLabelModel::ShortType::Pointer
+ExtractSegmentationRegion(const GenericImageData::LabelImageType *seg,
+                          const itk::ImageRegion<3> &region, LabelType label,
+                          int axis = -1,
+                          const std::vector<bool> &keep = std::vector<bool>())
+{
+  typedef GenericImageData::LabelImageType LabelImageType;
+  typedef InterpolateLabelModel::ShortType ShortType;
+
+  ShortType::Pointer out = ShortType::New();
+  out->CopyInformation(seg);
+  out->SetRegions(region);
+  out->Allocate();
+
+  const itk::ImageRegion<3> &bufRegion = seg->GetBufferedRegion();
+  const LabelImageType::BufferType *buffer = seg->GetBuffer();
+  long x0 = region.GetIndex(0) - bufRegion.GetIndex(0), x1 = x0 + region.GetSize(0);
+  long ny = region.GetSize(1);
+
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+  mt->ParallelizeArray(0, ny * region.GetSize(2), [&](itk::SizeValueType row)
+    {
+    ShortType::IndexType idx = region.GetIndex();
+    idx[1] += row % ny;
+    idx[2] += row / ny;
+    short *p = out->GetBufferPointer() + out->ComputeOffset(idx);
+    bool keep_line = keep.empty() || axis == 0 || keep[idx[axis] - bufRegion.GetIndex(axis)];
+
+    LabelImageType::BufferType::IndexType lineIndex = {{ idx[1], idx[2] }};
+    const LabelImageType::RLLine &line = buffer->GetPixel(lineIndex);
+    long t = 0;
+    for(size_t i = 0; i < line.size() && t < x1; i++)
+      {
+      long r0 = std::max(t, x0), r1 = std::min(t + (long) line[i].first, x1);
+      t += line[i].first;
+      short value = (label == 0 || line[i].second == label) ? (short) line[i].second : 0;
+      for(long r = r0; r < r1; r++)
         {
-        // Critical that these pipelines be released later
-        auto src = it.GetLayer()->CreateCastToFloatVectorPipeline("BinaryWeightedAverage");
-        bwa->AddVectorImage(src);
+        bool kept = keep_line && (axis != 0 || keep.empty() || keep[r]);
+        p[r - x0] = kept ? value : 0;
         }
       }
+    }, nullptr);
 
+  return out;
+}
 
-    // Should we be interpolating a specific label or all labels?
-    if(interp_all)
+// Find the slices along the axis in which the interpolation filter will find
+// a drawn contour, using the same test as CombineBWAandRFFilter when the axis
+// is fixed: a voxel of the label that has no label on either side along the
+// axis, and the label on both sides along the other two axes
+static std::vector<bool>
+FindKeySlices(const InterpolateLabelModel::ShortType *seg, int axis,
+              long first_slice, size_t n_slices)
+{
+  typedef InterpolateLabelModel::ShortType ShortType;
+  const ShortType::RegionType &region = seg->GetBufferedRegion();
+
+  std::vector<char> found(region.GetSize(axis), 0);
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+  mt->ParallelizeArray(0, region.GetSize(axis), [&](itk::SizeValueType k)
+    {
+    ShortType::RegionType slice = region;
+    slice.SetIndex(axis, region.GetIndex(axis) + k);
+    slice.SetSize(axis, 1);
+
+    itk::ImageRegionConstIteratorWithIndex<ShortType> it(seg, slice);
+    for(; !it.IsAtEnd() && !found[k]; ++it)
       {
-      bwa->SetSegmentationImage(SegmentationImageShortType);
+      short val = it.Get();
+      if(val == 0)
+        continue;
+
+      unsigned int c_clear = 0, c_adjacent = 0;
+      int clear_axis = -1;
+      for(int a = 0; a < 3; a++)
+        {
+        ShortType::IndexType i_prev = it.GetIndex(), i_next = it.GetIndex();
+        i_prev[a]--;
+        i_next[a]++;
+        short prev = region.IsInside(i_prev) ? seg->GetPixel(i_prev) : 0;
+        short next = region.IsInside(i_next) ? seg->GetPixel(i_next) : 0;
+        if(prev == 0 && next == 0)
+          {
+          clear_axis = a;
+          c_clear++;
+          }
+        else if(prev == val && next == val)
+          {
+          c_adjacent++;
+          }
+        }
+
+      if(c_clear == 1 && c_adjacent == 2 && clear_axis == axis)
+        found[k] = 1;
       }
+    }, nullptr);
+
+  std::vector<bool> key(n_slices, false);
+  for(size_t k = 0; k < found.size(); k++)
+    key[region.GetIndex(axis) + k - first_slice] = found[k] != 0;
+  return key;
+}
+
+// Copy a region of an image into an image disconnected from the pipeline
+template <class TImage>
+static SmartPtr<TImage> ExtractLayerRegion(TImage *image, const itk::ImageRegion<3> &region)
+{
+  typedef itk::ExtractImageFilter<TImage, TImage> ExtractFilterType;
+  SmartPtr<ExtractFilterType> extract = ExtractFilterType::New();
+  extract->SetInput(image);
+  extract->SetExtractionRegion(region);
+  extract->SetDirectionCollapseToSubmatrix();
+  extract->Update();
+
+  SmartPtr<TImage> output = extract->GetOutput();
+  output->DisconnectPipeline();
+  return output;
+}
+
+InterpolateLabelModel::BWALayerList
+InterpolateLabelModel::GetBWAIntensityLayers()
+{
+  BWALayerList layers;
+  for(LayerIterator it = m_CurrentImageData->GetLayers(MAIN_ROLE | OVERLAY_ROLE);
+      !it.IsAtEnd(); ++it)
+    layers.push_back(std::make_pair(it.GetLayer()->GetUniqueId(),
+                                    it.GetLayer()->GetImageBase()->GetMTime()));
+  return layers;
+}
+
+void InterpolateLabelModel::InterpolateBinaryWeightedAverage(LabelImageWrapper *liw)
+{
+  // Inputs to the filter will be floating point images
+  typedef ImageWrapperBase::FloatImageType ImageType;
+  typedef ImageWrapperBase::FloatVectorImageType VectorImageType;
+  typedef itk::CombineBWAandRFFilter<ImageType,VectorImageType,ShortType> BinaryWeightedAverageType;
+  typedef itk::ImageRegion<3> RegionType;
+
+  const GenericImageData::LabelImageType *seg = liw->GetImage();
+  const RegionType &bufRegion = seg->GetBufferedRegion();
+
+  LabelType label = this->GetInterpolateAll() ? 0 : this->GetInterpolateLabel();
+  bool contour_only = this->GetBWAUseContourOnly();
+  bool intermediate_only = this->GetBWAInterpolateIntermediateOnly();
+
+  // Did the user manually specify the slicing direction
+  int axis = -1;
+  if (this->GetSliceDirection())
+    axis = this->m_Parent->GetDriver()->GetImageDirectionForAnatomicalDirection(this->GetSliceDirectionAxis());
+
+  // Only the bounding box of the label(s) being interpolated needs to be
+  // processed. It is padded by the extent of the background sampled around
+  // the label by the random forest (RFLabelMap) and of its feature patches.
+  // The occupancy index is brought up to date with the segmentation when it
+  // is retrieved, so the bounding box includes the latest edits.
+  RegionType roi;
+  LabelOccupancyIndex *occupancy = liw->GetOccupancyIndex();
+  if(!(label ? occupancy->GetLabelBoundingBox(label, roi) : occupancy->GetForegroundBoundingBox(roi)))
+    return;
+  roi.PadByRadius(8);
+  roi.Crop(bufRegion);
+
+  // The regions to interpolate, each handled by a separate filter. The slices
+  // are indexed along the axis relative to the start of the image.
+  std::vector<RegionType> jobs;
+  LabelInterpolationSlicePlan plan;
+  long first_slice = axis >= 0 ? bufRegion.GetIndex(axis) : 0;
+  BWALayerList layers = this->GetBWAIntensityLayers();
+
+  if(label == 0 || axis < 0)
+    {
+    // The filter works out the slicing direction or the labels to interpolate
+    // itself, so the interpolation can not be broken up into gaps between slices
+    jobs.push_back(roi);
+    }
+  else
+    {
+    size_t n_slices = bufRegion.GetSize(axis);
+    std::vector<unsigned long> signature, count;
+    ComputeSliceProfile(seg, roi, label, axis, signature, count);
+
+    // If this label was interpolated along the same axis and with the same
+    // intensity images before, only the gaps next to the slices that have
+    // changed since need to be filled again
+    bool incremental =
+        m_BWAState.WrapperId == liw->GetUniqueId() && m_BWAState.Image == seg
+        && m_BWAState.Label == label && m_BWAState.Axis == axis
+        && m_BWAState.ContourOnly == contour_only
+        && m_BWAState.IntermediateOnly == intermediate_only
+        && m_BWAState.Signature.size() == n_slices
+        && m_BWAState.DrawOver == this->GetDrawOverFilter()
+        && m_BWAState.Layers == layers
+        && this->GetDrawingLabel() == label;
+
+    if(incremental)
+      plan.InitializeIncremental(signature, count, m_BWAState.Signature, m_BWAState.KeySlice);
     else
+      plan.Initialize(FindKeySlices(ExtractSegmentationRegion(seg, roi, label), axis, first_slice, n_slices));
+
+    // Each gap between consecutive key slices is interpolated separately. With
+    // the random forest, gaps that share a key slice are kept together so that
+    // the forest is trained on all of the slices drawn around them.
+    plan.ComputeRanges(!contour_only);
+    for(const LabelInterpolationSlicePlan::SliceRange &range : plan.GetRanges())
       {
-      // We need to extract a single component from the segmentation image to interpolate
-        typename BinarizerType::Pointer Binarizer = BinarizerType::New();
-        Binarizer->SetInput(SegmentationImageShortType);
-        Binarizer->SetLowerThreshold(this->GetInterpolateLabel());
-        Binarizer->SetUpperThreshold(this->GetInterpolateLabel());
-        Binarizer->SetInsideValue(this->GetInterpolateLabel());
-        Binarizer->SetOutsideValue(0);
-        Binarizer->Update();
-        bwa->SetSegmentationImage(Binarizer->GetOutput());
-        bwa->SetLabel(this->GetInterpolateLabel());
+      RegionType gap = roi;
+      gap.SetIndex(axis, first_slice + range.first);
+      gap.SetSize(axis, range.second - range.first + 1);
+      jobs.push_back(gap);
       }
+    }
 
-    // Should we be interpolating a specific label?
-//    if (!interp_all){
-//      bwa->SetLabel(this->GetInterpolateLabel());
-//    }
+  // The filter keeps a single intensity image: the last of the layers added
+  SmartPtr<ImageType> scalar_source;
+  SmartPtr<VectorImageType> vector_source;
+  for(LayerIterator it = m_CurrentImageData->GetLayers(MAIN_ROLE | OVERLAY_ROLE);
+      !it.IsAtEnd(); ++it)
+    {
+    if(it.GetLayerAsScalar())
+      {
+      // Critical that these pipelines be released later
+      scalar_source = it.GetLayer()->CreateCastToFloatPipeline("BinaryWeightedAverage");
+      vector_source = NULL;
+      }
+    else if (it.GetLayerAsVector())
+      {
+      // Critical that these pipelines be released later
+      vector_source = it.GetLayer()->CreateCastToFloatVectorPipeline("BinaryWeightedAverage");
+      scalar_source = NULL;
+      }
+    }
 
-    //    bwa->SetSegmentationImage(SegmentationImageShortType);
-    bwa->SetContourInformationOnly(this->GetBWAUseContourOnly());
-    bwa->SetIntermediateSlicesOnly(this->GetBWAInterpolateIntermediateOnly());
+  // Crop the inputs for each job up front, since the pipelines they come
+  // from can not be updated from several threads at once
+  struct Job
+  {
+    RegionType Region;
+    SmartPtr<ShortType> Segmentation, Interpolation;
+    SmartPtr<ImageType> Scalar;
+    SmartPtr<VectorImageType> Vector;
+  };
+
+  std::vector<Job> job_list(jobs.size());
+  for(size_t i = 0; i < jobs.size(); i++)
+    {
+    Job &job = job_list[i];
+    job.Region = jobs[i];
+    job.Segmentation = ExtractSegmentationRegion(seg, job.Region, label, axis, plan.GetKeepSlices());
+    if(scalar_source)
+      job.Scalar = ExtractLayerRegion<ImageType>(scalar_source, job.Region);
+    else if(vector_source)
+      job.Vector = ExtractLayerRegion<VectorImageType>(vector_source, job.Region);
+    }
 
-    // Did the user manually specify the slicing direction
-    if (this->GetSliceDirection())
-      {
-      int axis = this->m_Parent->GetDriver()->GetImageDirectionForAnatomicalDirection(this->GetSliceDirectionAxis());
+  // Run the jobs in parallel. Platform threads are used because the filters
+  // themselves run on the default (pooled) multi-threader.
+  itk::PlatformMultiThreader::Pointer mt = itk::PlatformMultiThreader::New();
+  mt->SetNumberOfWorkUnits(std::max(1u, std::min((unsigned int) job_list.size(), mt->GetNumberOfWorkUnits())));
+  mt->ParallelizeArray(0, job_list.size(), [&](itk::SizeValueType i)
+    {
+    Job &job = job_list[i];
+    BinaryWeightedAverageType::Pointer bwa = BinaryWeightedAverageType::New();
+    if(job.Scalar)
+      bwa->AddScalarImage(job.Scalar);
+    else if(job.Vector)
+      bwa->AddVectorImage(job.Vector);
+
+    bwa->SetSegmentationImage(job.Segmentation);
+    if(label)
+      bwa->SetLabel(label);
+    bwa->SetContourInformationOnly(contour_only);
+    bwa->SetIntermediateSlicesOnly(intermediate_only);
+    if(axis >= 0)
       bwa->SetUserAxis(axis);
-      }
 
     bwa->Update();
+    job.Interpolation = bwa->GetInterpolation();
+    }, nullptr);
 
-    // Apply the labels back to the segmentation - same as Morphological
-    SegmentationUpdateIterator it_trg(liw, liw->GetBufferedRegion(),
+  // Apply the labels back to the segmentation - same as Morphological. The
+  // jobs are ordered along the axis and share the other two extents, so their
+  // results are put together to make a single update (and undo point).
+  if(job_list.size())
+    {
+    RegionType paint_region = job_list.front().Region;
+    SmartPtr<ShortType> result = job_list.front().Interpolation;
+    if(job_list.size() > 1)
+      {
+      const RegionType &last = job_list.back().Region;
+      paint_region.SetSize(axis, last.GetIndex(axis) + last.GetSize(axis) - paint_region.GetIndex(axis));
+      result = ShortType::New();
+      result->CopyInformation(seg);
+      result->SetRegions(paint_region);
+      result->Allocate();
+      result->FillBuffer(0);
+      for(Job &job : job_list)
+        itk::ImageAlgorithm::Copy(job.Interpolation.GetPointer(), result.GetPointer(), job.Region, job.Region);
+      }
+
+    SegmentationUpdateIterator it_trg(liw, paint_region,
                                       this->GetDrawingLabel(), this->GetDrawOverFilter());
 
-    itk::ImageRegionConstIterator<ShortType>
-        it_src(bwa->GetInterpolation(), bwa->GetInterpolation()->GetBufferedRegion());
+    itk::ImageRegionConstIterator<ShortType> it_src(result, paint_region);
 
-    if(interp_all)
+    LabelType l_replace = this->GetDrawingLabel();
+    const std::vector<bool> &clear = plan.GetClearSlices();
+    for(; !it_trg.IsAtEnd(); ++it_trg, ++it_src)
       {
-      // Just replace the segmentation by the interpolation, respecting draw-over
-      for(; !it_trg.IsAtEnd(); ++it_trg, ++it_src)
+      if(label == 0)
+        {
+        // Just replace the segmentation by the interpolation, respecting draw-over
         it_trg.PaintLabel(it_src.Get());
-      }
-    else
-      {
-      LabelType l_interp = this->GetInterpolateLabel();
-      LabelType l_replace = this->GetDrawingLabel();
-      for(; !it_trg.IsAtEnd(); ++it_trg, ++it_src)
-        if(it_src.Get() == l_interp)
-          it_trg.PaintLabelWithExtraProtection(l_interp, l_replace);
+        }
+      else if(it_src.Get() == label)
+        {
+        it_trg.PaintLabelWithExtraProtection(label, l_replace);
+        }
+      else if(clear.size() && clear[it_trg.GetIndex()[axis] - first_slice])
+        {
+        // Clear what the last interpolation filled in and this one did not
+        it_trg.ReplaceLabel(label, 0);
+        }
       }
 
     // Finish the segmentation editing and create an undo point
     it_trg.Finalize("Interpolate label");
     }
 
-  // Iterate through all of the relevant layers and release the pipelines we created
-  for(LayerIterator it = m_CurrentImageData->GetLayers(MAIN_ROLE | OVERLAY_ROLE);
-      !it.IsAtEnd(); ++it)
+  // Remember the slices of the label for the next interpolation, if it was
+  // painted with its own label (so that the filled-in slices can be found)
+  RegionType bbox;
+  m_BWAState.Image = NULL;
+  if(label && axis >= 0 && this->GetDrawingLabel() == label
+     && liw->GetOccupancyIndex()->GetLabelBoundingBox(label, bbox))
     {
-    it.GetLayer()->ReleaseInternalPipeline("BinaryWeightedAverage");
+    std::vector<unsigned long> count;
+    ComputeSliceProfile(seg, bbox, label, axis, m_BWAState.Signature, count);
+    m_BWAState.WrapperId = liw->GetUniqueId();
+    m_BWAState.Image = seg;
+    m_BWAState.Label = label;
+    m_BWAState.Axis = axis;
+    m_BWAState.DrawOver = this->GetDrawOverFilter();
+    m_BWAState.ContourOnly = contour_only;
+    m_BWAState.IntermediateOnly = intermediate_only;
+    m_BWAState.Layers = layers;
+    m_BWAState.KeySlice = plan.GetKeySlices();
     }
-
-
-  // Fire event to inform GUI that segmentation has changed
-  this->m_Parent->GetDriver()->InvokeEvent(SegmentationChangeEvent());
 }
 
 
@@ -293,4 +622,8 @@ InterpolateLabelModel::InterpolateLabelModel()
   m_SliceDirectionModel = NewSimpleConcreteProperty(false);
   m_SliceDirectionAxisModel = NewSimpleEnumProperty("InterpolationAxis", ANATOMY_AXIAL, emap_interp_axis);
 
+  // No interpolation to build on yet
+  m_BWAState.WrapperId = 0;
+  m_BWAState.Image = NULL;
+
 }
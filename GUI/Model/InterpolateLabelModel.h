@@ -11,9 +11,12 @@
 #include "SNAPImageData.h"
 #include "itkImage.h"
 #include "itkBinaryThresholdImageFilter.h"
+#include <utility>
+#include <vector>
 
 class GlobalUIModel;
 class GenericImageData; // DO I need this?
+class LabelImageWrapper;
 
 class InterpolateLabelModel : public AbstractPropertyContainerModel
 {
@@ -124,6 +127,37 @@ protected:
   // Templated code to interpolate an image
   template <class TImage> void DoInterpolate(TImage *image);
 
+  // Binary weighted average interpolation, cropped to the label(s) involved
+  void InterpolateBinaryWeightedAverage(LabelImageWrapper *liw);
+
+  // The id and image modification time of each intensity layer, which the
+  // random forest of the binary weighted average interpolation is trained on
+  typedef std::vector<std::pair<unsigned long, itk::ModifiedTimeType> > BWALayerList;
+  BWALayerList GetBWAIntensityLayers();
+
+  // The slices of the interpolated label after the last binary weighted
+  // average interpolation of a single label along a fixed axis. The next
+  // interpolation compares the slices with these to find the ones edited
+  // since, and only interpolates the gaps next to them again.
+  struct BWASliceState
+  {
+    // The segmentation, intensity images and settings that the state applies to
+    unsigned long WrapperId;
+    const void *Image;
+    LabelType Label;
+    int Axis;
+    DrawOverFilter DrawOver;
+    bool ContourOnly, IntermediateOnly;
+    BWALayerList Layers;
+
+    // Checksum of the label in each slice, and whether the slice is one of
+    // those drawn by the user (as opposed to filled in by the interpolation)
+    std::vector<unsigned long> Signature;
+    std::vector<bool> KeySlice;
+  };
+
+  BWASliceState m_BWAState;
+
   // The parent model
   GlobalUIModel *m_Parent;
 
@@ -15,6 +15,7 @@ PaintbrushModel::PaintbrushModel()
   m_Watershed = new BrushWatershedPipeline();
   m_ContextLayerId = (unsigned long) -1;
   m_IsEngaged = false;
+  m_StencilValid = false;
 }
 
 PaintbrushModel::~PaintbrushModel()
@@ -80,9 +81,6 @@ bool PaintbrushModel::TestInside(const Vector2d &x, const PaintbrushSettings &ps
   return this->TestInside(Vector3d(x(0), x(1), 0.0), ps);
 }
 
-
-// TODO: make this faster by precomputing all the repeated quantities. The inside
-// check should take a lot less time!
 bool PaintbrushModel::TestInside(const Vector3d &x, const PaintbrushSettings &ps)
 {
   // Determine how to scale the voxels
@@ -107,6 +105,98 @@ bool PaintbrushModel::TestInside(const Vector3d &x, const PaintbrushSettings &ps
     }
 }
 
+const PaintbrushModel::BrushStencil &
+PaintbrushModel::GetBrushStencil(const PaintbrushSettings &pbs, unsigned int sliceAxis)
+{
+  // The settings that determine which voxels are inside of the brush
+  const ImageCoordinateTransform *toDisplay = m_Parent->GetImageToDisplayTransform();
+  Vector3d offset = ComputeOffset();
+  Vector3d spacing = m_Parent->GetSliceSpacing();
+  Vector3d axes[3];
+  for(unsigned int i = 0; i < 3; i++)
+    {
+    Vector3d e(0.0);
+    e(i) = 1.0;
+    axes[i] = toDisplay->TransformVector(e);
+    }
+
+  BrushStencil &st = m_Stencil;
+  if(m_StencilValid
+     && st.Mode == pbs.mode && st.Radius == pbs.radius
+     && st.Volumetric == pbs.volumetric && st.Isotropic == pbs.isotropic
+     && st.SliceAxis == sliceAxis && st.Offset == offset && st.Spacing == spacing
+     && st.DisplayAxes[0] == axes[0] && st.DisplayAxes[1] == axes[1]
+     && st.DisplayAxes[2] == axes[2])
+    return st;
+
+  st.Mode = pbs.mode;
+  st.Radius = pbs.radius;
+  st.Volumetric = pbs.volumetric;
+  st.Isotropic = pbs.isotropic;
+  st.SliceAxis = sliceAxis;
+  st.Offset = offset;
+  st.Spacing = spacing;
+  for(unsigned int i = 0; i < 3; i++)
+    st.DisplayAxes[i] = axes[i];
+
+  // The box that contains the brush, relative to the voxel under the mouse
+  Vector3i b0, bsz;
+  for(unsigned int i = 0; i < 3; i++)
+    {
+    if(i != sliceAxis || pbs.volumetric)
+      {
+      b0(i) = (int) floor(-pbs.radius);
+      bsz(i) = (int) (2 * pbs.radius + 1);
+      }
+    else
+      {
+      b0(i) = 0;
+      bsz(i) = 1;
+      }
+    }
+
+  // Test every voxel in the box once, keeping the runs and their extents
+  std::vector<Vector2i> runs(bsz(1) * bsz(2), Vector2i(0, -1));
+  Vector3i lo(0), hi(0);
+  bool found = false;
+  for(int z = 0; z < bsz(2); z++)
+    {
+    for(int y = 0; y < bsz(1); y++)
+      {
+      Vector2i &run = runs[y + bsz(1) * z];
+      for(int x = 0; x < bsz(0); x++)
+        {
+        Vector3i d(b0(0) + x, b0(1) + y, b0(2) + z);
+        Vector3d xDelta = offset + to_double(d);
+        if(!TestInside(toDisplay->TransformVector(xDelta), pbs))
+          continue;
+
+        if(run(0) > run(1))
+          run(0) = d(0);
+        run(1) = d(0);
+
+        for(unsigned int i = 0; i < 3; i++)
+          {
+          lo(i) = (!found || d(i) < lo(i)) ? d(i) : lo(i);
+          hi(i) = (!found || d(i) > hi(i)) ? d(i) : hi(i);
+          }
+        found = true;
+        }
+      }
+    }
+
+  // Keep only the lines within the extents of the brush
+  st.Start = lo;
+  st.Size = found ? Vector3i(hi - lo + Vector3i(1)) : Vector3i(0);
+  st.Runs.clear();
+  for(int z = lo(2); found && z <= hi(2); z++)
+    for(int y = lo(1); y <= hi(1); y++)
+      st.Runs.push_back(runs[(y - b0(1)) + bsz(1) * (z - b0(2))]);
+
+  m_StencilValid = true;
+  return st;
+}
+
 bool
 PaintbrushModel
 ::ProcessPushEvent(const Vector3d &xSlice, const Vector2ui &gridCell, bool reverse_mode)
@@ -156,38 +246,34 @@ PaintbrushModel
 
   if(m_IsEngaged)
     {
-    // The behavior is different for 'fast' regular brushes and adaptive brush. For the
-    // adaptive brush, dragging is disabled.
-    if(pbs.mode != PAINTBRUSH_WATERSHED || m_ReverseMode)
+    // See how much we have moved since the last event. If we moved more than
+    // the value of the radius, we interpolate the path and place brush strokes
+    // along the path. The adaptive brush reuses its watersheds along the way
+    // while the brush stays within the same tile.
+    if(pixelsMoved > pbs.radius)
       {
-      // See how much we have moved since the last event. If we moved more than
-      // the value of the radius, we interpolate the path and place brush strokes
-      // along the path
-      if(pixelsMoved > pbs.radius)
+      // Break up the path into steps
+      size_t nSteps = (int) ceil(pixelsMoved / pbs.radius);
+      for(size_t i = 0; i < nSteps; i++)
         {
-        // Break up the path into steps
-        size_t nSteps = (int) ceil(pixelsMoved / pbs.radius);
-        for(size_t i = 0; i < nSteps; i++)
-          {
-          double t = (1.0 + i) / nSteps;
-          Vector3d X = t * m_LastApplyX + (1.0 - t) * xSlice;
-          ComputeMousePosition(X);
-          ApplyBrush(m_ReverseMode, true);
-          }
-        }
-      else
-        {
-        // Find the pixel under the mouse
-        ComputeMousePosition(xSlice);
-
-        // Scan convert the points into the slice
+        double t = (1.0 + i) / nSteps;
+        Vector3d X = t * m_LastApplyX + (1.0 - t) * xSlice;
+        ComputeMousePosition(X);
         ApplyBrush(m_ReverseMode, true);
         }
+      }
+    else
+      {
+      // Find the pixel under the mouse
+      ComputeMousePosition(xSlice);
 
-      // Store this as the last apply position
-      m_LastApplyX = xSlice;
+      // Scan convert the points into the slice
+      ApplyBrush(m_ReverseMode, true);
       }
 
+    // Store this as the last apply position
+    m_LastApplyX = xSlice;
+
     // If the mouse is being released, we need to commit the drawing
     if(release)
       {
@@ -263,60 +349,88 @@ PaintbrushModel::ApplyBrush(bool reverse_mode, bool dragging)
   PaintbrushSettings pbs = gs->GetPaintbrushSettings();
 
   // Whether watershed filter is used (adaptive brush)
-  bool flagWatershed = (
-        pbs.mode == PAINTBRUSH_WATERSHED
-        && (!reverse_mode) && (!dragging));
+  bool flagWatershed = (pbs.mode == PAINTBRUSH_WATERSHED && !reverse_mode);
 
-  // Define a region of interest
+  // The voxels covered by the brush
+  unsigned int sliceAxis = imgLabel->GetDisplaySliceImageAxis(m_Parent->GetId());
+  const BrushStencil &stencil = GetBrushStencil(pbs, sliceAxis);
+  if(stencil.Runs.empty())
+    return false;
+
+  // The bounding box of the stencil is all that needs to be visited
   LabelImageWrapper::ImageType::RegionType xTestRegion;
   for(size_t i = 0; i < 3; i++)
     {
-    if(i != imgLabel->GetDisplaySliceImageAxis(m_Parent->GetId())
-       || pbs.volumetric)
-      {
-      // For watersheds, the radius must be > 2
-      double rad = (flagWatershed && pbs.radius < 1.5) ? 1.5 : pbs.radius;
-      xTestRegion.SetIndex(i, (long) (m_MousePosition(i) - rad)); // + 1);
-      xTestRegion.SetSize(i, (long) (2 * rad + 1)); // - 1);
-      }
-    else
-      {
-      xTestRegion.SetIndex(i, m_MousePosition(i));
-      xTestRegion.SetSize(i, 1);
-      }
+    xTestRegion.SetIndex(i, (long) m_MousePosition(i) + stencil.Start(i));
+    xTestRegion.SetSize(i, stencil.Size(i));
     }
 
   // Crop the region by the buffered region
-  xTestRegion.Crop(imgLabel->GetImage()->GetBufferedRegion());
+  if(!xTestRegion.Crop(imgLabel->GetImage()->GetBufferedRegion()))
+    return false;
 
   // Special code for Watershed brush
   if(flagWatershed)
     {
+    // The region on which watersheds are needed
+    LabelImageWrapper::ImageType::RegionType xWatershedRegion, xTile;
+    for(size_t i = 0; i < 3; i++)
+      {
+      if(i != sliceAxis || pbs.volumetric)
+        {
+        // For watersheds, the radius must be > 2
+        double rad = (pbs.radius < 1.5) ? 1.5 : pbs.radius;
+        xWatershedRegion.SetIndex(i, (long) (m_MousePosition(i) - rad)); // + 1);
+        xWatershedRegion.SetSize(i, (long) (2 * rad + 1)); // - 1);
+
+        // The watersheds are computed for a tile extending one radius
+        // further, and reused as long as the brush stays within the tile
+        xTile.SetIndex(i, xWatershedRegion.GetIndex(i) - (long) ceil(rad));
+        xTile.SetSize(i, xWatershedRegion.GetSize(i) + 2 * (long) ceil(rad));
+        }
+      else
+        {
+        xWatershedRegion.SetIndex(i, m_MousePosition(i));
+        xWatershedRegion.SetSize(i, 1);
+        xTile.SetIndex(i, m_MousePosition(i));
+        xTile.SetSize(i, 1);
+        }
+      }
+    xWatershedRegion.Crop(imgLabel->GetImage()->GetBufferedRegion());
+    xTile.Crop(imgLabel->GetImage()->GetBufferedRegion());
+
     // Get the currently engaged layer
     ImageWrapperBase *context_layer = gid->FindLayer(m_ContextLayerId, false);
     if(!context_layer)
       context_layer = gid->GetMain();
 
-    // Obtain a cast to float pipeline from the layer
-    // TODO: this causes repeated memory allocation - should probably create when entering mode
-    auto *img_source = context_layer->CreateCastToFloatPipeline("WatershedBrush", this->m_Parent->GetId());
-
-    // Precompute the watersheds
-    m_Watershed->PrecomputeWatersheds(
-          img_source,
-          driver->GetSelectedSegmentationLayer()->GetImage(),
-          xTestRegion, to_itkIndex(m_MousePosition), pbs.watershed.smooth_iterations);
+    const itk::Object *source = context_layer->GetImageBase();
+    if(m_Watershed->CanReuseWatersheds(
+         source, source->GetMTime(), xWatershedRegion, pbs.watershed.smooth_iterations))
+      {
+      m_Watershed->SetCenter(to_itkIndex(m_MousePosition), xWatershedRegion);
+      }
+    else
+      {
+      // Obtain a cast to float pipeline from the layer
+      auto *img_source = context_layer->CreateCastToFloatPipeline("WatershedBrush", this->m_Parent->GetId());
+
+      // Precompute the watersheds
+      m_Watershed->PrecomputeWatersheds(
+            img_source,
+            driver->GetSelectedSegmentationLayer()->GetImage(),
+            xTile, to_itkIndex(m_MousePosition), xWatershedRegion,
+            pbs.watershed.smooth_iterations,
+            source, source->GetMTime());
+
+      // Release the casting pipeline
+      context_layer->ReleaseInternalPipeline("WatershedBrush", this->m_Parent->GetId());
+      }
 
+    // Cut the watershed tree at the current level
     m_Watershed->RecomputeWatersheds(pbs.watershed.level);
-
-    // Release the casting pipeline
-    context_layer->ReleaseInternalPipeline("WatershedBrush", this->m_Parent->GetId());
-
     }
 
-  // Shift vector (different depending on whether the brush has odd/even diameter
-  Vector3d offset = ComputeOffset();
-
   // Iterate over the region using
   SegmentationUpdateIterator it_update(
         imgLabel, xTestRegion, drawing_color, drawover);
@@ -325,24 +439,15 @@ PaintbrushModel::ApplyBrush(bool reverse_mode, bool dragging)
     {
     SegmentationUpdateIterator::IndexType idx = it_update.GetIndex();
 
-    Vector3d xDelta = offset + to_double(idx) - to_double(m_MousePosition);
-    Vector3d xDeltaSliceSpace = to_double(
-          m_Parent->GetImageToDisplayTransform()->TransformVector(xDelta));
-
     // Check if the pixel is inside
-    if(!TestInside(xDeltaSliceSpace, pbs))
+    if(!stencil.Contains((int) (idx[0] - m_MousePosition(0)),
+                         (int) (idx[1] - m_MousePosition(1)),
+                         (int) (idx[2] - m_MousePosition(2))))
       continue;
 
     // Check if the pixel is in the watershed
-    if(flagWatershed)
-      {
-      LabelImageWrapper::ImageType::IndexType idxoff;
-      for(unsigned int i = 0; i < 3; i++)
-        idxoff[i] = idx.GetIndex()[i] - xTestRegion.GetIndex().GetIndex()[i];
-
-      if(!m_Watershed->IsPixelInSegmentation(idxoff))
-        continue;
-      }
+    if(flagWatershed && !m_Watershed->IsPixelInSegmentation(idx))
+      continue;
 
     // Paint the pixel
     if(reverse_mode)
@@ -64,12 +64,48 @@ protected:
   // Whether the push operation was in a paintable location
   bool m_IsEngaged;
 
+  // The voxels covered by the brush, relative to the voxel under the mouse.
+  // The brush is convex, so it covers a single run of voxels on each line
+  // along the image x axis
+  struct BrushStencil
+  {
+    // Brush and view settings for which the stencil was computed
+    PaintbrushMode Mode;
+    double Radius;
+    bool Volumetric, Isotropic;
+    unsigned int SliceAxis;
+    Vector3d Offset, Spacing, DisplayAxes[3];
+
+    // Bounding box of the covered voxels
+    Vector3i Start, Size;
+
+    // First and last x offset covered on each line of the bounding box,
+    // with lines ordered by y, then z
+    std::vector<Vector2i> Runs;
+
+    bool Contains(int dx, int dy, int dz) const
+    {
+      dy -= Start(1); dz -= Start(2);
+      if(dy < 0 || dy >= Size(1) || dz < 0 || dz >= Size(2))
+        return false;
+      const Vector2i &run = Runs[dy + Size(1) * dz];
+      return dx >= run(0) && dx <= run(1);
+    }
+  };
+
+  // Stencil of the brush used last, recomputed when the settings change
+  BrushStencil m_Stencil;
+  bool m_StencilValid;
+
   PaintbrushModel();
   virtual ~PaintbrushModel();
 
   Vector3d ComputeOffset();
   void ComputeMousePosition(const Vector3d &xSlice);
 
+  // Get the stencil for the current brush settings
+  const BrushStencil &GetBrushStencil(const PaintbrushSettings &pbs, unsigned int sliceAxis);
+
   bool ApplyBrush(bool reverse_mode, bool dragging);
 
   GenericSliceModel *m_Parent;
@@ -26,6 +26,14 @@ SnakeParameterModel::SnakeParameterModel()
   m_SpeedupFactorModel = wrapGetterSetterPairAsProperty(
         this, &Self::GetSpeedupFactorValueAndRange, &Self::SetSpeedupFactorValue);
 
+  m_MultiResolutionLevelsModel = wrapGetterSetterPairAsProperty(
+        this, &Self::GetMultiResolutionLevelsValueAndRange,
+        &Self::SetMultiResolutionLevelsValue);
+
+  m_MultiResolutionIterationsModel = wrapGetterSetterPairAsProperty(
+        this, &Self::GetMultiResolutionIterationsValueAndRange,
+        &Self::SetMultiResolutionIterationsValue);
+
   m_AdvancedEquationModeModel = NewSimpleConcreteProperty(false);
 
   m_CasellesOrAdvancedModeModel = wrapGetterSetterPairAsProperty(
@@ -372,6 +380,54 @@ SnakeParameterModel
   m_ParametersModel->SetValue(param);
 }
 
+bool
+SnakeParameterModel
+::GetMultiResolutionLevelsValueAndRange(int &value, NumericValueRange<int> *domain)
+{
+  SnakeParameters param = m_ParametersModel->GetValue();
+  value = param.GetMultiResolutionLevels();
+
+  if(domain)
+    domain->Set(1, 4, 1);
+
+  return true;
+}
+
+void
+SnakeParameterModel
+::SetMultiResolutionLevelsValue(int value)
+{
+  SnakeParameters param = m_ParametersModel->GetValue();
+  param.SetMultiResolutionLevels(value);
+  m_ParametersModel->SetValue(param);
+}
+
+bool
+SnakeParameterModel
+::GetMultiResolutionIterationsValueAndRange(int &value, NumericValueRange<int> *domain)
+{
+  // Only relevant when there are coarse levels
+  SnakeParameters param = m_ParametersModel->GetValue();
+  if(param.GetMultiResolutionLevels() <= 1)
+    return false;
+
+  value = param.GetMultiResolutionIterations();
+
+  if(domain)
+    domain->Set(10, 500, 10);
+
+  return true;
+}
+
+void
+SnakeParameterModel
+::SetMultiResolutionIterationsValue(int value)
+{
+  SnakeParameters param = m_ParametersModel->GetValue();
+  param.SetMultiResolutionIterations(value);
+  m_ParametersModel->SetValue(param);
+}
+
 bool SnakeParameterModel::GetCasellesOrAdvancedModeValue()
 {
   return this->GetAdvancedEquationModeModel()->GetValue() || (!this->IsRegionSnake());
@@ -55,6 +55,10 @@ public:
   // Speedup factor
   irisRangedPropertyAccessMacro(SpeedupFactor, double)
 
+  // Number of resolution levels, and iterations run at each coarse level
+  irisRangedPropertyAccessMacro(MultiResolutionLevels, int)
+  irisRangedPropertyAccessMacro(MultiResolutionIterations, int)
+
   // The model for whether the advanced mode (exponents) is on
   irisSimplePropertyAccessMacro(AdvancedEquationMode, bool)
   irisSimplePropertyAccessMacro(CasellesOrAdvancedMode, bool)
@@ -100,6 +104,16 @@ protected:
       double &value, NumericValueRange<double> *domain);
   void SetSpeedupFactorValue(double value);
 
+  SmartPtr<AbstractRangedIntProperty> m_MultiResolutionLevelsModel;
+  bool GetMultiResolutionLevelsValueAndRange(
+      int &value, NumericValueRange<int> *domain);
+  void SetMultiResolutionLevelsValue(int value);
+
+  SmartPtr<AbstractRangedIntProperty> m_MultiResolutionIterationsModel;
+  bool GetMultiResolutionIterationsValueAndRange(
+      int &value, NumericValueRange<int> *domain);
+  void SetMultiResolutionIterationsValue(int value);
+
   SmartPtr<ConcreteSimpleBooleanProperty> m_AdvancedEquationModeModel;
 
   SmartPtr<AbstractSimpleBooleanProperty> m_CasellesOrAdvancedModeModel;
@@ -3,6 +3,9 @@
 #include "IRISApplication.h"
 #include "GenericImageData.h"
 #include "SNAPSegmentationROISettings.h"
+#include "DisplayMappingPolicy.h"
+#include "SNAPEventListenerCallbacks.h"
+#include <itkImage.h>
 
 SnakeROIResampleModel::SnakeROIResampleModel()
 {
@@ -27,6 +30,9 @@ SnakeROIResampleModel::SnakeROIResampleModel()
 
   // Create the interpolation model
   m_InterpolationModeModel = ConcreteInterpolationModeModel::New();
+
+  m_ResampleDimensions.fill(0);
+  m_PreviewVisible = false;
 }
 
 void SnakeROIResampleModel::SetParentModel(GlobalUIModel *model)
@@ -40,6 +46,15 @@ void SnakeROIResampleModel::SetParentModel(GlobalUIModel *model)
 
   // Layer change events too
   Rebroadcast(m_Parent->GetDriver(), LayerChangeEvent(), ModelUpdateEvent());
+
+  // The preview slices follow the cursor
+  AddListener(m_Parent->GetDriver(), CursorUpdateEvent(), this, &Self::OnCursorUpdate);
+}
+
+void SnakeROIResampleModel::OnCursorUpdate()
+{
+  if(m_PreviewVisible)
+    InvokeEvent(ModelUpdateEvent());
 }
 
 void SnakeROIResampleModel::Reset()
@@ -254,3 +269,96 @@ void SnakeROIResampleModel
 }
 
 
+
+SnakeROIResampleModel::DisplaySliceType *
+SnakeROIResampleModel::GetPreviewSlice(unsigned int axis)
+{
+  IRISApplication *app = m_Parent->GetDriver();
+  if(!app->IsMainImageLoaded() || m_ResampleDimensions.min_value() == 0)
+    return NULL;
+
+  ImageWrapperBase *main = app->GetCurrentImageData()->GetMain();
+  SNAPSegmentationROISettings roi = m_ROISettingsModel->GetValue();
+  itk::ImageRegion<3> region = roi.GetROI();
+  InterpolationMethod interp = m_InterpolationModeModel->GetValue();
+
+  // The spacing and origin of the resampled ROI, computed as when the ROI
+  // is extracted from the image
+  Vector3d spacing = app->GetCurrentImageData()->GetImageSpacing();
+  Vector3d newSpacing, newOrigin;
+  Vector3d vIndex = to_double(Vector3i(region.GetIndex()));
+  Vector3d vSize = to_double(Vector3ui(region.GetSize()));
+  for(int d = 0; d < 3; d++)
+    newSpacing[d] = spacing[d] * vSize[d] / m_ResampleDimensions[d];
+
+  const ImageWrapperBase::ImageBaseType *ref = main->GetImageBase();
+  vnl_matrix_fixed<double, 3, 3> dm = ref->GetDirection().GetVnlMatrix();
+  Vector3d origin(ref->GetOrigin().GetDataPointer());
+  newOrigin = origin + dm * (element_product(vIndex - 0.5, spacing) + newSpacing * 0.5);
+
+  // The slice of the resampled ROI containing the cursor
+  Vector3ui cursor = app->GetCursorPosition();
+  double ci = (cursor[axis] - vIndex[axis] + 0.5) * m_ResampleDimensions[axis] / vSize[axis] - 0.5;
+  int slice_index = std::max(0, std::min((int) m_ResampleDimensions[axis] - 1, (int) floor(ci + 0.5)));
+
+  // Reuse the slice if nothing it depends on has changed
+  PreviewSlice &pv = m_Preview[axis];
+  if(pv.Slice && pv.ROI == region && pv.ResampleDimensions == m_ResampleDimensions
+     && pv.Interpolation == interp && pv.SliceIndex == (unsigned int) slice_index
+     && pv.ImageMTime == ref->GetMTime()
+     && pv.DisplayMTime == main->GetDisplayMapping()->GetMTime())
+    return pv.Slice;
+
+  // The in-plane axes of the slice
+  unsigned int ax0 = (axis == 0) ? 1 : 0, ax1 = (axis == 2) ? 1 : 2;
+
+  // Set up the geometry of the slice
+  typedef itk::Image<unsigned char, 3> RefType;
+  RefType::Pointer ref_slice = RefType::New();
+
+  RefType::SpacingType ref_spacing;
+  ref_spacing[0] = newSpacing[ax0];
+  ref_spacing[1] = newSpacing[ax1];
+  ref_spacing[2] = newSpacing[axis];
+  ref_slice->SetSpacing(ref_spacing);
+
+  vnl_matrix_fixed<double, 3, 3> ref_dm;
+  ref_dm.set_column(0, dm.get_column(ax0));
+  ref_dm.set_column(1, dm.get_column(ax1));
+  ref_dm.set_column(2, dm.get_column(axis));
+  RefType::DirectionType ref_direction;
+  ref_direction = ref_dm;
+  ref_slice->SetDirection(ref_direction);
+
+  Vector3d ref_origin = newOrigin + dm.get_column(axis) * (newSpacing[axis] * slice_index);
+  ref_slice->SetOrigin(to_itkPoint(ref_origin));
+
+  RefType::RegionType ref_region;
+  ref_region.SetSize(0, m_ResampleDimensions[ax0]);
+  ref_region.SetSize(1, m_ResampleDimensions[ax1]);
+  ref_region.SetSize(2, 1);
+  ref_slice->SetRegions(ref_region);
+
+  // Sample the main image on the slice. The slicer only interpolates with
+  // nearest neighbor or linear interpolation, see IsPreviewApproximate()
+  pv.Slice = main->SampleArbitraryDisplaySlice(ref_slice, interp == NEAREST_NEIGHBOR);
+  DisplaySliceType::SpacingType slice_spacing;
+  slice_spacing[0] = ref_spacing[0];
+  slice_spacing[1] = ref_spacing[1];
+  pv.Slice->SetSpacing(slice_spacing);
+
+  pv.ROI = region;
+  pv.ResampleDimensions = m_ResampleDimensions;
+  pv.Interpolation = interp;
+  pv.SliceIndex = slice_index;
+  pv.ImageMTime = ref->GetMTime();
+  pv.DisplayMTime = main->GetDisplayMapping()->GetMTime();
+
+  return pv.Slice;
+}
+
+bool SnakeROIResampleModel::IsPreviewApproximate()
+{
+  InterpolationMethod interp = m_InterpolationModeModel->GetValue();
+  return interp != NEAREST_NEIGHBOR && interp != TRILINEAR;
+}
@@ -3,6 +3,7 @@
 
 #include "PropertyModel.h"
 #include "SNAPSegmentationROISettings.h"
+#include "ImageWrapperBase.h"
 
 class GlobalUIModel;
 
@@ -50,6 +51,33 @@ public:
 
   void ApplyPreset(ResamplePreset preset);
 
+  typedef ImageWrapperBase::DisplaySliceType DisplaySliceType;
+
+  /**
+   * Get a preview of the resampled ROI: the slice through the cursor that is
+   * orthogonal to the given image axis, sampled from the main image on the
+   * grid of the resampled ROI using the current dimensions and interpolation
+   * mode, and mapped to display colors. Only the three preview slices are
+   * resampled, rather than the whole ROI. Each slice is kept until the ROI,
+   * the resampling settings, the cursor slice or the main image change, so
+   * repeated calls are cheap. Returns NULL if no image is loaded.
+   */
+  DisplaySliceType *GetPreviewSlice(unsigned int axis);
+
+  /**
+   * Whether the preview differs from the resampled ROI because the selected
+   * interpolation mode is not available for the preview. Cubic and sinc
+   * interpolation are previewed with linear interpolation
+   */
+  bool IsPreviewApproximate();
+
+  /**
+   * Whether the preview is on screen. Cursor moves only update the model
+   * while it is, since the cursor only affects the preview
+   */
+  irisSetMacro(PreviewVisible, bool)
+  irisGetMacro(PreviewVisible, bool)
+
 protected:
 
   SnakeROIResampleModel();
@@ -94,6 +122,23 @@ protected:
   // Model for the interpolation modes
   typedef ConcretePropertyModel<InterpolationMethod, InterpolationModeDomain> ConcreteInterpolationModeModel;
   SmartPtr<ConcreteInterpolationModeModel> m_InterpolationModeModel;
+
+  // A cached preview slice and the settings it was sampled with
+  struct PreviewSlice
+  {
+    SmartPtr<DisplaySliceType> Slice;
+    itk::ImageRegion<3> ROI;
+    Vector3ui ResampleDimensions;
+    InterpolationMethod Interpolation;
+    unsigned int SliceIndex;
+    itk::ModifiedTimeType ImageMTime, DisplayMTime;
+  };
+
+  PreviewSlice m_Preview[3];
+  bool m_PreviewVisible;
+
+  // Rebroadcasts cursor moves while the preview is visible
+  void OnCursorUpdate();
 };
 
 #endif // SNAKEROIRESAMPLEMODEL_H
@@ -105,6 +105,13 @@ SnakeWizardModel::SnakeWizardModel()
         EdgePreprocessingSettingsUpdateEvent(),
         EdgePreprocessingSettingsUpdateEvent());
 
+  m_EdgePreprocessingRecursiveGaussianModel = wrapGetterSetterPairAsProperty(
+        this,
+        &Self::GetEdgePreprocessingRecursiveGaussianValue,
+        &Self::SetEdgePreprocessingRecursiveGaussianValue,
+        EdgePreprocessingSettingsUpdateEvent(),
+        EdgePreprocessingSettingsUpdateEvent());
+
   m_SnakeTypeModel = wrapGetterSetterPairAsProperty(
         this,
         &Self::GetSnakeTypeValueAndRange,
@@ -140,6 +147,13 @@ SnakeWizardModel::SnakeWizardModel()
         nullsetter,
         EvolutionIterationEvent());
 
+  m_EvolutionCheckpointModel = wrapGetterSetterPairAsProperty(
+        this,
+        &Self::GetEvolutionCheckpointValueAndRange,
+        &Self::SetEvolutionCheckpointValue,
+        EvolutionIterationEvent(),
+        EvolutionIterationEvent());
+
   m_NumberOfClustersModel = wrapGetterSetterPairAsProperty(
         this,
         &Self::GetNumberOfClustersValueAndRange,
@@ -1098,6 +1112,26 @@ SnakeWizardModel
   eps->SetRemappingExponent(x);
 }
 
+bool
+SnakeWizardModel
+::GetEdgePreprocessingRecursiveGaussianValue(bool &value)
+{
+  if(!AreEdgePreprocessingModelsActive())
+    return false;
+
+  EdgePreprocessingSettings *eps = m_Driver->GetEdgePreprocessingSettings();
+  value = eps->GetUseRecursiveGaussian();
+  return true;
+}
+
+void
+SnakeWizardModel
+::SetEdgePreprocessingRecursiveGaussianValue(bool value)
+{
+  EdgePreprocessingSettings *eps = m_Driver->GetEdgePreprocessingSettings();
+  eps->SetUseRecursiveGaussian(value);
+}
+
 
 void SnakeWizardModel
 ::EvaluateEdgePreprocessingFunction(unsigned int n, float *x, float *y)
@@ -1133,6 +1167,11 @@ void SnakeWizardModel::ApplyPreprocessing()
   InvokeEvent(ModelUpdateEvent());
 }
 
+bool SnakeWizardModel::UpdateSpeedVolumeFill()
+{
+  return m_Driver->UpdateSpeedVolumeFill();
+}
+
 bool SnakeWizardModel::GetSnakeTypeValueAndRange(
     SnakeType &value, GlobalState::SnakeTypeDomain *range)
 {
@@ -1442,6 +1481,43 @@ int SnakeWizardModel::GetEvolutionIterationValue()
   else return 0;
 }
 
+bool SnakeWizardModel
+::GetEvolutionCheckpointValueAndRange(int &value, NumericValueRange<int> *range)
+{
+  if(!m_Driver->IsSnakeModeActive() ||
+     !m_Driver->GetSNAPImageData()->IsSegmentationActive())
+    return false;
+
+  SNAPImageData *sid = m_Driver->GetSNAPImageData();
+  std::vector<unsigned int> iter = sid->GetLevelSetCheckpointIterations();
+  if(iter.empty())
+    return false;
+
+  // The value is the last checkpoint at or before the current iteration
+  unsigned int elapsed = sid->GetElapsedSegmentationIterations();
+  value = 0;
+  for(size_t i = 0; i < iter.size() && iter[i] <= elapsed; i++)
+    value = (int) i;
+
+  if(range)
+    range->Set(0, (int) iter.size() - 1, 1);
+
+  return true;
+}
+
+void SnakeWizardModel
+::SetEvolutionCheckpointValue(int value)
+{
+  SNAPImageData *sid = m_Driver->GetSNAPImageData();
+  std::vector<unsigned int> iter = sid->GetLevelSetCheckpointIterations();
+  if(value >= 0 && value < (int) iter.size()
+     && iter[value] != sid->GetElapsedSegmentationIterations())
+    {
+    sid->RewindSegmentationToCheckpoint(iter[value]);
+    InvokeEvent(EvolutionIterationEvent());
+    }
+}
+
 ThresholdSettings *SnakeWizardModel::GetThresholdSettings()
 {
   // Get the layer currently being thresholded
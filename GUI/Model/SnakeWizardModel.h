@@ -118,6 +118,7 @@ public:
   irisGetMacro(EdgePreprocessingSigmaModel, AbstractRangedDoubleProperty *)
   irisGetMacro(EdgePreprocessingKappaModel, AbstractRangedDoubleProperty *)
   irisGetMacro(EdgePreprocessingExponentModel, AbstractRangedDoubleProperty *)
+  irisGetMacro(EdgePreprocessingRecursiveGaussianModel, AbstractSimpleBooleanProperty *)
 
 
   // Called when entering proprocessing mode (i.e., back from button page)
@@ -142,6 +143,10 @@ public:
   irisGetMacro(StepSizeModel, AbstractRangedIntProperty *)
   irisGetMacro(EvolutionIterationModel, AbstractSimpleIntProperty *)
 
+  // The model for choosing one of the stored level set checkpoints, indexed
+  // from the oldest; setting it rewinds the evolution to that checkpoint
+  irisGetMacro(EvolutionCheckpointModel, AbstractRangedIntProperty *)
+
   /** Check the state flags above */
   bool CheckState(UIState state);
 
@@ -178,6 +183,10 @@ public:
   /** Perform the preprocessing based on thresholds */
   void ApplyPreprocessing();
 
+  /** Show the speed image filled in the background so far. Returns true
+      while the fill is still running */
+  bool UpdateSpeedVolumeFill();
+
   /** Do some cleanup when the preprocessing dialog closes */
   void CompletePreprocessing();
 
@@ -351,6 +360,10 @@ protected:
   bool GetEdgePreprocessingKappaValueAndRange(double &x, NumericValueRange<double> *range);
   void SetEdgePreprocessingKappaValue(double x);
 
+  SmartPtr<AbstractSimpleBooleanProperty> m_EdgePreprocessingRecursiveGaussianModel;
+  bool GetEdgePreprocessingRecursiveGaussianValue(bool &value);
+  void SetEdgePreprocessingRecursiveGaussianValue(bool value);
+
   SmartPtr<AbstractSnakeTypeModel> m_SnakeTypeModel;
   bool GetSnakeTypeValueAndRange(SnakeType &value, GlobalState::SnakeTypeDomain *range);
   void SetSnakeTypeValue(SnakeType value);
@@ -372,6 +385,10 @@ protected:
   SmartPtr<AbstractSimpleIntProperty> m_EvolutionIterationModel;
   int GetEvolutionIterationValue();
 
+  SmartPtr<AbstractRangedIntProperty> m_EvolutionCheckpointModel;
+  bool GetEvolutionCheckpointValueAndRange(int &value, NumericValueRange<int> *range);
+  void SetEvolutionCheckpointValue(int value);
+
   // Get the threshold settings for the active layer
   ThresholdSettings *GetThresholdSettings();
 
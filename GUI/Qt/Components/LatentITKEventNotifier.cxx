@@ -81,10 +81,14 @@ LatentITKEventNotifierHelper
 #endif
 
   // Register this event
+  bool pending = !m_Bucket.IsEmpty();
   m_Bucket.PutEvent(evt, object);
 
-  // Emit signal
-  emit itkEvent();
+  // Schedule delivery when the first event arrives. Until the main Qt loop
+  // gets to it, further events are only coalesced into the bucket, so that
+  // bursts of events (e.g., when dragging the cursor) do not flood the queue
+  if(!pending)
+    emit itkEvent();
 
   // Call parent's update
   // QApplication::postEvent(this, new QEvent(QEvent::User), 1000);
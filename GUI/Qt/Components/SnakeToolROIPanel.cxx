@@ -19,6 +19,11 @@ SnakeToolROIPanel::SnakeToolROIPanel(QWidget *parent) :
 {
   ui->setupUi(this);
   m_ResampleDialog = new ResampleDialog(this);
+
+  // The resample dialog is not modal, so that the ROI and the cursor can be
+  // adjusted while its preview is shown. Segmentation starts when it is
+  // accepted
+  connect(m_ResampleDialog, SIGNAL(accepted()), SLOT(onResampleDialogAccepted()));
 }
 
 SnakeToolROIPanel::~SnakeToolROIPanel()
@@ -60,16 +65,27 @@ void SnakeToolROIPanel::on_btnAuto_clicked()
   // Handle resampling if requested
   if(ui->chkResample->isChecked())
     {
-    if(m_ResampleDialog->exec() != QDialog::Accepted)
-      return;
-    }
-  else
-    {
-    // Make sure that no interpolation is applied
-    m_Model->GetSnakeROIResampleModel()->Reset();
-    m_Model->GetSnakeROIResampleModel()->Accept();
+    m_ResampleDialog->show();
+    m_ResampleDialog->raise();
+    m_ResampleDialog->activateWindow();
+    return;
     }
 
+  // Make sure that no interpolation is applied
+  m_Model->GetSnakeROIResampleModel()->Reset();
+  m_Model->GetSnakeROIResampleModel()->Accept();
+  this->StartSegmentation();
+}
+
+void SnakeToolROIPanel::onResampleDialogAccepted()
+{
+  // The user may have left the snake ROI tool while the dialog was open
+  if(this->isVisible())
+    this->StartSegmentation();
+}
+
+void SnakeToolROIPanel::StartSegmentation()
+{
   // Switch to crosshairs mode
   m_Model->GetGlobalState()->SetToolbarMode(CROSSHAIRS_MODE);
 
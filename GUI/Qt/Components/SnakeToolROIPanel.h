@@ -25,11 +25,16 @@ private slots:
 
   void on_btnAuto_clicked();
 
+  void onResampleDialogAccepted();
+
 private:
   Ui::SnakeToolROIPanel *ui;
 
   GlobalUIModel *m_Model;
   ResampleDialog *m_ResampleDialog;
+
+  // Open the snake wizard for the current ROI
+  void StartSegmentation();
 };
 
 #endif // SNAKETOOLROIPANEL_H
@@ -157,6 +157,9 @@ SnakeWizardPanel::SnakeWizardPanel(QWidget *parent) :
   m_EvolutionTimer = new QTimer(this);
   connect(m_EvolutionTimer, SIGNAL(timeout()), this, SLOT(idleCallback()));
 
+  m_SpeedFillTimer = new QTimer(this);
+  connect(m_SpeedFillTimer, SIGNAL(timeout()), this, SLOT(speedFillCallback()));
+
   // Hook up the quick label selector
   connect(ui->boxLabelQuickList, SIGNAL(actionTriggered(QAction *)),
           this, SLOT(onClassifyQuickLabelSelection()));
@@ -252,6 +255,7 @@ void SnakeWizardPanel::SetModel(GlobalUIModel *model)
 
   makeCoupling(ui->inStepSize, m_Model->GetStepSizeModel());
   makeCoupling(ui->outIteration, m_Model->GetEvolutionIterationModel());
+  makeCoupling(ui->inCheckpoint, m_Model->GetEvolutionCheckpointModel());
 
   // Activation flags
   /*
@@ -286,6 +290,9 @@ void SnakeWizardPanel::on_btnNextPreproc_clicked()
   // Finish preprocessing
   m_Model->CompletePreprocessing();
 
+  // The rest of the speed image is filled in the background
+  m_SpeedFillTimer->start(250);
+
   // Initialize the model
   m_Model->OnBubbleModeEnter();
 
@@ -354,6 +361,21 @@ void SnakeWizardPanel::idleCallback()
     ui->btnPlay->setChecked(false);
 }
 
+void SnakeWizardPanel::speedFillCallback()
+{
+  // Show the bricks of the speed image computed so far
+  try
+  {
+    if(!m_Model->UpdateSpeedVolumeFill())
+      m_SpeedFillTimer->stop();
+  }
+  catch(std::exception &exc)
+  {
+    m_SpeedFillTimer->stop();
+    QMessageBox::warning(this, "ITK-SNAP", exc.what(), QMessageBox::Ok);
+  }
+}
+
 void SnakeWizardPanel::on_btnSingleStep_clicked()
 {
   // Turn off the play button (will turn off the timer too)
@@ -397,6 +419,12 @@ void SnakeWizardPanel::on_btnRewind_clicked()
   m_Model->RewindEvolution();
 }
 
+void SnakeWizardPanel::on_inCheckpoint_sliderPressed()
+{
+  // Pause the evolution while the user moves between checkpoints
+  ui->btnPlay->setChecked(false);
+}
+
 void SnakeWizardPanel::on_btnEvolutionParameters_clicked()
 {
   m_ParameterDialog->show();
@@ -86,6 +86,8 @@ private slots:
 
   void idleCallback();
 
+  void speedFillCallback();
+
   void on_btnSingleStep_clicked();
 
 
@@ -95,6 +97,8 @@ private slots:
 
   void on_btnRewind_clicked();
 
+  void on_inCheckpoint_sliderPressed();
+
   void on_btnEvolutionParameters_clicked();
 
   void on_btnCancel_clicked();
@@ -133,6 +137,9 @@ private:
 
   QTimer *m_EvolutionTimer;
 
+  // Timer that shows the speed image as it is filled in the background
+  QTimer *m_SpeedFillTimer;
+
   Ui::SnakeWizardPanel *ui;
 };
 
@@ -8,6 +8,7 @@
 #include "QtReporterDelegates.h"
 #include "LatentITKEventNotifier.h"
 #include "SNAPQtCommon.h"
+#include "TraceRecorder.h"
 
 #include <vtkSphereSource.h>
 #include <vtkPolyDataMapper.h>
@@ -42,6 +43,8 @@ public:
 
   virtual void paintGL() override
   {
+    SNAP_TRACE_SCOPE("render", "VTK paintGL");
+
     if(m_NeedRender)
       {
       this->renderWindow()->Render();
@@ -6,7 +6,10 @@
 #include "QtSpinBoxCoupling.h"
 #include "QtCheckBoxCoupling.h"
 #include "QtComboBoxCoupling.h"
+#include "LatentITKEventNotifier.h"
 #include <QMenu>
+#include <QImage>
+#include <QPixmap>
 
 Q_DECLARE_METATYPE(InterpolationMethod)
 
@@ -55,6 +58,64 @@ void ResampleDialog::SetModel(SnakeROIResampleModel *model)
 
   makeCoupling(ui->chkAspect, model->GetFixedAspectRatioModel());
 
+  // Update the preview when the ROI or the resampling settings change
+  LatentITKEventNotifier::connect(
+        model, ModelUpdateEvent(),
+        this, SLOT(onModelUpdate(const EventBucket &)));
+}
+
+void ResampleDialog::onModelUpdate(const EventBucket &)
+{
+  this->UpdatePreview();
+}
+
+void ResampleDialog::showEvent(QShowEvent *event)
+{
+  QDialog::showEvent(event);
+  m_Model->SetPreviewVisible(true);
+  this->UpdatePreview();
+}
+
+void ResampleDialog::hideEvent(QHideEvent *event)
+{
+  QDialog::hideEvent(event);
+  m_Model->SetPreviewVisible(false);
+}
+
+void ResampleDialog::UpdatePreview()
+{
+  // The preview is only computed when it can be seen
+  if(!this->isVisible())
+    return;
+
+  // Tell the user when the preview is not sampled with the selected mode
+  ui->grpPreview->setTitle(m_Model->IsPreviewApproximate()
+                           ? tr("Preview (approximate, linear interpolation)")
+                           : tr("Preview"));
+
+  QLabel *labels[] = { ui->outPreviewX, ui->outPreviewY, ui->outPreviewZ };
+  for(unsigned int i = 0; i < 3; i++)
+    {
+    SnakeROIResampleModel::DisplaySliceType *slice = m_Model->GetPreviewSlice(i);
+    if(!slice)
+      {
+      labels[i]->clear();
+      continue;
+      }
+
+    // Wrap the RGBA slice in a QImage, flipping it so that it appears as
+    // in the slice views
+    auto size = slice->GetBufferedRegion().GetSize();
+    QImage image(reinterpret_cast<const uchar *>(slice->GetBufferPointer()),
+                 size[0], size[1], 4 * size[0], QImage::Format_RGBA8888);
+
+    // Scale the image to fit the label, respecting the voxel spacing
+    QSizeF extent(size[0] * slice->GetSpacing()[0], size[1] * slice->GetSpacing()[1]);
+    extent.scale(QSizeF(labels[i]->minimumSize()), Qt::KeepAspectRatio);
+    labels[i]->setPixmap(QPixmap::fromImage(
+                           image.mirrored(false, true).scaled(extent.toSize(), Qt::IgnoreAspectRatio,
+                                                              Qt::FastTransformation)));
+    }
 }
 
 void ResampleDialog::on_buttonBox_clicked(QAbstractButton *button)
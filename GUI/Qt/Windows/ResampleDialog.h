@@ -8,7 +8,9 @@ class ResampleDialog;
 }
 
 class QAbstractButton;
+class QLabel;
 class SnakeROIResampleModel;
+class EventBucket;
 
 class ResampleDialog : public QDialog
 {
@@ -31,10 +33,21 @@ private slots:
 
   void on_actionSubIso_triggered();
 
+  void onModelUpdate(const EventBucket &bucket);
+
+protected:
+
+  virtual void showEvent(QShowEvent *event);
+
+  virtual void hideEvent(QHideEvent *event);
+
 private:
   Ui::ResampleDialog *ui;
 
   SnakeROIResampleModel *m_Model;
+
+  // Show the preview slices of the resampled region
+  void UpdatePreview();
 };
 
 #endif // RESAMPLEDIALOG_H
@@ -74,6 +74,9 @@ void SnakeParameterDialog::SetModel(SnakeParameterModel *model)
   makeCoupling(ui->inSpeedup, m_Model->GetSpeedupFactorModel());
   makeCoupling(ui->inSpeedupSlider, m_Model->GetSpeedupFactorModel());
 
+  makeCoupling(ui->inMultiResLevels, m_Model->GetMultiResolutionLevelsModel());
+  makeCoupling(ui->inMultiResIterations, m_Model->GetMultiResolutionIterationsModel());
+
   // Couple the advanced checkbox
   makeCoupling(ui->chkAdvanced, m_Model->GetAdvancedEquationModeModel());
 
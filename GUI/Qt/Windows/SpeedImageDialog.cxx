@@ -97,6 +97,7 @@ void SpeedImageDialog::SetModel(SnakeWizardModel *model)
   // Couple the edge preprocessing widgets
   makeCoupling(ui->inEdgeSmoothing, model->GetEdgePreprocessingSigmaModel());
   makeCoupling(ui->inEdgeSmoothingSlider, model->GetEdgePreprocessingSigmaModel());
+  makeCoupling(ui->chkEdgeRecursiveGaussian, model->GetEdgePreprocessingRecursiveGaussianModel());
   makeCoupling(ui->inEdgeKappa, model->GetEdgePreprocessingKappaModel());
   makeCoupling(ui->inEdgeKappaSlider, model->GetEdgePreprocessingKappaModel());
   makeCoupling(ui->inEdgeExponent, model->GetEdgePreprocessingExponentModel());
@@ -4,7 +4,9 @@
 #include "GlobalUIModel.h"
 #include "IRISApplication.h"
 #include "SegmentationStatistics.h"
+#include "LabelImageWrapper.h"
 #include "HistoryManager.h"
+#include "SNAPEventListenerCallbacks.h"
 #include <QStandardItemModel>
 #include <QTableView>
 #include <QHeaderView>
@@ -13,6 +15,8 @@
 #include <SNAPQtCommon.h>
 #include <QtCursorOverride.h>
 #include <SimpleFileDialogWithHistory.h>
+#include <LatentITKEventNotifier.h>
+#include <qtconcurrentrun.h>
 
 StatisticsDialog::StatisticsDialog(QWidget *parent) :
   QDialog(parent),
@@ -23,39 +27,175 @@ StatisticsDialog::StatisticsDialog(QWidget *parent) :
   m_ItemModel = new QStandardItemModel(this);
   ui->tvVolumes->setModel(m_ItemModel);
   m_Stats = new SegmentationStatistics();
+  m_PendingStats = new SegmentationStatistics();
+  m_Cancel = false;
+  m_UpdateRequested = false;
+  m_PendingStride = 1;
+  m_Model = NULL;
+  m_LayerChangeTag = 0;
+
+  m_Watcher = new QFutureWatcher<bool>(this);
+  connect(m_Watcher, SIGNAL(finished()), SLOT(onComputationFinished()));
 }
 
 StatisticsDialog::~StatisticsDialog()
 {
+  // Stop the background computation before deleting its data
+  m_Cancel = true;
+  m_Watcher->waitForFinished();
+  if(m_Model)
+    m_Model->GetDriver()->RemoveObserver(m_LayerChangeTag);
+
   delete ui;
   delete m_Stats;
+  delete m_PendingStats;
 }
 
 void StatisticsDialog::SetModel(GlobalUIModel *model)
 {
   m_Model = model;
+
+  // Keep the statistics up to date as the segmentation is edited
+  LatentITKEventNotifier::connect(
+        model->GetDriver(), SegmentationChangeEvent(),
+        this, SLOT(onModelUpdate(const EventBucket &)));
+  LatentITKEventNotifier::connect(
+        model->GetDriver(), LayerChangeEvent(),
+        this, SLOT(onModelUpdate(const EventBucket &)));
+
+  // Layer changes are also observed directly, since the latent notification
+  // arrives some time after the layers have been changed
+  m_LayerChangeTag = AddListener(
+        model->GetDriver(), LayerChangeEvent(),
+        this, &StatisticsDialog::OnLayerChangeImmediate);
+}
+
+void StatisticsDialog::OnLayerChangeImmediate()
+{
+  if(m_Watcher->isRunning())
+    {
+    m_Cancel = true;
+    m_UpdateRequested = true;
+    m_Watcher->waitForFinished();
+    }
+
+  // Do not keep the images of layers that may be unloaded
+  m_PendingStats->ReleaseSnapshot();
 }
 
 void StatisticsDialog::Activate()
 {
-  QtCursorOverride cursy(Qt::WaitCursor);
-  this->FillTable();
+  this->RequestUpdate();
   this->show();
   this->raise();
   this->activateWindow();
 }
 
-void StatisticsDialog::FillTable()
+void StatisticsDialog::onModelUpdate(const EventBucket &bucket)
+{
+  if(this->isVisible() && m_Model->GetDriver()->IsMainImageLoaded())
+    this->RequestUpdate();
+}
+
+void StatisticsDialog::RequestUpdate()
 {
-  // Compute the segmentation statistics
-  m_Stats->Compute(m_Model->GetDriver());
+  if(m_Watcher->isRunning())
+    {
+    // Stop the current computation; a new one is started when it returns
+    m_Cancel = true;
+    m_UpdateRequested = true;
+    }
+  else
+    {
+    this->StartComputation();
+    }
+}
+
+void StatisticsDialog::StartComputation()
+{
+  m_UpdateRequested = false;
+
+  // Take the snapshot of the data on the main thread
+  m_PendingStats->Initialize(m_Model->GetDriver());
+
+  // For large images, first compute approximate statistics from a subset
+  // of the image lines, and then refine them
+  itk::ImageRegion<3> region =
+      m_Model->GetDriver()->GetSelectedSegmentationLayer()->GetImage()->GetBufferedRegion();
+  m_PendingStride = region.GetNumberOfPixels() > 0x1000000 ? 8 : 1;
+
+  this->RunPendingComputation();
+}
 
+void StatisticsDialog::RunPendingComputation()
+{
+  m_Cancel = false;
+  SegmentationStatistics *stats = m_PendingStats;
+  unsigned int stride = m_PendingStride;
+  std::atomic<bool> *cancel = &m_Cancel;
+  m_Watcher->setFuture(QtConcurrent::run([stats, stride, cancel]() {
+    return stats->ComputeFromSnapshot(stride, cancel);
+    }));
+}
+
+void StatisticsDialog::onComputationFinished()
+{
+  // Start over if the data changed during the computation
+  if(m_UpdateRequested && this->isVisible())
+    {
+    this->StartComputation();
+    return;
+    }
+
+  // The computation was cancelled without a new request
+  if(!m_Watcher->result())
+    return;
+
+  // Publish the statistics. Only the pending statistics hold a snapshot
+  *m_Stats = *m_PendingStats;
+  m_Stats->ReleaseSnapshot();
+  this->FillTable();
+
+  // Refine approximate statistics
+  if(m_PendingStride > 1)
+    {
+    m_PendingStride = 1;
+    this->RunPendingComputation();
+    }
+}
+
+void StatisticsDialog::FinishComputation()
+{
+  // If the shown statistics are not final, stop the background computation
+  // and compute the exact statistics right away
+  if(m_Watcher->isRunning() || m_UpdateRequested || m_Stats->IsApproximate())
+    {
+    QtCursorOverride cursy(Qt::WaitCursor);
+    m_Cancel = true;
+    m_Watcher->waitForFinished();
+
+    if(m_UpdateRequested || !m_PendingStats->HasSnapshot())
+      m_PendingStats->Initialize(m_Model->GetDriver());
+    m_UpdateRequested = false;
+    m_PendingStride = 1;
+
+    m_PendingStats->ComputeFromSnapshot(1);
+    *m_Stats = *m_PendingStats;
+    m_Stats->ReleaseSnapshot();
+    this->FillTable();
+    }
+}
+
+void StatisticsDialog::FillTable()
+{
   // Fill out the item model
   m_ItemModel->clear();
 
   // Set the column names
   QStringList header;
-  header << "Label Name" << "Voxel Count" << "Volume (mm3)";
+  header << "Label Name"
+         << (m_Stats->IsApproximate() ? "Voxel Count (estimate)" : "Voxel Count")
+         << "Volume (mm3)";
   m_ItemModel->setHorizontalHeaderLabels(header);
 
   const std::vector<std::string> &cols = m_Stats->GetImageStatisticsColumns();
@@ -110,13 +250,14 @@ void StatisticsDialog::FillTable()
 
 void StatisticsDialog::on_btnUpdate_clicked()
 {
-  QtCursorOverride cursy(Qt::WaitCursor);
-  this->FillTable();
+  this->RequestUpdate();
 }
 
 
 void StatisticsDialog::on_btnCopy_clicked()
 {
+  this->FinishComputation();
+
   std::ostringstream oss;
   m_Stats->Export(oss, "\t", *m_Model->GetDriver()->GetColorLabelTable());
   QString tsv = QString::fromStdString(oss.str());
@@ -140,6 +281,7 @@ void StatisticsDialog::on_btnExport_clicked()
   // Open the labels from the selection
   if(selection.length())
     {
+    this->FinishComputation();
     try
       {
       std::ofstream fout(selection.toUtf8());
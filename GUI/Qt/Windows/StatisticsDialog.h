@@ -2,6 +2,8 @@
 #define STATISTICSDIALOG_H
 
 #include <QDialog>
+#include <QFutureWatcher>
+#include <atomic>
 
 namespace Ui {
 class StatisticsDialog;
@@ -10,6 +12,7 @@ class StatisticsDialog;
 class GlobalUIModel;
 class QStandardItemModel;
 class SegmentationStatistics;
+class EventBucket;
 
 class StatisticsDialog : public QDialog
 {
@@ -31,6 +34,10 @@ private slots:
 
   void on_btnExport_clicked();
 
+  void onModelUpdate(const EventBucket &bucket);
+
+  void onComputationFinished();
+
 private:
   Ui::StatisticsDialog *ui;
 
@@ -38,6 +45,41 @@ private:
   QStandardItemModel *m_ItemModel;
   SegmentationStatistics *m_Stats;
 
+  // Statistics computed in the background. They are copied to m_Stats and
+  // shown in the table when the computation finishes
+  SegmentationStatistics *m_PendingStats;
+  QFutureWatcher<bool> *m_Watcher;
+
+  // Flag that stops the background computation
+  std::atomic<bool> m_Cancel;
+
+  // Whether an update was requested while the computation was running
+  bool m_UpdateRequested;
+
+  // Stride of the background computation (1 for exact statistics)
+  unsigned int m_PendingStride;
+
+  // Tag of the observer that stops the computation when layers change
+  unsigned long m_LayerChangeTag;
+
+  // Stop the background computation as soon as the layers change, instead
+  // of when the latent notification arrives, so that it does not go on
+  // reading layers whose images may have been replaced
+  void OnLayerChangeImmediate();
+
+  // Request the statistics to be recomputed. Requests made while the
+  // statistics are being computed are merged into one
+  void RequestUpdate();
+
+  // Start computing the statistics for the current segmentation
+  void StartComputation();
+
+  // Run the computation with the current stride in the background
+  void RunPendingComputation();
+
+  // Make sure that m_Stats holds exact statistics
+  void FinishComputation();
+
   void FillTable();
 };
 
@@ -18,6 +18,8 @@
 #include "GenericSliceModel.h"
 #include "GlobalUIModel.h"
 #include "IRISImageData.h"
+#include "TraceRecorder.h"
+#include "itksys/SystemTools.hxx"
 
 #include "itkEventObject.h"
 #include "itkObject.h"
@@ -166,6 +168,7 @@ void usage(const char *progname)
   cout << "   --css file           : Read stylesheet from file." << endl;
   cout << "   --opengl MAJOR MINOR : Set the OpenGL major and minor version. Experimental." << endl;
   cout << "   --testgl             : Diagnose OpenGL/VTK issues." << endl;
+  cout << "   --trace FILE         : Record performance trace, save as Chrome trace JSON to FILE." << endl;
   cout << "Platform-Specific Options:" << endl;
 #if QT_VERSION < 0x050000
 #ifdef Q_WS_X11
@@ -219,6 +222,9 @@ public:
   // Number of threads
   int nThreads;
 
+  // Performance trace output file
+  std::string fnTrace;
+
   // GUI scaling
   int nDevicePixelRatio;
 
@@ -342,6 +348,9 @@ int parse(int argc, char *argv[], CommandLineRequest &argdata)
   // TODO: use and document this
   parser.AddOption("--threads", 1);
 
+  // Performance tracing
+  parser.AddOption("--trace", 1);
+
   // Current working directory
   parser.AddOption("--cwd", 1);
 
@@ -548,6 +557,11 @@ int parse(int argc, char *argv[], CommandLineRequest &argdata)
   if(parseResult.IsOptionPresent("--threads"))
     argdata.nThreads = atoi(parseResult.GetOptionParameter("--threads"));
 
+  // Trace file, made absolute in case the working directory changes
+  if(parseResult.IsOptionPresent("--trace"))
+    argdata.fnTrace = itksys::SystemTools::CollapseFullPath(
+          DecodeFilename(parseResult.GetOptionParameter("--trace")));
+
   // Number of threads
   if(parseResult.IsOptionPresent("--scale"))
     argdata.nDevicePixelRatio = atoi(parseResult.GetOptionParameter("--scale"));
@@ -688,6 +702,10 @@ int main(int argc, char *argv[])
     itk::MultiThreaderBase::SetGlobalMaximumNumberOfThreads(argdata.nThreads);
     }
 
+  // Start performance tracing
+  if(argdata.fnTrace.size())
+    TraceRecorder::Start(argdata.fnTrace);
+
   // Turn off ITK and VTK warning windows
   itk::Object::GlobalWarningDisplayOff();
   vtkObject::GlobalWarningDisplayOff();
@@ -1069,6 +1087,10 @@ int main(int argc, char *argv[])
     if(testingEngine)
       delete testingEngine;
 
+    // Write the performance trace
+    if(argdata.fnTrace.size() && !TraceRecorder::Stop())
+      std::cerr << "Failed to write trace file " << argdata.fnTrace << std::endl;
+
     // Exit with the return code
     std::cerr << "Return code : " << rc << std::endl;
     return rc;
@@ -110,9 +110,6 @@ public:
     Vector3d text_width_slice =
         m_Model->MapWindowOffsetToSliceOffset(Vector2d(96 * vppr , 12 * vppr));
 
-    // Get the list of annotations
-    const ImageAnnotationData *adata = m_AnnotationModel->GetAnnotations();
-
     // set line and point drawing parameters
     // glPointSize(3 * vppr);
     // glLineWidth(1.0 * vppr);
@@ -154,134 +151,132 @@ public:
         }
       } // Current line valid
 
-    // Draw each annotation
-    for(auto it = adata->GetAnnotations().begin(); it != adata->GetAnnotations().end(); ++it)
+    // Draw each annotation visible in this slice
+    ImageAnnotationData::AnnotationVector visible;
+    m_AnnotationModel->GetVisibleAnnotations(visible);
+    for(auto *a : visible)
       {
-      if(m_AnnotationModel->IsAnnotationVisible(*it))
+      // Draw all the line segments
+      auto *lsa = dynamic_cast<annot::LineSegmentAnnotation *>(a);
+      if(lsa)
         {
-        // Draw all the line segments
-        auto *lsa = dynamic_cast<annot::LineSegmentAnnotation *>(it->GetPointer());
-        if(lsa)
-          {
-          // Draw the line
-          Vector3d p1 = m_Model->MapImageToSlice(lsa->GetSegment().first);
-          Vector3d p2 = m_Model->MapImageToSlice(lsa->GetSegment().second);
+        // Draw the line
+        Vector3d p1 = m_Model->MapImageToSlice(lsa->GetSegment().first);
+        Vector3d p2 = m_Model->MapImageToSlice(lsa->GetSegment().second);
 
-          Vector3d color = lsa->GetColor();
+        Vector3d color = lsa->GetColor();
 
-          painter->GetPen()->SetColorF(color.data_block());
-          painter->GetPen()->SetOpacityF(alpha);
-          painter->GetPen()->SetWidth(3 * vppr);
-          painter->DrawPoint((p1[0] + p2[0]) * 0.5, (p1[1] + p2[1]) * 0.5);
+        painter->GetPen()->SetColorF(color.data_block());
+        painter->GetPen()->SetOpacityF(alpha);
+        painter->GetPen()->SetWidth(3 * vppr);
+        painter->DrawPoint((p1[0] + p2[0]) * 0.5, (p1[1] + p2[1]) * 0.5);
 
-          painter->GetPen()->SetWidth(1 * vppr);
-          painter->GetPen()->SetLineType(vtkPen::SOLID_LINE);
-          painter->DrawLine(p1[0], p1[1], p2[0], p2[1]);
+        painter->GetPen()->SetWidth(1 * vppr);
+        painter->GetPen()->SetLineType(vtkPen::SOLID_LINE);
+        painter->DrawLine(p1[0], p1[1], p2[0], p2[1]);
 
-          if(lsa->GetSelected()
-             && m_AnnotationModel->IsAnnotationModeActive()
-             && m_AnnotationModel->GetAnnotationMode() == ANNOTATION_SELECT)
-            {
-            this->DrawSelectionHandle(painter, p1);
-            this->DrawSelectionHandle(painter, p2);
-            }
+        if(lsa->GetSelected()
+           && m_AnnotationModel->IsAnnotationModeActive()
+           && m_AnnotationModel->GetAnnotationMode() == ANNOTATION_SELECT)
+          {
+          this->DrawSelectionHandle(painter, p1);
+          this->DrawSelectionHandle(painter, p2);
+          }
+
+        // Draw length or angle
+        if(m_AnnotationModel->IsDrawingRuler())
+          {
+          // Draw angle:
+          // Compute the dot product and no need for the third components that are zeros
+          double angle = m_AnnotationModel->GetAngleWithCurrentLine(lsa);
+          std::ostringstream oss_angle;
+          oss_angle << std::setprecision(3) << angle << "°";
+
+          Vector3d line_center = m_AnnotationModel->GetAnnotationCenter(lsa);
+
+          // Draw the angle text
+          this->DrawStringRect(painter, oss_angle.str(),
+                               line_center[0] + text_offset_slice[0],
+                               line_center[1] + text_offset_slice[1],
+                               text_width_slice[0], text_width_slice[1],
+                               font_info, -1, 1, lsa->GetColor(), alpha);
+          }
+        else
+          {
+          this->DrawLineLength(painter, p1, p2, lsa->GetColor(),alpha);
+          }
+        }
 
-          // Draw length or angle
-          if(m_AnnotationModel->IsDrawingRuler())
+      auto *lma = dynamic_cast<annot::LandmarkAnnotation *>(a);
+      if(lma)
+        {
+        // Get the head and tail coordinate in slice units
+        Vector3d xHeadSlice, xTailSlice;
+        m_AnnotationModel->GetLandmarkArrowPoints(lma->GetLandmark(), xHeadSlice, xTailSlice);
+
+        std::string text = lma->GetLandmark().Text;
+        Vector3d color = lma->GetColor();
+
+        // Draw the annotation line segment
+        painter->GetPen()->SetColorF(color.data_block());
+        painter->GetPen()->SetOpacityF(alpha);
+        painter->GetPen()->SetWidth(1 * vppr);
+        painter->GetPen()->SetLineType(vtkPen::SOLID_LINE);
+        painter->DrawLine(xHeadSlice[0], xHeadSlice[1], xTailSlice[0], xTailSlice[1]);
+
+        if(lma->GetSelected() && m_AnnotationModel->IsAnnotationModeActive() &&
+           m_AnnotationModel->GetAnnotationMode() == ANNOTATION_SELECT)
+          {
+          this->DrawSelectionHandle(painter, xHeadSlice);
+          this->DrawSelectionHandle(painter, xTailSlice);
+          }
+
+        // Text box size in slice coordinate units
+        Vector2d xTextSizeSlice(
+              AbstractRenderer::GetPlatformSupport()->MeasureTextWidth(text.c_str(), font_info),
+              font_info.pixel_size * GetVPPR());
+
+        // How to position the text
+        double xbox, ybox;
+        int align_horiz, align_vert;
+        if(fabs(lma->GetLandmark().Offset[0]) >= fabs(lma->GetLandmark().Offset[1]))
+          {
+          align_vert = 0;
+          ybox = xTailSlice[1] - xTextSizeSlice[1] / 2;
+          if(lma->GetLandmark().Offset[0] >= 0)
             {
-            // Draw angle:
-            // Compute the dot product and no need for the third components that are zeros
-            double angle = m_AnnotationModel->GetAngleWithCurrentLine(lsa);
-            std::ostringstream oss_angle;
-            oss_angle << std::setprecision(3) << angle << "°";
-
-            Vector3d line_center = m_AnnotationModel->GetAnnotationCenter(lsa);
-
-            // Draw the angle text
-            this->DrawStringRect(painter, oss_angle.str(),
-                                 line_center[0] + text_offset_slice[0],
-                                 line_center[1] + text_offset_slice[1],
-                                 text_width_slice[0], text_width_slice[1],
-                                 font_info, -1, 1, lsa->GetColor(), alpha);
+            align_horiz = -1;
+            xbox = xTailSlice[0];
             }
           else
             {
-            this->DrawLineLength(painter, p1, p2, lsa->GetColor(),alpha);
+            align_horiz = 1;
+            xbox = xTailSlice[0] - xTextSizeSlice[0];
             }
           }
-
-        auto *lma = dynamic_cast<annot::LandmarkAnnotation *>(it->GetPointer());
-        if(lma)
+        else
           {
-          // Get the head and tail coordinate in slice units
-          Vector3d xHeadSlice, xTailSlice;
-          m_AnnotationModel->GetLandmarkArrowPoints(lma->GetLandmark(), xHeadSlice, xTailSlice);
-
-          std::string text = lma->GetLandmark().Text;
-          Vector3d color = lma->GetColor();
-
-          // Draw the annotation line segment
-          painter->GetPen()->SetColorF(color.data_block());
-          painter->GetPen()->SetOpacityF(alpha);
-          painter->GetPen()->SetWidth(1 * vppr);
-          painter->GetPen()->SetLineType(vtkPen::SOLID_LINE);
-          painter->DrawLine(xHeadSlice[0], xHeadSlice[1], xTailSlice[0], xTailSlice[1]);
-
-          if(lma->GetSelected() && m_AnnotationModel->IsAnnotationModeActive() &&
-             m_AnnotationModel->GetAnnotationMode() == ANNOTATION_SELECT)
-            {
-            this->DrawSelectionHandle(painter, xHeadSlice);
-            this->DrawSelectionHandle(painter, xTailSlice);
-            }
-
-          // Text box size in slice coordinate units
-          Vector2d xTextSizeSlice(
-                AbstractRenderer::GetPlatformSupport()->MeasureTextWidth(text.c_str(), font_info),
-                font_info.pixel_size * GetVPPR());
-
-          // How to position the text
-          double xbox, ybox;
-          int align_horiz, align_vert;
-          if(fabs(lma->GetLandmark().Offset[0]) >= fabs(lma->GetLandmark().Offset[1]))
+          align_horiz = 0;
+          xbox = xTailSlice[0] - xTextSizeSlice[0] / 2;
+          if(lma->GetLandmark().Offset[1] >= 0)
             {
-            align_vert = 0;
-            ybox = xTailSlice[1] - xTextSizeSlice[1] / 2;
-            if(lma->GetLandmark().Offset[0] >= 0)
-              {
-              align_horiz = -1;
-              xbox = xTailSlice[0];
-              }
-            else
-              {
-              align_horiz = 1;
-              xbox = xTailSlice[0] - xTextSizeSlice[0];
-              }
+            align_vert = -1;
+            ybox = xTailSlice[1];
             }
           else
             {
-            align_horiz = 0;
-            xbox = xTailSlice[0] - xTextSizeSlice[0] / 2;
-            if(lma->GetLandmark().Offset[1] >= 0)
-              {
-              align_vert = -1;
-              ybox = xTailSlice[1];
-              }
-            else
-              {
-              align_vert = 1;
-              ybox = xTailSlice[1] - xTextSizeSlice[1];
-              }
+            align_vert = 1;
+            ybox = xTailSlice[1] - xTextSizeSlice[1];
             }
-
-          // Draw the text at the right location
-          font_info = rps->MakeFont(12 * GetVPPR(),
-                                    AbstractRendererPlatformSupport::SANS);
-          this->DrawStringRect(painter, text,
-                               xbox, ybox,
-                               xTextSizeSlice[0], xTextSizeSlice[1], font_info,
-                               align_horiz, align_vert, lma->GetColor(), alpha);
           }
 
+        // Draw the text at the right location
+        font_info = rps->MakeFont(12 * GetVPPR(),
+                                  AbstractRendererPlatformSupport::SANS);
+        this->DrawStringRect(painter, text,
+                             xbox, ybox,
+                             xTextSizeSlice[0], xTextSizeSlice[1], font_info,
+                             align_horiz, align_vert, lma->GetColor(), alpha);
         }
       }
 
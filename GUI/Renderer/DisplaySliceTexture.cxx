@@ -0,0 +1,161 @@
+#include "DisplaySliceTexture.h"
+#include "TraceRecorder.h"
+
+#include <vtkObjectFactory.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkRenderer.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtkTextureObject.h>
+#include <vtk_glew.h>
+#include <algorithm>
+#include <cstring>
+
+vtkStandardNewMacro(DisplaySliceTexture);
+
+DisplaySliceTexture::DisplaySliceTexture()
+{
+  m_SliceData = vtkSmartPointer<vtkImageData>::New();
+  m_SliceMTime = 0;
+  m_DirtyRegion[0] = m_DirtyRegion[1] = 0;
+  m_DirtyRegion[2] = m_DirtyRegion[3] = -1;
+  this->SetInputData(m_SliceData);
+}
+
+DisplaySliceTexture::~DisplaySliceTexture()
+{
+}
+
+void DisplaySliceTexture::SetDisplaySlice(DisplaySliceType *slice)
+{
+  if(m_Slice != slice)
+    {
+    m_Slice = slice;
+    m_SliceMTime = 0;
+    this->Modified();
+    }
+}
+
+bool DisplaySliceTexture::UpdateSliceData()
+{
+  if(!m_Slice)
+    return false;
+
+  // Bring the slice up to date. If the pipeline did not execute, the pixels
+  // are the same as last time
+  m_Slice->Update();
+  if(m_Slice->GetMTime() == m_SliceMTime)
+    return false;
+  m_SliceMTime = m_Slice->GetMTime();
+
+  int w = (int) m_Slice->GetBufferedRegion().GetSize()[0];
+  int h = (int) m_Slice->GetBufferedRegion().GetSize()[1];
+  if(w == 0 || h == 0)
+    return false;
+
+  const unsigned char *src =
+      reinterpret_cast<const unsigned char *>(m_Slice->GetBufferPointer());
+  size_t row_bytes = 4 * (size_t) w;
+
+  // If the slice dimensions changed, the whole texture is replaced
+  int *dim = m_SliceData->GetDimensions();
+  if(dim[0] != w || dim[1] != h || !m_SliceData->GetPointData()->GetScalars())
+    {
+    m_SliceData->SetDimensions(w, h, 1);
+    m_SliceData->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    memcpy(m_SliceData->GetScalarPointer(), src, row_bytes * h);
+    m_SliceData->Modified();
+    m_DirtyRegion[0] = m_DirtyRegion[1] = 0;
+    m_DirtyRegion[2] = m_DirtyRegion[3] = -1;
+    return true;
+    }
+
+  // Find the rectangle where the new slice differs from the uploaded one,
+  // copying the changed part of every row along the way
+  unsigned char *dst = static_cast<unsigned char *>(m_SliceData->GetScalarPointer());
+  bool changed = false;
+  for(int y = 0; y < h; y++)
+    {
+    const unsigned char *p_src = src + y * row_bytes;
+    unsigned char *p_dst = dst + y * row_bytes;
+    if(memcmp(p_src, p_dst, row_bytes) == 0)
+      continue;
+
+    int x0 = 0, x1 = w - 1;
+    while(memcmp(p_src + 4 * x0, p_dst + 4 * x0, 4) == 0)
+      ++x0;
+    while(memcmp(p_src + 4 * x1, p_dst + 4 * x1, 4) == 0)
+      --x1;
+    memcpy(p_dst + 4 * x0, p_src + 4 * x0, 4 * (x1 - x0 + 1));
+
+    if(m_DirtyRegion[0] > m_DirtyRegion[2])
+      {
+      m_DirtyRegion[0] = x0; m_DirtyRegion[1] = y;
+      m_DirtyRegion[2] = x1; m_DirtyRegion[3] = y;
+      }
+    else
+      {
+      m_DirtyRegion[0] = std::min(m_DirtyRegion[0], x0);
+      m_DirtyRegion[2] = std::max(m_DirtyRegion[2], x1);
+      m_DirtyRegion[3] = y;
+      }
+    changed = true;
+    }
+
+  return changed;
+}
+
+bool DisplaySliceTexture::UploadDirtyRegion(vtkRenderer *ren)
+{
+  // The partial upload is only possible into a texture that has already been
+  // loaded from the current image data in this render window
+  vtkTextureObject *tobj = this->GetTextureObject();
+  int *dim = m_SliceData->GetDimensions();
+  if(!tobj || !tobj->GetHandle()
+     || tobj->GetContext() != ren->GetRenderWindow()
+     || (int) tobj->GetWidth() != dim[0] || (int) tobj->GetHeight() != dim[1]
+     || this->LoadTime < m_SliceData->GetMTime()
+     || this->LoadTime < this->GetMTime()
+     || this->GetPremultipliedAlpha())
+    return false;
+
+  // Large changes are cheaper to upload in one go
+  int rw = m_DirtyRegion[2] - m_DirtyRegion[0] + 1;
+  int rh = m_DirtyRegion[3] - m_DirtyRegion[1] + 1;
+  if(2 * rw * rh > dim[0] * dim[1])
+    return false;
+
+  SNAP_TRACE_SCOPE("render", "DisplaySliceTexture partial upload");
+
+  const unsigned char *data =
+      static_cast<unsigned char *>(m_SliceData->GetScalarPointer(
+                                     m_DirtyRegion[0], m_DirtyRegion[1], 0));
+  tobj->Activate();
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, dim[0]);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, m_DirtyRegion[0], m_DirtyRegion[1], rw, rh,
+                  GL_RGBA, GL_UNSIGNED_BYTE, data);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  tobj->Deactivate();
+  return true;
+}
+
+void DisplaySliceTexture::Load(vtkRenderer *ren)
+{
+  if(this->UpdateSliceData() && m_DirtyRegion[0] <= m_DirtyRegion[2])
+    {
+    // Pixels changed within a rectangle: send just that rectangle to the
+    // GPU if possible, otherwise have the parent class reload everything
+    if(!this->UploadDirtyRegion(ren))
+      m_SliceData->Modified();
+    }
+
+  m_DirtyRegion[0] = m_DirtyRegion[1] = 0;
+  m_DirtyRegion[2] = m_DirtyRegion[3] = -1;
+
+  // The parent class reloads the whole texture only if the image data or the
+  // texture settings were modified since the last load
+  SNAP_TRACE_SCOPE("render", "DisplaySliceTexture::Load");
+  Superclass::Load(ren);
+}
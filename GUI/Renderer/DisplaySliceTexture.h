@@ -0,0 +1,67 @@
+#ifndef DISPLAYSLICETEXTURE_H
+#define DISPLAYSLICETEXTURE_H
+
+#include <vtkOpenGLTexture.h>
+#include <vtkSmartPointer.h>
+#include "ImageWrapperBase.h"
+
+class vtkImageData;
+
+/**
+ * @brief A texture that displays the RGBA display slice of an image layer.
+ *
+ * The texture pulls the display slice from the ITK pipeline when it is
+ * loaded for rendering, and only sends pixels to the GPU when the contents
+ * of the slice have actually changed. The slice is compared to a copy of the
+ * last uploaded slice, so that pipeline updates that produce an identical
+ * slice (e.g., a label slice being regenerated after an edit on another
+ * slice) cost no texture upload at all. When the change is confined to a
+ * small rectangle, as is the case for brush and polygon edits, only that
+ * rectangle is uploaded.
+ */
+class DisplaySliceTexture : public vtkOpenGLTexture
+{
+public:
+  vtkTypeMacro(DisplaySliceTexture, vtkOpenGLTexture)
+  static DisplaySliceTexture *New();
+
+  typedef ImageWrapperBase::DisplaySliceType DisplaySliceType;
+
+  /** Set the display slice shown by this texture */
+  void SetDisplaySlice(DisplaySliceType *slice);
+
+  /** Update the slice and upload the changed pixels before rendering */
+  void Load(vtkRenderer *ren) override;
+
+protected:
+
+  DisplaySliceTexture();
+  virtual ~DisplaySliceTexture();
+
+  // Bring the slice up to date and copy the changed pixels into the image
+  // data. Returns false if nothing changed since the last call
+  bool UpdateSliceData();
+
+  // Upload the dirty rectangle to an existing texture object
+  bool UploadDirtyRegion(vtkRenderer *ren);
+
+  // The display slice
+  SmartPtr<DisplaySliceType> m_Slice;
+
+  // Copy of the slice that is the input to the texture, i.e., the pixels that
+  // have been (or are about to be) uploaded to the GPU
+  vtkSmartPointer<vtkImageData> m_SliceData;
+
+  // The modified time of the display slice when it was last copied
+  itk::ModifiedTimeType m_SliceMTime;
+
+  // Rectangle of pixels changed since the last upload, as x0, y0, x1, y1
+  // (inclusive). Empty when x0 > x1
+  int m_DirtyRegion[4];
+
+private:
+  DisplaySliceTexture(const DisplaySliceTexture &) = delete;
+  void operator=(const DisplaySliceTexture &) = delete;
+};
+
+#endif // DISPLAYSLICETEXTURE_H
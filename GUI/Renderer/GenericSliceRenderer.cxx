@@ -38,6 +38,8 @@
 #include "LayerAssociation.h"
 #include "SliceWindowCoordinator.h"
 #include "PaintbrushSettingsModel.h"
+#include "TraceRecorder.h"
+#include "DisplaySliceTexture.h"
 #include <itkImageLinearConstIteratorWithIndex.h>
 
 
@@ -62,7 +64,6 @@
 #include <vtkMapper2D.h>
 #include <vtkPolyDataMapper2D.h>
 #include <itkRGBAPixel.h>
-#include "SNAPExportITKToVTK.h"
 #include "TexturedRectangleAssembly.h"
 #include "GenericSliceContextItem.h"
 
@@ -303,6 +304,8 @@ void GenericSliceRenderer::UpdateSceneAppearanceSettings()
 
 void GenericSliceRenderer::OnUpdate()
 {
+  SNAP_TRACE_SCOPE("render", "GenericSliceRenderer::OnUpdate");
+
   // Make sure the model has been updated first
   m_Model->Update();
 
@@ -419,16 +422,9 @@ void GenericSliceRenderer::UpdateLayerAssemblies()
       // Get the pointer to the display slice
       auto *ds = layer->GetDisplaySlice(m_Model->GetId()).GetPointer();
 
-      // Configure the texture pipeline
-      SmartPtr<LayerTextureAssembly::VTKExporter> exporter = LayerTextureAssembly::VTKExporter::New();
-      exporter->SetInput(ds);
-
-      lta->m_Exporter = exporter.GetPointer();
-      lta->m_Importer = vtkSmartPointer<vtkImageImport>::New();
-      ConnectITKExporterToVTKImporter(exporter.GetPointer(), lta->m_Importer);
-
-      lta->m_Texture = vtkSmartPointer<vtkTexture>::New();
-      lta->m_Texture->SetInputConnection(lta->m_Importer->GetOutputPort());
+      // Configure the texture, which pulls the slice when rendered
+      lta->m_Texture = vtkSmartPointer<DisplaySliceTexture>::New();
+      lta->m_Texture->SetDisplaySlice(ds);
 
       // Get the corners of the slice
       auto sc = m_Model->GetSliceCorners();
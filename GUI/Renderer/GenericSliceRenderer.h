@@ -35,7 +35,6 @@
 #include <LayerAssociation.h>
 
 class vtkTexture;
-class vtkImageImport;
 class vtkActor;
 class vtkActor2D;
 class vtkPolyData;
@@ -47,12 +46,9 @@ class vtkContextScene;
 class vtkContextTransform;
 class vtkAbstractContextItem;
 
-namespace itk {
-template <typename TInputImage> class VTKImageExport;
-}
-
 class TexturedRectangleAssembly;
 class TexturedRectangleAssembly2D;
+class DisplaySliceTexture;
 
 /**
  * @brief The parent class for overlays that are placed on top of the image
@@ -183,16 +179,9 @@ protected:
   public:
     irisITKObjectMacro(GenericSliceRenderer::LayerTextureAssembly, AbstractModel)
 
-    typedef itk::VTKImageExport<ImageWrapperBase::DisplaySliceType> VTKExporter;
-
-    // Exporter from ITK to VTK
-    SmartPtr<itk::Object> m_Exporter;
-
-    // Importer from ITK to VTK
-    vtkSmartPointer<vtkImageImport> m_Importer;
-
-    // Texture algorithm
-    vtkSmartPointer<vtkTexture> m_Texture;
+    // Texture holding the display slice. It tracks changes to the slice and
+    // only uploads the pixels that changed
+    vtkSmartPointer<DisplaySliceTexture> m_Texture;
 
     // Actor used to draw the layer
     vtkSmartPointer<TexturedRectangleAssembly> m_ImageRect;
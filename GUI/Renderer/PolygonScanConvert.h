@@ -36,59 +36,122 @@
 #define __PolygonScanConvert_h_
 
 #include "itkImage.h"
-#include "itkImageRegionIteratorWithIndex.h"
-#include <vtkPolygon.h>
-#include <vtkPoints.h>
-#include <vtkSmartPointer.h>
-#include <vtkContourTriangulator.h>
-
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * Scan conversion of a closed polygon into a 2D image. Pixels whose centers
+ * lie inside of the polygon are set to 1 and the rest to 0. The polygon may
+ * be concave and self-intersecting; inside is decided by the even-odd rule
+ * by default, or by the non-zero winding rule.
+ *
+ * The polygon is filled one row at a time: the x coordinates where the edges
+ * cross the center line of the row are sorted, and the pixels between pairs
+ * of crossings are filled as spans. The cost is proportional to the number
+ * of edges plus the number of crossings, not to the number of pixels times
+ * the number of vertices.
+ */
 template<class TImage, class TVertex, class TVertexIterator>
 class PolygonScanConvert
 {
 public:
-  static void RasterizeFilled(TVertexIterator first, unsigned int n, TImage *image)
+  static void RasterizeFilled(TVertexIterator first, unsigned int n, TImage *image,
+                              bool nonzero_winding = false)
   {
-    // Create a vtkPolygol
-    vtkSmartPointer<vtkPolygon> polygon = vtkPolygon::New();
-
-
-    // typedef itk::PolyLineParametricPath<TImage::ImageDimension> InputPolylineType;
-    // typedef typename InputPolylineType::VertexType VertexType;
-    // SmartPtr<InputPolylineType> path = InputPolylineType::New();
-
-    // Get the image region
-    // itk::ImageRegion<2> region = image->GetBufferedRegion();
-
-    // Add points to the path
+    typedef typename TImage::PixelType PixelType;
+
+    // Image extents
+    typename TImage::RegionType region = image->GetBufferedRegion();
+    long x0 = region.GetIndex()[0], y0 = region.GetIndex()[1];
+    long nx = region.GetSize()[0], ny = region.GetSize()[1];
+    image->FillBuffer(0);
+    if(n < 3 || nx == 0 || ny == 0)
+      return;
+
+    // Copy the vertices
+    std::vector<double> vx(n), vy(n);
     for (unsigned int i = 0; i < n; ++i, ++first)
-      polygon->GetPoints()->InsertNextPoint((*first)[0], (*first)[1], 0.0);
-
-    // Get the raw point data
-    double *point_data =
-        static_cast<double*>(polygon->GetPoints()->GetData()->GetVoidPointer(0));
-    int np = polygon->GetPoints()->GetNumberOfPoints();
-
-    // Get the normal and bounds
-    double normal[3];
-    polygon->ComputeNormal(np, point_data, normal);
+      {
+      vx[i] = (*first)[0];
+      vy[i] = (*first)[1];
+      }
 
-    double bounds[6];
-    polygon->GetPoints()->GetBounds(bounds);
+    // An edge covers the rows whose center line y + 0.5 is in [ymin, ymax).
+    // Edges are sorted into buckets by the first row they cover.
+    struct Edge { double x, dxdy; long last_row; int dir; };
+    std::vector<std::vector<Edge> > buckets(ny);
+    for (unsigned int i = 0; i < n; i++)
+      {
+      unsigned int j = (i + 1) % n;
+      if (vy[i] == vy[j])
+        continue;
+
+      int dir = vy[i] < vy[j] ? 1 : -1;
+      double xa = dir > 0 ? vx[i] : vx[j], ya = dir > 0 ? vy[i] : vy[j];
+      double xb = dir > 0 ? vx[j] : vx[i], yb = dir > 0 ? vy[j] : vy[i];
+
+      long r0 = (long) std::ceil(ya - 0.5) - y0;
+      long r1 = (long) std::ceil(yb - 0.5) - 1 - y0;
+      if (r1 < 0 || r0 >= ny)
+        continue;
+      r0 = std::max(r0, 0L);
+      r1 = std::min(r1, ny - 1);
+      if (r0 > r1)
+        continue;
+
+      Edge e;
+      e.dxdy = (xb - xa) / (yb - ya);
+      e.x = xa + (y0 + r0 + 0.5 - ya) * e.dxdy;
+      e.last_row = r1;
+      e.dir = dir;
+      buckets[r0].push_back(e);
+      }
 
-    // Go through the image and test each point
-    typedef itk::ImageRegionIteratorWithIndex<TImage> IteratorType;
-    IteratorType it(image, image->GetBufferedRegion());
-    for(; !it.IsAtEnd(); ++it)
+    // Process the rows, keeping a list of the edges crossing the current row
+    std::vector<Edge> active;
+    std::vector<std::pair<double, int> > crossings;
+    PixelType *buffer = image->GetBufferPointer();
+    for (long r = 0; r < ny; r++)
       {
-      double x[3];
-      x[0] = it.GetIndex()[0] + 0.5;
-      x[1] = it.GetIndex()[1] + 0.5;
-      x[2] = 0.0;
-
-      if(polygon->PointInPolygon(x, np, point_data, bounds, normal) == 1)
-        it.Set(1);
-      else
-        it.Set(0);
+      active.insert(active.end(), buckets[r].begin(), buckets[r].end());
+      if (active.empty())
+        continue;
+
+      crossings.clear();
+      for (const Edge &e : active)
+        crossings.push_back(std::make_pair(e.x, e.dir));
+      std::sort(crossings.begin(), crossings.end());
+
+      // Fill the spans between the crossings that are inside
+      PixelType *row = buffer + r * nx;
+      int winding = 0;
+      for (size_t k = 0; k + 1 < crossings.size(); k++)
+        {
+        winding += nonzero_winding ? crossings[k].second : 1;
+        bool inside = nonzero_winding ? winding != 0 : (winding & 1) != 0;
+        if (!inside)
+          continue;
+
+        // Pixels with centers in [xa, xb)
+        long c0 = std::max((long) std::ceil(crossings[k].first - 0.5) - x0, 0L);
+        long c1 = std::min((long) std::ceil(crossings[k + 1].first - 0.5) - x0, nx);
+        for (long c = c0; c < c1; c++)
+          row[c] = 1;
+        }
+
+      // Advance the edges to the next row and drop the ones that end
+      size_t m = 0;
+      for (size_t k = 0; k < active.size(); k++)
+        {
+        if (active[k].last_row > r)
+          {
+          active[m] = active[k];
+          active[m].x += active[m].dxdy;
+          m++;
+          }
+        }
+      active.resize(m);
       }
   }
 };
@@ -96,4 +159,3 @@ public:
 
 
 #endif
-
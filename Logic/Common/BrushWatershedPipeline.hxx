@@ -5,6 +5,9 @@
 #include "itkGradientAnisotropicDiffusionImageFilter.h"
 #include "itkGradientMagnitudeImageFilter.h"
 #include "itkWatershedImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMinimumMaximumImageCalculator.h"
+#include <algorithm>
 
 
 // TODO: move this into a separate file!!!!
@@ -26,24 +29,48 @@ public:
     gmf->SetInput(adf->GetOutput());
     wf = WFType::New();
     wf->SetInput(gmf->GetOutput());
+    source = NULL;
+    source_mtime = 0;
+    smoothing = 0;
+    tile_depth = 0;
+    level_scale = 1.0;
     }
 
+  /**
+   * Check whether the watersheds computed by the last call to
+   * PrecomputeWatersheds() can be used for a brush covering the given region.
+   * The source and its modification time identify the greyscale image.
+   */
+  bool CanReuseWatersheds(
+    const itk::Object *source,
+    itk::ModifiedTimeType source_mtime,
+    const itk::ImageRegion<3> &region,
+    size_t smoothing_iter) const
+    {
+    return this->source == source && this->source_mtime == source_mtime
+        && this->smoothing == smoothing_iter && this->region.IsInside(region);
+    }
+
+  /**
+   * Run the smoothing, gradient and watershed filters over a tile of the
+   * image. The watershed merge tree is kept, so that calls to
+   * SetCenter() and RecomputeWatersheds() for brushes within the tile
+   * do not need to run the filters again.
+   */
   void PrecomputeWatersheds(
     const FloatImageType *grey,
     const LabelImageType *label,
     itk::ImageRegion<3> region,
     itk::Index<3> vcenter,
-    size_t smoothing_iter)
+    const itk::ImageRegion<3> &brush,
+    size_t smoothing_iter,
+    const itk::Object *source = NULL,
+    itk::ModifiedTimeType source_mtime = 0)
     {
     this->region = region;
-
-    // Get the offset of vcenter in the region
-    if(region.IsInside(vcenter))
-      for(size_t d = 0; d < 3; d++)
-        this->vcenter[d] = vcenter[d] - region.GetIndex()[d];
-    else
-      for(size_t d = 0; d < 3; d++)
-        this->vcenter[d] = region.GetSize()[d] / 2;
+    this->source = source;
+    this->source_mtime = source_mtime;
+    this->smoothing = smoothing_iter;
 
     // Create a backup of the label image
     LROIType::Pointer lroi = LROIType::New();
@@ -61,21 +88,70 @@ public:
     // Set the initial level to lowest possible - to get all watersheds
     wf->SetLevel(1.0);
     wf->Update();
+
+    // The watershed filter measures the level as a fraction of the depth
+    // of the gradient magnitude over the whole tile
+    typedef itk::MinimumMaximumImageCalculator<FloatImageType> RangeType;
+    RangeType::Pointer range = RangeType::New();
+    range->SetImage(gmf->GetOutput());
+    range->Compute();
+    tile_depth = range->GetMaximum() - range->GetMinimum();
+
+    this->SetCenter(vcenter, brush);
+    }
+
+  /**
+   * Set the voxel whose watershed is painted by the brush, and the region
+   * covered by the brush. The level passed to RecomputeWatersheds() is
+   * relative to the depth of the gradient magnitude within the brush, as
+   * it was when the watersheds were computed for the brush alone, so the
+   * same level gives the same segmentation wherever the tile was computed.
+   */
+  void SetCenter(itk::Index<3> vcenter, itk::ImageRegion<3> brush)
+    {
+    level_scale = 1.0;
+    if(brush.Crop(region) && tile_depth > 0)
+      {
+      for(size_t d = 0; d < 3; d++)
+        brush.SetIndex(d, brush.GetIndex(d) - region.GetIndex(d));
+      itk::ImageRegionConstIterator<FloatImageType> it(gmf->GetOutput(), brush);
+      float gmin = it.Get(), gmax = it.Get();
+      for(; !it.IsAtEnd(); ++it)
+        {
+        gmin = std::min(gmin, it.Get());
+        gmax = std::max(gmax, it.Get());
+        }
+      level_scale = (gmax - gmin) / tile_depth;
+      }
+
+    // Get the offset of vcenter in the region
+    if(region.IsInside(vcenter))
+      for(size_t d = 0; d < 3; d++)
+        this->vcenter[d] = vcenter[d] - region.GetIndex()[d];
+    else
+      for(size_t d = 0; d < 3; d++)
+        this->vcenter[d] = region.GetSize()[d] / 2;
+
+    wctr = wf->GetOutput()->GetPixel(this->vcenter);
     }
 
   void RecomputeWatersheds(double level)
     {
-    // Reupdate the filter with new level
-    wf->SetLevel(level);
+    // Reupdate the filter with new level. If only the level changed, the
+    // filter just cuts the merge tree computed earlier at the new level
+    wf->SetLevel(level * level_scale);
     wf->Update();
+    wctr = wf->GetOutput()->GetPixel(vcenter);
     }
 
-  bool IsPixelInSegmentation(IndexType idx)
+  /** Check whether a voxel, given as an index in the image, is in the same
+   * watershed as the center voxel */
+  bool IsPixelInSegmentation(const IndexType &idx)
     {
-    // Get the watershed ID at the center voxel
-    unsigned long wctr = wf->GetOutput()->GetPixel(vcenter);
-    unsigned long widx = wf->GetOutput()->GetPixel(idx);
-    return wctr == widx;
+    IndexType idxoff;
+    for(size_t d = 0; d < 3; d++)
+      idxoff[d] = idx[d] - region.GetIndex()[d];
+    return wf->GetOutput()->GetPixel(idxoff) == wctr;
     }
 
 private:
@@ -93,6 +169,19 @@ private:
   itk::ImageRegion<3> region;
   LabelImageType::Pointer lsrc;
   itk::Index<3> vcenter;
+
+  // Watershed ID at the center voxel
+  itk::IdentifierType wctr;
+
+  // The image and settings from which the watersheds were computed
+  const itk::Object *source;
+  itk::ModifiedTimeType source_mtime;
+  size_t smoothing;
+
+  // Depth of the gradient magnitude over the tile, and the ratio of the
+  // depth within the current brush to it
+  double tile_depth;
+  double level_scale;
 };
 
 
@@ -0,0 +1,60 @@
+#include "LabelInterpolationSlicePlan.h"
+#include <algorithm>
+
+void LabelInterpolationSlicePlan::Initialize(const std::vector<bool> &key)
+{
+  m_Incremental = false;
+  m_Key = key;
+  m_Keep.clear();
+  m_Clear.clear();
+  m_Changed.assign(key.size(), true);
+  m_Ranges.clear();
+}
+
+void LabelInterpolationSlicePlan::InitializeIncremental(
+    const std::vector<unsigned long> &signature,
+    const std::vector<unsigned long> &count,
+    const std::vector<unsigned long> &last_signature,
+    const std::vector<bool> &last_key)
+{
+  // The slices drawn before and the slices edited since are the ones
+  // between which to interpolate. The others were filled in last time.
+  size_t n_slices = signature.size();
+  m_Incremental = true;
+  m_Key.assign(n_slices, false);
+  m_Changed.assign(n_slices, false);
+  for(size_t s = 0; s < n_slices; s++)
+    {
+    m_Changed[s] = signature[s] != last_signature[s];
+    m_Key[s] = count[s] > 0 && (last_key[s] || m_Changed[s]);
+    }
+  m_Keep = m_Key;
+  m_Clear.assign(n_slices, false);
+  m_Ranges.clear();
+}
+
+void LabelInterpolationSlicePlan::ComputeRanges(bool merge_adjoining)
+{
+  m_Ranges.clear();
+  long prev = -1;
+  for(long s = 0; s < (long) m_Key.size(); s++)
+    {
+    if(!m_Key[s])
+      continue;
+
+    // Only the gaps next to a changed slice are interpolated
+    if(prev >= 0 && s - prev > 1
+       && std::find(m_Changed.begin() + prev, m_Changed.begin() + s + 1, true) != m_Changed.begin() + s + 1)
+      {
+      if(merge_adjoining && m_Ranges.size() && m_Ranges.back().second >= prev)
+        m_Ranges.back().second = s;
+      else
+        m_Ranges.push_back(SliceRange(prev, s));
+
+      // What was filled in last time between the key slices is replaced
+      if(m_Incremental)
+        std::fill(m_Clear.begin() + prev + 1, m_Clear.begin() + s, true);
+      }
+    prev = s;
+    }
+}
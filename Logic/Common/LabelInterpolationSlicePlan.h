@@ -0,0 +1,71 @@
+#ifndef LABELINTERPOLATIONSLICEPLAN_H
+#define LABELINTERPOLATIONSLICEPLAN_H
+
+#include <utility>
+#include <vector>
+
+/**
+ * This class works out which slices of a label to interpolate along an axis.
+ * The label is interpolated in the gaps between the key slices, i.e., the
+ * slices drawn by the user. After an earlier interpolation of the same label,
+ * the key slices are those that were drawn before or have been edited since,
+ * and only the gaps next to the edited slices are interpolated again. The
+ * slices are indexed from the start of the image along the axis.
+ */
+class LabelInterpolationSlicePlan
+{
+public:
+
+  /** A range of slices, first and last inclusive, interpolated together */
+  typedef std::pair<long, long> SliceRange;
+
+  /** Plan the interpolation between the given key slices */
+  void Initialize(const std::vector<bool> &key);
+
+  /**
+   * Plan the interpolation after an earlier one, given the checksum and the
+   * voxel count of the label in each slice, and the checksums and key slices
+   * recorded after the earlier interpolation
+   */
+  void InitializeIncremental(const std::vector<unsigned long> &signature,
+                             const std::vector<unsigned long> &count,
+                             const std::vector<unsigned long> &last_signature,
+                             const std::vector<bool> &last_key);
+
+  /**
+   * Split the slices into the gaps between consecutive key slices that need
+   * to be interpolated. Gaps that share a key slice are merged into a single
+   * range if requested, e.g., so that the random forest is trained on all of
+   * the slices drawn around them.
+   */
+  void ComputeRanges(bool merge_adjoining);
+
+  /** Whether the plan updates an earlier interpolation */
+  bool IsIncremental() const { return m_Incremental; }
+
+  /** The key slices */
+  const std::vector<bool> &GetKeySlices() const { return m_Key; }
+
+  /**
+   * The slices kept as input to the interpolation. Empty unless incremental,
+   * in which case the slices filled in earlier are left out.
+   */
+  const std::vector<bool> &GetKeepSlices() const { return m_Keep; }
+
+  /**
+   * The slices where what the earlier interpolation filled in is replaced.
+   * Empty unless incremental.
+   */
+  const std::vector<bool> &GetClearSlices() const { return m_Clear; }
+
+  /** The ranges to interpolate, in order along the axis */
+  const std::vector<SliceRange> &GetRanges() const { return m_Ranges; }
+
+protected:
+
+  bool m_Incremental = false;
+  std::vector<bool> m_Key, m_Keep, m_Clear, m_Changed;
+  std::vector<SliceRange> m_Ranges;
+};
+
+#endif // LABELINTERPOLATIONSLICEPLAN_H
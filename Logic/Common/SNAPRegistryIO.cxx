@@ -119,6 +119,12 @@ SNAPRegistryIO
     registry["SolverAlgorithm"].GetEnum(
       m_EnumMapSolver,defaultSet.GetSolver()));
 
+  out.SetMultiResolutionLevels(
+    registry["MultiResolutionLevels"][defaultSet.GetMultiResolutionLevels()]);
+
+  out.SetMultiResolutionIterations(
+    registry["MultiResolutionIterations"][defaultSet.GetMultiResolutionIterations()]);
+
   return out;
 }
 
@@ -141,6 +147,8 @@ SNAPRegistryIO
   registry["AdvectionSpeedExponent"] << in.GetAdvectionSpeedExponent();
   registry["SnakeType"].PutEnum(m_EnumMapSnakeType,in.GetSnakeType());
   registry["SolverAlgorithm"].PutEnum(m_EnumMapSolver,in.GetSolver());
+  registry["MultiResolutionLevels"] << in.GetMultiResolutionLevels();
+  registry["MultiResolutionIterations"] << in.GetMultiResolutionIterations();
 }
 
 /** Read mesh options from a registry */
@@ -39,15 +39,23 @@
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 
 using namespace std;
 
 
-// TODO: improve efficiency by using filters to integrate label intensities
 void
 SegmentationStatistics
 ::Compute(IRISApplication *app)
+{
+  this->Initialize(app);
+  this->ComputeFromSnapshot(1);
+}
+
+void
+SegmentationStatistics
+::Initialize(IRISApplication *app)
 {
   // Get the current image data
   GenericImageData *id = app->GetCurrentImageData();
@@ -55,11 +63,9 @@ SegmentationStatistics
   // Get the selected segmentation layer
   LabelImageWrapper *seg = app->GetSelectedSegmentationLayer();
 
-  // A list of image sources
-  vector<ScalarImageWrapperBase *> layers;
-
-  // Clear the list of column names
+  // Clear the list of column names and layers
   m_ImageStatisticsColumnNames.clear();
+  m_Layers.clear();
 
   // Find all the images available for statistics computation
   for(LayerIterator it(id, MAIN_ROLE | OVERLAY_ROLE); !it.IsAtEnd(); ++it)
@@ -68,7 +74,7 @@ SegmentationStatistics
     if(lscalar)
       {
       m_ImageStatisticsColumnNames.push_back(lscalar->GetNickname());
-      layers.push_back(lscalar);
+      m_Layers.push_back(lscalar);
       }
     else
       {
@@ -80,60 +86,74 @@ SegmentationStatistics
         if(lvector->GetNumberOfComponents() > 1)
           oss << " [" << j << "]";
         m_ImageStatisticsColumnNames.push_back(oss.str());
-        layers.push_back(lvector->GetScalarRepresentation(
+        m_Layers.push_back(lvector->GetScalarRepresentation(
               SCALAR_REP_COMPONENT, j));
         }
       }
     }
 
-  // Get the number of gray image layers
-  size_t ngray = layers.size();
+  // Copy the segmentation. This only copies the runs, so it is cheap
+  // compared to the computation of the statistics
+  const LabelImageType *img = seg->GetImage();
+  m_Segmentation = LabelImageType::New();
+  m_Segmentation->CopyInformation(img);
+  m_Segmentation->SetRegions(img->GetBufferedRegion());
+  m_Segmentation->Allocate();
+  std::copy(img->GetBuffer()->GetBufferPointer(),
+            img->GetBuffer()->GetBufferPointer() + img->GetBuffer()->GetPixelContainer()->Size(),
+            m_Segmentation->GetBuffer()->GetBufferPointer());
 
-  // Clear and initialize the statistics table
-  m_Stats.clear();
+  // The gray layers are sampled at the time point of the segmentation
+  m_TimePoint = app->GetCursorTimePoint();
 
-  // Start the label image iteration
-  LabelImageWrapper::ConstIterator itLabel = seg->GetImageConstIterator();
-  itk::ImageRegion<3> region = itLabel.GetRegion();
+  // Compute the size of a voxel, in mm^3
+  const double *spacing = 
+    id->GetMain()->GetImageBase()->GetSpacing().GetDataPointer();
+  m_VoxelVolume = spacing[0] * spacing[1] * spacing[2];
+}
 
-  // Cache the entry to avoid many calls to std::map
-  LabelType runLabel = 0;
-  Entry *cachedEntry = &m_Stats[runLabel];
-  cachedEntry->resize(ngray);
-  itk::Index<3> runStart = itLabel.GetIndex();
-  long runLength = 0;
+bool
+SegmentationStatistics
+::ComputeFromSnapshot(unsigned int stride, const std::atomic<bool> *cancel)
+{
+  assert(m_Segmentation && stride > 0);
+
+  // Get the number of gray image layers
+  size_t ngray = m_Layers.size();
+
+  // The statistics are computed into a new table
+  EntryMap stats;
 
-  // Aggregate the statistical data
-  for( ; !itLabel.IsAtEnd(); ++itLabel, ++runLength)
+  // Visit the runs of the sampled lines of the segmentation
+  const LabelImageType::BufferType *buffer = m_Segmentation->GetBuffer();
+  itk::ImageRegion<3> region = m_Segmentation->GetBufferedRegion();
+  size_t ny = region.GetSize(1), n_lines = ny * region.GetSize(2), n_sampled = 0;
+  for(size_t line = 0; line < n_lines; line += stride, n_sampled++)
     {
-    // Get the label and the corresponding entry (use cache to reduce time wasted in std::map)
-    LabelType label = itLabel.Value();
-    if(label != runLabel)
-      {
-      // Record the statistics from the last run
-      this->RecordRunLength(ngray, layers, region, runStart, runLength, cachedEntry);
+    if(cancel && *cancel)
+      return false;
 
-      // Change the cached entry
-      runLabel = label;
-      cachedEntry = &m_Stats[runLabel];
-      if(cachedEntry->count == 0)
-        cachedEntry->resize(ngray);
+    LabelImageType::BufferType::IndexType lineIndex;
+    lineIndex[0] = region.GetIndex(1) + (itk::IndexValueType) (line % ny);
+    lineIndex[1] = region.GetIndex(2) + (itk::IndexValueType) (line / ny);
+    const LabelImageType::RLLine &rl = buffer->GetPixel(lineIndex);
 
-      runStart = itLabel.GetIndex();
-      runLength = 0;
+    itk::Index<3> runStart = {{ region.GetIndex(0), lineIndex[0], lineIndex[1] }};
+    for(size_t i = 0; i < rl.size(); i++)
+      {
+      auto ins = stats.insert(std::make_pair(rl[i].second, Entry()));
+      if(ins.second)
+        ins.first->second.resize(ngray);
+      this->RecordRunLength(region, runStart, rl[i].first, &ins.first->second);
+      runStart[0] += rl[i].first;
       }
     }
 
-  // Record the statistics from the last run
-  this->RecordRunLength(ngray, layers, region, runStart, runLength, cachedEntry);
+  // Scale the counts to the whole image
+  double scale = n_sampled ? n_lines / (double) n_sampled : 1.0;
 
-  // Compute the size of a voxel, in mm^3
-  const double *spacing = 
-    id->GetMain()->GetImageBase()->GetSpacing().GetDataPointer();
-  double volVoxel = spacing[0] * spacing[1] * spacing[2];
-  
   // Compute the mean and standard deviation
-  for(EntryMap::iterator it = m_Stats.begin(); it != m_Stats.end(); ++it)
+  for(EntryMap::iterator it = stats.begin(); it != stats.end(); ++it)
     {
     Entry &entry = it->second;
     for(size_t j = 0; j < ngray; j++)
@@ -143,25 +163,43 @@ SegmentationStatistics
       double stdev = sqrt((entry.sumsq[j] - entry.sum[j] * mean) / (entry.nvalid[j] - 1));
 
       // Map with scale and shift
-      entry.mean[j] = layers[j]->GetNativeIntensityMapping()->MapInternalToNative(mean);
+      entry.mean[j] = m_Layers[j]->GetNativeIntensityMapping()->MapInternalToNative(mean);
 
       // Map with just shift
-      entry.stdev[j] = layers[j]->GetNativeIntensityMapping()->MapGradientMagnitudeToNative(stdev);
+      entry.stdev[j] = m_Layers[j]->GetNativeIntensityMapping()->MapGradientMagnitudeToNative(stdev);
       }
-    entry.volume_mm3 = entry.count * volVoxel;
+    if(stride > 1)
+      entry.count = (unsigned long) (entry.count * scale + 0.5);
+    entry.volume_mm3 = entry.count * m_VoxelVolume;
     }
+
+  m_Stats.swap(stats);
+  m_Approximate = stride > 1;
+
+  // The exact statistics are final, so the snapshot is no longer needed
+  if(!m_Approximate)
+    this->ReleaseSnapshot();
+
+  return true;
+}
+
+void
+SegmentationStatistics
+::ReleaseSnapshot()
+{
+  m_Segmentation = NULL;
+  m_Layers.clear();
 }
 
 void SegmentationStatistics
-::RecordRunLength(size_t ngray, vector<ScalarImageWrapperBase *> &layers,
-                  itk::ImageRegion<3> &region, itk::Index<3> &runStart,
+::RecordRunLength(const itk::ImageRegion<3> &region, const itk::Index<3> &runStart,
                   long runLength, Entry *cachedEntry)
 {
   // Record the statistics from the last run
-  for(size_t j = 0; j < ngray; j++)
+  for(size_t j = 0; j < m_Layers.size(); j++)
     {
-    layers[j]->GetRunLengthIntensityStatistics(
-          region, runStart, runLength,
+    m_Layers[j]->GetRunLengthIntensityStatistics(
+          region, runStart, runLength, m_TimePoint,
           cachedEntry->nvalid.data_block() + j,
           cachedEntry->sum.data_block() + j,
           cachedEntry->sumsq.data_block() + j);
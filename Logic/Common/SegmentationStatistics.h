@@ -36,10 +36,13 @@
 #define __SegmentationStatistics_h_
 
 #include "SNAPCommon.h"
+#include "RLEImage.h"
+#include "ImageWrapperBase.h"
 #include <vector>
 #include <string>
 #include <iostream>
 #include <map>
+#include <atomic>
 
 class GenericImageData;
 class ColorLabelTable;
@@ -84,6 +87,40 @@ public:
 
   /* Compute statistics from a segmentation image */
   void Compute(IRISApplication *app);
+
+  /*
+   * Prepare for computing the statistics outside of the main thread. This
+   * takes a snapshot of the segmentation and keeps references to the image
+   * layers and the current time point. The computation is not affected by
+   * later edits, by layers being unloaded or by time point changes. It must
+   * be stopped before the images of a layer it uses are replaced.
+   */
+  void Initialize(IRISApplication *app);
+
+  /*
+   * Compute the statistics from the snapshot taken by Initialize(). This can
+   * be called from a background thread. With a stride greater than one, only
+   * every stride-th image line is visited and the voxel counts are scaled
+   * up, which gives approximate values quickly. The computation stops early
+   * and returns false if the cancel flag is raised. The snapshot is kept for
+   * a later pass, unless the exact statistics were computed, in which case it
+   * is released.
+   */
+  bool ComputeFromSnapshot(unsigned int stride, const std::atomic<bool> *cancel = NULL);
+
+  /* Whether there is a snapshot to compute the statistics from */
+  bool HasSnapshot() const
+    { return m_Segmentation.IsNotNull(); }
+
+  /*
+   * Release the snapshot, so that it no longer keeps the copy of the
+   * segmentation and the images of the layers in memory
+   */
+  void ReleaseSnapshot();
+
+  /* Whether the statistics were computed from a subsample of the image */
+  bool IsApproximate() const
+    { return m_Approximate; }
   
   /* Export to a text file using legacy format */
   void ExportLegacy(std::ostream &oss, const ColorLabelTable &clt);
@@ -102,17 +139,25 @@ public:
 
 private:
 
+  typedef RLEImage<LabelType> LabelImageType;
+
   // Label statistics
   EntryMap m_Stats;
+  bool m_Approximate = false;
 
   // Column information
   std::vector<std::string> m_ImageStatisticsColumnNames;
-  
+
+  // Data captured by Initialize(): a copy of the segmentation, the image
+  // layers sampled for each column, their time point and the voxel volume
+  SmartPtr<LabelImageType> m_Segmentation;
+  std::vector< SmartPtr<ScalarImageWrapperBase> > m_Layers;
+  unsigned int m_TimePoint = 0;
+  double m_VoxelVolume = 0;
+
   void RecordRunLength(
-      size_t ngray,
-      std::vector<ScalarImageWrapperBase *> &layers,
-      itk::ImageRegion<3> &region,
-      itk::Index<3> &runStart,
+      const itk::ImageRegion<3> &region,
+      const itk::Index<3> &runStart,
       long runLength,
       Entry *cachedEntry);
 };
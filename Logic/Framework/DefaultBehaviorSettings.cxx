@@ -33,4 +33,8 @@ DefaultBehaviorSettings::DefaultBehaviorSettings()
   // Paintbrush defaults
   m_PaintbrushDefaultInitialSizeModel = NewRangedProperty("PaintbrushDefaultInitialSize", 8, 1, 10000, 1);
   m_PaintbrushDefaultMaximumSizeModel = NewRangedProperty("PaintbrushDefaultMaximumSize", 40, 10, 10000, 1);
+
+  // Derived quantities of multi-component images
+  m_PrecomputeDerivedQuantitiesModel = NewSimpleProperty("PrecomputeDerivedQuantities", true);
+  m_DerivedQuantityMemoryBudgetModel = NewRangedProperty("DerivedQuantityMemoryBudget", 512, 0, 65536, 64);
 }
@@ -43,6 +43,11 @@ public:
   irisRangedPropertyAccessMacro(PaintbrushDefaultInitialSize, int)
   irisRangedPropertyAccessMacro(PaintbrushDefaultMaximumSize, int)
 
+  // Whether the magnitude, maximum and mean of multi-component images are
+  // precomputed, and the memory they may use per image, in megabytes
+  irisSimplePropertyAccessMacro(PrecomputeDerivedQuantities, bool)
+  irisRangedPropertyAccessMacro(DerivedQuantityMemoryBudget, int)
+
 protected:
 
   // Default behaviors
@@ -67,6 +72,10 @@ protected:
   SmartPtr<ConcreteRangedIntProperty> m_PaintbrushDefaultInitialSizeModel;
   SmartPtr<ConcreteRangedIntProperty> m_PaintbrushDefaultMaximumSizeModel;
 
+  // Derived quantities of multi-component images
+  SmartPtr<ConcreteSimpleBooleanProperty> m_PrecomputeDerivedQuantitiesModel;
+  SmartPtr<ConcreteRangedIntProperty> m_DerivedQuantityMemoryBudgetModel;
+
   // Constructor
   DefaultBehaviorSettings();
 };
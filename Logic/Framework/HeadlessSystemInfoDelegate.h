@@ -0,0 +1,42 @@
+#ifndef HEADLESSSYSTEMINFODELEGATE_H
+#define HEADLESSSYSTEMINFODELEGATE_H
+
+#include "UIReporterDelegates.h"
+#include "itksys/SystemTools.hxx"
+
+/**
+ * System information delegate for using the logic layer without a GUI, e.g.,
+ * in command-line tools, tests and benchmarks. There are no resources to
+ * load, and user data lives in the directory given to the constructor.
+ */
+class HeadlessSystemInfoDelegate : public SystemInfoDelegate
+{
+public:
+
+  HeadlessSystemInfoDelegate(const char *argv0, const std::string &data_dir)
+    : m_ExecutableName(argv0), m_DataDir(data_dir) {}
+
+  virtual std::string GetApplicationDirectory()
+    { return itksys::SystemTools::GetFilenamePath(m_ExecutableName); }
+
+  virtual std::string GetApplicationFile()
+    { return m_ExecutableName; }
+
+  virtual std::string GetApplicationPermanentDataLocation()
+    { return m_DataDir; }
+
+  virtual std::string GetUserDocumentsLocation()
+    { return m_DataDir; }
+
+  virtual std::string EncodeServerURL(const std::string &url)
+    { return url; }
+
+  virtual void LoadResourceAsImage2D(std::string tag, GrayscaleImage *image) {}
+  virtual void LoadResourceAsRegistry(std::string tag, Registry &reg) {}
+  virtual void WriteRGBAImage2D(std::string file, RGBAImageType *image) {}
+
+protected:
+  std::string m_ExecutableName, m_DataDir;
+};
+
+#endif // HEADLESSSYSTEMINFODELEGATE_H
@@ -60,6 +60,7 @@
 #include "itkFlipImageFilter.h"
 #include "itkConstantBoundaryCondition.h"
 #include <itksys/SystemTools.hxx>
+#include <algorithm>
 #include "vtkAppendPolyData.h"
 #include "vtkUnsignedShortArray.h"
 #include "vtkPointData.h"
@@ -245,6 +246,7 @@ IRISApplication
     m_ColorLabelTable->GetColorLabel(passThroughLabel));
 
   // Initialize the speed image of the SNAP image data
+  this->CancelSpeedVolumeFill();
   m_SNAPImageData->InitializeSpeed();
 
   // Remember the ROI object
@@ -283,6 +285,7 @@ IRISApplication
     == newSpeedImage->GetBufferedRegion().GetSize());
 
   // Initialize the speed wrapper
+  this->CancelSpeedVolumeFill();
   if(!m_SNAPImageData->IsSpeedLoaded())
     m_SNAPImageData->InitializeSpeed();
   
@@ -563,8 +566,43 @@ IRISApplication
     double zSlice,
     const std::string &undoTitle)
 {
+  // Drawing parameters
+  bool invert = m_GlobalState->GetPolygonInvert();
+
   // Turn the 2D region of the drawing into a 3D region in the segmentation
   IRISApplication::SliceBinaryImageType::RegionType r_draw = drawing->GetBufferedRegion();
+  const SliceBinaryImageType::PixelType *drawBuffer = drawing->GetBufferPointer();
+  long drawWidth = r_draw.GetSize()[0];
+
+  // Unless the drawing is inverted, only the part of the drawing containing
+  // non-zero pixels needs to be applied to the segmentation
+  if(!invert)
+    {
+    long x_min = drawWidth, x_max = -1, y_min = r_draw.GetSize()[1], y_max = -1;
+    for(long y = 0; y < (long) r_draw.GetSize()[1]; y++)
+      {
+      const SliceBinaryImageType::PixelType *row = drawBuffer + y * drawWidth;
+      long x0 = 0, x1 = drawWidth - 1;
+      while(x0 <= x1 && row[x0] == 0) x0++;
+      if(x0 > x1)
+        continue;
+      while(row[x1] == 0) x1--;
+      x_min = std::min(x_min, x0);
+      x_max = std::max(x_max, x1);
+      y_min = std::min(y_min, y);
+      y_max = y;
+      }
+
+    if(x_max < 0)
+      return 0;
+
+    SliceBinaryImageType::IndexType idx_draw = r_draw.GetIndex();
+    idx_draw[0] += x_min;
+    idx_draw[1] += y_min;
+    r_draw.SetIndex(idx_draw);
+    r_draw.SetSize(0, x_max - x_min + 1);
+    r_draw.SetSize(1, y_max - y_min + 1);
+    }
 
   // Array of corners of the drawing region
   Vector2ui corners[4];
@@ -612,30 +650,50 @@ IRISApplication
                                    m_GlobalState->GetDrawingColorLabel(),
                                    m_GlobalState->GetDrawOverFilter());
 
-  // Drawing parameters
-  bool invert = m_GlobalState->GetPolygonInvert();
-
   // Inverse transform
   ImageCoordinateTransform::Pointer xfmImageToSlice = ImageCoordinateTransform::New();
   xfmSliceToImage->ComputeInverse(xfmImageToSlice);
 
+  // The transform is affine, so rather than transforming every voxel, the
+  // slice coordinate is stepped along the lines of the volume region
+  itk::Index<3> idx_start = r_vol.GetIndex();
+  Vector3d x_start = xfmImageToSlice->TransformPoint(
+                       Vector3d(idx_start[0] + 0.5, idx_start[1] + 0.5, idx_start[2] + 0.5));
+  Vector3d step[3];
+  for(int d = 0; d < 3; d++)
+    {
+    Vector3d unit(0.0);
+    unit[d] = 1.0;
+    step[d] = xfmImageToSlice->TransformVector(unit);
+    }
+
+  // Offset of the drawing buffer
+  itk::Index<2> idx_draw_origin = drawing->GetBufferedRegion().GetIndex();
+
   // Iterate over the volume region
+  Vector3d x_slice;
   for(; !itVol.IsAtEnd(); ++itVol)
     {
     // Find the coordinate of the voxel in the slice
     itk::Index<3> idx_vol = itVol.GetIndex();
-    Vector3d x_slice = xfmImageToSlice->TransformPoint(
-                         Vector3d(idx_vol[0] + 0.5, idx_vol[1] + 0.5, idx_vol[2] + 0.5));
-    itk::Index<2> idx_slice;
-    idx_slice[0] = (int) x_slice[0];
-    idx_slice[1] = (int) x_slice[1];
+    if(idx_vol[0] == idx_start[0])
+      {
+      x_slice = x_start
+                + step[1] * (double) (idx_vol[1] - idx_start[1])
+                + step[2] * (double) (idx_vol[2] - idx_start[2]);
+      }
+    else
+      {
+      x_slice += step[0];
+      }
+
+    long ix = (long) x_slice[0] - idx_draw_origin[0];
+    long iy = (long) x_slice[1] - idx_draw_origin[1];
 
     // Check value
-    SliceBinaryImageType::PixelType px = drawing->GetPixel(idx_slice);
+    SliceBinaryImageType::PixelType px = drawBuffer[iy * drawWidth + ix];
     if((px != 0) ^ invert)
       itVol.PaintAsForeground();
-
-
     }
 
   // Finalize
@@ -820,6 +878,15 @@ IRISApplication
     m_GlobalState->SetCrosshairsPosition(cursor);
     this->GetCurrentImageData()->SetCrosshairs(cursor);
 
+    // Fill the speed image around the cursor first
+    if(IsSnakeModeActive())
+      {
+      m_ThresholdPreviewWrapper->SetStreamingFocus(cursor);
+      m_EdgePreviewWrapper->SetStreamingFocus(cursor);
+      m_GMMPreviewWrapper->SetStreamingFocus(cursor);
+      m_RandomForestPreviewWrapper->SetStreamingFocus(cursor);
+      }
+
     // Fire the appropriate event
     InvokeEvent(CursorUpdateEvent());
     }
@@ -927,6 +994,7 @@ IRISApplication
   assert(m_SNAPImageData->IsMainLoaded() &&
          m_CurrentImageData != m_SNAPImageData);
 
+  this->CancelSpeedVolumeFill();
   m_SNAPImageData->UnloadAll();
 }
 
@@ -1529,6 +1597,9 @@ IRISApplication
   if(m_GlobalState->GetDefaultBehaviorSettings()->GetAutoContrast())
     AutoContrastLayerOnLoad(layer);
 
+  // Precompute the derived quantities of multi-component images
+  ApplyDerivedQuantitySettings(layer);
+
   // Set the selected layer ID to be the new selected overlay - but only if it is
   // not sticky!
   if(!layer->IsSticky())
@@ -1575,11 +1646,40 @@ IRISApplication
   if(m_GlobalState->GetDefaultBehaviorSettings()->GetAutoContrast())
     AutoContrastLayerOnLoad(overlay);
 
+  // Precompute the derived quantities of multi-component images
+  ApplyDerivedQuantitySettings(overlay);
+
   // Set the selected layer ID to be the new overlay
   if(!overlay->IsSticky())
     m_GlobalState->SetSelectedLayerId(overlay->GetUniqueId());
 }
 
+void
+IRISApplication
+::ApplyDerivedQuantitySettings(ImageWrapperBase *layer)
+{
+  VectorImageWrapperBase *vec = dynamic_cast<VectorImageWrapperBase *>(layer);
+  if(vec)
+    {
+    DefaultBehaviorSettings *dbs = m_GlobalState->GetDefaultBehaviorSettings();
+    vec->SetDerivedQuantityMemoryBudget(
+          (size_t) dbs->GetDerivedQuantityMemoryBudget() * 1024 * 1024);
+    vec->SetMaterializeDerivedQuantities(dbs->GetPrecomputeDerivedQuantities());
+    }
+}
+
+void
+IRISApplication
+::UpdateDerivedQuantitySettings()
+{
+  if(!this->IsMainImageLoaded())
+    return;
+
+  for(LayerIterator it = this->GetIRISImageData()->GetLayers(MAIN_ROLE | OVERLAY_ROLE);
+      !it.IsAtEnd(); ++it)
+    this->ApplyDerivedQuantitySettings(it.GetLayer());
+}
+
 void
 IRISApplication
 ::AutoContrastLayerOnLoad(ImageWrapperBase *layer)
@@ -1673,6 +1773,9 @@ IRISApplication
   if(m_GlobalState->GetDefaultBehaviorSettings()->GetAutoContrast())
     AutoContrastLayerOnLoad(layer);
 
+  // Precompute the derived quantities of multi-component images
+  ApplyDerivedQuantitySettings(layer);
+
   // Save the thumbnail for the current image. This ensures that a thumbnail
   // is created even if the application crashes or is killed.
   ImageWrapperBase::DisplaySlicePointer thumbnail = layer->MakeThumbnail(128);
@@ -2605,6 +2708,7 @@ void IRISApplication::SetSnakeMode(SnakeType mode)
             SnakeParameters::GetDefaultEdgeParameters());
 
     // Clear the speed layer
+    this->CancelSpeedVolumeFill();
     m_SNAPImageData->InitializeSpeed();
     }
 }
@@ -2749,6 +2853,11 @@ void IRISApplication::EnterPreprocessingMode(PreprocessingMode mode)
   if(mode == m_PreprocessingMode)
     return;
 
+  // The speed image may still be filled from the last time the preprocessing
+  // was applied. Going back to preprocessing stops this.
+  if(mode != PREPROCESS_NONE)
+    this->CancelSpeedVolumeFill();
+
   // Detach the current mode
   switch(m_PreprocessingMode)
     {
@@ -2855,11 +2964,50 @@ IRISApplication
 
   if(wrapper)
     {
+    wrapper->SetStreamingFocus(this->GetCursorPosition());
     wrapper->ComputeOutputVolume(progress);
     m_GlobalState->SetSpeedValid(true);
     }
 }
 
+bool
+IRISApplication
+::UpdateSpeedVolumeFill()
+{
+  AbstractSlicePreviewFilterWrapper *wrappers[] = {
+    m_ThresholdPreviewWrapper, m_EdgePreviewWrapper,
+    m_GMMPreviewWrapper, m_RandomForestPreviewWrapper };
+
+  bool filling = false;
+  for(unsigned int i = 0; i < 4; i++)
+    filling |= wrappers[i]->UpdateOutputVolume();
+  return filling;
+}
+
+void
+IRISApplication
+::WaitForSpeedVolume()
+{
+  AbstractSlicePreviewFilterWrapper *wrappers[] = {
+    m_ThresholdPreviewWrapper, m_EdgePreviewWrapper,
+    m_GMMPreviewWrapper, m_RandomForestPreviewWrapper };
+
+  for(unsigned int i = 0; i < 4; i++)
+    wrappers[i]->WaitForOutputVolume();
+}
+
+void
+IRISApplication
+::CancelSpeedVolumeFill()
+{
+  AbstractSlicePreviewFilterWrapper *wrappers[] = {
+    m_ThresholdPreviewWrapper, m_EdgePreviewWrapper,
+    m_GMMPreviewWrapper, m_RandomForestPreviewWrapper };
+
+  for(unsigned int i = 0; i < 4; i++)
+    wrappers[i]->CancelOutputVolume();
+}
+
 IRISApplication::BubbleArray&
 IRISApplication::GetBubbleArray()
 {
@@ -2868,6 +3016,9 @@ IRISApplication::GetBubbleArray()
 
 bool IRISApplication::InitializeActiveContourPipeline()
 {
+  // The evolution needs the whole speed image
+  this->WaitForSpeedVolume();
+
   // Initialize the segmentation with current bubbles and parameters
   return m_SNAPImageData->InitializeSegmentation(
         m_GlobalState->GetSnakeParameters(),
@@ -389,6 +389,18 @@ public:
     */
   void ApplyCurrentPreprocessingModeToSpeedVolume(itk::Command *progress = 0);
 
+  /**
+    Applying the preprocessing computes the slices through the cursor right
+    away and fills the rest of the speed image in the background. This shows
+    the part filled so far, and returns true while the fill is running.
+    */
+  bool UpdateSpeedVolumeFill();
+
+  /**
+    Block until the background fill of the speed image is finished
+    */
+  void WaitForSpeedVolume();
+
   /**
     Get the current preprocessing mode
     */
@@ -558,6 +570,13 @@ public:
    */
   ImageWrapperBase *GetMainImage() const;
 
+  /**
+   * Apply the default behavior settings for precomputing the derived
+   * quantities of multi-component images to the loaded layers. This is
+   * done on load, and should be called when the settings change.
+   */
+  void UpdateDerivedQuantitySettings();
+
   /**
     Load label descriptions from file
     */
@@ -773,6 +792,9 @@ protected:
   // Random forest preprocessing wrapper
   SmartPtr<RFPreprocessingPreviewWrapperType> m_RandomForestPreviewWrapper;
 
+  // Stop filling the speed image, e.g., before it is reinitialized
+  void CancelSpeedVolumeFill();
+
   // The EM classification object
   SmartPtr<UnsupervisedClustering> m_ClusteringEngine;
 
@@ -831,6 +853,9 @@ protected:
   // Auto-adjust contrast of a layer on load
   void AutoContrastLayerOnLoad(ImageWrapperBase *layer);
 
+  // Apply the default behavior settings for derived quantities to a layer
+  void ApplyDerivedQuantitySettings(ImageWrapperBase *layer);
+
   // -------------- Saving IRIS state during SNAP mode --------------------
   unsigned long m_SavedIRISSelectedSegmentationLayerId;
 
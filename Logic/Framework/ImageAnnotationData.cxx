@@ -1,6 +1,9 @@
 #include "ImageAnnotationData.h"
 #include "Registry.h"
 #include "IRISException.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
 
 namespace annot
 {
@@ -40,6 +43,31 @@ bool AbstractAnnotation::IsVisible(int plane) const
   return true;
 }
 
+void AbstractAnnotation::SetVisibleInAllSlices(bool value)
+{
+  m_VisibleInAllSlices = value;
+  this->GeometryModified();
+}
+
+void AbstractAnnotation::SetVisibleInAllPlanes(bool value)
+{
+  m_VisibleInAllPlanes = value;
+  this->GeometryModified();
+}
+
+void AbstractAnnotation::SetPlane(int value)
+{
+  m_Plane = value;
+  this->GeometryModified();
+}
+
+void AbstractAnnotation::GeometryModified()
+{
+  if(m_CollectionGeometryVersion)
+    ++(*m_CollectionGeometryVersion);
+  this->Modified();
+}
+
 void AbstractAnnotation::Save(Registry &folder)
 {
   folder["Selected"] << m_Selected;
@@ -58,6 +86,7 @@ void AbstractAnnotation::Load(Registry &folder)
   m_Plane = folder["Plane"][0];
   m_Color = folder["Color"][Vector3d(1.0, 0.0, 0.0)];
   folder["Tags"].GetList(m_Tags);
+  this->GeometryModified();
 }
 
 unsigned long AbstractAnnotation::GetUniqueId() const
@@ -103,10 +132,17 @@ void LineSegmentAnnotation::Load(Registry &folder)
     throw IRISException("Invalid line segment annotation detected in file.");
 }
 
+void LineSegmentAnnotation::SetSegment(const LineSegment &segment)
+{
+  m_Segment = segment;
+  this->GeometryModified();
+}
+
 void LineSegmentAnnotation::MoveBy(const Vector3d &offset)
 {
   m_Segment.first += offset;
   m_Segment.second += offset;
+  this->GeometryModified();
 }
 
 Vector3d LineSegmentAnnotation::GetCenter() const
@@ -114,6 +150,15 @@ Vector3d LineSegmentAnnotation::GetCenter() const
   return (m_Segment.first + m_Segment.second) / 2.0;
 }
 
+void LineSegmentAnnotation::GetBoundingBox(Vector3d &xmin, Vector3d &xmax) const
+{
+  for(int d = 0; d < 3; d++)
+    {
+    xmin[d] = std::min(m_Segment.first[d], m_Segment.second[d]);
+    xmax[d] = std::max(m_Segment.first[d], m_Segment.second[d]);
+    }
+}
+
 int LandmarkAnnotation::GetSliceIndex(int plane) const
 {
   // Just return the coordinate of the first point. It should be the same
@@ -126,9 +171,16 @@ Vector3d LandmarkAnnotation::GetAnchorPoint(int plane) const
   return m_Landmark.Pos;
 }
 
+void LandmarkAnnotation::SetLandmark(const Landmark &landmark)
+{
+  m_Landmark = landmark;
+  this->GeometryModified();
+}
+
 void LandmarkAnnotation::MoveBy(const Vector3d &offset)
 {
   m_Landmark.Pos += offset;
+  this->GeometryModified();
 }
 
 Vector3d LandmarkAnnotation::GetCenter() const
@@ -136,6 +188,13 @@ Vector3d LandmarkAnnotation::GetCenter() const
   return m_Landmark.Pos;
 }
 
+void LandmarkAnnotation::GetBoundingBox(Vector3d &xmin, Vector3d &xmax) const
+{
+  // The text is offset in screen units, so only the position is included
+  xmin = m_Landmark.Pos;
+  xmax = m_Landmark.Pos;
+}
+
 void LandmarkAnnotation::Save(Registry &folder)
 {
   Superclass::Save(folder);
@@ -156,15 +215,194 @@ void LandmarkAnnotation::Load(Registry &folder)
 
 }
 
+const double ImageAnnotationData::GridCellSize = 16.0;
+
+ImageAnnotationData::ImageAnnotationData()
+{
+  m_GeometryVersion = std::make_shared<unsigned long>(0);
+  m_MaximumLandmarkOffset = 0.0;
+  m_IndexGeometryVersion = 0;
+  m_IndexMTime = 0;
+  m_IndexValid = false;
+}
+
 void ImageAnnotationData::AddAnnotation(ImageAnnotationData::AbstractAnnotation *annot)
 {
   SmartPtr<AbstractAnnotation> myannot = annot;
+  this->Adopt(annot);
   m_Annotations.push_back(myannot);
+  this->Modified();
+}
+
+void ImageAnnotationData::Adopt(AbstractAnnotation *annot) const
+{
+  annot->m_CollectionGeometryVersion = m_GeometryVersion;
 }
 
 void ImageAnnotationData::Reset()
 {
   m_Annotations.clear();
+  this->Modified();
+}
+
+void ImageAnnotationData::UpdateIndex() const
+{
+  if(m_IndexValid
+     && m_IndexGeometryVersion == *m_GeometryVersion
+     && m_IndexMTime == this->GetMTime()
+     && m_IndexItems.size() == m_Annotations.size())
+    return;
+
+  for(int p = 0; p < 3; p++)
+    {
+    m_Index[p].Slices.clear();
+    m_Index[p].AllSlices = SliceIndex();
+    }
+
+  m_IndexItems.assign(m_Annotations.size(), NULL);
+  m_MaximumLandmarkOffset = 0.0;
+
+  size_t k = 0;
+  for(AnnotationConstIterator it = m_Annotations.begin(); it != m_Annotations.end(); ++it, ++k)
+    {
+    AbstractAnnotation *a = *it;
+    m_IndexItems[k] = a;
+
+    // Annotations placed in the list directly are adopted here
+    this->Adopt(a);
+
+    const annot::LandmarkAnnotation *lma = dynamic_cast<const annot::LandmarkAnnotation *>(a);
+    if(lma)
+      {
+      const Vector2d &offset = lma->GetLandmark().Offset;
+      m_MaximumLandmarkOffset = std::max(m_MaximumLandmarkOffset,
+                                         std::max(fabs(offset[0]), fabs(offset[1])));
+      }
+
+    Vector3d xmin, xmax;
+    a->GetBoundingBox(xmin, xmax);
+
+    for(int p = 0; p < 3; p++)
+      {
+      if(!a->IsVisible(p))
+        continue;
+
+      SliceIndex &si = a->GetVisibleInAllSlices()
+                       ? m_Index[p].AllSlices
+                       : m_Index[p].Slices[a->GetSliceIndex(p)];
+      si.Items.push_back(k);
+
+      // Cells of the grid covered by the annotation in the plane
+      int d0 = (p + 1) % 3, d1 = (p + 2) % 3;
+      long c0[2], c1[2];
+      c0[0] = (long) std::floor(xmin[d0] / GridCellSize);
+      c1[0] = (long) std::floor(xmax[d0] / GridCellSize);
+      c0[1] = (long) std::floor(xmin[d1] / GridCellSize);
+      c1[1] = (long) std::floor(xmax[d1] / GridCellSize);
+
+      // Annotations covering many cells are kept in a separate list
+      if((c1[0] - c0[0] + 1) * (c1[1] - c0[1] + 1) > 64)
+        {
+        si.LargeItems.push_back(k);
+        continue;
+        }
+
+      for(long i = c0[0]; i <= c1[0]; i++)
+        for(long j = c0[1]; j <= c1[1]; j++)
+          si.Grid[std::make_pair(i, j)].push_back(k);
+      }
+    }
+
+  m_IndexGeometryVersion = *m_GeometryVersion;
+  m_IndexMTime = this->GetMTime();
+  m_IndexValid = true;
+}
+
+void ImageAnnotationData::GetAnnotationsInSlice(
+    int plane, int slice, AnnotationVector &out) const
+{
+  out.clear();
+  if(plane < 0 || plane > 2)
+    return;
+
+  this->UpdateIndex();
+
+  // Merge the annotations in all slices with those in this slice
+  const std::vector<size_t> &all = m_Index[plane].AllSlices.Items;
+  std::vector<size_t> items;
+  std::map<int, SliceIndex>::const_iterator it = m_Index[plane].Slices.find(slice);
+  if(it != m_Index[plane].Slices.end())
+    std::merge(all.begin(), all.end(), it->second.Items.begin(), it->second.Items.end(),
+               std::back_inserter(items));
+  else
+    items = all;
+
+  out.reserve(items.size());
+  for(size_t k : items)
+    out.push_back(m_IndexItems[k]);
+}
+
+void ImageAnnotationData::GetAnnotationsInSliceNear(
+    int plane, int slice, const Vector3d &xmin, const Vector3d &xmax,
+    AnnotationVector &out) const
+{
+  out.clear();
+  if(plane < 0 || plane > 2)
+    return;
+
+  this->UpdateIndex();
+
+  int d0 = (plane + 1) % 3, d1 = (plane + 2) % 3;
+  long c0[2], c1[2];
+  c0[0] = (long) std::floor(xmin[d0] / GridCellSize);
+  c1[0] = (long) std::floor(xmax[d0] / GridCellSize);
+  c0[1] = (long) std::floor(xmin[d1] / GridCellSize);
+  c1[1] = (long) std::floor(xmax[d1] / GridCellSize);
+
+  // Collect the annotations in the cells overlapping the box
+  std::vector<size_t> items;
+  const SliceIndex *indices[2] = { &m_Index[plane].AllSlices, NULL };
+  std::map<int, SliceIndex>::const_iterator it = m_Index[plane].Slices.find(slice);
+  if(it != m_Index[plane].Slices.end())
+    indices[1] = &it->second;
+
+  for(const SliceIndex *si : indices)
+    {
+    if(!si)
+      continue;
+
+    // If the box covers more cells than there are annotations, take them all
+    if((c1[0] - c0[0] + 1) * (double) (c1[1] - c0[1] + 1) > si->Items.size())
+      {
+      items.insert(items.end(), si->Items.begin(), si->Items.end());
+      continue;
+      }
+
+    items.insert(items.end(), si->LargeItems.begin(), si->LargeItems.end());
+    for(long i = c0[0]; i <= c1[0]; i++)
+      {
+      for(long j = c0[1]; j <= c1[1]; j++)
+        {
+        auto cell = si->Grid.find(std::make_pair(i, j));
+        if(cell != si->Grid.end())
+          items.insert(items.end(), cell->second.begin(), cell->second.end());
+        }
+      }
+    }
+
+  // Annotations spanning several cells are found more than once
+  std::sort(items.begin(), items.end());
+  items.erase(std::unique(items.begin(), items.end()), items.end());
+
+  out.reserve(items.size());
+  for(size_t k : items)
+    out.push_back(m_IndexItems[k]);
+}
+
+double ImageAnnotationData::GetMaximumLandmarkOffset() const
+{
+  this->UpdateIndex();
+  return m_MaximumLandmarkOffset;
 }
 
 void ImageAnnotationData::SaveAnnotations(Registry &reg)
@@ -198,6 +436,7 @@ void ImageAnnotationData::LoadAnnotations(Registry &reg)
 
   // Clear the annotations
   m_Annotations.clear();
+  this->Modified();
 
   // Read the list of annotations
   int n_annot = reg["Annotations.ArraySize"][0];
@@ -223,6 +462,7 @@ void ImageAnnotationData::LoadAnnotations(Registry &reg)
     if(ann)
       {
       ann->Load(folder);
+      this->Adopt(ann);
       m_Annotations.push_back(ann);
       }
     }
@@ -5,11 +5,15 @@
 #include <utility>
 #include <string>
 #include <list>
+#include <map>
+#include <memory>
+#include <vector>
 #include "itkDataObject.h"
 #include "itkObjectFactory.h"
 #include "TagList.h"
 
 class Registry;
+class ImageAnnotationData;
 
 namespace annot
 {
@@ -42,13 +46,16 @@ public:
   irisGetSetMacro(Selected, bool)
 
   /** Whether this annotation is visible in all slices or just its own slice */
-  irisGetSetMacro(VisibleInAllSlices, bool)
+  irisGetMacro(VisibleInAllSlices, bool)
+  virtual void SetVisibleInAllSlices(bool value);
 
   /** Whether this annotation is visible in all ortho planes or just its own plane */
-  irisGetSetMacro(VisibleInAllPlanes, bool)
+  irisGetMacro(VisibleInAllPlanes, bool)
+  virtual void SetVisibleInAllPlanes(bool value);
 
   /** The image dimension to which this annotation belongs, or -1 if it's non-planar */
-  irisGetSetMacro(Plane, int)
+  irisGetMacro(Plane, int)
+  virtual void SetPlane(int value);
 
   /** Get the color of the annotation */
   irisGetSetMacro(Color, const Vector3d &)
@@ -75,6 +82,9 @@ public:
   /** Get the 3D center of the annotation */
   virtual Vector3d GetCenter() const = 0;
 
+  /** Get the bounding box of the points defining the annotation */
+  virtual void GetBoundingBox(Vector3d &xmin, Vector3d &xmax) const = 0;
+
   /** Get the annotation type */
   virtual AnnotationType GetType() const = 0;
 
@@ -95,6 +105,15 @@ protected:
   AbstractAnnotation();
   ~AbstractAnnotation() {}
 
+  // Called when the position or the visibility of the annotation changes
+  void GeometryModified();
+
+  // Counter of geometry changes of the collection that holds the annotation,
+  // which is incremented by GeometryModified() so that the collection knows
+  // when its index is out of date
+  std::shared_ptr<unsigned long> m_CollectionGeometryVersion;
+  friend class ::ImageAnnotationData;
+
   // Unique Id of this annotation, may not be zero
   unsigned long m_UniqueId;
 
@@ -120,13 +139,15 @@ public:
 
   typedef LineSegment                   ObjectType;
 
-  irisGetSetMacro(Segment, const LineSegment &)
+  irisGetMacro(Segment, const LineSegment &)
+  virtual void SetSegment(const LineSegment &segment);
 
   virtual void Save(Registry &folder) ITK_OVERRIDE;
   virtual void Load(Registry &folder) ITK_OVERRIDE;
 
   virtual void MoveBy(const Vector3d &offset) ITK_OVERRIDE;
   virtual Vector3d GetCenter() const ITK_OVERRIDE;
+  virtual void GetBoundingBox(Vector3d &xmin, Vector3d &xmax) const ITK_OVERRIDE;
   virtual AnnotationType GetType() const ITK_OVERRIDE { return LINE_SEGMENT; }
 
 
@@ -156,10 +177,12 @@ public:
 
   typedef Landmark                   ObjectType;
 
-  irisGetSetMacro(Landmark, const Landmark &)
+  irisGetMacro(Landmark, const Landmark &)
+  virtual void SetLandmark(const Landmark &landmark);
 
   virtual void MoveBy(const Vector3d &offset) ITK_OVERRIDE;
   virtual Vector3d GetCenter() const ITK_OVERRIDE;
+  virtual void GetBoundingBox(Vector3d &xmin, Vector3d &xmax) const ITK_OVERRIDE;
   virtual AnnotationType GetType() const ITK_OVERRIDE { return LANDMARK; }
 
 protected:
@@ -184,6 +207,15 @@ protected:
  * Image annotations are defined in voxel coordinate space. This helps keep the
  * annotations in place when header information changes. It also makes the internal
  * logic simpler.
+ *
+ * To avoid testing every annotation when drawing a slice or picking, the
+ * collection keeps an index of the annotations visible in each slice of each
+ * plane, and within a slice, a grid of the annotations by position. The
+ * index is rebuilt on demand after annotations are moved, added or removed.
+ * Each collection counts the changes to its own annotations, so changes to
+ * another collection do not affect its index. An annotation belongs to one
+ * collection at a time. Code that edits the list returned by GetAnnotations()
+ * directly must call Modified() on this object afterwards.
  */
 class ImageAnnotationData : public itk::DataObject
 {
@@ -193,6 +225,7 @@ public:
   typedef std::list<AnnotationPtr> AnnotationList;
   typedef AnnotationList::iterator AnnotationIterator;
   typedef AnnotationList::const_iterator AnnotationConstIterator;
+  typedef std::vector<AbstractAnnotation *> AnnotationVector;
 
   irisITKObjectMacro(ImageAnnotationData, itk::DataObject)
 
@@ -207,11 +240,63 @@ public:
   void SaveAnnotations(Registry &reg);
   void LoadAnnotations(Registry &reg);
 
+  /** Get the annotations visible in a given plane and slice, in list order */
+  void GetAnnotationsInSlice(int plane, int slice, AnnotationVector &out) const;
+
+  /**
+   * Get the annotations visible in a given plane and slice that are near a
+   * box, given in voxel coordinates. The result, in list order, contains
+   * every such annotation whose bounding box overlaps the box in the plane.
+   * It may also contain some annotations that are outside of the box.
+   */
+  void GetAnnotationsInSliceNear(int plane, int slice,
+                                 const Vector3d &xmin, const Vector3d &xmax,
+                                 AnnotationVector &out) const;
+
+  /** Get the largest offset of a landmark text from its position, in either direction */
+  double GetMaximumLandmarkOffset() const;
+
 protected:
-  ImageAnnotationData() {}
+  ImageAnnotationData();
   ~ImageAnnotationData() {}
 
   AnnotationList m_Annotations;
+
+  // Size of the cells of the grid, in voxels
+  static const double GridCellSize;
+
+  // Annotations in a slice, referenced by their position in the list
+  struct SliceIndex
+  {
+    std::vector<size_t> Items;
+    std::map<std::pair<long, long>, std::vector<size_t> > Grid;
+    std::vector<size_t> LargeItems;
+  };
+
+  // Slice index for annotations visible in a single slice and in all slices
+  struct PlaneIndex
+  {
+    std::map<int, SliceIndex> Slices;
+    SliceIndex AllSlices;
+  };
+
+  // Rebuild the index if out of date
+  void UpdateIndex() const;
+
+  // Counter of changes to the position or visibility of the annotations,
+  // shared with the annotations in the collection
+  std::shared_ptr<unsigned long> m_GeometryVersion;
+
+  // Make an annotation report its geometry changes to this collection
+  void Adopt(AbstractAnnotation *annot) const;
+
+  // The index and the state of the annotations when it was built
+  mutable PlaneIndex m_Index[3];
+  mutable AnnotationVector m_IndexItems;
+  mutable double m_MaximumLandmarkOffset;
+  mutable unsigned long m_IndexGeometryVersion;
+  mutable itk::ModifiedTimeType m_IndexMTime;
+  mutable bool m_IndexValid;
 };
 
 /** Iterator that searches for annotations */
@@ -383,6 +383,9 @@ SNAPImageData
   // Copy the configuration parameters
   m_CurrentSnakeParameters = p;
 
+  // Checkpoints from an earlier evolution are no longer valid
+  m_LevelSetCheckpoints.Clear();
+
   // Enter a thread-safe section
   m_LevelSetPipelineMutex.lock();
 
@@ -424,8 +427,20 @@ SNAPImageData
   // Enter a thread-safe section
   m_LevelSetPipelineMutex.lock();
 
+  // If the user rewound to a checkpoint, the later checkpoints are obsolete
+  m_LevelSetCheckpoints.DiscardAfter(m_LevelSetDriver->GetElapsedIterations());
+
   // clock_t c1 = clock();
   m_LevelSetDriver->Run(nIterations);
+
+  // In multi-resolution mode, the driver reinitializes its full resolution
+  // filter when the coarse levels are done, which reallocates the output
+  UpdateSnakeWrapperPixelContainer();
+
+  // Save a checkpoint if one is due
+  unsigned int nElapsed = m_LevelSetDriver->GetElapsedIterations();
+  if(m_LevelSetCheckpoints.IsCheckpointDue(nElapsed))
+    m_LevelSetCheckpoints.Store(m_LevelSetDriver->GetOutput(), nElapsed);
   
   // The wrapper has to be notified that pixels have been updated
   m_SnakeWrapper->PixelsModified();
@@ -464,6 +479,7 @@ SNAPImageData
 
   // Pass through to the level set driver
   m_LevelSetDriver->Restart();
+  m_LevelSetCheckpoints.Clear();
     
   // Copy the output pixels from the level set filter to the snake image wrapper.
   // The ITK pattern is to do the opposite, i.e., graft the image onto the level
@@ -478,6 +494,51 @@ SNAPImageData
   this->InvokeEvent(LevelSetImageChangeEvent());
 }
 
+bool
+SNAPImageData
+::RewindSegmentationToCheckpoint(unsigned int iteration)
+{
+  // Should be in level set mode
+  assert(m_LevelSetDriver);
+
+  // Enter a thread-safe section
+  m_LevelSetPipelineMutex.lock();
+
+  // Decompress the checkpoint into a new level set image
+  FloatImageType *output = m_LevelSetDriver->GetOutput();
+  SmartPtr<FloatImageType> level_set = FloatImageType::New();
+  level_set->CopyInformation(output);
+  level_set->SetRegions(output->GetBufferedRegion());
+  level_set->Allocate();
+
+  bool found = m_LevelSetCheckpoints.Restore(iteration, level_set);
+  if(found)
+    {
+    // Resume the evolution from the checkpoint
+    m_LevelSetDriver->RestartFromLevelSet(level_set, iteration);
+    UpdateSnakeWrapperPixelContainer();
+    m_SnakeWrapper->PixelsModified();
+    }
+
+  // Leave a thread-safe section
+  m_LevelSetPipelineMutex.unlock();
+
+  // Fire the update event
+  if(found)
+    this->InvokeEvent(LevelSetImageChangeEvent());
+
+  return found;
+}
+
+void
+SNAPImageData
+::UpdateSnakeWrapperPixelContainer()
+{
+  FloatImageType *output = m_LevelSetDriver->GetPreviewOutput();
+  if(output->GetBufferPointer() != m_SnakeWrapper->GetImage()->GetBufferPointer())
+    m_SnakeWrapper->SetPixelContainer(output->GetPixelContainer());
+}
+
 void 
 SNAPImageData
 ::TerminateSegmentation()
@@ -488,8 +549,13 @@ SNAPImageData
   // Enter a thread-safe section
   m_LevelSetPipelineMutex.lock();
 
+  // At a coarse level, the displayed level set may lag behind the evolution.
+  // Bring it up to date, since it becomes the result of the segmentation
+  m_LevelSetDriver->GetOutput();
+
   // Delete the level set driver and all the problems that go along with it
   delete m_LevelSetDriver; m_LevelSetDriver = NULL;
+  m_LevelSetCheckpoints.Clear();
 
   // Leave a thread-safe section
   m_LevelSetPipelineMutex.unlock();
@@ -46,6 +46,7 @@
 #include "SnakeParameters.h"
 
 #include "SNAPLevelSetDriver.h"
+#include "LevelSetCheckpointRing.h"
 
 #include <vector>
 
@@ -181,6 +182,25 @@ public:
   /** Get the number of elapsed iterations */
   unsigned int GetElapsedSegmentationIterations() const;
 
+  /**
+   * Access the checkpoints of the level set evolution. Checkpoints are stored
+   * by RunSegmentation at the interval set in the returned object, and are
+   * cleared when the segmentation is restarted or terminated.
+   */
+  LevelSetCheckpointRing *GetLevelSetCheckpoints() { return &m_LevelSetCheckpoints; }
+
+  /** List the iterations for which level set checkpoints are available */
+  std::vector<unsigned int> GetLevelSetCheckpointIterations() const
+    { return m_LevelSetCheckpoints.GetCheckpointIterations(); }
+
+  /**
+   * Rewind (or fast-forward) the evolution to a stored checkpoint. Later
+   * checkpoints are kept until the segmentation is run again, so the user
+   * can move back and forth between them. Returns false if there is no
+   * checkpoint for the given iteration.
+   */
+  bool RewindSegmentationToCheckpoint(unsigned int iteration);
+
   /** Release the resources associated with the level set segmentation.  This 
    * method must be called once the segmentation pipeline has terminated, or 
    * else it would create a nasty crash */
@@ -267,6 +287,12 @@ protected:
   // Snake driver
   SNAPLevelSetDriver<3> *m_LevelSetDriver;
 
+  // Compressed snapshots of the level set evolution
+  LevelSetCheckpointRing m_LevelSetCheckpoints;
+
+  // Point the snake wrapper to the output of the level set driver
+  void UpdateSnakeWrapperPixelContainer();
+
   // Label color used for the snake images
   LabelType m_SnakeColorLabel;
 
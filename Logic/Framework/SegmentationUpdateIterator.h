@@ -235,7 +235,7 @@ public:
     m_Delta->FinishEncoding();
     if(m_ChangedVoxels > 0)
       {
-      m_Wrapper->PixelsModified();
+      m_Wrapper->PixelsModified(m_Region);
       if(undo_string)
         m_Wrapper->StoreUndoPoint(undo_string, RelinquishDelta());
       return true;
@@ -0,0 +1,164 @@
+#ifndef AXISALIGNEDRESAMPLEIMAGEFILTER_H
+#define AXISALIGNEDRESAMPLEIMAGEFILTER_H
+
+#include "itkImageToImageFilter.h"
+#include "itkTransform.h"
+#include "itkContinuousIndex.h"
+#include "SNAPCommon.h"
+#include <map>
+#include <vector>
+
+/**
+ * This filter resamples an image onto a grid whose axes are parallel to the
+ * axes of the input image, i.e., the output voxel (i,j,k) samples the input
+ * at the continuous index (x0 + i*dx, y0 + j*dy, z0 + k*dz). This is the case
+ * when a region of interest is resampled to a different size without any
+ * reslicing.
+ *
+ * Because the mapping is separable, the interpolation kernels are applied one
+ * axis at a time along scanlines, using precomputed tables of indices and
+ * weights, instead of evaluating a 3D interpolation function at each voxel.
+ * The output is computed in slabs, and each pass runs in parallel.
+ *
+ * The results are the same as with itk::ResampleImageFilter combined with the
+ * nearest neighbor, linear or B-spline interpolators (output voxels mapping
+ * outside of the input image are set to zero). For the B-spline kernel, the
+ * input to the filter must be the image of B-spline coefficients, e.g., from
+ * BSplineCoefficientCache.
+ */
+template <class TInputImage, class TOutputImage>
+class AxisAlignedResampleImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+
+  typedef AxisAlignedResampleImageFilter<TInputImage, TOutputImage> Self;
+  typedef itk::ImageToImageFilter<TInputImage, TOutputImage> Superclass;
+  typedef SmartPtr<Self> Pointer;
+  typedef SmartPtr<const Self> ConstPointer;
+
+  itkNewMacro(Self)
+  itkTypeMacro(AxisAlignedResampleImageFilter, ImageToImageFilter)
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  typedef TInputImage InputImageType;
+  typedef TOutputImage OutputImageType;
+  typedef typename InputImageType::InternalPixelType InputComponentType;
+  typedef typename OutputImageType::InternalPixelType OutputComponentType;
+  typedef typename OutputImageType::RegionType RegionType;
+  typedef typename OutputImageType::SizeType SizeType;
+  typedef typename OutputImageType::SpacingType SpacingType;
+  typedef typename OutputImageType::PointType PointType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+  typedef itk::ContinuousIndex<double, ImageDimension> ContinuousIndexType;
+  typedef itk::Vector<double, ImageDimension> StepType;
+  typedef itk::ImageBase<ImageDimension> ImageBaseType;
+  typedef itk::Transform<double, ImageDimension, ImageDimension> TransformType;
+
+  /** Interpolation kernels */
+  enum KernelType { NEAREST_NEIGHBOR = 0, LINEAR, CUBIC_BSPLINE };
+
+  /** Set the interpolation kernel */
+  itkSetMacro(Kernel, KernelType)
+  itkGetMacro(Kernel, KernelType)
+
+  /** Continuous index in the input image sampled by the first output voxel */
+  itkSetMacro(SamplingStart, ContinuousIndexType)
+  itkGetMacro(SamplingStart, ContinuousIndexType)
+
+  /** Increment of the continuous input index per output voxel along each axis */
+  itkSetMacro(SamplingStep, StepType)
+  itkGetMacro(SamplingStep, StepType)
+
+  /** Geometry of the output image */
+  itkSetMacro(OutputSize, SizeType)
+  itkSetMacro(OutputSpacing, SpacingType)
+  itkSetMacro(OutputOrigin, PointType)
+  itkSetMacro(OutputDirection, DirectionType)
+
+  /**
+   * Work out how an output grid maps into an image through a transform, i.e.,
+   * the sampling start and step for this filter. Returns false if the mapping
+   * is not axis-aligned, in which case the filter can not be used.
+   */
+  static bool ComputeSampling(const ImageBaseType *image,
+                              const TransformType *transform,
+                              const PointType &origin,
+                              const SpacingType &spacing,
+                              const DirectionType &direction,
+                              ContinuousIndexType &outStart,
+                              StepType &outStep);
+
+protected:
+
+  AxisAlignedResampleImageFilter();
+  virtual ~AxisAlignedResampleImageFilter() {}
+
+  void GenerateOutputInformation() ITK_OVERRIDE;
+  void GenerateInputRequestedRegion() ITK_OVERRIDE;
+  void EnlargeOutputRequestedRegion(itk::DataObject *output) ITK_OVERRIDE;
+  void GenerateData() ITK_OVERRIDE;
+
+  // Indices (relative to the input buffer) and weights of the input samples
+  // contributing to each output voxel along one axis
+  struct AxisTable
+  {
+    unsigned int Width;
+    std::vector<long> Index;
+    std::vector<double> Weight;
+    std::vector<bool> Inside;
+  };
+
+  void ComputeAxisTable(unsigned int axis, AxisTable &table) const;
+
+  KernelType m_Kernel;
+  ContinuousIndexType m_SamplingStart;
+  StepType m_SamplingStep;
+
+  SizeType m_OutputSize;
+  SpacingType m_OutputSpacing;
+  PointType m_OutputOrigin;
+  DirectionType m_OutputDirection;
+};
+
+
+/**
+ * Cubic B-spline coefficients of an image, computed once and reused for as
+ * long as the image is not modified. The coefficients are a full-size float
+ * copy of the image, so only those of the most recently requested image are
+ * kept, and the cache should not outlive the resampling it is used for.
+ */
+class BSplineCoefficientCache : public itk::Object
+{
+public:
+  irisITKObjectMacro(BSplineCoefficientCache, itk::Object)
+
+  typedef itk::Image<float, 3> CoefficientImageType;
+
+  /** Get the coefficients for an image, computing them if necessary */
+  template <class TImage>
+  CoefficientImageType *GetCoefficients(const TImage *image);
+
+  /** Discard all cached coefficients */
+  void Reset() { m_Cache.clear(); }
+
+protected:
+  BSplineCoefficientCache() {}
+  virtual ~BSplineCoefficientCache() {}
+
+  struct Entry
+  {
+    itk::ModifiedTimeType SourceMTime;
+    SmartPtr<CoefficientImageType> Coefficients;
+  };
+
+  // Cached coefficients, at most one entry
+  std::map<const itk::Object *, Entry> m_Cache;
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "AxisAlignedResampleImageFilter.txx"
+#endif
+
+#endif // AXISALIGNEDRESAMPLEIMAGEFILTER_H
@@ -0,0 +1,353 @@
+#ifndef AXISALIGNEDRESAMPLEIMAGEFILTER_TXX
+#define AXISALIGNEDRESAMPLEIMAGEFILTER_TXX
+
+#include "AxisAlignedResampleImageFilter.h"
+#include "itkBSplineDecompositionImageFilter.h"
+#include "itkMultiThreaderBase.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+template <class TInputImage, class TOutputImage>
+AxisAlignedResampleImageFilter<TInputImage, TOutputImage>
+::AxisAlignedResampleImageFilter()
+{
+  m_Kernel = LINEAR;
+  m_SamplingStart.Fill(0.0);
+  m_SamplingStep.Fill(1.0);
+  m_OutputSize.Fill(0);
+  m_OutputSpacing.Fill(1.0);
+  m_OutputOrigin.Fill(0.0);
+  m_OutputDirection.SetIdentity();
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+AxisAlignedResampleImageFilter<TInputImage, TOutputImage>
+::ComputeSampling(const ImageBaseType *image,
+                  const TransformType *transform,
+                  const PointType &origin,
+                  const SpacingType &spacing,
+                  const DirectionType &direction,
+                  ContinuousIndexType &outStart,
+                  StepType &outStep)
+{
+  if(!transform->IsLinear())
+    return false;
+
+  // Map the first output voxel into the image
+  image->TransformPhysicalPointToContinuousIndex(transform->TransformPoint(origin), outStart);
+
+  // Map its neighbors along each axis, which must only move along the same axis
+  for(unsigned int d = 0; d < ImageDimension; d++)
+    {
+    PointType p = origin;
+    for(unsigned int j = 0; j < ImageDimension; j++)
+      p[j] += direction(j, d) * spacing[d];
+
+    ContinuousIndexType cix;
+    image->TransformPhysicalPointToContinuousIndex(transform->TransformPoint(p), cix);
+    for(unsigned int j = 0; j < ImageDimension; j++)
+      {
+      if(j != d && std::fabs(cix[j] - outStart[j]) > 1.0e-6)
+        return false;
+      }
+    outStep[d] = cix[d] - outStart[d];
+    }
+
+  return true;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+AxisAlignedResampleImageFilter<TInputImage, TOutputImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+
+  OutputImageType *output = this->GetOutput();
+  RegionType region;
+  region.SetSize(m_OutputSize);
+  output->SetLargestPossibleRegion(region);
+  output->SetSpacing(m_OutputSpacing);
+  output->SetOrigin(m_OutputOrigin);
+  output->SetDirection(m_OutputDirection);
+  output->SetNumberOfComponentsPerPixel(this->GetInput()->GetNumberOfComponentsPerPixel());
+}
+
+template <class TInputImage, class TOutputImage>
+void
+AxisAlignedResampleImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImageType *input = const_cast<InputImageType *>(this->GetInput());
+  if(input)
+    input->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <class TInputImage, class TOutputImage>
+void
+AxisAlignedResampleImageFilter<TInputImage, TOutputImage>
+::EnlargeOutputRequestedRegion(itk::DataObject *output)
+{
+  Superclass::EnlargeOutputRequestedRegion(output);
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <class TInputImage, class TOutputImage>
+void
+AxisAlignedResampleImageFilter<TInputImage, TOutputImage>
+::ComputeAxisTable(unsigned int axis, AxisTable &table) const
+{
+  const RegionType &inRegion = this->GetInput()->GetBufferedRegion();
+  long n = inRegion.GetSize(axis);
+  unsigned int nOut = m_OutputSize[axis];
+
+  table.Width = (m_Kernel == NEAREST_NEIGHBOR) ? 1 : (m_Kernel == LINEAR ? 2 : 4);
+  table.Index.assign(nOut * table.Width, 0);
+  table.Weight.assign(nOut * table.Width, 0.0);
+  table.Inside.assign(nOut, false);
+
+  for(unsigned int i = 0; i < nOut; i++)
+    {
+    // Continuous index relative to the start of the buffer
+    double x = m_SamplingStart[axis] + i * m_SamplingStep[axis] - inRegion.GetIndex(axis);
+
+    // Same test as ImageBase::IsInsideBuffer for continuous indices
+    if(!(x >= -0.5 && x < n - 0.5))
+      continue;
+
+    table.Inside[i] = true;
+    long *idx = &table.Index[i * table.Width];
+    double *w = &table.Weight[i * table.Width];
+
+    if(m_Kernel == NEAREST_NEIGHBOR)
+      {
+      idx[0] = std::min((long) std::floor(x + 0.5), n - 1);
+      w[0] = 1.0;
+      }
+    else if(m_Kernel == LINEAR)
+      {
+      // As in itk::LinearInterpolateImageFunction, the border voxel is used
+      // past either end of the buffer
+      long b = (long) std::floor(x);
+      double t = x - b;
+      if(b < 0)
+        {
+        b = 0;
+        t = 0.0;
+        }
+      idx[0] = b;
+      idx[1] = std::min(b + 1, n - 1);
+      w[0] = (b + 1 < n) ? 1.0 - t : 1.0;
+      w[1] = (b + 1 < n) ? t : 0.0;
+      }
+    else
+      {
+      // Cubic B-spline weights, with mirror boundary conditions as in
+      // itk::BSplineInterpolateImageFunction
+      long b = (long) std::floor(x);
+      double t = x - b;
+      w[3] = t * t * t / 6.0;
+      w[0] = 1.0 / 6.0 + 0.5 * t * (t - 1.0) - w[3];
+      w[2] = t + w[0] - 2.0 * w[3];
+      w[1] = 1.0 - w[0] - w[2] - w[3];
+      for(int k = 0; k < 4; k++)
+        {
+        long m = b - 1 + k;
+        if(n == 1)
+          m = 0;
+        else
+          {
+          if(m < 0)
+            m = -m;
+          if(m > n - 1)
+            m = 2 * (n - 1) - m;
+          }
+        idx[k] = std::max(0L, std::min(m, n - 1));
+        }
+      }
+    }
+}
+
+// Conversion of interpolated values to the output type, clamping to the range
+// of integer types as in itk::ResampleImageFilter
+template <class TComponent>
+inline TComponent AxisAlignedResampleCast(double value)
+{
+  if constexpr (std::numeric_limits<TComponent>::is_integer)
+    {
+    value = std::max(value, (double) std::numeric_limits<TComponent>::lowest());
+    value = std::min(value, (double) std::numeric_limits<TComponent>::max());
+    }
+  return static_cast<TComponent>(value);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+AxisAlignedResampleImageFilter<TInputImage, TOutputImage>
+::GenerateData()
+{
+  const InputImageType *input = this->GetInput();
+  OutputImageType *output = this->GetOutput();
+  output->SetBufferedRegion(output->GetRequestedRegion());
+  output->Allocate();
+
+  const RegionType &inRegion = input->GetBufferedRegion();
+  size_t nc = input->GetNumberOfComponentsPerPixel();
+  size_t in_nx = inRegion.GetSize(0), in_ny = inRegion.GetSize(1);
+  size_t nx = m_OutputSize[0], ny = m_OutputSize[1], nz = m_OutputSize[2];
+  size_t line = nx * nc;
+
+  const InputComponentType *in = input->GetBufferPointer();
+  OutputComponentType *out = output->GetBufferPointer();
+  std::fill(out, out + line * ny * nz, OutputComponentType(0));
+  if(inRegion.GetNumberOfPixels() == 0 || line == 0)
+    return;
+
+  // Index and weight tables for each axis
+  AxisTable tx, ty, tz;
+  this->ComputeAxisTable(0, tx);
+  this->ComputeAxisTable(1, ty);
+  this->ComputeAxisTable(2, tz);
+
+  // Range of input rows needed along y
+  long y0 = std::numeric_limits<long>::max(), y1 = -1;
+  for(size_t j = 0; j < ny; j++)
+    {
+    if(ty.Inside[j])
+      {
+      for(unsigned int k = 0; k < ty.Width; k++)
+        {
+        y0 = std::min(y0, ty.Index[j * ty.Width + k]);
+        y1 = std::max(y1, ty.Index[j * ty.Width + k]);
+        }
+      }
+    }
+  if(y1 < 0)
+    return;
+  size_t ry = y1 - y0 + 1;
+
+  itk::MultiThreaderBase *mt = this->GetMultiThreader();
+  std::vector<double> buf1, buf2;
+
+  // The output is computed in slabs of slices, to limit the size of the
+  // intermediate buffers
+  const size_t slab = 8;
+  for(size_t k0 = 0; k0 < nz; k0 += slab)
+    {
+    size_t k1 = std::min(k0 + slab, nz);
+
+    // Range of input slices needed for this slab
+    long z0 = std::numeric_limits<long>::max(), z1 = -1;
+    for(size_t k = k0; k < k1; k++)
+      {
+      if(tz.Inside[k])
+        {
+        for(unsigned int q = 0; q < tz.Width; q++)
+          {
+          z0 = std::min(z0, tz.Index[k * tz.Width + q]);
+          z1 = std::max(z1, tz.Index[k * tz.Width + q]);
+          }
+        }
+      }
+
+    if(z1 >= 0)
+      {
+      size_t rz = z1 - z0 + 1;
+
+      // Interpolate along x: input rows to rows of nx samples
+      buf1.assign(line * ry * rz, 0.0);
+      mt->ParallelizeArray(0, ry * rz, [&](itk::SizeValueType row)
+        {
+        size_t y = row % ry, z = row / ry;
+        const InputComponentType *src = in + ((z0 + z) * in_ny + (y0 + y)) * in_nx * nc;
+        double *dst = buf1.data() + row * line;
+        for(size_t i = 0; i < nx; i++)
+          {
+          const long *idx = &tx.Index[i * tx.Width];
+          const double *w = &tx.Weight[i * tx.Width];
+          for(size_t c = 0; c < nc; c++)
+            {
+            double v = 0.0;
+            for(unsigned int k = 0; k < tx.Width; k++)
+              v += w[k] * src[idx[k] * nc + c];
+            dst[i * nc + c] = v;
+            }
+          }
+        }, nullptr);
+
+      // Interpolate along y
+      buf2.assign(line * ny * rz, 0.0);
+      mt->ParallelizeArray(0, ny * rz, [&](itk::SizeValueType row)
+        {
+        size_t j = row % ny, z = row / ny;
+        double *dst = buf2.data() + row * line;
+        for(unsigned int k = 0; k < ty.Width; k++)
+          {
+          double w = ty.Weight[j * ty.Width + k];
+          if(w == 0.0)
+            continue;
+          const double *src = buf1.data() + (z * ry + (ty.Index[j * ty.Width + k] - y0)) * line;
+          for(size_t t = 0; t < line; t++)
+            dst[t] += w * src[t];
+          }
+        }, nullptr);
+
+      // Interpolate along z and write the output
+      mt->ParallelizeArray(0, ny * (k1 - k0), [&](itk::SizeValueType row)
+        {
+        size_t j = row % ny, k = k0 + row / ny;
+        if(!ty.Inside[j] || !tz.Inside[k])
+          return;
+
+        std::vector<double> acc(line, 0.0);
+        for(unsigned int q = 0; q < tz.Width; q++)
+          {
+          double w = tz.Weight[k * tz.Width + q];
+          if(w == 0.0)
+            continue;
+          const double *src = buf2.data() + ((tz.Index[k * tz.Width + q] - z0) * ny + j) * line;
+          for(size_t t = 0; t < line; t++)
+            acc[t] += w * src[t];
+          }
+
+        OutputComponentType *dst = out + (k * ny + j) * line;
+        for(size_t i = 0; i < nx; i++)
+          if(tx.Inside[i])
+            for(size_t c = 0; c < nc; c++)
+              dst[i * nc + c] = AxisAlignedResampleCast<OutputComponentType>(acc[i * nc + c]);
+        }, nullptr);
+      }
+
+    this->UpdateProgress((float) k1 / nz);
+    }
+}
+
+template <class TImage>
+BSplineCoefficientCache::CoefficientImageType *
+BSplineCoefficientCache::GetCoefficients(const TImage *image)
+{
+  auto it = m_Cache.find(image);
+  if(it != m_Cache.end() && it->second.SourceMTime == image->GetMTime())
+    return it->second.Coefficients;
+
+  // Only the coefficients of the most recent image are kept
+  m_Cache.clear();
+
+  typedef itk::BSplineDecompositionImageFilter<TImage, CoefficientImageType> FilterType;
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetSplineOrder(3);
+  filter->SetInput(image);
+  filter->Update();
+
+  Entry &entry = m_Cache[image];
+  entry.SourceMTime = image->GetMTime();
+  entry.Coefficients = filter->GetOutput();
+  entry.Coefficients->DisconnectPipeline();
+  return entry.Coefficients;
+}
+
+#endif // AXISALIGNEDRESAMPLEIMAGEFILTER_TXX
@@ -37,6 +37,7 @@
 #include "SNAPCommon.h"
 #include "SNAPRegistryIO.h"
 #include "ImageCoordinateGeometry.h"
+#include "TraceRecorder.h"
 
 #include "itkImage.h"
 #include "itkImageIOBase.h"
@@ -458,6 +459,8 @@ void
 GuidedNativeImageIO
 ::ReadNativeImageHeader(const char *FileName, Registry &folder, itk::Command *progressCmd)
 {
+  SNAP_TRACE_SCOPE_DETAIL("io", "ReadNativeImageHeader", FileName);
+
 	/* Progress Command Usage:
 	 * We only add progressCmd as observers to each conditional branch, which
 	 * means we don't have shared progress in the header reading method. Assuming
@@ -705,6 +708,8 @@ void
 GuidedNativeImageIO
 ::ReadNativeImageData(itk::Command *progressCmd)
 {
+  SNAP_TRACE_SCOPE_DETAIL("io", "ReadNativeImageData", m_NativeFileName);
+
   // Based on the component type, read image in native mode
   DispatchBase *dispatch = this->CreateDispatch(m_IOBase->GetComponentType());
 	dispatch->ReadNative(this, m_NativeFileName.c_str(), m_Hints, progressCmd);
@@ -1475,6 +1480,8 @@ void
 GuidedNativeImageIO
 ::SaveNativeImage(const char *FileName, Registry &folder)
 {
+  SNAP_TRACE_SCOPE_DETAIL("io", "SaveNativeImage", FileName);
+
   // Cast image from native format to TPixel
   DispatchBase *dispatch = this->CreateDispatch(this->GetComponentTypeInNativeImage());
   dispatch->SaveNative(this, FileName, folder);
@@ -53,6 +53,7 @@
 #include <itkIdentityTransform.h>
 #include <itkFlipImageFilter.h>
 #include <itkUnaryFunctorImageFilter.h>
+#include <itkMultiThreaderBase.h>
 #include "UnaryFunctorVectorImageFilter.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
@@ -70,11 +71,13 @@
 #include "itkCastImageFilter.h"
 #include "RLEImageRegionConstIterator.h"
 #include "TDigestImageFilter.h"
+#include "AxisAlignedResampleImageFilter.h"
 #include "AllPurposeProgressAccumulator.h"
 
 #include <vnl/vnl_inverse.h>
 #include <iostream>
 #include <cassert>
+#include <limits>
 
 #include <itksys/SystemTools.hxx>
 
@@ -204,7 +207,8 @@ public:
                                         const TransformType *itkNotUsed(transform),
                                         const SNAPSegmentationROISettings &itkNotUsed(roi),
                                         bool itkNotUsed(force_resampling),
-                                        itk::Command *itkNotUsed(progressCommand))
+                                        itk::Command *itkNotUsed(progressCommand),
+                                        BSplineCoefficientCache *itkNotUsed(cache))
   {
     throw IRISException("CopyRegion unsupported for class %s",
                         image->GetNameOfClass());
@@ -253,6 +257,13 @@ public:
 
   }
 
+  static void SamplePatchesAsFloat(TImage *image, const std::vector<itk::Index<3> > &,
+                                   const PatchOffsetTable &, float * const *, size_t,
+                                   itk::MultiThreaderBase *)
+  {
+    throw IRISException("SamplePatchesAsFloat unsupported for class %s", image->GetNameOfClass());
+  }
+
   /*
   template <typename TPixel>
   static void UpdateImportPointer(Image4DType *image_4d,
@@ -309,6 +320,93 @@ public:
     writer->Update();
   }
 
+  // Compute the spacing and origin of the resampled ROI
+  static void ComputeResampledRegionGeometry(
+      ImageBaseType *refspace,
+      const SNAPSegmentationROISettings &roi,
+      Vector3d &vNewSpacing, Vector3d &vNewOrigin)
+  {
+    Vector3d vOldSpacing = refspace->GetSpacing();
+    Vector3d vOldOrigin = refspace->GetOrigin();
+    Vector3i vROIIndex(roi.GetROI().GetIndex());
+    Vector3ui vROISize(roi.GetROI().GetSize());
+
+    // We need the direction matrix
+    typedef typename ImageType::DirectionType DirectionType;
+    const DirectionType &dm = refspace->GetDirection();
+
+    // The spacing of the new ROI
+    vNewSpacing =
+        element_quotient(element_product(vOldSpacing, to_double(vROISize)),
+                         to_double(roi.GetResampleDimensions()));
+
+    // The origin of the new ROI
+    vNewOrigin =
+        vOldOrigin + dm.GetVnlMatrix() * (
+          element_product((to_double(vROIIndex) - 0.5), vOldSpacing) +
+          vNewSpacing * 0.5);
+  }
+
+  /**
+   * Resample the ROI with the separable resampling filter. This is possible
+   * when the output grid is aligned with the axes of the image, e.g., when
+   * the image lives in the reference space and the ROI is just scaled. The
+   * sampled image is the image itself, or its B-spline coefficients for
+   * cubic interpolation. Returns NULL if the fast path does not apply.
+   */
+  template <class TSampledImage>
+  static SmartPtr<ImageType> AxisAlignedResampleRegion(
+      const TSampledImage *sampled,
+      ImageBaseType *refspace,
+      const TransformType *transform,
+      const SNAPSegmentationROISettings &roi,
+      itk::Command *progressCommand)
+  {
+    typedef AxisAlignedResampleImageFilter<TSampledImage, ImageType> FilterType;
+    typename FilterType::KernelType kernel;
+    switch(roi.GetInterpolationMethod())
+      {
+      case NEAREST_NEIGHBOR : kernel = FilterType::NEAREST_NEIGHBOR; break;
+      case TRILINEAR : kernel = FilterType::LINEAR; break;
+      case TRICUBIC : kernel = FilterType::CUBIC_BSPLINE; break;
+      default : return NULL;
+      }
+
+    Vector3d vNewSpacing, vNewOrigin;
+    ComputeResampledRegionGeometry(refspace, roi, vNewSpacing, vNewOrigin);
+
+    typename FilterType::PointType origin;
+    typename FilterType::SpacingType spacing;
+    for(unsigned int d = 0; d < 3; d++)
+      {
+      origin[d] = vNewOrigin[d];
+      spacing[d] = vNewSpacing[d];
+      }
+
+    // Check that the resampling is axis-aligned
+    typename FilterType::ContinuousIndexType start;
+    typename FilterType::StepType step;
+    if(!FilterType::ComputeSampling(sampled, transform, origin, spacing,
+                                    refspace->GetDirection(), start, step))
+      return NULL;
+
+    typename FilterType::Pointer filter = FilterType::New();
+    filter->SetInput(sampled);
+    filter->SetKernel(kernel);
+    filter->SetSamplingStart(start);
+    filter->SetSamplingStep(step);
+    filter->SetOutputSize(to_itkSize(roi.GetResampleDimensions()));
+    filter->SetOutputSpacing(spacing);
+    filter->SetOutputOrigin(origin);
+    filter->SetOutputDirection(refspace->GetDirection());
+
+    if(progressCommand)
+      filter->AddObserver(itk::AnyEvent(), progressCommand);
+
+    filter->Update();
+    return filter->GetOutput();
+  }
+
   template <class TInterpolateFunction>
   static SmartPtr<ImageType> DeepCopyImageRegion(
       ImageType *image,
@@ -319,29 +417,11 @@ public:
       bool force_resampling,
       itk::Command *progressCommand)
   {
-    // Check if there is a difference in voxel size, i.e., user wants resampling
-    Vector3d vOldSpacing = refspace->GetSpacing();
-    Vector3d vOldOrigin = refspace->GetOrigin();
-    Vector3i vROIIndex(roi.GetROI().GetIndex());
-    Vector3ui vROISize(roi.GetROI().GetSize());
-
     if(force_resampling || roi.IsResampling())
       {
-      // We need to compute the new spacing and origin of the resampled
-      // ROI piece. To do this, we need the direction matrix
-      typedef typename ImageType::DirectionType DirectionType;
-      const DirectionType &dm = refspace->GetDirection();
-
-      // The spacing of the new ROI
-      Vector3d vNewSpacing =
-          element_quotient(element_product(vOldSpacing, to_double(vROISize)),
-                           to_double(roi.GetResampleDimensions()));
-
-      // The origin of the new ROI
-      Vector3d vNewOrigin =
-          vOldOrigin + dm.GetVnlMatrix() * (
-            element_product((to_double(vROIIndex) - 0.5), vOldSpacing) +
-            vNewSpacing * 0.5);
+      // Compute the new spacing and origin of the resampled ROI piece
+      Vector3d vNewSpacing, vNewOrigin;
+      ComputeResampledRegionGeometry(refspace, roi, vNewSpacing, vNewOrigin);
 
       // Create a filter for resampling the image
       typedef itk::ResampleImageFilter<ImageType,ImageType> ResampleFilterType;
@@ -477,6 +557,49 @@ public:
         out[i++] = (double) buffer[k];
   }
 
+  /**
+   * Sample many patches at once. Each patch is written to its own output row,
+   * starting at the given column, ordered first by component and then by
+   * location in the patch. Patches are sampled in parallel with the given
+   * threader, reading the buffer directly with the native component type.
+   */
+  static void SamplePatchesAsFloat(TImage *image, const std::vector<itk::Index<3> > &idx,
+                                   const PatchOffsetTable &offset_table,
+                                   float * const *out_rows, size_t column,
+                                   itk::MultiThreaderBase *mt)
+  {
+    typedef ImagePartialSpecialization<TImage> Specializaton;
+    const int nc = Specializaton::IsVector::value ? Specializaton::GetNumberOfComponents(image) : 1;
+
+    // Number of pixels in the patch
+    int patch_size = 0;
+    for(auto &p : offset_table)
+      patch_size += (p.second - p.first) / nc;
+
+    const auto *buffer = image->GetBufferPointer();
+    const itk::Index<3> &origin = image->GetBufferedRegion().GetIndex();
+    const auto *offsets = image->GetOffsetTable();
+
+    mt->ParallelizeArray(0, idx.size(), [&](itk::SizeValueType row)
+      {
+      // Buffer offset of the center pixel
+      typedef itk::ImageHelper<3, 3> Helper;
+      typename Helper::OffsetValueType offset = 0;
+      Helper::ComputeOffset(origin, idx[row], offsets, offset);
+      offset *= nc;
+
+      // Walk the strides of the patch, scattering the components
+      float *out_row = out_rows[row] + column;
+      int j = 0;
+      for(auto &p : offset_table)
+        {
+        for(int k = p.first + offset; k < p.second + offset; k += nc, j++)
+          for(int c = 0; c < nc; c++)
+            out_row[c * patch_size + j] = (float) buffer[k + c];
+        }
+      }, nullptr);
+  }
+
 
 
   /*
@@ -521,8 +644,24 @@ public:
                                         const typename Superclass::TransformType *transform,
                                         const SNAPSegmentationROISettings &roi,
                                         bool force_resampling,
-                                        itk::Command *progressCommand)
+                                        itk::Command *progressCommand,
+                                        BSplineCoefficientCache *cache)
   {
+    // Axis-aligned resampling uses the separable resampler, with cached
+    // B-spline coefficients for cubic interpolation
+    if(force_resampling || roi.IsResampling())
+      {
+      SmartPtr<ImageType> result;
+      if(roi.GetInterpolationMethod() == TRICUBIC && cache)
+        result = Superclass::AxisAlignedResampleRegion(
+                   cache->GetCoefficients(image), refspace, transform, roi, progressCommand);
+      else if(roi.GetInterpolationMethod() != TRICUBIC)
+        result = Superclass::AxisAlignedResampleRegion(
+                   image, refspace, transform, roi, progressCommand);
+      if(result)
+        return result;
+      }
+
     typedef itk::InterpolateImageFunction<ImageType> Interpolator;
     SmartPtr<Interpolator> interp = NULL;
 
@@ -594,8 +733,18 @@ public:
                                         const typename Superclass::TransformType *transform,
                                         const SNAPSegmentationROISettings &roi,
                                         bool force_resampling,
-                                        itk::Command *progressCommand)
+                                        itk::Command *progressCommand,
+                                        BSplineCoefficientCache *itkNotUsed(cache))
   {
+    // Axis-aligned resampling uses the separable resampler
+    if((force_resampling || roi.IsResampling()) && roi.GetInterpolationMethod() != TRICUBIC)
+      {
+      SmartPtr<ImageType> result = Superclass::AxisAlignedResampleRegion(
+                                     image, refspace, transform, roi, progressCommand);
+      if(result)
+        return result;
+      }
+
     typedef itk::InterpolateImageFunction<ImageType> Interpolator;
     SmartPtr<Interpolator> interp = NULL;
 
@@ -767,7 +916,8 @@ public:
                                         const TransformType *transform,
                                         const SNAPSegmentationROISettings &roi,
                                         bool force_resampling,
-                                        itk::Command *progressCommand)
+                                        itk::Command *progressCommand,
+                                        BSplineCoefficientCache *itkNotUsed(cache))
   {
     //the interpolator will operate on uncompressed region
     typedef itk::InterpolateImageFunction<UncompressedType> Interpolator;
@@ -965,6 +1115,9 @@ ImageWrapper<TTraits>
   // Initialize the t-digest filter
   m_TDigestFilter = TDigestFilterType::New();
 
+  // The threader used to sample patches
+  m_PatchSamplingThreader = itk::MultiThreaderBase::New();
+
   // Update the image geometry to default value
   this->UpdateImageGeometry();
 }
@@ -1746,6 +1899,18 @@ ImageWrapper<TTraits>
   Specialization::SamplePatchAsDouble(m_Image, idx, offset_table, out_patch);
 }
 
+template<class TTraits>
+void
+ImageWrapper<TTraits>
+::SamplePatchesAsFloat(
+    const std::vector<IndexType> &idx, const PatchOffsetTable &offset_table,
+    float * const *out_rows, size_t column) const
+{
+  typedef ImageWrapperPartialSpecializationTraits<ImageType, Image4DType> Specialization;
+  Specialization::SamplePatchesAsFloat(
+        m_Image.GetPointer(), idx, offset_table, out_rows, column, m_PatchSamplingThreader);
+}
+
 
 template<class TTraits>
 void
@@ -2685,6 +2850,15 @@ ImageWrapper<TTraits>
 {
   typedef ImageWrapperPartialSpecializationTraits<ImageType, Image4DType> Specialization;
   Specialization::SetSourceNativeMapping(m_Image4D, scale, shift);
+  this->UpdateTimePointPixelAccessors();
+}
+
+template<class TTraits>
+void
+ImageWrapper<TTraits>
+::UpdateTimePointPixelAccessors()
+{
+  typedef ImageWrapperPartialSpecializationTraits<ImageType, Image4DType> Specialization;
   for(unsigned int j = 0; j < m_ImageTimePoints.size(); j++)
     Specialization::ConfigureTimePointImageFromImage4D(m_Image4D, m_ImageTimePoints[j], j);
 }
@@ -2799,13 +2973,16 @@ ImageWrapper<TTraits>
   // we must force resampling to occur
   bool force_resampling = !this->IsSlicingOrthogonal();
 
+  // The B-spline coefficients are released once the region is extracted
+  SmartPtr<BSplineCoefficientCache> cache = BSplineCoefficientCache::New();
+
   // We use partial template specialization here because region copy is
   // only supported for images that are concrete (Image, VectorImage)
   typedef ImageWrapperPartialSpecializationTraits<ImageType, Image4DType> Specialization;
   return Specialization::CopyRegion(
         m_Image, m_ReferenceSpace,
         this->GetITKTransform(), roi,
-        force_resampling, progressCommand);
+        force_resampling, progressCommand, cache);
 }
 
 template<class TTraits>
@@ -2821,6 +2998,9 @@ ImageWrapper<TTraits>
   Image4DPointer outImg = Image4DType::New();
   const unsigned int nT = this->GetNumberOfTimePoints();
 
+  // Holds the B-spline coefficients of one time point at a time
+  SmartPtr<BSplineCoefficientCache> cache = BSplineCoefficientCache::New();
+
   // Set the spacing, origin, direction for the last coordinate
   auto spacing_4d = m_Image4D->GetSpacing();
   auto origin_4d = m_Image4D->GetOrigin();
@@ -2857,7 +3037,7 @@ ImageWrapper<TTraits>
     {
     tpImg = this->GetImageByTimePoint(t);
     tpResliced = Specialization::CopyRegion(tpImg, m_ReferenceSpace, this->GetITKTransform(),
-                                         roi, force_resampling, TPCommand[t]);
+                                         roi, force_resampling, TPCommand[t], cache);
 
     auto buffer3d = tpResliced->GetPixelContainer()->GetBufferPointer();
     memcpy(pCrntTPStart, buffer3d, buffer3dSizeInBytes);
@@ -3069,6 +3249,49 @@ class CreateCastToTargetTypePipelinePartialSpecializationTraits<
 };
 
 
+template<class TTraits>
+template <class TOutputImage, class TSpecialization>
+TOutputImage *
+ImageWrapper<TTraits>
+::GetSharedCastPipeline(SharedCastPipeline &shared, const char *key, int index)
+{
+  // Replace any pipeline previously stored under this key and index
+  this->ReleaseInternalPipeline(key, index);
+
+  // Create the cast if there is none or if it was made for another image or mapping
+  if(!shared.pipeline.output || shared.source != m_Image || shared.mapping != m_NativeMapping)
+    {
+    auto p = TSpecialization::CreatePipeline(this->m_Image, this->m_NativeMapping);
+    if(!p.second)
+      return NULL;
+
+    shared.pipeline = p.first;
+    shared.pipeline.output = p.second.GetPointer();
+    shared.source = m_Image;
+    shared.mapping = m_NativeMapping;
+    shared.users.clear();
+    }
+
+  this->AddInternalPipeline(shared.pipeline, key, index);
+  shared.users.insert(std::make_pair(std::string(key), index));
+
+  return static_cast<TOutputImage *>(shared.pipeline.output.GetPointer());
+}
+
+template<class TTraits>
+void
+ImageWrapper<TTraits>
+::ReleaseSharedCastUser(SharedCastPipeline &shared, const std::string &key, int index)
+{
+  auto it = shared.users.lower_bound(std::make_pair(key, index < 0 ? std::numeric_limits<int>::min() : index));
+  while(it != shared.users.end() && it->first == key && (index < 0 || it->second == index))
+    it = shared.users.erase(it);
+
+  // Drop the cast when it is no longer used
+  if(shared.users.empty())
+    shared = SharedCastPipeline();
+}
+
 template<class TTraits>
 typename ImageWrapper<TTraits>::FloatImageType *
 ImageWrapper<TTraits>
@@ -3080,12 +3303,8 @@ ImageWrapper<TTraits>
   typedef CreateCastToTargetTypePipelinePartialSpecializationTraits<
       ImageType, FloatImageType, NativeIntensityMapping, IsLinear::value, !IsVector::value> Specialization;
 
-  auto p = Specialization::CreatePipeline(this->m_Image, this->m_NativeMapping);
-
-  if(p.second)
-    this->AddInternalPipeline(p.first, key, index);
-
-  return p.second;
+  return this->template GetSharedCastPipeline<FloatImageType, Specialization>(
+        m_SharedCastToFloat, key, index);
 }
 
 template<class TTraits>
@@ -3098,15 +3317,9 @@ ImageWrapper<TTraits>
   // Create a pipeline that maps us to the matching image
   typedef CreateCastToTargetTypePipelinePartialSpecializationTraits<
       ImageType, FloatVectorImageType, NativeIntensityMapping, IsLinear::value, IsVector::value> Specialization;
-  auto p = Specialization::CreatePipeline(this->m_Image, this->m_NativeMapping);
-
-  // Now, if MatchingFloatImage is not a FloatVectorImageType, we have to create a filter that
-  // will disguise it as one
-
-  if(p.second)
-    this->AddInternalPipeline(p.first, key, index);
 
-  return p.second;
+  return this->template GetSharedCastPipeline<FloatVectorImageType, Specialization>(
+        m_SharedCastToFloatVector, key, index);
 }
 
 template<class TTraits>
@@ -3155,6 +3368,9 @@ template<class TTraits>
 void ImageWrapper<TTraits>::ReleaseInternalPipeline(const char *key, int index)
 {
   std::string k(key);
+  this->ReleaseSharedCastUser(m_SharedCastToFloat, k, index);
+  this->ReleaseSharedCastUser(m_SharedCastToFloatVector, k, index);
+
   if(index < 0)
     {
     m_ManagedPipelines.erase(k);
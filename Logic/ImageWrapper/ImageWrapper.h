@@ -44,6 +44,7 @@
 #include <DisplayMappingPolicy.h>
 #include <itkSimpleDataObjectDecorator.h>
 #include <array>
+#include <set>
 #include <vector>
 
 // Forward declarations to IRIS classes
@@ -62,6 +63,7 @@ class SNAPSegmentationROISettings;
 namespace itk {
   template <unsigned int VDimension> class ImageBase;
   template <class TImage> class ImageSource;
+  class MultiThreaderBase;
   template <typename TScalar, unsigned int V1, unsigned int V2> class Transform;
   template<typename TInputImage,
            typename TOutputImage> class ExtractImageFilter;
@@ -358,6 +360,11 @@ public:
   virtual void SamplePatchAsDouble(const IndexType &idx, const PatchOffsetTable &offset_table,
                                    double *out_patch) const ITK_OVERRIDE;
 
+  /** Sample patches around a list of pixel locations into rows of floats */
+  virtual void SamplePatchesAsFloat(const std::vector<IndexType> &idx,
+                                    const PatchOffsetTable &offset_table,
+                                    float * const *out_rows, size_t column) const ITK_OVERRIDE;
+
   /**
    * Sample image intensity at a 4D position in the reference space. If the reference
    * space does not match the native space, the intensity will be interpolated based
@@ -418,7 +425,7 @@ public:
    * This function should be called whenever the pixels in the image returned via GetModifableImage
    * are modified. This will cause pipelines to update correctly.
    */
-  void PixelsModified();
+  virtual void PixelsModified();
 
   /**
    * Replace the pixel data in the wrapped 4D image with a new data array. This method should be
@@ -721,6 +728,13 @@ public:
    */
   void SetSourceNativeMapping(double scale, double shift);
 
+  /**
+   * This method is only used when this wrapper is around an image adaptor.
+   * After the pixel accessor of the 4D adaptor has been modified, it must be
+   * passed on to the images that represent the individual time points.
+   */
+  void UpdateTimePointPixelAccessors();
+
   /**
     * Get the image from a specific timepoint
     */
@@ -746,6 +760,10 @@ public:
     this method in terms of memory, so the recommended use is in conjunction with
     streaming filters, so that the cast mini-pipeline does not allocate the whole
     floating point image all at once.
+
+    Pipelines created with different keys share a single cast of the image, so
+    that the image is not cast to float more than once. The cast is released
+    when the last pipeline using it is released.
     */
   virtual FloatImageType* CreateCastToFloatPipeline(const char *key, int index = 0) ITK_OVERRIDE;
 
@@ -900,6 +918,11 @@ protected:
    */
   SmartPtr<TDigestFilterType> m_TDigestFilter;
 
+  /**
+   * Threader used to sample patches, created once and reused by all calls
+   */
+  SmartPtr<itk::MultiThreaderBase> m_PatchSamplingThreader;
+
   /**
    * Internally cached transform from image coordinates to RAS (NIFTI) physical coordinates.
    * This is derived from the origin, spacing, and direction cosine matrix in the image header.
@@ -932,6 +955,34 @@ protected:
   /** Internally used method to create a mini-pipeline */
   virtual void AddInternalPipeline(const MiniPipeline &mp, const char *key, int index);
 
+  /**
+   * A cast of the image to a floating point type that is shared between the
+   * managed pipelines. The cast is valid for as long as the image and the
+   * native mapping it was created for are current. The keys of the managed
+   * pipelines that use the cast are kept, and the cast is dropped when the
+   * last of these pipelines is released.
+   */
+  struct SharedCastPipeline
+  {
+    MiniPipeline pipeline;
+    SmartPtr<ImageType> source;
+    NativeIntensityMapping mapping;
+    std::set< std::pair<std::string, int> > users;
+  };
+
+  /** Shared casts to float and to float vector images */
+  SharedCastPipeline m_SharedCastToFloat, m_SharedCastToFloatVector;
+
+  /**
+   * Get the output of a shared cast, creating the cast if needed, and register
+   * it as the managed pipeline with the given key and index
+   */
+  template <class TOutputImage, class TSpecialization>
+  TOutputImage *GetSharedCastPipeline(SharedCastPipeline &shared, const char *key, int index);
+
+  /** Remove a managed pipeline from the users of the shared casts */
+  void ReleaseSharedCastUser(SharedCastPipeline &shared, const std::string &key, int index);
+
 
 
   /**
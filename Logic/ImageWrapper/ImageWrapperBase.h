@@ -352,12 +352,14 @@ public:
   /** Return componentwise maximum cast to double, after mapping to native range */
   virtual double GetImageMaxNative() = 0;
 
-  /** Compute statistics over a run of voxels in the image starting at the index
-   * startIdx. Appends the statistics to a running sum and sum of squared. The
-   * statistics are returned in internal (not native mapped) format */
+  /** Compute statistics over a run of voxels in the image of time point tp,
+   * starting at the index startIdx. Appends the statistics to a running sum and
+   * sum of squared. The statistics are returned in internal (not native mapped)
+   * format. Since the time point is given, the result does not depend on the
+   * current time point of the layer */
   virtual void GetRunLengthIntensityStatistics(
       const itk::ImageRegion<3> &region,
-      const itk::Index<3> &startIdx, long runlength,
+      const itk::Index<3> &startIdx, long runlength, unsigned int tp,
       double *out_nvalid, double *out_sum, double *out_sumsq) const = 0;
 
   /**
@@ -376,9 +378,11 @@ public:
    * This method samples a 2D slice based on a reference geometry from
    * the current image and maps it using the current display mapping. It
    * is used to generate thumbnails and for other sampling of image
-   * appearance that is outside of the main display pipeline
+   * appearance that is outside of the main display pipeline. By default,
+   * nearest neighbor interpolation is used, otherwise linear
    */
-  virtual DisplaySlicePointer SampleArbitraryDisplaySlice(const ImageBaseType *ref_space) = 0;
+  virtual DisplaySlicePointer SampleArbitraryDisplaySlice(
+      const ImageBaseType *ref_space, bool use_nearest_neighbor = true) = 0;
 
   typedef std::vector< std::pair<int, int> > PatchOffsetTable;
 
@@ -397,6 +401,17 @@ public:
   virtual void SamplePatchAsDouble(const IndexType &idx, const PatchOffsetTable &offset_table,
                                    double *out_patch) const = 0;
 
+  /**
+   * Sample the image patches around a list of pixel locations. The patch
+   * around the i-th location is written to out_rows[i], starting at the given
+   * column. Within a row, the values are ordered first by component and then by
+   * location in the patch. As with SamplePatchAsDouble, no bounds checking is
+   * done. The patches are sampled in parallel.
+   */
+  virtual void SamplePatchesAsFloat(const std::vector<IndexType> &idx,
+                                    const PatchOffsetTable &offset_table,
+                                    float * const *out_rows, size_t column) const = 0;
+
   /** Clear the data associated with storing an image */
   virtual void Reset() = 0;
 
@@ -656,6 +671,13 @@ public:
   virtual bool FindScalarRepresentation(
       ImageWrapperBase *scalar_rep, ScalarRepresentation &type, int &index) const = 0;
 
+  /**
+   * Whether to precompute the derived scalar quantities (magnitude, maximum,
+   * mean) and how much memory they may use, in bytes
+   */
+  virtual void SetMaterializeDerivedQuantities(bool value) = 0;
+  virtual void SetDerivedQuantityMemoryBudget(size_t bytes) = 0;
+
 };
 
 
@@ -43,6 +43,27 @@
 #include "LabelImageWrapper.h"
 #include "UndoDataManager.h"
 #include "Rebroadcaster.h"
+#include <algorithm>
+
+// Smallest region containing two regions, either of which may be empty
+static itk::ImageRegion<3> UnionRegion(const itk::ImageRegion<3> &a, const itk::ImageRegion<3> &b)
+{
+  if(a.GetNumberOfPixels() == 0)
+    return b;
+  if(b.GetNumberOfPixels() == 0)
+    return a;
+
+  itk::ImageRegion<3> u;
+  for(int d = 0; d < 3; d++)
+    {
+    itk::IndexValueType i0 = std::min(a.GetIndex(d), b.GetIndex(d));
+    itk::IndexValueType i1 = std::max(a.GetIndex(d) + (itk::IndexValueType) a.GetSize(d),
+                                      b.GetIndex(d) + (itk::IndexValueType) b.GetSize(d));
+    u.SetIndex(d, i0);
+    u.SetSize(d, i1 - i0);
+    }
+  return u;
+}
 
 LabelImageWrapper::LabelImageWrapper()
 {
@@ -70,6 +91,12 @@ void LabelImageWrapper::UpdateWrappedImages(
   for(auto &p : m_TimePointUndoManagers)
     p = new UndoManagerType(4, 200000);
 
+  // Occupancy indices are created up front, since they may be requested from
+  // worker threads, but they are only built when first updated
+  m_TimePointOccupancyIndices.resize(this->GetNumberOfTimePoints());
+  for(auto &index : m_TimePointOccupancyIndices)
+    index = LabelOccupancyIndex::New();
+
   // Modified event on the image is rebroadcast as the WrapperImageChangeEvent
   Rebroadcaster::Rebroadcast(image_4d, itk::ModifiedEvent(), this, WrapperImageChangeEvent());
 
@@ -124,12 +151,16 @@ void LabelImageWrapper::Undo()
   // The label image that will undergo undo
   typedef itk::ImageRegionIterator<ImageType> IteratorType;
 
+  // The region affected by the deltas
+  itk::ImageRegion<3> region;
+
   // Iterate over all the deltas in reverse order
   UndoManagerType::DList::const_reverse_iterator dit = commit.GetDeltas().rbegin();
   for(; dit != commit.GetDeltas().rend(); ++dit)
     {
     // Apply the changes in the current delta
     UndoManagerType::Delta *delta = *dit;
+    region = UnionRegion(region, delta->GetRegion());
 
     // Iterator for the relevant region in the label image
     IteratorType lit(m_Image, delta->GetRegion());
@@ -149,7 +180,7 @@ void LabelImageWrapper::Undo()
     }
 
   // Set modified flags
-  this->PixelsModified();
+  this->PixelsModified(region);
 }
 
 bool LabelImageWrapper::IsRedoPossible()
@@ -168,12 +199,16 @@ void LabelImageWrapper::Redo()
   // The label image that will undergo redo
   typedef itk::ImageRegionIterator<ImageType> IteratorType;
 
+  // The region affected by the deltas
+  itk::ImageRegion<3> region;
+
   // Iterate over all the deltas in reverse order
   UndoManagerType::DList::const_iterator dit = commit.GetDeltas().begin();
   for(; dit != commit.GetDeltas().end(); ++dit)
     {
     // Apply the changes in the current delta
     UndoManagerType::Delta *delta = *dit;
+    region = UnionRegion(region, delta->GetRegion());
 
     // Iterator for the relevant region in the label image
     IteratorType lit(m_Image, delta->GetRegion());
@@ -193,7 +228,7 @@ void LabelImageWrapper::Redo()
     }
 
   // Set modified flags
-  this->PixelsModified();
+  this->PixelsModified(region);
 }
 
 const
@@ -216,3 +251,23 @@ LabelImageWrapper::CompressImage() const
   new_cumulative->FinishEncoding();
   return new_cumulative;
 }
+
+LabelOccupancyIndex *
+LabelImageWrapper::GetOccupancyIndex(unsigned int tp)
+{
+  LabelOccupancyIndex *index = m_TimePointOccupancyIndices[tp];
+  index->Update(m_ImageTimePoints[tp]);
+  return index;
+}
+
+void LabelImageWrapper::PixelsModified(const itk::ImageRegion<3> &region)
+{
+  // Rescan the modified region in the index before the image is marked as
+  // modified, and record the new modification time right after, so that the
+  // index does not have to be rebuilt
+  LabelOccupancyIndex *index = m_TimePointOccupancyIndices[m_TimePointIndex];
+  ImageType *image = m_ImageTimePoints[m_TimePointIndex];
+  index->UpdateRegion(image, region);
+  this->PixelsModified();
+  index->AcceptModification(image);
+}
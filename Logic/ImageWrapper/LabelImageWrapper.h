@@ -3,6 +3,7 @@
 
 #include "ImageWrapperTraits.h"
 #include "ScalarImageWrapper.h"
+#include "LabelOccupancyIndex.h"
 
 template <typename TPixel> class UndoDataManager;
 template <typename TPixel> class UndoDelta;
@@ -83,6 +84,25 @@ public:
    * array created in this call. */
   UndoManagerDelta *CompressImage() const;
 
+  /**
+   * Get the index of where each label occurs in a time point, which is brought
+   * up to date with the image. The index is built the first time it is
+   * requested and is then kept current by PixelsModified(region).
+   */
+  LabelOccupancyIndex *GetOccupancyIndex(unsigned int tp);
+
+  /** Get the index of where each label occurs in the current time point */
+  LabelOccupancyIndex *GetOccupancyIndex()
+  { return this->GetOccupancyIndex(m_TimePointIndex); }
+
+  /**
+   * Variant of PixelsModified() to call when all the modified voxels are
+   * known to lie in a region. This allows the occupancy index to be updated
+   * without rescanning the whole image.
+   */
+  void PixelsModified(const itk::ImageRegion<3> &region);
+  using Superclass::PixelsModified;
+
 protected:
 
   LabelImageWrapper();
@@ -93,6 +113,9 @@ protected:
   // undo steps with little cost in performance or memory. We currently associate each time
   // point with its own undo manager
   std::vector<UndoManagerType *> m_TimePointUndoManagers;
+
+  // Label occupancy index for each time point
+  std::vector<SmartPtr<LabelOccupancyIndex> > m_TimePointOccupancyIndices;
 };
 
 #endif // LABELIMAGEWRAPPER_H
@@ -0,0 +1,330 @@
+#include "LabelOccupancyIndex.h"
+#include "TraceRecorder.h"
+#include <itkMultiThreaderBase.h>
+#include <algorithm>
+
+LabelOccupancyIndex::LabelOccupancyIndex()
+{
+  m_IndexedMTime = 0;
+  m_ModificationPending = false;
+  m_GridSize[0] = m_GridSize[1] = m_GridSize[2] = 0;
+}
+
+LabelOccupancyIndex::~LabelOccupancyIndex()
+{
+}
+
+// Hash of a run of voxels, combined into the checksums by addition so that
+// the checksum does not depend on the order in which the runs are visited
+inline unsigned long HashRun(long x0, long x1, long y, long z)
+{
+  unsigned long long h =
+      (unsigned long long) x0 ^ ((unsigned long long) x1 << 16)
+      ^ ((unsigned long long) y << 32) ^ ((unsigned long long) z << 48);
+  h += 0x9e3779b97f4a7c15ull;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  return (unsigned long) (h ^ (h >> 31));
+}
+
+void LabelOccupancyIndex::Update(const ImageType *image)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if(image == m_Image && image->GetMTime() == m_IndexedMTime)
+    return;
+
+  SNAP_TRACE_SCOPE("logic", "LabelOccupancyIndex::Update");
+
+  m_Image = image;
+  m_IndexedMTime = image->GetMTime();
+  m_ModificationPending = false;
+
+  // Set up the brick grid over the buffered region
+  const RegionType &region = image->GetBufferedRegion();
+  size_t n_bricks = 1;
+  for(int d = 0; d < 3; d++)
+    {
+    m_GridSize[d] = (region.GetSize(d) + BrickEdge - 1) / BrickEdge;
+    n_bricks *= m_GridSize[d];
+    }
+
+  m_Bricks.clear();
+  m_Bricks.resize(n_bricks);
+
+  if(n_bricks)
+    this->ScanRegion(region);
+  this->UpdateSummaries();
+  this->Modified();
+}
+
+void LabelOccupancyIndex::UpdateRegion(const ImageType *image, const RegionType &region)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+
+  // If the index is out of date, clear it and leave it to the next Update()
+  // to rebuild it, so that stale contents are never reported
+  if(image != m_Image || image->GetMTime() != m_IndexedMTime)
+    {
+    m_Image = NULL;
+    m_ModificationPending = false;
+    m_GridSize[0] = m_GridSize[1] = m_GridSize[2] = 0;
+    m_Bricks.clear();
+    m_Summaries.clear();
+    this->Modified();
+    return;
+    }
+
+  RegionType crop = region;
+  if(crop.Crop(image->GetBufferedRegion()))
+    {
+    this->ScanRegion(crop);
+    this->UpdateSummaries();
+    this->Modified();
+    }
+
+  m_ModificationPending = true;
+}
+
+void LabelOccupancyIndex::AcceptModification(const ImageType *image)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if(m_ModificationPending && image == m_Image)
+    m_IndexedMTime = image->GetMTime();
+  m_ModificationPending = false;
+}
+
+LabelOccupancyIndex::RegionType
+LabelOccupancyIndex::GetBrickRegion(size_t brick_id) const
+{
+  size_t b[3];
+  b[0] = brick_id % m_GridSize[0];
+  b[1] = (brick_id / m_GridSize[0]) % m_GridSize[1];
+  b[2] = brick_id / (m_GridSize[0] * m_GridSize[1]);
+
+  RegionType region;
+  for(int d = 0; d < 3; d++)
+    {
+    region.SetIndex(d, b[d] * BrickEdge);
+    region.SetSize(d, BrickEdge);
+    }
+  region.SetIndex(region.GetIndex() + m_Image->GetBufferedRegion().GetIndex());
+  region.Crop(m_Image->GetBufferedRegion());
+  return region;
+}
+
+void LabelOccupancyIndex::ScanRegion(const RegionType &region)
+{
+  // Range of bricks covered by the region
+  const RegionType &bufRegion = m_Image->GetBufferedRegion();
+  unsigned int b0[3], b1[3];
+  for(int d = 0; d < 3; d++)
+    {
+    long k0 = region.GetIndex(d) - bufRegion.GetIndex(d);
+    long k1 = k0 + region.GetSize(d) - 1;
+    b0[d] = (unsigned int) (k0 / BrickEdge);
+    b1[d] = (unsigned int) (k1 / BrickEdge);
+    }
+
+  // Rows of bricks are independent of each other
+  unsigned int ny = b1[1] - b0[1] + 1, nz = b1[2] - b0[2] + 1;
+  itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+  mt->ParallelizeArray(0, ny * nz, [&](itk::SizeValueType row)
+    {
+    this->ScanBrickRow(b0[1] + row % ny, b0[2] + row / ny, b0[0], b1[0]);
+    }, nullptr);
+}
+
+void LabelOccupancyIndex::ScanBrickRow(unsigned int by, unsigned int bz,
+                                       unsigned int bx0, unsigned int bx1)
+{
+  const RegionType &bufRegion = m_Image->GetBufferedRegion();
+  const itk::Index<3> &origin = bufRegion.GetIndex();
+  long width = bufRegion.GetSize(0);
+  size_t row_id = m_GridSize[0] * (by + m_GridSize[1] * (size_t) bz);
+
+  for(unsigned int bx = bx0; bx <= bx1; bx++)
+    m_Bricks[row_id + bx].clear();
+
+  // Extents of the brick row relative to the buffered region
+  long x_min = bx0 * BrickEdge, x_max = std::min((long) ((bx1 + 1) * BrickEdge), width);
+  long y_min = by * BrickEdge, y_max = std::min(y_min + (long) BrickEdge, (long) bufRegion.GetSize(1));
+  long z_min = bz * BrickEdge, z_max = std::min(z_min + (long) BrickEdge, (long) bufRegion.GetSize(2));
+
+  ImageType::BufferType *buffer = m_Image->GetBuffer();
+  ImageType::BufferType::IndexType lineIndex;
+  for(long z = z_min; z < z_max; z++)
+    {
+    for(long y = y_min; y < y_max; y++)
+      {
+      lineIndex[0] = origin[1] + y;
+      lineIndex[1] = origin[2] + z;
+      const ImageType::RLLine &line = buffer->GetPixel(lineIndex);
+
+      // Walk the runs of the line, splitting them at the brick boundaries
+      long t = 0;
+      unsigned int entry_bx = bx1 + 1;
+      size_t entry_pos = 0;
+      for(size_t i = 0; i < line.size() && t < x_max; i++)
+        {
+        long t_end = t + line[i].first;
+        LabelType label = line[i].second;
+        long r0 = std::max(t, x_min);
+        while(r0 < std::min(t_end, x_max))
+          {
+          unsigned int bx = (unsigned int) (r0 / BrickEdge);
+          long r1 = std::min(t_end, (long) ((bx + 1) * BrickEdge)) - 1;
+          Vector3i p0(origin[0] + r0, origin[1] + y, origin[2] + z);
+          Vector3i p1(origin[0] + r1, origin[1] + y, origin[2] + z);
+
+          // Find the entry for the label in the brick, usually the last one used
+          BrickContents &contents = m_Bricks[row_id + bx];
+          if(bx != entry_bx || contents[entry_pos].Label != label)
+            {
+            entry_bx = bx;
+            for(entry_pos = 0; entry_pos < contents.size(); entry_pos++)
+              if(contents[entry_pos].Label == label)
+                break;
+            if(entry_pos == contents.size())
+              {
+              BrickEntry e;
+              e.Label = label;
+              e.Count = 0;
+              e.CheckSum = 0;
+              e.BoundingBox[0] = p0;
+              e.BoundingBox[1] = p1;
+              contents.push_back(e);
+              }
+            }
+
+          BrickEntry *entry = &contents[entry_pos];
+          entry->Count += r1 - r0 + 1;
+          entry->CheckSum += HashRun(p0[0], p1[0], p0[1], p0[2]);
+          for(int d = 0; d < 3; d++)
+            {
+            entry->BoundingBox[0][d] = std::min(entry->BoundingBox[0][d], p0[d]);
+            entry->BoundingBox[1][d] = std::max(entry->BoundingBox[1][d], p1[d]);
+            }
+
+          r0 = r1 + 1;
+          }
+        t = t_end;
+        }
+      }
+    }
+}
+
+void LabelOccupancyIndex::UpdateSummaries()
+{
+  m_Summaries.clear();
+  for(const BrickContents &contents : m_Bricks)
+    {
+    for(const BrickEntry &e : contents)
+      {
+      auto ins = m_Summaries.insert(std::make_pair(e.Label, LabelSummary()));
+      LabelSummary &s = ins.first->second;
+      if(ins.second)
+        {
+        s.Count = e.Count;
+        s.CheckSum = e.CheckSum;
+        s.Bricks = 1;
+        s.BoundingBox[0] = e.BoundingBox[0];
+        s.BoundingBox[1] = e.BoundingBox[1];
+        }
+      else
+        {
+        s.Count += e.Count;
+        s.CheckSum += e.CheckSum;
+        s.Bricks++;
+        for(int d = 0; d < 3; d++)
+          {
+          s.BoundingBox[0][d] = std::min(s.BoundingBox[0][d], e.BoundingBox[0][d]);
+          s.BoundingBox[1][d] = std::max(s.BoundingBox[1][d], e.BoundingBox[1][d]);
+          }
+        }
+      }
+    }
+}
+
+LabelOccupancyIndex::LabelSummaryMap LabelOccupancyIndex::GetLabelSummaries() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Summaries;
+}
+
+bool LabelOccupancyIndex::IsLabelPresent(LabelType label) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Summaries.find(label) != m_Summaries.end();
+}
+
+unsigned long LabelOccupancyIndex::GetLabelVoxelCount(LabelType label) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  LabelSummaryMap::const_iterator it = m_Summaries.find(label);
+  return it == m_Summaries.end() ? 0 : it->second.Count;
+}
+
+bool LabelOccupancyIndex::GetLabelBoundingBox(LabelType label, RegionType &bbox) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  LabelSummaryMap::const_iterator it = m_Summaries.find(label);
+  if(it == m_Summaries.end())
+    return false;
+
+  for(int d = 0; d < 3; d++)
+    {
+    bbox.SetIndex(d, it->second.BoundingBox[0][d]);
+    bbox.SetSize(d, 1 + it->second.BoundingBox[1][d] - it->second.BoundingBox[0][d]);
+    }
+  return true;
+}
+
+bool LabelOccupancyIndex::GetForegroundBoundingBox(RegionType &bbox) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  Vector3i bb[2];
+  bool found = false;
+  for(LabelSummaryMap::const_iterator it = m_Summaries.begin(); it != m_Summaries.end(); ++it)
+    {
+    if(it->first == 0)
+      continue;
+    for(int d = 0; d < 3; d++)
+      {
+      bb[0][d] = found ? std::min(bb[0][d], it->second.BoundingBox[0][d]) : it->second.BoundingBox[0][d];
+      bb[1][d] = found ? std::max(bb[1][d], it->second.BoundingBox[1][d]) : it->second.BoundingBox[1][d];
+      }
+    found = true;
+    }
+
+  if(found)
+    {
+    for(int d = 0; d < 3; d++)
+      {
+      bbox.SetIndex(d, bb[0][d]);
+      bbox.SetSize(d, 1 + bb[1][d] - bb[0][d]);
+      }
+    }
+  return found;
+}
+
+std::vector<LabelOccupancyIndex::RegionType>
+LabelOccupancyIndex::GetOccupiedBrickRegions(LabelType label) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::vector<RegionType> regions;
+  if(!m_Image || m_Summaries.find(label) == m_Summaries.end())
+    return regions;
+
+  for(size_t i = 0; i < m_Bricks.size(); i++)
+    {
+    for(const BrickEntry &e : m_Bricks[i])
+      {
+      if(e.Label == label)
+        {
+        regions.push_back(this->GetBrickRegion(i));
+        break;
+        }
+      }
+    }
+  return regions;
+}
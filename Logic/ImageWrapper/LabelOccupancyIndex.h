@@ -0,0 +1,148 @@
+#ifndef LABELOCCUPANCYINDEX_H
+#define LABELOCCUPANCYINDEX_H
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+#include <itkImageRegion.h>
+#include <SNAPCommon.h>
+#include <RLEImage.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+  An index of where each label occurs in a segmentation image. The image is
+  divided into bricks (32 voxels on a side) and for every brick the index
+  keeps the list of labels present in it, with their voxel counts, extents
+  and a checksum of the runs. From these, a summary for each label in the
+  image (count, bounding box, checksum) is maintained, so that code looking
+  for a label does not need to scan the whole image.
+
+  The index is built from the image on the first call to Update() and
+  rebuilt whenever the image is modified, unless the modification is
+  reported with UpdateRegion() and AcceptModification(), in which case only
+  the bricks overlapping the modified region are scanned again.
+
+  The index may be updated and queried from different threads (e.g., by the
+  mesh worker while the user paints), so all methods lock the index and the
+  queries return copies.
+  */
+class LabelOccupancyIndex : public itk::Object
+{
+public:
+  irisITKObjectMacro(LabelOccupancyIndex, itk::Object)
+
+  typedef RLEImage<LabelType> ImageType;
+  typedef itk::ImageRegion<3> RegionType;
+
+  /** Number of voxels along each side of a brick */
+  itkStaticConstMacro(BrickEdge, unsigned int, 32);
+
+  /** Where a label occurs in the image */
+  struct LabelSummary
+  {
+    // The number of voxels with the label
+    unsigned long Count;
+
+    // The extents of the bounding box (inclusive)
+    Vector3i BoundingBox[2];
+
+    // Checksum of the runs of the label, changes when its voxels change
+    unsigned long CheckSum;
+
+    // The number of bricks containing the label
+    unsigned long Bricks;
+  };
+
+  typedef std::map<LabelType, LabelSummary> LabelSummaryMap;
+
+  /**
+   * Bring the index up to date with the image. The whole image is scanned
+   * if it is not the image last indexed or if it has been modified since.
+   */
+  void Update(const ImageType *image);
+
+  /**
+   * Scan the bricks overlapping a region after changing the voxels in it.
+   * This must be called before the change is announced by calling Modified()
+   * on the image, and AcceptModification() must be called right after that.
+   * If the index was out of date, this method clears it, and the index is
+   * rebuilt by the next Update().
+   */
+  void UpdateRegion(const ImageType *image, const RegionType &region);
+
+  /**
+   * Record the modification time of the image after the change reported by
+   * UpdateRegion() has been announced, so that the next Update() does not
+   * rescan the image. Any later modification causes a rebuild.
+   */
+  void AcceptModification(const ImageType *image);
+
+  /** The summaries for all the labels present in the image, including 0 */
+  LabelSummaryMap GetLabelSummaries() const;
+
+  /** Check whether the label is present in the image */
+  bool IsLabelPresent(LabelType label) const;
+
+  /** Get the number of voxels with a label */
+  unsigned long GetLabelVoxelCount(LabelType label) const;
+
+  /** Get the bounding box of a label, returns false if the label is absent */
+  bool GetLabelBoundingBox(LabelType label, RegionType &bbox) const;
+
+  /** Get the bounding box of all the voxels with non-zero labels */
+  bool GetForegroundBoundingBox(RegionType &bbox) const;
+
+  /**
+   * Get the regions of the bricks that contain a label. The list is empty
+   * if the index has been invalidated and not updated since.
+   */
+  std::vector<RegionType> GetOccupiedBrickRegions(LabelType label) const;
+
+protected:
+  LabelOccupancyIndex();
+  virtual ~LabelOccupancyIndex();
+
+  // A label present in a brick
+  struct BrickEntry
+  {
+    LabelType Label;
+    unsigned long Count;
+    Vector3i BoundingBox[2];
+    unsigned long CheckSum;
+  };
+
+  typedef std::vector<BrickEntry> BrickContents;
+
+  // Scan a row of bricks along the x axis, from brick bx0 to bx1 inclusive
+  void ScanBrickRow(unsigned int by, unsigned int bz,
+                    unsigned int bx0, unsigned int bx1);
+
+  // Scan all the bricks intersecting a region of the image
+  void ScanRegion(const RegionType &region);
+
+  // Recompute the per-label summaries from the brick contents
+  void UpdateSummaries();
+
+  // Get the image region covered by a brick
+  RegionType GetBrickRegion(size_t brick_id) const;
+
+  // Guards all the state below
+  mutable std::mutex m_Mutex;
+
+  // The indexed image and its modification time when last indexed
+  itk::SmartPointer<const ImageType> m_Image;
+  itk::ModifiedTimeType m_IndexedMTime;
+
+  // Whether UpdateRegion() was called and AcceptModification() is expected
+  bool m_ModificationPending;
+
+  // Number of bricks along each dimension, and the contents of the bricks
+  unsigned int m_GridSize[3];
+  std::vector<BrickContents> m_Bricks;
+
+  LabelSummaryMap m_Summaries;
+};
+
+#endif // LABELOCCUPANCYINDEX_H
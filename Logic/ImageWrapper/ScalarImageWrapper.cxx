@@ -176,20 +176,21 @@ UnaryFunctorImageToSingleComponentVectorImageFilter<TInputImage, TOutputImage, T
 
 #endif // __DELETE_THIS_CODE_
 
-/** Compute statistics over a run of voxels in the image starting at the index
- * startIdx. Appends the statistics to a running sum and sum of squared. The
- * statistics are returned in internal (not native mapped) format */
+/** Compute statistics over a run of voxels in the image of time point tp,
+ * starting at the index startIdx. Appends the statistics to a running sum and
+ * sum of squared. The statistics are returned in internal (not native mapped)
+ * format */
 template<class TTraits>
 void
 ScalarImageWrapper<TTraits>
 ::GetRunLengthIntensityStatistics(
     const itk::ImageRegion<3> &region,
-    const itk::Index<3> &startIdx, long runlength,
+    const itk::Index<3> &startIdx, long runlength, unsigned int tp,
     double *out_nvalid, double *out_sum, double *out_sumsq) const
 {
   if(this->IsSlicingOrthogonal())
     {
-    ConstIterator it(this->m_Image, region);
+    ConstIterator it(this->GetImageByTimePoint(tp), region);
     it.SetIndex(startIdx);
 
     // Perform the integration
@@ -236,7 +237,7 @@ ScalarImageWrapper<TTraits>
 template<class TTraits>
 typename ScalarImageWrapper<TTraits>::DisplaySlicePointer
 ScalarImageWrapper<TTraits>
-::SampleArbitraryDisplaySlice(const ImageBaseType *ref_space)
+::SampleArbitraryDisplaySlice(const ImageBaseType *ref_space, bool use_nearest_neighbor)
 {
   // Create a non-orthogonal slicer for this task - we don't want to interfere with the
   // main slicing pipeline
@@ -249,6 +250,7 @@ ScalarImageWrapper<TTraits>
   typedef itk::IdentityTransform<double, 3> IdTransformType;
   typename IdTransformType::Pointer idTran = IdTransformType::New();
   thumb_slicer->SetTransform(idTran);
+  thumb_slicer->SetUseNearestNeighbor(use_nearest_neighbor);
 
   // Perform slicing
   thumb_slicer->Update();
@@ -120,12 +120,13 @@ public:
   /** This image type has only one component */
   virtual size_t GetNumberOfComponents() const ITK_OVERRIDE { return 1; }
 
-  /** Compute statistics over a run of voxels in the image starting at the index
-   * startIdx. Appends the statistics to a running sum and sum of squared. The
-   * statistics are returned in internal (not native mapped) format */
+  /** Compute statistics over a run of voxels in the image of time point tp,
+   * starting at the index startIdx. Appends the statistics to a running sum and
+   * sum of squared. The statistics are returned in internal (not native mapped)
+   * format */
   virtual void GetRunLengthIntensityStatistics(
       const itk::ImageRegion<3> &region,
-      const itk::Index<3> &startIdx, long runlength,
+      const itk::Index<3> &startIdx, long runlength, unsigned int tp,
       double *out_nvalid, double *out_sum, double *out_sumsq) const ITK_OVERRIDE;
 
   /**
@@ -144,9 +145,11 @@ public:
    * This method samples a 2D slice based on a reference geometry from
    * the current image and maps it using the current display mapping. It
    * is used to generate thumbnails and for other sampling of image
-   * appearance that is outside of the main display pipeline
+   * appearance that is outside of the main display pipeline. By default,
+   * nearest neighbor interpolation is used, otherwise linear
    */
-  virtual DisplaySlicePointer SampleArbitraryDisplaySlice(const ImageBaseType *ref_space) ITK_OVERRIDE;
+  virtual DisplaySlicePointer SampleArbitraryDisplaySlice(
+      const ImageBaseType *ref_space, bool use_nearest_neighbor = true) ITK_OVERRIDE;
 
   /**
     Get the maximum possible value of the gradient magnitude. This will
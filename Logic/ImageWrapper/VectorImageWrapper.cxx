@@ -29,6 +29,7 @@
 #include "Rebroadcaster.h"
 #include "GuidedNativeImageIO.h"
 #include "itkImageFileWriter.h"
+#include "itkMultiThreaderBase.h"
 
 #include <iostream>
 
@@ -44,6 +45,7 @@ template <class TTraits>
 VectorImageWrapper<TTraits>
 ::~VectorImageWrapper()
 {
+  this->CancelMaterializedDerivedQuantities();
 }
 
 
@@ -62,12 +64,12 @@ void
 VectorImageWrapper<TTraits>
 ::GetRunLengthIntensityStatistics(
     const itk::ImageRegion<3> &region,
-    const itk::Index<3> &startIdx, long runlength,
+    const itk::Index<3> &startIdx, long runlength, unsigned int tp,
     double *out_nvalid, double *out_sum, double *out_sumsq) const
 {
   if(this->IsSlicingOrthogonal())
     {
-    ConstIterator it(this->m_Image, region);
+    ConstIterator it(this->GetImageByTimePoint(tp), region);
     it.SetIndex(startIdx);
     size_t nc = this->GetNumberOfComponents();
 
@@ -131,7 +133,7 @@ VectorImageWrapper<TTraits>
 template<class TTraits>
 typename VectorImageWrapper<TTraits>::DisplaySlicePointer
 VectorImageWrapper<TTraits>
-::SampleArbitraryDisplaySlice(const ImageBaseType *ref_space)
+::SampleArbitraryDisplaySlice(const ImageBaseType *ref_space, bool use_nearest_neighbor)
 {
   // Get the numerical value
   MultiChannelDisplayMode mode = this->m_DisplayMapping->GetDisplayMode();
@@ -148,6 +150,7 @@ VectorImageWrapper<TTraits>
     typedef itk::IdentityTransform<double, 3> IdTransformType;
     typename IdTransformType::Pointer idTran = IdTransformType::New();
     thumb_slicer->SetTransform(idTran);
+    thumb_slicer->SetUseNearestNeighbor(use_nearest_neighbor);
 
     // Perform slicing
     thumb_slicer->Update();
@@ -176,7 +179,7 @@ VectorImageWrapper<TTraits>
     // Just delegate to the scalar wrapper
     ScalarImageWrapperBase *siw =
         this->GetScalarRepresentation(mode.SelectedScalarRep, mode.SelectedComponent);
-    return siw->SampleArbitraryDisplaySlice(ref_space);
+    return siw->SampleArbitraryDisplaySlice(ref_space, use_nearest_neighbor);
     }
 }
 
@@ -218,6 +221,9 @@ VectorImageWrapper<TTraits>
       SetNativeMappingInDerivedWrapper<MeanFunctor>(it->second, mapping);
       }
     }
+
+  // The derived quantities depend on the source native mapping
+  this->UpdateMaterializedDerivedQuantities();
 }
 
 template <class TTraits>
@@ -352,6 +358,8 @@ VectorImageWrapper<TTraits>
   // Call the parent's method = this will initialize the display mapping. This should
   // be called after the component/child wrappers have been created
   Superclass::UpdateWrappedImages(image_4d, referenceSpace, transform);
+
+  this->UpdateMaterializedDerivedQuantities();
 }
 
 template<class TTraits>
@@ -367,6 +375,225 @@ VectorImageWrapper<TTraits>
 }
 
 
+template<class TTraits>
+void
+VectorImageWrapper<TTraits>
+::SetTimePointIndex(unsigned int index)
+{
+  bool changed = (index != this->m_TimePointIndex);
+  Superclass::SetTimePointIndex(index);
+
+  // Propagate to owned scalar wrappers
+  for(ScalarRepIterator it = m_ScalarReps.begin(); it != m_ScalarReps.end(); ++it)
+    {
+    it->second->SetTimePointIndex(index);
+    }
+
+  if(changed)
+    this->UpdateMaterializedDerivedQuantities();
+}
+
+template<class TTraits>
+void
+VectorImageWrapper<TTraits>
+::PixelsModified()
+{
+  Superclass::PixelsModified();
+  this->UpdateMaterializedDerivedQuantities();
+}
+
+template<class TTraits>
+void
+VectorImageWrapper<TTraits>
+::SetMaterializeDerivedQuantities(bool value)
+{
+  if(value != m_MaterializeDerivedQuantities)
+    {
+    m_MaterializeDerivedQuantities = value;
+    this->UpdateMaterializedDerivedQuantities();
+    }
+}
+
+template<class TTraits>
+void
+VectorImageWrapper<TTraits>
+::SetDerivedQuantityMemoryBudget(size_t bytes)
+{
+  if(bytes != m_DerivedQuantityMemoryBudget)
+    {
+    m_DerivedQuantityMemoryBudget = bytes;
+    this->UpdateMaterializedDerivedQuantities();
+    }
+}
+
+template <class TTraits>
+template <class TFunctor>
+VectorToScalarImageAccessor<TFunctor> &
+VectorImageWrapper<TTraits>
+::GetDerivedWrapperAccessor(ScalarRepresentation type)
+{
+  typedef VectorDerivedQuantityImageWrapperTraits<TFunctor> WrapperTraits;
+  typedef typename WrapperTraits::WrapperType DerivedWrapper;
+  typedef typename DerivedWrapper::Image4DType AdaptorType;
+
+  DerivedWrapper *dw = dynamic_cast<DerivedWrapper *>(
+                         m_ScalarReps[std::make_pair(type, 0)].GetPointer());
+  AdaptorType *adaptor = dynamic_cast<AdaptorType *>(dw->GetImage4DBase());
+  return adaptor->GetPixelAccessor();
+}
+
+template <class TTraits>
+template <class TFunctor>
+void
+VectorImageWrapper<TTraits>
+::SetMaterializedValuesInDerivedWrapper(
+    ScalarRepresentation type,
+    typename VectorToScalarImageAccessor<TFunctor>::MaterializedValuesPointer values)
+{
+  typedef VectorDerivedQuantityImageWrapperTraits<TFunctor> WrapperTraits;
+  typedef typename WrapperTraits::WrapperType DerivedWrapper;
+  typedef typename DerivedWrapper::ImageType AdaptorType;
+  typedef typename VectorToScalarImageAccessor<TFunctor>::MaterializedValuesPointer ValuesPointer;
+
+  // The values are only given to the image of the current time point. The
+  // 4D adaptor shares its buffer with the first time point, but it indexes
+  // past the end of a single time point, so it never gets the values
+  DerivedWrapper *dw = dynamic_cast<DerivedWrapper *>(
+                         m_ScalarReps[std::make_pair(type, 0)].GetPointer());
+  for(unsigned int t = 0; t < dw->GetNumberOfTimePoints(); t++)
+    {
+    AdaptorType *img = dw->GetImageByTimePoint(t).GetPointer();
+    VectorToScalarImageAccessor<TFunctor> &acc = img->GetPixelAccessor();
+    ValuesPointer tp_values = (t == this->m_TimePointIndex) ? values : ValuesPointer();
+    if(acc.GetMaterializedValues() != tp_values)
+      {
+      acc.SetMaterializedValues(tp_values);
+      img->Modified();
+      }
+    }
+}
+
+template <class TTraits>
+void
+VectorImageWrapper<TTraits>
+::CancelMaterializedDerivedQuantities()
+{
+  for(int k = 0; k < 3; k++)
+    if(m_MaterializedValues[k])
+      m_MaterializedValues[k]->Cancelled = true;
+
+  if(m_MaterializeFuture.valid())
+    m_MaterializeFuture.wait();
+
+  // Copies of the values may still be held by pipeline outputs, so make sure
+  // that they are never read
+  for(int k = 0; k < 3; k++)
+    {
+    if(m_MaterializedValues[k])
+      m_MaterializedValues[k]->Ready = false;
+    m_MaterializedValues[k].reset();
+    }
+}
+
+template <class TTraits>
+void
+VectorImageWrapper<TTraits>
+::UpdateMaterializedDerivedQuantities()
+{
+  this->CancelMaterializedDerivedQuantities();
+
+  // Derived wrappers have not been created yet
+  if(m_ScalarReps.find(std::make_pair(SCALAR_REP_MAGNITUDE, 0)) == m_ScalarReps.end()
+     || this->m_ImageTimePoints.size() <= this->m_TimePointIndex)
+    return;
+
+  typedef VectorToScalarImageAccessor<MagnitudeFunctor> MagnitudeAccessor;
+  typedef VectorToScalarImageAccessor<MaxFunctor> MaxAccessor;
+  typedef VectorToScalarImageAccessor<MeanFunctor> MeanAccessor;
+  typedef std::shared_ptr<MaterializedValues> MaterializedPointer;
+
+  // Work out how many of the quantities fit into the memory budget
+  size_t nv = this->GetNumberOfVoxels();
+  size_t n_fit = 0;
+  if(m_MaterializeDerivedQuantities && nv > 0)
+    n_fit = std::min((size_t) 3, m_DerivedQuantityMemoryBudget / (nv * sizeof(float)));
+
+  // Allocate the values in priority order. They are not used by the
+  // accessors until the background computation marks them as ready
+  MaterializedPointer mv[3];
+  const InternalPixelType *begin =
+      this->m_ImageTimePoints[this->m_TimePointIndex]->GetBufferPointer();
+  for(size_t k = 0; k < n_fit; k++)
+    {
+    mv[k] = std::make_shared<MaterializedValues>();
+    mv[k]->Begin = begin;
+    mv[k]->Values.resize(nv);
+    m_MaterializedValues[k] = mv[k];
+    }
+
+  SetMaterializedValuesInDerivedWrapper<MagnitudeFunctor>(SCALAR_REP_MAGNITUDE, mv[0]);
+  SetMaterializedValuesInDerivedWrapper<MaxFunctor>(SCALAR_REP_MAX, mv[1]);
+  SetMaterializedValuesInDerivedWrapper<MeanFunctor>(SCALAR_REP_AVERAGE, mv[2]);
+
+  if(n_fit == 0)
+    return;
+
+  // Copies of the accessors of the 4D adaptors are used so the values match
+  // the on the fly computation exactly, including the source native mapping
+  MagnitudeAccessor acc_mag = this->template GetDerivedWrapperAccessor<MagnitudeFunctor>(SCALAR_REP_MAGNITUDE);
+  MaxAccessor acc_max = this->template GetDerivedWrapperAccessor<MaxFunctor>(SCALAR_REP_MAX);
+  MeanAccessor acc_mean = this->template GetDerivedWrapperAccessor<MeanFunctor>(SCALAR_REP_AVERAGE);
+  size_t nc = this->GetNumberOfComponents();
+
+  // The pixel container keeps the buffer alive if the image is replaced
+  // while the values are being computed
+  typename Image4DType::PixelContainerPointer container = this->m_Image4D->GetPixelContainer();
+
+  m_MaterializeFuture = std::async(std::launch::async,
+                                   [mv, n_fit, nv, nc, begin, acc_mag, acc_max, acc_mean, container]()
+    {
+    float *out_mag = mv[0] ? mv[0]->Values.data() : NULL;
+    float *out_max = mv[1] ? mv[1]->Values.data() : NULL;
+    float *out_mean = mv[2] ? mv[2]->Values.data() : NULL;
+
+    // All quantities are computed in a single pass over the components,
+    // split into blocks of voxels that are processed in parallel
+    const size_t block_size = 0x10000;
+    size_t n_blocks = (nv + block_size - 1) / block_size;
+    itk::MultiThreaderBase::Pointer mt = itk::MultiThreaderBase::New();
+    mt->ParallelizeArray(0, n_blocks, [&](itk::SizeValueType b)
+      {
+      if(mv[0]->Cancelled)
+        return;
+
+      size_t first = b * block_size, last = std::min(nv, first + block_size);
+      const InternalPixelType *p = begin + first * nc;
+      for(size_t i = first; i < last; i++, p += nc)
+        {
+        if(out_mag)
+          out_mag[i] = acc_mag.Get(p);
+        if(out_max)
+          out_max[i] = acc_max.Get(p);
+        if(out_mean)
+          out_mean[i] = acc_mean.Get(p);
+        }
+      }, nullptr);
+
+    if(!mv[0]->Cancelled)
+      for(size_t k = 0; k < n_fit; k++)
+        mv[k]->Ready.store(true, std::memory_order_release);
+    });
+}
+
+template <class TTraits>
+void
+VectorImageWrapper<TTraits>
+::WaitForMaterializedDerivedQuantities()
+{
+  if(m_MaterializeFuture.valid())
+    m_MaterializeFuture.wait();
+}
+
 template <class TTraits>
 inline ScalarImageWrapperBase *
 VectorImageWrapper<TTraits>
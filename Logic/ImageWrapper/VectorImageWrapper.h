@@ -22,6 +22,7 @@
 #include "ScalarImageWrapper.h"
 #include "itkImageAdaptor.h"
 #include "VectorToScalarImageAccessor.h"
+#include <future>
 
 /**
  * \class VectorImageWrapper
@@ -142,12 +143,13 @@ public:
     return this->m_Image4D->GetNumberOfComponentsPerPixel();
   }
 
-  /** Compute statistics over a run of voxels in the image starting at the index
-   * startIdx. Appends the statistics to a running sum and sum of squared. The
-   * statistics are returned in internal (not native mapped) format */
+  /** Compute statistics over a run of voxels in the image of time point tp,
+   * starting at the index startIdx. Appends the statistics to a running sum and
+   * sum of squared. The statistics are returned in internal (not native mapped)
+   * format */
   virtual void GetRunLengthIntensityStatistics(
       const itk::ImageRegion<3> &region,
-      const itk::Index<3> &startIdx, long runlength,
+      const itk::Index<3> &startIdx, long runlength, unsigned int tp,
       double *out_nvalid, double *out_sum, double *out_sumsq) const ITK_OVERRIDE;
 
   /**
@@ -166,9 +168,11 @@ public:
    * This method samples a 2D slice based on a reference geometry from
    * the current image and maps it using the current display mapping. It
    * is used to generate thumbnails and for other sampling of image
-   * appearance that is outside of the main display pipeline
+   * appearance that is outside of the main display pipeline. By default,
+   * nearest neighbor interpolation is used, otherwise linear
    */
-  virtual DisplaySlicePointer SampleArbitraryDisplaySlice(const ImageBaseType *ref_space) ITK_OVERRIDE;
+  virtual DisplaySlicePointer SampleArbitraryDisplaySlice(
+      const ImageBaseType *ref_space, bool use_nearest_neighbor = true) ITK_OVERRIDE;
 
   virtual void SetNativeMapping(NativeIntensityMapping mapping) ITK_OVERRIDE;
 
@@ -183,6 +187,36 @@ public:
   virtual void CopyImageCoordinateTransform(const ImageWrapperBase *source) ITK_OVERRIDE;
 
   virtual void SetSticky(bool value) ITK_OVERRIDE;
+
+  virtual void SetTimePointIndex(unsigned int index) ITK_OVERRIDE;
+
+  virtual void PixelsModified() ITK_OVERRIDE;
+
+  /**
+   * Whether the derived scalar quantities (magnitude, maximum, mean) should be
+   * precomputed for the current time point and stored, rather than computed
+   * from the vector components every time a voxel is accessed. This trades
+   * memory for much faster slicing, histograms and thumbnails of these
+   * quantities when there are many components. Off by default; the
+   * application sets it for loaded images from DefaultBehaviorSettings.
+   *
+   * The quantities are computed in a background thread, and voxel access
+   * computes them on the fly until they are ready.
+   */
+  void SetMaterializeDerivedQuantities(bool value) ITK_OVERRIDE;
+  irisGetMacro(MaterializeDerivedQuantities, bool)
+
+  /**
+   * Maximum number of bytes used to store the derived quantities. The
+   * quantities are materialized in the order magnitude, maximum, mean for as
+   * long as they fit in the budget; the rest are computed on the fly.
+   */
+  void SetDerivedQuantityMemoryBudget(size_t bytes) ITK_OVERRIDE;
+  irisGetMacro(DerivedQuantityMemoryBudget, size_t)
+
+  /** Wait until the derived quantities for the current time point are ready */
+  void WaitForMaterializedDerivedQuantities();
+
 protected:
 
   /**
@@ -194,7 +228,10 @@ protected:
   /**
    * Copy constructor.  Copies the contents of the passed-in image wrapper.
    */
-  VectorImageWrapper(const Self &copy) : Superclass(copy) {}
+  VectorImageWrapper(const Self &copy)
+    : Superclass(copy),
+      m_MaterializeDerivedQuantities(copy.m_MaterializeDerivedQuantities),
+      m_DerivedQuantityMemoryBudget(copy.m_DerivedQuantityMemoryBudget) {}
 
   virtual void UpdateWrappedImages(Image4DType *image_4d,
                                    ImageBaseType *refSpace = NULL,
@@ -217,6 +254,39 @@ protected:
   void SetNativeMappingInDerivedWrapper(
       ScalarImageWrapperBase *w, NativeIntensityMapping &mapping);
 
+  /** Get the pixel accessor used by one of the derived wrappers */
+  template <class TFunctor>
+  VectorToScalarImageAccessor<TFunctor> &GetDerivedWrapperAccessor(ScalarRepresentation type);
+
+  /**
+   * Assign materialized values to the current time point image of one of the
+   * derived wrappers, and remove them from the other time points
+   */
+  template <class TFunctor>
+  void SetMaterializedValuesInDerivedWrapper(
+      ScalarRepresentation type,
+      typename VectorToScalarImageAccessor<TFunctor>::MaterializedValuesPointer values);
+
+  /**
+   * Start recomputing the materialized derived quantities for the current
+   * time point, or release them if materialization is off. Called whenever
+   * the time point, the pixel data or the native mapping changes
+   */
+  void UpdateMaterializedDerivedQuantities();
+
+  /** Stop the background computation of the derived quantities, if any */
+  void CancelMaterializedDerivedQuantities();
+
+  bool m_MaterializeDerivedQuantities = false;
+  size_t m_DerivedQuantityMemoryBudget = 512 * 1024 * 1024;
+
+  // Values being computed or in use, in the order magnitude, max, mean
+  typedef VectorToScalarMaterializedValues<InternalPixelType, float> MaterializedValues;
+  std::shared_ptr<MaterializedValues> m_MaterializedValues[3];
+
+  // Background computation of the materialized values
+  std::future<void> m_MaterializeFuture;
+
   // Array of derived quantities
   typedef SmartPtr<ScalarImageWrapperBase> ScalarWrapperPointer;
   typedef std::pair<ScalarRepresentation, int> ScalarRepIndex;
@@ -3,6 +3,9 @@
 
 #include "itkDefaultVectorPixelAccessor.h"
 #include "itkVectorImageToImageAdaptor.h"
+#include <atomic>
+#include <memory>
+#include <vector>
 
 
 namespace itk
@@ -11,9 +14,30 @@ template <class TImage, class TAccessor> class ImageAdaptor;
 template <class TPixel, unsigned int Vdim> class VectorImage;
 }
 
+/**
+ * Derived quantity values that have been computed ahead of time for all the
+ * voxels of a vector image buffer (typically a single time point of a 4D
+ * image). The values are used by the accessor when the buffer being accessed
+ * starts at Begin, and are indexed by the voxel offset. The values may be
+ * filled in by a background thread after the accessor receives them; they
+ * are only read once Ready is set, and are never resized after that.
+ */
+template <class TInternal, class TExternal>
+struct VectorToScalarMaterializedValues
+{
+  const TInternal *Begin;
+  std::vector<TExternal> Values;
+  std::atomic<bool> Ready { false };
+  std::atomic<bool> Cancelled { false };
+};
+
 /**
  * An accessor very similar to itk::VectorImageToImageAccessor that allows us
- * to extract certain computed quantities from the vectors, such as magnitude
+ * to extract certain computed quantities from the vectors, such as magnitude.
+ *
+ * The accessor can optionally hold a materialized copy of the derived values
+ * for one buffer. Iterator access into that buffer then reads the stored
+ * value instead of evaluating the functor over all components of the voxel.
  */
 template <class TFunctor>
 class VectorToScalarImageAccessor
@@ -27,6 +51,9 @@ public:
   typedef itk::VariableLengthVector<ExternalType> ActualPixelType;
   typedef unsigned int VectorLengthType;
 
+  typedef VectorToScalarMaterializedValues<InternalType, ExternalType> MaterializedValues;
+  typedef std::shared_ptr<const MaterializedValues> MaterializedValuesPointer;
+
   inline void Set(ActualPixelType output, const ExternalType &input) const
     { output.Fill(input); }
 
@@ -42,7 +69,13 @@ public:
 
   inline ExternalType Get(const InternalType &input,
                           const SizeValueType offset) const
-    { return Get(Superclass::Get(input, offset)); }
+    {
+    if(m_Materialized && &input == m_Materialized->Begin
+       && offset < m_Materialized->Values.size()
+       && m_Materialized->Ready.load(std::memory_order_acquire))
+      return m_Materialized->Values[offset];
+    return Get(Superclass::Get(input, offset));
+    }
 
   void SetVectorLength(VectorLengthType l)
     {
@@ -62,10 +95,27 @@ public:
   void SetSourceNativeMapping(double scale, double shift)
   {
     m_Functor.SetSourceNativeMapping(scale, shift);
+    m_Materialized.reset();
+  }
+
+  /**
+   * Set the precomputed derived values, or NULL to always compute the values
+   * from the vector components. The values must have been computed with the
+   * same functor settings as this accessor.
+   */
+  void SetMaterializedValues(MaterializedValuesPointer values)
+  {
+    m_Materialized = values;
+  }
+
+  MaterializedValuesPointer GetMaterializedValues() const
+  {
+    return m_Materialized;
   }
 
 protected:
   TFunctor m_Functor;
+  MaterializedValuesPointer m_Materialized;
 };
 
 /**
@@ -0,0 +1,124 @@
+#include "LevelSetCheckpointRing.h"
+#include <algorithm>
+#include <limits>
+
+LevelSetCheckpointRing::LevelSetCheckpointRing()
+{
+  m_Interval = 100;
+  m_MemoryBudget = 256 * 1024 * 1024;
+
+  // Matches the background value of the sparse field solver with 3 layers
+  m_BackgroundValue = 4.0f;
+}
+
+bool LevelSetCheckpointRing::IsCheckpointDue(unsigned int iteration) const
+{
+  if(m_Interval == 0)
+    return false;
+
+  unsigned int last = m_Checkpoints.size() ? m_Checkpoints.back().Iteration : 0;
+  return iteration / m_Interval > last / m_Interval;
+}
+
+void LevelSetCheckpointRing::Store(const FloatImageType *image, unsigned int iteration)
+{
+  // Checkpoints are kept sorted by iteration
+  this->DiscardAfter(iteration);
+  if(m_Checkpoints.size() && m_Checkpoints.back().Iteration == iteration)
+    m_Checkpoints.pop_back();
+
+  Checkpoint cp;
+  cp.Iteration = iteration;
+  cp.NumberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+
+  // Run-length encode the classification of each voxel
+  const float *p = image->GetBufferPointer();
+  for(size_t i = 0; i < cp.NumberOfPixels; i++)
+    {
+    float v = p[i];
+    unsigned char type = (v == -m_BackgroundValue) ? FAR_INSIDE
+                         : ((v == m_BackgroundValue) ? FAR_OUTSIDE : BAND);
+
+    if(type == BAND)
+      cp.BandValues.push_back(v);
+
+    if(cp.Runs.size() && cp.Runs.back().Type == type
+       && cp.Runs.back().Length < std::numeric_limits<unsigned int>::max())
+      {
+      cp.Runs.back().Length++;
+      }
+    else
+      {
+      Run r = { 1, type };
+      cp.Runs.push_back(r);
+      }
+    }
+
+  cp.Runs.shrink_to_fit();
+  cp.BandValues.shrink_to_fit();
+  m_Checkpoints.push_back(cp);
+
+  // Enforce the memory budget, always keeping the newest checkpoint
+  while(m_Checkpoints.size() > 1 && this->GetMemoryUsage() > m_MemoryBudget)
+    m_Checkpoints.pop_front();
+}
+
+bool LevelSetCheckpointRing::Restore(unsigned int iteration, FloatImageType *image) const
+{
+  for(auto &cp : m_Checkpoints)
+    {
+    if(cp.Iteration != iteration)
+      continue;
+
+    if(image->GetBufferedRegion().GetNumberOfPixels() != cp.NumberOfPixels)
+      return false;
+
+    float *p = image->GetBufferPointer();
+    const float *band = cp.BandValues.data();
+    for(auto &r : cp.Runs)
+      {
+      if(r.Type == BAND)
+        {
+        std::copy(band, band + r.Length, p);
+        band += r.Length;
+        }
+      else
+        {
+        std::fill(p, p + r.Length, r.Type == FAR_INSIDE ? -m_BackgroundValue : m_BackgroundValue);
+        }
+      p += r.Length;
+      }
+
+    image->Modified();
+    return true;
+    }
+
+  return false;
+}
+
+std::vector<unsigned int> LevelSetCheckpointRing::GetCheckpointIterations() const
+{
+  std::vector<unsigned int> result;
+  for(auto &cp : m_Checkpoints)
+    result.push_back(cp.Iteration);
+  return result;
+}
+
+void LevelSetCheckpointRing::DiscardAfter(unsigned int iteration)
+{
+  while(m_Checkpoints.size() && m_Checkpoints.back().Iteration > iteration)
+    m_Checkpoints.pop_back();
+}
+
+void LevelSetCheckpointRing::Clear()
+{
+  m_Checkpoints.clear();
+}
+
+size_t LevelSetCheckpointRing::GetMemoryUsage() const
+{
+  size_t total = 0;
+  for(auto &cp : m_Checkpoints)
+    total += cp.GetMemoryUsage();
+  return total;
+}
@@ -0,0 +1,93 @@
+#ifndef LEVELSETCHECKPOINTRING_H
+#define LEVELSETCHECKPOINTRING_H
+
+#include "SNAPCommon.h"
+#include <itkImage.h>
+#include <list>
+#include <vector>
+
+/**
+ * A bounded collection of compressed level set snapshots taken at regular
+ * iteration intervals during snake evolution. Each snapshot stores runs of
+ * voxels equal to plus or minus the background value, and the exact values
+ * of all other voxels, so restoring a snapshot is lossless. The sparse field
+ * solver sets all voxels outside of its layers to the background value, so
+ * its snapshots are a small fraction of the size of the image. The dense
+ * solver does not clamp the level set, and its snapshots are about as large
+ * as the image.
+ *
+ * When the total size of the snapshots exceeds the memory budget, the oldest
+ * snapshots are discarded.
+ */
+class LevelSetCheckpointRing
+{
+public:
+  typedef itk::Image<float, 3> FloatImageType;
+
+  LevelSetCheckpointRing();
+  virtual ~LevelSetCheckpointRing() {}
+
+  /** Number of iterations between checkpoints, 0 disables checkpointing */
+  irisGetSetMacro(Interval, unsigned int)
+
+  /** Maximum total size of the stored checkpoints, in bytes */
+  irisGetSetMacro(MemoryBudget, size_t)
+
+  /** Magnitude of the level set away from the contour, stored as runs */
+  irisGetSetMacro(BackgroundValue, float)
+
+  /** Whether a checkpoint should be stored after the given iteration */
+  bool IsCheckpointDue(unsigned int iteration) const;
+
+  /** Store a snapshot of the level set at the given iteration */
+  void Store(const FloatImageType *image, unsigned int iteration);
+
+  /**
+   * Decompress the snapshot for the given iteration into an image with the
+   * same buffered region as the one used to store it. Returns false if there
+   * is no checkpoint for that iteration.
+   */
+  bool Restore(unsigned int iteration, FloatImageType *image) const;
+
+  /** List the iterations for which checkpoints are available */
+  std::vector<unsigned int> GetCheckpointIterations() const;
+
+  /** Remove checkpoints taken after the given iteration */
+  void DiscardAfter(unsigned int iteration);
+
+  /** Remove all checkpoints */
+  void Clear();
+
+  /** Total size of the stored checkpoints, in bytes */
+  size_t GetMemoryUsage() const;
+
+protected:
+
+  // A run of voxels that are either far inside, far outside or in the band,
+  // where the voxels far from the contour are equal to the background value
+  enum RunType { FAR_INSIDE = 0, FAR_OUTSIDE, BAND };
+  struct Run
+  {
+    unsigned int Length;
+    unsigned char Type;
+  };
+
+  struct Checkpoint
+  {
+    unsigned int Iteration;
+    size_t NumberOfPixels;
+    std::vector<Run> Runs;
+    std::vector<float> BandValues;
+
+    size_t GetMemoryUsage() const
+    { return Runs.size() * sizeof(Run) + BandValues.size() * sizeof(float); }
+  };
+
+  std::list<Checkpoint> m_Checkpoints;
+
+  unsigned int m_Interval;
+  size_t m_MemoryBudget;
+  float m_BackgroundValue;
+};
+
+#endif // LEVELSETCHECKPOINTRING_H
@@ -39,6 +39,8 @@
 
 #include "SnakeParameters.h"
 #include "SNAPLevelSetFunction.h"
+#include "itkResampleImageFilter.h"
+#include <vector>
 // #include "SNAPLevelSetStopAndGoFilter.h"
 
 template <class TFilter> class LevelSetExtensionFilter;
@@ -105,6 +107,16 @@ public:
  * level set evolution is implemented in ITK.  This gives the software a bit of 
  * modularity.  As far as SNAP cares, the public methods declared in this class are
  * the only ways to control level set evolution.
+ *
+ * When SnakeParameters::GetMultiResolutionLevels() is greater than one, the
+ * driver first evolves the level set on a pyramid of downsampled speed and
+ * level set images, running GetMultiResolutionIterations() iterations at each
+ * coarse level and upsampling the result to seed the next level. The full
+ * resolution filter is only used for the final refinement. While a coarse
+ * level is active, the upsampled coarse level set is copied into the output
+ * image so that the evolution can be displayed. Because the full resolution
+ * filter is reinitialized when the last coarse stage completes, the pixel
+ * container of the output may change after calls to Run().
  */
 template <unsigned int VDimension> 
 class SNAPLevelSetDriver : public SNAPLevelSetDriverBase
@@ -162,6 +174,13 @@ public:
   /** Restart the snake */
   void Restart();
 
+  /**
+   * Restart the snake from a previously saved level set, e.g., a checkpoint.
+   * The evolution continues at full resolution, and the elapsed iteration
+   * count is set to the given value.
+   */
+  void RestartFromLevelSet(FloatImageType *level_set, unsigned int iteration);
+
   /** Get the level set function */
   itkGetConstMacro(LevelSetFunction,LevelSetFunctionType *);
 
@@ -177,6 +196,13 @@ public:
    * so to access output, this method should be called
    */
   FloatImageType *GetOutput();
+
+  /**
+   * Get the output image for display. While the evolution is at a coarse
+   * level, the upsampled level set in this image may lag behind the coarse
+   * level by fewer than 2^level iterations. GetOutput() is always current.
+   */
+  FloatImageType *GetPreviewOutput();
   
 private:
   /** An internal class used to invert an image */
@@ -188,6 +214,7 @@ private:
 
   /** Type definition for the level set filter */
   typedef itk::FiniteDifferenceImageFilter<FloatImageType,FloatImageType> FilterType;
+  typedef typename ShortImageType::Pointer ShortImagePointer;
 
   /** Level set filter wrapped by this object */
   typename FilterType::Pointer m_LevelSetFilter;
@@ -201,14 +228,53 @@ private:
   /** Speed image adaptor */
   typename ShortImageType::Pointer m_SpeedAdaptor;
 
+  /** Whether an external advection field is used (single resolution only) */
+  bool m_HasExternalAdvection;
+
   /** Last accepted snake parameters */
   SnakeParameters m_Parameters;
 
+  /** Speed images for the coarse resolution levels (level 0 is unused) */
+  std::vector<ShortImagePointer> m_SpeedPyramid;
+
+  /** Level set function and filter used at the current coarse level */
+  typename LevelSetFunctionType::Pointer m_CoarseLevelSetFunction;
+  typename FilterType::Pointer m_CoarseLevelSetFilter;
+
+  /** Filter that upsamples the coarse level set for display */
+  typedef itk::ResampleImageFilter<FloatImageType, FloatImageType> PreviewFilterType;
+  typename PreviewFilterType::Pointer m_PreviewFilter;
+
+  /** Coarse iterations shown in the output, or -1 if the current coarse
+    stage has not been shown yet */
+  int m_PreviewIterations;
+
+  /** Current resolution level (0 is full resolution) */
+  unsigned int m_CurrentLevel;
+
+  /** Iterations run at the current coarse level, and iterations that preceded
+    the last initialization of the full resolution filter (coarse levels or
+    a restored checkpoint) */
+  unsigned int m_StageIterations, m_PriorIterations;
+
   /** Assign the values of snake parameters to a snake function */
   void AssignParametersToPhi(const SnakeParameters &parms, bool firstTime);
+  void AssignParametersToFunction(LevelSetFunctionType *phi, const SnakeParameters &parms);
 
   /** Internal routines */
   void DoCreateLevelSetFilter();
+  typename FilterType::Pointer CreateFilter(FloatImageType *input, LevelSetFunctionType *phi);
+
+  /** Multi-resolution support */
+  unsigned int GetNumberOfLevels() const;
+  void InitializeMultiResolution();
+  void StartCoarseStage(unsigned int level, FloatImageType *init);
+  void AdvanceToNextLevel();
+  void UpdateCoarsePreview();
+  FloatImagePointer Upsample(FloatImageType *image, itk::ImageBase<VDimension> *reference);
+
+  template <class TImage>
+  static typename TImage::Pointer Downsample(TImage *image, unsigned int factor, bool minimum);
 };
 
 // Type definitions
@@ -50,6 +50,12 @@
 #include "itkDenseFiniteDifferenceImageFilter.h"
 #include "LevelSetExtensionFilter.h"
 #include "itkImageDuplicator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborExtrapolateImageFunction.h"
+#include <algorithm>
 
 #include "itkParallelSparseFieldLevelSetImageFilter.h"
 
@@ -122,6 +128,7 @@ SNAPLevelSetDriver<VDimension>
   m_LevelSetFunction->SetSpeedScaleFactor(1.0 / 0x7fff);
 
   // Set the external advection if any
+  m_HasExternalAdvection = (externalAdvection != NULL);
   if(externalAdvection)
     m_LevelSetFunction->SetAdvectionField(externalAdvection);
 
@@ -141,6 +148,9 @@ SNAPLevelSetDriver<VDimension>
 
   // Create the filter
   DoCreateLevelSetFilter();
+
+  // Set up the coarse resolution levels, if any
+  InitializeMultiResolution();
 }
 
 template<unsigned int VDimension>
@@ -149,35 +159,46 @@ SNAPLevelSetDriver<VDimension>
 ::AssignParametersToPhi(const SnakeParameters &p, bool itkNotUsed(firstTime))
 {
   // Set up the level set function
+  AssignParametersToFunction(m_LevelSetFunction, p);
+
+  // The coarse level function, if active, gets the same parameters
+  if(m_CoarseLevelSetFunction)
+    AssignParametersToFunction(m_CoarseLevelSetFunction, p);
+
+  // Remember the parameters
+  m_Parameters = p;
+}
 
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::AssignParametersToFunction(LevelSetFunctionType *phi, const SnakeParameters &p)
+{
   // The sign of the advection term is flipped in our equation
-  m_LevelSetFunction->SetAdvectionWeight(- p.GetAdvectionWeight());
-  m_LevelSetFunction->SetAdvectionSpeedExponent(p.GetAdvectionSpeedExponent());
+  phi->SetAdvectionWeight(- p.GetAdvectionWeight());
+  phi->SetAdvectionSpeedExponent(p.GetAdvectionSpeedExponent());
 
   // The curvature exponent for traditional/legacy reasons has a +1 value.
-  m_LevelSetFunction->SetCurvatureSpeedExponent(p.GetCurvatureSpeedExponent()+1);  
-  m_LevelSetFunction->SetCurvatureWeight(p.GetCurvatureWeight());
+  phi->SetCurvatureSpeedExponent(p.GetCurvatureSpeedExponent()+1);
+  phi->SetCurvatureWeight(p.GetCurvatureWeight());
   
-  m_LevelSetFunction->SetPropagationWeight(p.GetPropagationWeight());
-  m_LevelSetFunction->SetPropagationSpeedExponent(p.GetPropagationSpeedExponent());  
-  m_LevelSetFunction->SetLaplacianSmoothingWeight(p.GetLaplacianWeight());
-  m_LevelSetFunction->SetLaplacianSmoothingSpeedExponent(p.GetLaplacianSpeedExponent());  
+  phi->SetPropagationWeight(p.GetPropagationWeight());
+  phi->SetPropagationSpeedExponent(p.GetPropagationSpeedExponent());
+  phi->SetLaplacianSmoothingWeight(p.GetLaplacianWeight());
+  phi->SetLaplacianSmoothingSpeedExponent(p.GetLaplacianSpeedExponent());
   
   // We only need to recompute the internal images if the exponents to those
   // images have changed
-  m_LevelSetFunction->CalculateInternalImages();
+  phi->CalculateInternalImages();
   
   // Call the initialize method
   typename LevelSetFunctionType::RadiusType radius;
   radius.Fill(1);
-  m_LevelSetFunction->Initialize(radius);
+  phi->Initialize(radius);
 
   // Set the time step
-  m_LevelSetFunction->SetTimeStepFactor(
+  phi->SetTimeStepFactor(
     p.GetAutomaticTimeStep() ? 1.0 : p.GetTimeStepFactor());
-
-  // Remember the parameters
-  m_Parameters = p;
 }
 
 template<unsigned int VDimension>
@@ -185,6 +206,16 @@ void
 SNAPLevelSetDriver<VDimension>
 ::DoCreateLevelSetFilter()
 {
+  m_LevelSetFilter = CreateFilter(m_InitializationCopyImage, m_LevelSetFunction);
+}
+
+template<unsigned int VDimension>
+typename SNAPLevelSetDriver<VDimension>::FilterType::Pointer
+SNAPLevelSetDriver<VDimension>
+::CreateFilter(FloatImageType *input, LevelSetFunctionType *phi)
+{
+  typename FilterType::Pointer result;
+
   // In this method we have the flexibility to create a level set filter
   // of any ITK solver type.  This way, we can plug in different solvers:
   // NarrowBand, ParallelSparseField, even Dense.  
@@ -199,13 +230,13 @@ SNAPLevelSetDriver<VDimension>
 
     // Cast this specific filter down to the lowest common denominator that is
     // a filter
-    m_LevelSetFilter = filter.GetPointer();
+    result = filter.GetPointer();
 
     // Perform the special configuration tasks on the filter
-    filter->SetInput(m_InitializationCopyImage);
+    filter->SetInput(input);
     filter->SetNumberOfLayers(3);
     filter->SetIsoSurfaceValue(0.0f);
-    filter->SetDifferenceFunction(m_LevelSetFunction);
+    filter->SetDifferenceFunction(phi);
     }
 /*
   else if(m_Parameters.GetSolver() == SnakeParameters::NARROW_BAND_SOLVER)
@@ -218,7 +249,7 @@ SNAPLevelSetDriver<VDimension>
 
     // Cast this specific filter down to the lowest common denominator that is
     // a filter
-    m_LevelSetFilter = filter.GetPointer();
+    result = filter.GetPointer();
 
     // Perform the special configuration tasks on the filter
     filter->SetSegmentationFunction(m_LevelSetFunction);
@@ -238,11 +269,11 @@ SNAPLevelSetDriver<VDimension>
     
     // Cast this specific filter down to the lowest common denominator that is
     // a filter
-    m_LevelSetFilter = filter.GetPointer();
+    result = filter.GetPointer();
 
     // Perform the special configuration tasks on the filter
-    filter->SetInput(m_InitializationCopyImage);
-    filter->SetDifferenceFunction(m_LevelSetFunction);
+    filter->SetInput(input);
+    filter->SetDifferenceFunction(phi);
     }
 
   else
@@ -252,13 +283,15 @@ SNAPLevelSetDriver<VDimension>
 
   // This code is common to all filters. It causes the filter to initialize
   // the necessary memory and sets the iteration counter to 0
-  m_LevelSetFilter->SetManualReinitialization(true);
-  m_LevelSetFilter->SetNumberOfIterations(0);
+  result->SetManualReinitialization(true);
+  result->SetNumberOfIterations(0);
   
   // Update the largest possible region. The slicer may be changing the 
   // requested region on this image, so it's important that we always 
   // update the entire image
-  m_LevelSetFilter->UpdateLargestPossibleRegion();
+  result->UpdateLargestPossibleRegion();
+
+  return result;
 }
 
 template<unsigned int VDimension>
@@ -267,7 +300,9 @@ SNAPLevelSetDriver<VDimension>
 ::Restart()
 { 
   // Tell the filter to reinitialize next time that an update will 
-  // be performed, and set the number of iterations to 0
+  // be performed, and set the number of iterations to 0. The input may
+  // have been replaced by an upsampled coarse level set, so reset it too
+  m_LevelSetFilter->SetInput(m_InitializationCopyImage);
   m_LevelSetFilter->SetStateToUninitialized();
   m_LevelSetFilter->SetNumberOfIterations(0);
 
@@ -275,6 +310,28 @@ SNAPLevelSetDriver<VDimension>
   // requested region on this image, so it's important that we always 
   // update the entire image
   m_LevelSetFilter->UpdateLargestPossibleRegion();
+
+  // Go back to the coarsest resolution level
+  InitializeMultiResolution();
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::RestartFromLevelSet(FloatImageType *level_set, unsigned int iteration)
+{
+  // Leave the coarse levels, if any
+  m_CoarseLevelSetFilter = NULL;
+  m_CoarseLevelSetFunction = NULL;
+  m_CurrentLevel = 0;
+  m_StageIterations = 0;
+  m_PriorIterations = iteration;
+
+  // Reinitialize the full resolution filter from the level set
+  m_LevelSetFilter->SetInput(level_set);
+  m_LevelSetFilter->SetStateToUninitialized();
+  m_LevelSetFilter->SetNumberOfIterations(0);
+  m_LevelSetFilter->UpdateLargestPossibleRegion();
 }
 
 template<unsigned int VDimension>
@@ -282,6 +339,41 @@ void
 SNAPLevelSetDriver<VDimension>
 ::Run(unsigned int nIterations)
 {
+  // Run the iterations at the coarse levels first
+  unsigned int nPerStage = (unsigned int) m_Parameters.GetMultiResolutionIterations();
+  while(m_CurrentLevel > 0 && nIterations > 0)
+    {
+    unsigned int nStage = (nPerStage > m_StageIterations)
+        ? std::min(nIterations, nPerStage - m_StageIterations) : 0;
+
+    unsigned int nCoarseElapsed = m_CoarseLevelSetFilter->GetElapsedIterations();
+    m_CoarseLevelSetFilter->SetNumberOfIterations(nCoarseElapsed + nStage);
+    m_CoarseLevelSetFilter->UpdateLargestPossibleRegion();
+
+    m_StageIterations += nStage;
+    m_PriorIterations += nStage;
+    nIterations -= nStage;
+
+    // Move on to the next finer level if this stage is done
+    if(m_StageIterations >= nPerStage)
+      AdvanceToNextLevel();
+    }
+
+  // If still at a coarse level, show the current coarse level set in the
+  // output. Upsampling to full resolution costs about as much as 2^level
+  // coarse iterations, so the display is refreshed at that rate, and at the
+  // start of every stage
+  if(m_CurrentLevel > 0)
+    {
+    int nCoarse = (int) m_CoarseLevelSetFilter->GetElapsedIterations();
+    if(m_PreviewIterations < 0 || nCoarse >= m_PreviewIterations + (1 << m_CurrentLevel))
+      UpdateCoarsePreview();
+    return;
+    }
+
+  if(nIterations == 0)
+    return;
+
   // Increment the number of iterations 
   unsigned int nElapsed = m_LevelSetFilter->GetElapsedIterations();
   m_LevelSetFilter->SetNumberOfIterations(nElapsed + nIterations);
@@ -297,7 +389,7 @@ bool
 SNAPLevelSetDriver<VDimension>
 ::IsEvolutionConverged()
 {
-  if(m_LevelSetFilter->GetElapsedIterations() == 0)
+  if(m_CurrentLevel > 0 || m_LevelSetFilter->GetElapsedIterations() == 0)
     return false;
 
   // For now, require absolute convergence
@@ -310,7 +402,7 @@ unsigned int
 SNAPLevelSetDriver<VDimension>
 ::GetElapsedIterations() const
 {
-  return m_LevelSetFilter->GetElapsedIterations();
+  return m_PriorIterations + m_LevelSetFilter->GetElapsedIterations();
 }
 
 template<unsigned int VDimension>
@@ -323,12 +415,29 @@ SNAPLevelSetDriver<VDimension>
   // function to free memory
   m_LevelSetFilter = NULL;
   m_LevelSetFunction = NULL;
+  m_CoarseLevelSetFilter = NULL;
+  m_CoarseLevelSetFunction = NULL;
+  m_PreviewFilter = NULL;
+  m_SpeedPyramid.clear();
 }
 
 template<unsigned int VDimension>
 typename SNAPLevelSetDriver<VDimension>::FloatImageType *
 SNAPLevelSetDriver<VDimension>
 ::GetOutput()
+{
+  // Bring the upsampled coarse level set up to date
+  if(m_CurrentLevel > 0
+     && m_PreviewIterations != (int) m_CoarseLevelSetFilter->GetElapsedIterations())
+    UpdateCoarsePreview();
+
+  return m_LevelSetFilter->GetOutput();
+}
+
+template<unsigned int VDimension>
+typename SNAPLevelSetDriver<VDimension>::FloatImageType *
+SNAPLevelSetDriver<VDimension>
+::GetPreviewOutput()
 {
   return m_LevelSetFilter->GetOutput();
 }
@@ -339,8 +448,10 @@ SNAPLevelSetDriver<VDimension>
 ::SetSnakeParameters(const SnakeParameters &sparms)
 {
   // Parameter setting can be destructive or passive.  If the solver has 
-  // has changed, then it's destructive, otherwise it's passive
-  bool destructive = sparms.GetSolver() != m_Parameters.GetSolver();
+  // has changed, then it's destructive, otherwise it's passive. Changing
+  // the number of resolution levels is also destructive
+  bool destructive = sparms.GetSolver() != m_Parameters.GetSolver()
+      || sparms.GetMultiResolutionLevels() != m_Parameters.GetMultiResolutionLevels();
 
   // First of all, pass the parameters to the phi function, which may or
   // may not cause it to recompute it's images
@@ -350,7 +461,224 @@ SNAPLevelSetDriver<VDimension>
   if(destructive)
     {
     DoCreateLevelSetFilter();
+    InitializeMultiResolution();
+    }
+}
+
+template<unsigned int VDimension>
+unsigned int
+SNAPLevelSetDriver<VDimension>
+::GetNumberOfLevels() const
+{
+  // The external advection field is only available at full resolution
+  if(m_HasExternalAdvection || m_Parameters.GetMultiResolutionIterations() <= 0)
+    return 1;
+
+  // Do not shrink the image below a few voxels on the shortest side
+  typename FloatImageType::SizeType size =
+      m_InitializationCopyImage->GetBufferedRegion().GetSize();
+  unsigned int nLevels = 1;
+  while(nLevels < (unsigned int) m_Parameters.GetMultiResolutionLevels())
+    {
+    bool fits = true;
+    for(unsigned int d = 0; d < VDimension; d++)
+      if((size[d] >> nLevels) < 8)
+        fits = false;
+    if(!fits)
+      break;
+    nLevels++;
     }
+
+  return nLevels;
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::InitializeMultiResolution()
+{
+  m_CoarseLevelSetFilter = NULL;
+  m_CoarseLevelSetFunction = NULL;
+  m_CurrentLevel = 0;
+  m_StageIterations = 0;
+  m_PriorIterations = 0;
+  m_PreviewIterations = -1;
+
+  unsigned int nLevels = GetNumberOfLevels();
+  if(nLevels <= 1)
+    {
+    m_SpeedPyramid.clear();
+    return;
+    }
+
+  // The speed image does not change during the lifetime of the driver, so the
+  // pyramid only needs to be computed when the number of levels changes
+  if(m_SpeedPyramid.size() != nLevels)
+    {
+    m_SpeedPyramid.resize(nLevels);
+    for(unsigned int l = 1; l < nLevels; l++)
+      m_SpeedPyramid[l] = Downsample<ShortImageType>(
+            m_LevelSetFunction->GetSpeedImage(), 1u << l, false);
+    }
+
+  // Start from the coarsest level. The initialization is downsampled using
+  // the minimum, so that small bubbles are not lost
+  FloatImagePointer init = Downsample<FloatImageType>(
+        m_InitializationCopyImage, 1u << (nLevels - 1), true);
+  StartCoarseStage(nLevels - 1, init);
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::StartCoarseStage(unsigned int level, FloatImageType *init)
+{
+  m_CoarseLevelSetFunction = LevelSetFunctionType::New();
+  m_CoarseLevelSetFunction->SetSpeedImage(m_SpeedPyramid[level]);
+  m_CoarseLevelSetFunction->SetSpeedScaleFactor(1.0 / 0x7fff);
+  AssignParametersToFunction(m_CoarseLevelSetFunction, m_Parameters);
+
+  m_CoarseLevelSetFilter = CreateFilter(init, m_CoarseLevelSetFunction);
+  m_CurrentLevel = level;
+  m_StageIterations = 0;
+  m_PreviewIterations = -1;
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::AdvanceToNextLevel()
+{
+  assert(m_CurrentLevel > 0);
+  unsigned int next = m_CurrentLevel - 1;
+
+  if(next > 0)
+    {
+    // Seed the next coarse level with the upsampled result
+    FloatImagePointer init = Upsample(
+          m_CoarseLevelSetFilter->GetOutput(), m_SpeedPyramid[next]);
+    StartCoarseStage(next, init);
+    }
+  else
+    {
+    // Seed the full resolution filter with the upsampled result. The filter
+    // will rebuild its sparse field from the zero level set of the input
+    FloatImagePointer init = Upsample(
+          m_CoarseLevelSetFilter->GetOutput(), m_InitializationCopyImage);
+    m_CoarseLevelSetFilter = NULL;
+    m_CoarseLevelSetFunction = NULL;
+    m_CurrentLevel = 0;
+
+    m_LevelSetFilter->SetInput(init);
+    m_LevelSetFilter->SetStateToUninitialized();
+    m_LevelSetFilter->SetNumberOfIterations(0);
+    m_LevelSetFilter->UpdateLargestPossibleRegion();
+    }
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::UpdateCoarsePreview()
+{
+  typedef itk::LinearInterpolateImageFunction<FloatImageType, double> Interpolator;
+  typedef itk::NearestNeighborExtrapolateImageFunction<FloatImageType, double> Extrapolator;
+
+  // The filter is reused for all the refreshes of all the coarse stages
+  FloatImageType *output = m_LevelSetFilter->GetOutput();
+  if(!m_PreviewFilter)
+    {
+    m_PreviewFilter = PreviewFilterType::New();
+    m_PreviewFilter->SetInterpolator(Interpolator::New());
+    m_PreviewFilter->SetExtrapolator(Extrapolator::New());
+    }
+  m_PreviewFilter->SetInput(m_CoarseLevelSetFilter->GetOutput());
+  m_PreviewFilter->SetOutputParametersFromImage(output);
+  m_PreviewFilter->Update();
+
+  FloatImageType *up = m_PreviewFilter->GetOutput();
+  itk::ImageRegionConstIterator<FloatImageType> itSrc(up, up->GetBufferedRegion());
+  itk::ImageRegionIterator<FloatImageType> itTrg(output, output->GetBufferedRegion());
+  for(; !itTrg.IsAtEnd(); ++itSrc, ++itTrg)
+    itTrg.Set(itSrc.Get());
+  output->Modified();
+
+  m_PreviewIterations = (int) m_CoarseLevelSetFilter->GetElapsedIterations();
+}
+
+template<unsigned int VDimension>
+typename SNAPLevelSetDriver<VDimension>::FloatImagePointer
+SNAPLevelSetDriver<VDimension>
+::Upsample(FloatImageType *image, itk::ImageBase<VDimension> *reference)
+{
+  typedef itk::ResampleImageFilter<FloatImageType, FloatImageType> ResampleFilter;
+  typedef itk::LinearInterpolateImageFunction<FloatImageType, double> Interpolator;
+  typedef itk::NearestNeighborExtrapolateImageFunction<FloatImageType, double> Extrapolator;
+
+  typename ResampleFilter::Pointer fltResample = ResampleFilter::New();
+  fltResample->SetInput(image);
+  fltResample->SetInterpolator(Interpolator::New());
+  fltResample->SetExtrapolator(Extrapolator::New());
+  fltResample->SetOutputParametersFromImage(reference);
+  fltResample->Update();
+
+  FloatImagePointer result = fltResample->GetOutput();
+  result->DisconnectPipeline();
+  return result;
+}
+
+template<unsigned int VDimension>
+template <class TImage>
+typename TImage::Pointer
+SNAPLevelSetDriver<VDimension>
+::Downsample(TImage *image, unsigned int factor, bool minimum)
+{
+  typedef typename TImage::RegionType RegionType;
+  typedef typename TImage::PixelType PixelType;
+
+  // Compute the size of the coarse image. Partial blocks at the end of each
+  // dimension are included, so no input voxels are dropped
+  RegionType rIn = image->GetBufferedRegion(), rOut;
+  itk::ContinuousIndex<double, VDimension> cidx;
+  for(unsigned int d = 0; d < VDimension; d++)
+    {
+    rOut.SetSize(d, (rIn.GetSize(d) + factor - 1) / factor);
+    rOut.SetIndex(d, 0);
+    cidx[d] = rIn.GetIndex(d) + 0.5 * (factor - 1.0);
+    }
+
+  // The coarse voxel centers are at the centers of the fine voxel blocks
+  typename TImage::PointType origin;
+  image->TransformContinuousIndexToPhysicalPoint(cidx, origin);
+  typename TImage::SpacingType spacing = image->GetSpacing() * (double) factor;
+
+  typename TImage::Pointer result = TImage::New();
+  result->SetRegions(rOut);
+  result->SetOrigin(origin);
+  result->SetSpacing(spacing);
+  result->SetDirection(image->GetDirection());
+  result->Allocate();
+
+  // Accumulate the fine voxels into the coarse voxels
+  std::vector<double> accum(rOut.GetNumberOfPixels(), minimum ? itk::NumericTraits<double>::max() : 0.0);
+  std::vector<unsigned int> count(rOut.GetNumberOfPixels(), 0);
+  for(itk::ImageRegionConstIteratorWithIndex<TImage> it(image, rIn); !it.IsAtEnd(); ++it)
+    {
+    typename TImage::IndexType idx = it.GetIndex(), cIdx;
+    for(unsigned int d = 0; d < VDimension; d++)
+      cIdx[d] = (idx[d] - rIn.GetIndex(d)) / factor;
+
+    itk::OffsetValueType offset = result->ComputeOffset(cIdx);
+    double value = static_cast<double>(it.Get());
+    accum[offset] = minimum ? std::min(accum[offset], value) : accum[offset] + value;
+    count[offset]++;
+    }
+
+  PixelType *buffer = result->GetBufferPointer();
+  for(size_t i = 0; i < accum.size(); i++)
+    buffer[i] = static_cast<PixelType>(minimum ? accum[i] : accum[i] / count[i]);
+
+  return result;
 }
 
 #endif
@@ -184,6 +184,23 @@ public:
     this->m_AdvectionSpeedExponent = value;
   }
 
+  /** Number of resolution levels used by the level set driver. A value of
+    one (default) evolves the snake at full resolution only. With N > 1 levels,
+    the early iterations are run on images downsampled by 2^(N-1), ..., 2 and
+    the result is upsampled to the next level after each stage. */
+  itkGetConstMacro(MultiResolutionLevels,int);
+  void SetMultiResolutionLevels( int value )
+  {
+    this->m_MultiResolutionLevels = value;
+  }
+
+  /** Number of iterations run at each coarse resolution level */
+  itkGetConstMacro(MultiResolutionIterations,int);
+  void SetMultiResolutionIterations( int value )
+  {
+    this->m_MultiResolutionIterations = value;
+  }
+
 private:
   float m_TimeStepFactor;
   float m_Ground;
@@ -206,6 +223,9 @@ private:
   int m_AdvectionSpeedExponent;   
 
   SolverType m_Solver;
+
+  int m_MultiResolutionLevels;
+  int m_MultiResolutionIterations;
 };
 
 #endif // __SnakeParameters_h_
@@ -41,6 +41,7 @@
 #include "itkBSplineInterpolationWeightFunction.h"
 #include "itkBSplineKernelFunction.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
 #include "itkNarrowBandLevelSetImageFilter.h"
 #include "itkVTKImageExport.h"
 #include "vtkCellArray.h"
@@ -49,6 +50,7 @@
 #include "vtkImageImport.h"
 #include "vtkPolyData.h"
 #include <vtkPoints2D.h>
+#include <vtkSmartPointer.h>
 
 #include "SNAPLevelSetDriver.h"
 #include "PolygonScanConvert.h"
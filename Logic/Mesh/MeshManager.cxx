@@ -183,6 +183,7 @@ MeshManager
     // Make sure the pipeline has the right image
     LabelImageWrapper::ImagePointer imgpt = wrapper->GetImageByTimePoint(timepoint);
     pipeline->SetImage(imgpt);
+    pipeline->SetOccupancyIndex(wrapper->GetOccupancyIndex(timepoint));
 
       // Pass the options to the pipeline
     pipeline->SetMeshOptions(m_GlobalState->GetMeshOptions());
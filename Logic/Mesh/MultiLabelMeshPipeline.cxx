@@ -44,7 +44,9 @@
 #include "IRISVectorTypesToITKConversion.h"
 #include "VTKMeshPipeline.h"
 #include "MeshOptions.h"
+#include "LabelOccupancyIndex.h"
 #include "vtkUnsignedShortArray.h"
+#include "TraceRecorder.h"
 
 // ITK includes
 #include "itkBinaryThresholdImageFilter.h"
@@ -203,45 +205,69 @@ void MultiLabelMeshPipeline::UpdateMeshInfoHelper(
 
 void MultiLabelMeshPipeline::UpdateMeshes(itk::Command *progressCommand)
 {
+  SNAP_TRACE_SCOPE("mesh", "MultiLabelMeshPipeline::UpdateMeshes");
+
   // Create a temporary table of mesh info
   MeshInfoMap meshmap;
 
-  // Current label and current mesh map
-  LabelType current_label = 0;
-  MeshInfo *current_meshinfo = NULL;
-  itk::Index<3> run_start;
-
-  // The length of a line
-  //unsigned long line_length = m_InputImage->GetLargestPossibleRegion().GetSize()[0];
-
-  // Iterate through the image updating the mesh map. This code takes advantage
-  // of the organization of label data. Rather than updating the extents after
-  // each pixel read, the code collects runs of pixels of the same label and
-  // updates once the run ends (a pixel of another label is found or the end
-  // of a line of pixels is reached). This makes for much more efficient code.
-  typedef itk::ImageRegionConstIteratorWithIndex<InputImageType> InputIterator;
-  InputIterator it(m_InputImage, m_InputImage->GetLargestPossibleRegion());
-  while( !it.IsAtEnd() )
+  if(m_OccupancyIndex)
     {
-    run_start = it.GetIndex();
-    const InputIterator::RLLine &line=*(it.rlLine);
-    int t = 0;
-    // Iterate through the line
-    for (size_t x = 0; x < line.size(); x++)
+    // The index knows the number of voxels, the extent and the checksum of
+    // every label, so the image does not need to be scanned
+    m_OccupancyIndex->Update(m_InputImage);
+    LabelOccupancyIndex::LabelSummaryMap summaries =
+        m_OccupancyIndex->GetLabelSummaries();
+    LabelOccupancyIndex::LabelSummaryMap::const_iterator it = summaries.begin();
+    for(; it != summaries.end(); ++it)
       {
-      run_start[0] = t;
-      current_label = line[x].second;
-      t += line[x].first;
-      if (current_label != 0)
+      if(it->first == 0)
+        continue;
+      MeshInfo &info = meshmap[it->first];
+      info.Count = it->second.Count;
+      info.CheckSum = it->second.CheckSum;
+      info.BoundingBox[0] = it->second.BoundingBox[0];
+      info.BoundingBox[1] = it->second.BoundingBox[1];
+      }
+    }
+  else
+    {
+    // Current label and current mesh map
+    LabelType current_label = 0;
+    MeshInfo *current_meshinfo = NULL;
+    itk::Index<3> run_start;
+
+    // The length of a line
+    //unsigned long line_length = m_InputImage->GetLargestPossibleRegion().GetSize()[0];
+
+    // Iterate through the image updating the mesh map. This code takes advantage
+    // of the organization of label data. Rather than updating the extents after
+    // each pixel read, the code collects runs of pixels of the same label and
+    // updates once the run ends (a pixel of another label is found or the end
+    // of a line of pixels is reached). This makes for much more efficient code.
+    typedef itk::ImageRegionConstIteratorWithIndex<InputImageType> InputIterator;
+    InputIterator it(m_InputImage, m_InputImage->GetLargestPossibleRegion());
+    while( !it.IsAtEnd() )
+      {
+      run_start = it.GetIndex();
+      const InputIterator::RLLine &line=*(it.rlLine);
+      int t = 0;
+      // Iterate through the line
+      for (size_t x = 0; x < line.size(); x++)
         {
-        current_meshinfo = &meshmap[current_label];
-        // Update the current mesh info
-        UpdateMeshInfoHelper(current_meshinfo, run_start, it, t);
-        current_meshinfo = &meshmap[current_label];
+        run_start[0] = t;
+        current_label = line[x].second;
+        t += line[x].first;
+        if (current_label != 0)
+          {
+          current_meshinfo = &meshmap[current_label];
+          // Update the current mesh info
+          UpdateMeshInfoHelper(current_meshinfo, run_start, it, t);
+          current_meshinfo = &meshmap[current_label];
+          }
         }
+      ++(it.bi);
+      it.rlLine = &it.bi.Value();
       }
-    ++(it.bi);
-    it.rlLine = &it.bi.Value();
     }
 
   // At this point, meshmap has the number of voxels for every label, as well
@@ -333,6 +359,13 @@ void MultiLabelMeshPipeline::UpdateMeshes(itk::Command *progressCommand)
   this->Modified();
 }
 
+void
+MultiLabelMeshPipeline
+::SetOccupancyIndex(LabelOccupancyIndex *index)
+{
+  m_OccupancyIndex = index;
+}
+
 void 
 MultiLabelMeshPipeline
 ::SetImage(const InputImageType *image)
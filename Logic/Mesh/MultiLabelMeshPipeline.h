@@ -59,6 +59,7 @@ class MeshOptions;
 class VTKMeshPipeline;
 class vtkPolyData;
 class AllPurposeProgressAccumulator;
+class LabelOccupancyIndex;
 
 
 /**
@@ -108,6 +109,13 @@ public:
   /** Set the input segmentation image */
   void SetImage(const InputImageType *input);
 
+  /**
+   * Set an occupancy index for the input image. The labels present in the
+   * image and their extents are then taken from the index, which is only
+   * updated where the image changed, instead of scanning the whole image.
+   */
+  void SetOccupancyIndex(LabelOccupancyIndex *index);
+
   /** Compute the bounding boxes for different regions.  Prerequisite for 
    * calling ComputeMesh(). Returns the total number of voxels in all boxes */
   unsigned long ComputeBoundingBoxes();
@@ -166,6 +174,9 @@ private:
   // The input image
   InputImageConstPointer      m_InputImage;
 
+  // Optional index of the labels in the input image
+  SmartPtr<LabelOccupancyIndex> m_OccupancyIndex;
+
   // The ROI extraction filter used for constructing a bounding box
   ROIFilterPointer            m_ROIFilter;
 
@@ -25,10 +25,12 @@ GetPipeline()
 
 void
 SegmentationMeshAssembly::
-UpdateMeshAssembly(itk::Command *progress, ImagePointer img, MeshOptions *options)
+UpdateMeshAssembly(itk::Command *progress, ImagePointer img,
+                   LabelOccupancyIndex *index, MeshOptions *options)
 {
   // Get the image from current tp and feed the pipeline
   m_Pipeline->SetImage(img);
+  m_Pipeline->SetOccupancyIndex(index);
   m_Pipeline->SetMeshOptions(options);
 
   // Run the UpdateMesh for the current tp assembly
@@ -147,7 +149,8 @@ SegmentationMeshWrapper::UpdateMeshes(itk::Command *progressCmd, unsigned int ti
 
 
   auto img = m_ImagePointer->GetImageByTimePoint(timepoint);
-  assembly->UpdateMeshAssembly(progressCmd, img, m_MeshOptions);
+  auto index = m_ImagePointer->GetOccupancyIndex(timepoint);
+  assembly->UpdateMeshAssembly(progressCmd, img, index, m_MeshOptions);
 }
 
 void
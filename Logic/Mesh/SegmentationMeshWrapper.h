@@ -17,7 +17,8 @@ public:
 
   MultiLabelMeshPipeline *GetPipeline();
 
-  void UpdateMeshAssembly(itk::Command *progress, ImagePointer img, MeshOptions *options);
+  void UpdateMeshAssembly(itk::Command *progress, ImagePointer img,
+                          LabelOccupancyIndex *index, MeshOptions *options);
 protected:
   SegmentationMeshAssembly();
   virtual ~SegmentationMeshAssembly();
@@ -50,6 +50,8 @@ namespace itk {
   template <class TIn, class TOut> class GradientMagnitudeImageFilter;
   template <class TIn, class TOut, class Fun> class UnaryFunctorImageFilter;
   template <class TIn, class TOut> class CastImageFilter;
+  template <class TIn, class TOut> class RecursiveGaussianImageFilter;
+  template <class TIn, class TOut> class RegionOfInterestImageFilter;
 }
 
 
@@ -106,6 +108,14 @@ private:
  * 
  * This functor implements a Gaussian blur, followed by a gradient magnitude
  * operator, followed by a 'contrast enhancement' intensity remapping filter.
+ *
+ * When the settings request it, the blurred gradient is instead computed by
+ * recursive (IIR) Gaussian derivative filters, whose cost per voxel does not
+ * grow with the blur scale. The derivatives are computed over the requested
+ * region padded by four blur scales, beyond which the Gaussian is negligible,
+ * so slice previews and volume bricks both use this path, and no gradient
+ * image larger than the padded region is ever held. The gradient magnitude
+ * and the remapping are computed in the same pass as the last derivative.
  */
 template <typename TInputImage,typename TOutputImage>
 class EdgePreprocessingImageFilter: 
@@ -178,6 +188,13 @@ protected:
    */
   void GenerateInputRequestedRegion() ITK_OVERRIDE;
 
+  /** Compute the output using recursive Gaussian derivative filters */
+  void GenerateDataRecursive(EdgePreprocessingSettings *settings);
+
+  /** The input region needed by the recursive filters for an output region */
+  OutputImageRegionType GetRecursiveInputRegion(
+      const OutputImageRegionType &region, EdgePreprocessingSettings *settings);
+
 private:
 
   double m_InputImageMaximumGradientMagnitude;
@@ -206,6 +223,18 @@ private:
   SmartPtr<GradMagFilter> m_GradMagFilter;
   SmartPtr<RemapFilter> m_RemapFilter;
 
+  // Recursive Gaussian filters. The ROI filter crops the padded region from
+  // the input, and the chain m_RecursiveFilter[d] computes the derivative
+  // along dimension d over it, smoothing along the other dimensions.
+  typedef itk::RegionOfInterestImageFilter<InternalImageType,
+                                           InternalImageType>    ROIFilter;
+
+  typedef itk::RecursiveGaussianImageFilter<InternalImageType,
+                                            InternalImageType>   RecursiveFilter;
+
+  SmartPtr<ROIFilter> m_ROIFilter;
+  SmartPtr<RecursiveFilter> m_RecursiveFilter[3][3];
+
 #ifdef SNAP_USE_GPU
   SmartPtr<GPUImageSource> m_GPUImageSource;
   SmartPtr<GPUBlurFilter>  m_GPUBlurFilter;
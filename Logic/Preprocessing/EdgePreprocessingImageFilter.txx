@@ -39,6 +39,10 @@
 #include <itkCastImageFilter.h>
 #include <itkDiscreteGaussianImageFilter.h>
 #include <itkGradientMagnitudeImageFilter.h>
+#include <itkRecursiveGaussianImageFilter.h>
+#include <itkRegionOfInterestImageFilter.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkUnaryFunctorImageFilter.h>
 #include <IRISException.h>
 
@@ -91,6 +95,29 @@ EdgePreprocessingImageFilter<TInputImage,TOutputImage>
 
   m_RemapFilter = RemapFilter::New();
   m_RemapFilter->SetInput(m_GradMagFilter->GetOutput());
+
+  // The cropped input is read by all three derivative chains, so it is
+  // released by hand once they are done
+  m_ROIFilter = ROIFilter::New();
+  m_ROIFilter->SetInput(m_CastFilter->GetOutput());
+
+  // Set up the recursive derivative chains. The first filter in each chain
+  // reads the shared cropped image, so only the later filters run in place
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    for(unsigned int k = 0; k < 3; k++)
+      {
+      m_RecursiveFilter[d][k] = RecursiveFilter::New();
+      m_RecursiveFilter[d][k]->SetDirection(k);
+      m_RecursiveFilter[d][k]->SetOrder(
+            k == d ? RecursiveFilter::FirstOrder : RecursiveFilter::ZeroOrder);
+      m_RecursiveFilter[d][k]->SetNormalizeAcrossScale(false);
+      m_RecursiveFilter[d][k]->ReleaseDataFlagOn();
+      m_RecursiveFilter[d][k]->SetInput(
+            k == 0 ? m_ROIFilter->GetOutput() : m_RecursiveFilter[d][k-1]->GetOutput());
+      m_RecursiveFilter[d][k]->SetInPlace(k > 0);
+      }
+    }
 }
 
 template<typename TInputImage,typename TOutputImage>
@@ -109,6 +136,13 @@ EdgePreprocessingImageFilter<TInputImage,TOutputImage>
   if(!settings)
     throw IRISException("Parameters not set in EdgePreprocessingImageFilter");
 
+  // Use the recursive filters if requested
+  if(settings->GetUseRecursiveGaussian())
+    {
+    this->GenerateDataRecursive(settings);
+    return;
+    }
+
   itk::ProgressAccumulator::Pointer pac = itk::ProgressAccumulator::New();
   pac->SetMiniPipelineFilter(this);
 
@@ -150,6 +184,98 @@ EdgePreprocessingImageFilter<TInputImage,TOutputImage>
   this->GraftOutput(m_RemapFilter->GetOutput());
 }
 
+template<typename TInputImage,typename TOutputImage>
+typename EdgePreprocessingImageFilter<TInputImage,TOutputImage>::OutputImageRegionType
+EdgePreprocessingImageFilter<TInputImage,TOutputImage>
+::GetRecursiveInputRegion(const OutputImageRegionType &region,
+                          EdgePreprocessingSettings *settings)
+{
+  // Beyond four blur scales (given in voxel units) the Gaussian and its
+  // derivative are negligible, so the output only depends on the input this
+  // close to the region. One more voxel is added for the derivative.
+  int margin = (int) std::ceil(4.0 * settings->GetGaussianBlurScale()) + 1;
+
+  OutputImageRegionType padded = region;
+  padded.PadByRadius(margin);
+  padded.Crop(this->GetInput()->GetLargestPossibleRegion());
+  return padded;
+}
+
+template<typename TInputImage,typename TOutputImage>
+void
+EdgePreprocessingImageFilter<TInputImage,TOutputImage>
+::GenerateDataRecursive(EdgePreprocessingSettings *settings)
+{
+  const InputImageType *inputImage = this->GetInput();
+  typename OutputImageType::Pointer outputImage = this->GetOutput();
+  OutputImageRegionType region = outputImage->GetRequestedRegion();
+
+  itk::ProgressAccumulator::Pointer pac = itk::ProgressAccumulator::New();
+  pac->SetMiniPipelineFilter(this);
+  for(unsigned int d = 0; d < 3; d++)
+    for(unsigned int k = 0; k < 3; k++)
+      pac->RegisterInternalFilter(m_RecursiveFilter[d][k], 1.0 / 9);
+
+  // Crop the padded region from the input. The recursive filters run along
+  // whole lines of the cropped image, which start and end in the padding.
+  OutputImageRegionType padded = this->GetRecursiveInputRegion(region, settings);
+  m_CastFilter->SetInput(inputImage);
+  m_ROIFilter->SetRegionOfInterest(padded);
+
+  // The blur scale is given in voxel units, like in the discrete Gaussian
+  // path, but the recursive filter expects physical units. The derivatives
+  // are taken in physical units, as in the gradient magnitude filter
+  for(unsigned int d = 0; d < 3; d++)
+    for(unsigned int k = 0; k < 3; k++)
+      m_RecursiveFilter[d][k]->SetSigma(
+            settings->GetGaussianBlurScale() * inputImage->GetSpacing()[k]);
+
+  // The requested region within the cropped image, whose index starts at 0
+  typename InternalImageType::RegionType crop_region(region.GetSize());
+  for(unsigned int k = 0; k < 3; k++)
+    crop_region.SetIndex(k, region.GetIndex(k) - padded.GetIndex(k));
+
+  // Apply the remapping function directly to the gradient magnitude
+  FunctorType functor;
+  functor.SetParameters(0.0, m_InputImageMaximumGradientMagnitude,
+                        settings->GetRemappingExponent(),
+                        settings->GetRemappingSteepness());
+
+  // Sum the squared derivatives over the requested region. The last one is
+  // added in the same pass as the square root and the remapping.
+  InternalImagePointer sum = InternalImageType::New();
+  sum->SetRegions(region);
+  sum->Allocate();
+  sum->FillBuffer(0.0f);
+
+  this->AllocateOutputs();
+
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    m_RecursiveFilter[d][2]->UpdateLargestPossibleRegion();
+    InternalImageType *deriv = m_RecursiveFilter[d][2]->GetOutput();
+
+    itk::ImageRegionConstIterator<InternalImageType> it(deriv, crop_region);
+    itk::ImageRegionIterator<InternalImageType> itSum(sum, region);
+    if(d < 2)
+      {
+      for(; !it.IsAtEnd(); ++it, ++itSum)
+        itSum.Set(itSum.Get() + it.Get() * it.Get());
+      }
+    else
+      {
+      itk::ImageRegionIterator<OutputImageType> itOut(outputImage, region);
+      for(; !it.IsAtEnd(); ++it, ++itSum, ++itOut)
+        itOut.Set(functor(std::sqrt(itSum.Get() + it.Get() * it.Get())));
+      }
+
+    // We no longer need the derivative
+    deriv->ReleaseData();
+    }
+
+  m_ROIFilter->GetOutput()->ReleaseData();
+}
+
 template<typename TInputImage,typename TOutputImage>
 void
 EdgePreprocessingImageFilter<TInputImage,TOutputImage>
@@ -196,8 +322,14 @@ EdgePreprocessingImageFilter<TInputImage,TOutputImage>
     const_cast< TInputImage * >( this->GetInput() );
   OutputImagePointer outputPtr = this->GetOutput();
 
-  // Use the largest possible region (hack)
-  inputPtr->SetRequestedRegion(
-        inputPtr->GetLargestPossibleRegion());
+  // The recursive path only needs the padded region. Otherwise, use the
+  // largest possible region (hack)
+  EdgePreprocessingSettings *settings = this->GetParameters();
+  if(settings && settings->GetUseRecursiveGaussian())
+    inputPtr->SetRequestedRegion(
+          this->GetRecursiveInputRegion(outputPtr->GetRequestedRegion(), settings));
+  else
+    inputPtr->SetRequestedRegion(
+          inputPtr->GetLargestPossibleRegion());
 }
 
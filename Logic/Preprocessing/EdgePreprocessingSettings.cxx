@@ -42,14 +42,16 @@ EdgePreprocessingSettings
 {
   return (m_GaussianBlurScale == other.m_GaussianBlurScale &&
           m_RemappingSteepness == other.m_RemappingSteepness &&
-          m_RemappingExponent == other.m_RemappingExponent);
+          m_RemappingExponent == other.m_RemappingExponent &&
+          m_UseRecursiveGaussian == other.m_UseRecursiveGaussian);
 }
 
 EdgePreprocessingSettings::
 EdgePreprocessingSettings():
         m_GaussianBlurScale(1.0f), 
         m_RemappingSteepness(0.04f),  
-        m_RemappingExponent(3.0f) 
+        m_RemappingExponent(3.0f),
+        m_UseRecursiveGaussian(false)
 {
   this->InitializeToDefaults();
 }
@@ -62,6 +64,7 @@ EdgePreprocessingSettings
   SetGaussianBlurScale(1.0f);
   SetRemappingSteepness(0.04f);
   SetRemappingExponent(3.0f);
+  SetUseRecursiveGaussian(false);
 }
 
 void
@@ -71,6 +74,7 @@ EdgePreprocessingSettings
   m_GaussianBlurScale = registry["GaussianBlurScale"][m_GaussianBlurScale];
   m_RemappingSteepness = registry["RemappingSteepness"][m_RemappingSteepness];
   m_RemappingExponent = registry["RemappingExponent"][m_RemappingExponent];
+  m_UseRecursiveGaussian = registry["UseRecursiveGaussian"][m_UseRecursiveGaussian];
 }
 
 void EdgePreprocessingSettings
@@ -79,4 +83,5 @@ void EdgePreprocessingSettings
   registry["GaussianBlurScale"] << m_GaussianBlurScale;
   registry["RemappingSteepness"] << m_RemappingSteepness;
   registry["RemappingExponent"] << m_RemappingExponent;
+  registry["UseRecursiveGaussian"] << m_UseRecursiveGaussian;
 }
@@ -59,6 +59,15 @@ public:
 
   itkGetConstMacro(RemappingExponent,float)
   itkSetMacro(RemappingExponent,float)
+
+  /**
+   * Whether the blurred gradient is computed with recursive (IIR) Gaussian
+   * derivative filters, whose cost does not depend on the blur scale, rather
+   * than with a discrete Gaussian kernel
+   */
+  itkGetConstMacro(UseRecursiveGaussian,bool)
+  itkSetMacro(UseRecursiveGaussian,bool)
+  itkBooleanMacro(UseRecursiveGaussian)
   
   /** Compare two sets of settings */
   bool operator == (const EdgePreprocessingSettings &other) const;
@@ -86,6 +95,7 @@ private:
   float m_GaussianBlurScale;
   float m_RemappingSteepness;
   float m_RemappingExponent;
+  bool m_UseRecursiveGaussian;
 };
 
 #endif // __EdgePreprocessingSettings_h_
@@ -1,27 +1,46 @@
 #include "EMGaussianMixtures.h"
+#include "itkMultiThreaderBase.h"
 #include <iostream>
 #include <ctime>
+#include <algorithm>
+
+// Number of samples processed together by a single thread
+static const int EM_BLOCK_SIZE = 1024;
 
 EMGaussianMixtures::EMGaussianMixtures(double **x, int dataSize, int dataDim, int numOfClass)
-  :m_x(x), m_numOfData(dataSize), m_dimOfGaussian(dataDim), m_numOfGaussian(numOfClass), m_setPriorFlag(0), m_numOfIteration(0), m_fail(0)
+  :m_numOfData(dataSize), m_dimOfGaussian(dataDim), m_numOfGaussian(numOfClass), m_setPriorFlag(0), m_numOfIteration(0), m_fail(0)
 {
-  m_latent = new double*[dataSize];
-  m_probs = new double[dataSize*numOfClass];
-  for (int i = 0; i < dataSize; i++)
-    {
-    m_latent[i] = &m_probs[i*numOfClass];
-    }
-  m_log_pdf = new double*[dataSize];
-  m_probs2 = new double[dataSize*numOfClass];
+  // Copy the samples into structure-of-arrays layout
+  m_x.resize(dataSize * dataDim);
   for (int i = 0; i < dataSize; i++)
     {
-    m_log_pdf[i] = &m_probs2[i*numOfClass];
+    for (int k = 0; k < dataDim; k++)
+      {
+      m_x[k * dataSize + i] = x[i][k];
+      }
     }
-  m_tmp1 = new double[numOfClass];
-  m_tmp2 = new double[dataDim];
-  m_tmp3 = new double[dataDim*dataDim];
-  m_sum = new double[numOfClass];
-  m_weight = new double[numOfClass];
+
+  m_latent.resize(dataSize * numOfClass, 0.0);
+  m_log_pdf.resize(dataSize * numOfClass, 0.0);
+  m_sum.resize(numOfClass, 0.0);
+  m_weight.resize(numOfClass, 0.0);
+  m_numOfBlocks = (dataSize + EM_BLOCK_SIZE - 1) / EM_BLOCK_SIZE;
+  m_prior = 0;
+
+  // Pointers to the components of each block of samples
+  m_blockPointers.resize(m_numOfBlocks * dataDim);
+  for (int b = 0; b < m_numOfBlocks; b++)
+    for (int k = 0; k < dataDim; k++)
+      m_blockPointers[b * dataDim + k] = m_x.data() + k * dataSize + b * EM_BLOCK_SIZE;
+
+  // Scratch space: the covariance pass needs a block of mean-subtracted
+  // samples, the likelihood pass three values per sample
+  m_scratchPerBlock = EM_BLOCK_SIZE * std::max(dataDim, 3);
+  m_blockScratch.resize(m_numOfBlocks * m_scratchPerBlock);
+
+  // Partial sums: the covariance pass needs the most
+  m_blockSum.resize(m_numOfBlocks * numOfClass * dataDim * dataDim);
+  m_threader = itk::MultiThreaderBase::New();
 
   m_gmm = GaussianMixtureModel::New();
   m_gmm->Initialize(dataDim, numOfClass);
@@ -33,15 +52,22 @@ EMGaussianMixtures::EMGaussianMixtures(double **x, int dataSize, int dataDim, in
 
 EMGaussianMixtures::~EMGaussianMixtures()
 {
-  delete m_probs;
-  delete m_probs2;
-  delete m_latent;
-  delete m_log_pdf;
-  delete m_tmp1;
-  delete m_tmp2;
-  delete m_tmp3;
-  delete m_sum;
-  delete m_weight;
+}
+
+void EMGaussianMixtures::ParallelizeOverBlocks(const BlockFunction &f)
+{
+  int nData = m_numOfData;
+  m_threader->ParallelizeArray(0, m_numOfBlocks, [&f, nData](itk::SizeValueType b)
+    {
+    int block = static_cast<int>(b), first = block * EM_BLOCK_SIZE;
+    f(block, first, std::min(EM_BLOCK_SIZE, nData - first));
+    }, nullptr);
+}
+
+double *EMGaussianMixtures::ResetBlockSums(int n)
+{
+  std::fill(m_blockSum.begin(), m_blockSum.begin() + m_numOfBlocks * n, 0.0);
+  return m_blockSum.data();
 }
 
 void EMGaussianMixtures::Reset(void)
@@ -49,11 +75,8 @@ void EMGaussianMixtures::Reset(void)
   m_numOfIteration = 0;
   m_fail = 0;
   m_logLikelihood = std::numeric_limits<double>::infinity();
-  for (int i = 0; i < m_numOfData*m_numOfGaussian; i++)
-    {
-    m_probs[i] = 0;
-    m_probs2[i] = 0;
-    }
+  std::fill(m_latent.begin(), m_latent.end(), 0.0);
+  std::fill(m_log_pdf.begin(), m_log_pdf.end(), 0.0);
 }
 
 void EMGaussianMixtures::SetMaxIteration(int maxIteration)
@@ -102,24 +125,34 @@ int EMGaussianMixtures::GetMaxIteration(void)
   return m_maxIteration;
 }
 
-double ** EMGaussianMixtures::Update(void)
+bool EMGaussianMixtures::CheckLogLikelihood(double previous, double current)
+{
+  // The change is measured per sample, so that the tolerance does not depend
+  // on the number of samples. EM never lowers the log likelihood, so a drop
+  // beyond the tolerance means that it has failed.
+  double change = (current - previous) / m_numOfData;
+  if (change < -m_precision)
+    {
+    m_fail = 1;
+    std::cout << "!!!!!! Log Likelihood decrease, EM fails" << std::endl;
+    std::cout << "old=" << previous << std::endl << "new=" << current << std::endl;
+    }
+  return fabs(change) <= m_precision;
+}
+
+void EMGaussianMixtures::Update(void)
 {
-  double currentLogLikelihood = 0;
   m_numOfIteration = 0;
   m_fail = 0;
-  while ((fabs(m_logLikelihood - currentLogLikelihood) > m_precision) && (m_numOfIteration < m_maxIteration))
+  bool converged = false;
+  while (!converged && m_numOfIteration < m_maxIteration)
     {
-    if (m_logLikelihood < currentLogLikelihood)
-      {
-      m_fail = 1;
-      std::cout << "!!!!!! Log Likelihood increase, EM fails" << std::endl;
-      std::cout << "old=" <<m_logLikelihood << std::endl << "new=" << currentLogLikelihood << std::endl;
-      // break;
-      }
+    double previousLogLikelihood = m_logLikelihood;
     ++m_numOfIteration;
-    m_logLikelihood = currentLogLikelihood;
     EvaluatePDF();
-    currentLogLikelihood = EvaluateLogLikelihood();
+    m_logLikelihood = EvaluateLogLikelihood();
+    if (m_numOfIteration > 1)
+      converged = CheckLogLikelihood(previousLogLikelihood, m_logLikelihood);
     UpdateLatent();
     UpdateMean();
     UpdateCovariance();
@@ -134,10 +167,9 @@ double ** EMGaussianMixtures::Update(void)
     PrintParameters();
     //getchar();
     }
-  return m_latent;
 }
 
-double ** EMGaussianMixtures::UpdateOnce(void)
+void EMGaussianMixtures::UpdateOnce(void)
 {
   long start = 0;
   long end = 0;
@@ -149,13 +181,7 @@ double ** EMGaussianMixtures::UpdateOnce(void)
   double currentLogLikelihood = EvaluateLogLikelihood();
   end = clock();
   std::cout << "evaluate likelihood spending " << (end-start)/1000 << std::endl;
-  if (m_logLikelihood < currentLogLikelihood)
-    {
-    m_fail = 1;
-    std::cout << "!!!!!! Log Likelihood increase, EM fails" << std::endl;
-    std::cout << "old=" <<m_logLikelihood << std::endl << "new=" << currentLogLikelihood << std::endl;
-    }
-  if (fabs(m_logLikelihood - currentLogLikelihood) <= m_precision)
+  if (m_numOfIteration > 0 && CheckLogLikelihood(m_logLikelihood, currentLogLikelihood))
     {
     std::cout << "Log Likelihood converged" << std::endl;
     }
@@ -191,18 +217,21 @@ double ** EMGaussianMixtures::UpdateOnce(void)
   std::cout << "log likelihood:" << std::endl << m_logLikelihood << std::endl;
   PrintParameters();
   //getchar();
-  return m_latent;
 }
 
 void EMGaussianMixtures::EvaluatePDF(void)
 {
-  for (int i = 0; i < m_numOfData; i++)
+  ParallelizeOverBlocks([this](int b, int first, int n)
     {
+    const double * const *xb = GetBlockPointers(b);
+    double *zscratch = GetBlockScratch(b);
     for (int j = 0; j < m_numOfGaussian; j++)
       {
-      m_log_pdf[i][j] = m_gmm->EvaluateLogPDF(j, m_x[i]);
+      m_gmm->GetGaussian(j)->EvaluateLogPDF(
+            xb, n, m_log_pdf.data() + j * m_numOfData + first, zscratch);
       }
-    }
+    });
+
   if (m_setPriorFlag == 0)
     {
     for (int j = 0; j < m_numOfGaussian; j++)
@@ -266,53 +295,72 @@ double EMGaussianMixtures::ComputePosterior(int nGauss, double *log_pdf, double
 
 void EMGaussianMixtures::UpdateLatent(void)
 {
-  double sum = 0;
   for (int i = 0; i < m_numOfGaussian; i++)
     {
     m_sum[i] = 0;
     }
 
-  // Compute log of the weights and store in logw
-  vnl_vector<double> logw(m_numOfGaussian);
-  for(int i = 0; i < m_numOfGaussian; i++)
-    logw(i) = log(m_weight[i]);
-  
   if (m_setPriorFlag == 0)
     {
-    for (int i = 0; i < m_numOfData; i++)
+    // Compute log of the weights
+    std::vector<double> logw(m_numOfGaussian);
+    for (int j = 0; j < m_numOfGaussian; j++)
+      logw[j] = log(m_weight[j]);
+
+    // Per-block sums of the latent variables
+    double *block_sum = ResetBlockSums(m_numOfGaussian);
+
+    ParallelizeOverBlocks([this, &logw, block_sum](int b, int first, int n)
       {
+      // This is the same posterior as in ComputePosterior, but computed for
+      // the whole block using log-sum-exp, i.e.,
+      //   latent[i][j] = exp(a_j - max_k a_k) / Sum_k[ exp(a_k - max_k a_k) ]
+      // where a_j = log(w[j]) + log(pdf[j]). The loops run over contiguous
+      // samples so that the compiler can vectorize them.
+      const double neg_inf = -std::numeric_limits<double>::infinity();
+      double *amax = GetBlockScratch(b), *asum = amax + n;
+      std::fill(amax, amax + n, neg_inf);
+      std::fill(asum, asum + n, 0.0);
       for (int j = 0; j < m_numOfGaussian; j++)
         {
-        m_latent[i][j] = ComputePosterior(m_numOfGaussian, m_log_pdf[i], m_weight, logw.data_block(), j);
-        m_sum[j] += m_latent[i][j];
+        const double *lp = m_log_pdf.data() + j * m_numOfData + first;
+        double lw = logw[j];
+        for (int s = 0; s < n; s++)
+          amax[s] = std::max(amax[s], lw + lp[s]);
         }
 
-
-      /*
-      sum = 0;
       for (int j = 0; j < m_numOfGaussian; j++)
         {
-        m_tmp1[j] = m_weight[j] * m_pdf[i][j];
-        sum += m_tmp1[j];
-        }
-      if(sum == 0)
-        {
-        for (int j = 0; j < m_numOfGaussian; j++)
+        const double *lp = m_log_pdf.data() + j * m_numOfData + first;
+        double *lat = m_latent.data() + j * m_numOfData + first;
+        double lw = logw[j];
+        for (int s = 0; s < n; s++)
           {
-          m_latent[i][j] = 1.0 / m_numOfGaussian;
-          m_sum[j] += m_latent[i][j];
+          lat[s] = (amax[s] > neg_inf) ? exp(lw + lp[s] - amax[s]) : 0.0;
+          asum[s] += lat[s];
           }
         }
-      else
+
+      // Normalize. If all the classes have zero likelihood at a sample, the
+      // sample is assigned to all classes with equal probability
+      double *bsum = block_sum + b * m_numOfGaussian;
+      for (int j = 0; j < m_numOfGaussian; j++)
         {
-        for (int j = 0; j < m_numOfGaussian; j++)
+        double *lat = m_latent.data() + j * m_numOfData + first;
+        double bsum_j = 0.0;
+        for (int s = 0; s < n; s++)
           {
-          m_latent[i][j] = m_tmp1[j] / sum;
-          m_sum[j] += m_latent[i][j];
+          lat[s] = (asum[s] > 0) ? lat[s] / asum[s] : 1.0 / m_numOfGaussian;
+          bsum_j += lat[s];
           }
+        bsum[j] = bsum_j;
         }
-        */
-      }
+      });
+
+    // Reduce the per-block sums
+    for (int b = 0; b < m_numOfBlocks; b++)
+      for (int j = 0; j < m_numOfGaussian; j++)
+        m_sum[j] += block_sum[b * m_numOfGaussian + j];
     }
   else
     {
@@ -337,90 +385,117 @@ void EMGaussianMixtures::UpdateLatent(void)
 
 void EMGaussianMixtures::UpdateMean(void)
 {
-  for (int i = 0; i < m_numOfGaussian; i++)
+  int nDim = m_dimOfGaussian, nGauss = m_numOfGaussian;
+
+  // Per-block weighted sums of the samples
+  double *block_sum = ResetBlockSums(nGauss * nDim);
+  ParallelizeOverBlocks([this, nDim, nGauss, block_sum](int b, int first, int n)
     {
-    for (int j = 0; j < m_dimOfGaussian; j++)
+    const double * const *xb = GetBlockPointers(b);
+    double *bsum = block_sum + b * nGauss * nDim;
+    for (int i = 0; i < nGauss; i++)
       {
-      m_tmp2[j] = 0;
-      }
-    
-    for (int j = 0; j < m_numOfData; j++)
-      {
-      for (int k = 0; k < m_dimOfGaussian; k++)
+      const double *lat = m_latent.data() + i * m_numOfData + first;
+      for (int k = 0; k < nDim; k++)
         {
-        m_tmp2[k] += m_latent[j][i] * m_x[j][k];
+        const double *xk = xb[k];
+        double sum = 0.0;
+        for (int s = 0; s < n; s++)
+          sum += lat[s] * xk[s];
+        bsum[i * nDim + k] = sum;
         }
       }
+    });
+
+  VectorType mean(nDim);
+  for (int i = 0; i < nGauss; i++)
+    {
+    mean.fill(0.0);
+    for (int b = 0; b < m_numOfBlocks; b++)
+      for (int k = 0; k < nDim; k++)
+        mean[k] += block_sum[(b * nGauss + i) * nDim + k];
 
     // This can lead to a possible divide by zero situation. In case the sum
     // of latent variables for class i is zero, we set the mean of that class
     // to infinity
     if(m_sum[i] > 0)
-      {
-      for (int j = 0; j < m_dimOfGaussian; j++)
-        {
-        m_tmp2[j] = m_tmp2[j] / m_sum[i];
-        }
-      }
+      mean /= m_sum[i];
     else
-      {
-      for (int j = 0; j < m_dimOfGaussian; j++)
-        {
-        m_tmp2[j] = - std::numeric_limits<double>::infinity();
-        }
-      }
+      mean.fill(- std::numeric_limits<double>::infinity());
 
-
-    m_gmm->SetMean(i, VectorType(m_tmp2, m_dimOfGaussian));
+    m_gmm->SetMean(i, mean);
     }
 }
 
 void EMGaussianMixtures::UpdateCovariance(void)
 {
-  for (int i = 0; i < m_numOfGaussian; i++)
+  int nDim = m_dimOfGaussian, nGauss = m_numOfGaussian;
+
+  // Current means, needed for the centered products
+  std::vector<VectorType> means(nGauss);
+  for (int i = 0; i < nGauss; i++)
+    means[i] = m_gmm->GetMean(i);
+
+  // Per-block weighted sums of the outer products (upper triangle only)
+  double *block_sum = ResetBlockSums(nGauss * nDim * nDim);
+  ParallelizeOverBlocks([this, nDim, nGauss, &means, block_sum](int b, int first, int n)
     {
-    const VectorType &current_mean = m_gmm->GetMean(i);
-    
-    for (int j = 0; j < m_dimOfGaussian; j++)
+    const double * const *xb = GetBlockPointers(b);
+    double *dx = GetBlockScratch(b);
+    double *bsum = block_sum + b * nGauss * nDim * nDim;
+    for (int i = 0; i < nGauss; i++)
       {
-      for (int k = 0; k < m_dimOfGaussian; k++)
-        {
-        m_tmp3[j*m_dimOfGaussian+k] = 0;
-        }
-      }
-    
-    for (int j = 0; j < m_numOfData; j++)
-      {
-      for (int k = 0; k < m_dimOfGaussian; k++)
+      // Classes with no samples get a zero covariance matrix below
+      if(m_sum[i] <= 0)
+        continue;
+
+      // Mean-subtracted samples
+      for (int k = 0; k < nDim; k++)
         {
-        m_tmp2[k] = m_x[j][k] - current_mean[k];
+        const double *xk = xb[k];
+        double *dxk = dx + k * n, mk = means[i][k];
+        for (int s = 0; s < n; s++)
+          dxk[s] = xk[s] - mk;
         }
-      for (int k = 0; k < m_dimOfGaussian; k++)
+
+      const double *lat = m_latent.data() + i * m_numOfData + first;
+      for (int k = 0; k < nDim; k++)
         {
-        for (int l = 0; l < m_dimOfGaussian; l++)
+        const double *dxk = dx + k * n;
+        for (int l = k; l < nDim; l++)
           {
-          m_tmp3[k*m_dimOfGaussian+l] += m_tmp2[k] * m_tmp2[l] * m_latent[j][i];
+          const double *dxl = dx + l * n;
+          double sum = 0.0;
+          for (int s = 0; s < n; s++)
+            sum += lat[s] * dxk[s] * dxl[s];
+          bsum[(i * nDim + k) * nDim + l] = sum;
           }
         }
       }
+    });
 
+  MatrixType cov(nDim, nDim);
+  for (int i = 0; i < nGauss; i++)
+    {
+    cov.fill(0.0);
     if(m_sum[i] > 0)
       {
-      for (int j = 0; j < m_dimOfGaussian*m_dimOfGaussian; j++)
-        {
-        m_tmp3[j] = m_tmp3[j] / m_sum[i];
-        }
-      }
-    else
-      {
-      for (int j = 0; j < m_dimOfGaussian*m_dimOfGaussian; j++)
+      for (int b = 0; b < m_numOfBlocks; b++)
+        for (int k = 0; k < nDim; k++)
+          for (int l = k; l < nDim; l++)
+            cov(k, l) += block_sum[((b * nGauss + i) * nDim + k) * nDim + l];
+
+      for (int k = 0; k < nDim; k++)
         {
-        m_tmp3[j] = 0.0;
+        for (int l = k; l < nDim; l++)
+          {
+          cov(k, l) /= m_sum[i];
+          cov(l, k) = cov(k, l);
+          }
         }
       }
 
-
-    m_gmm->SetCovariance(i, MatrixType(m_tmp3, m_dimOfGaussian, m_dimOfGaussian));
+    m_gmm->SetCovariance(i, cov);
     }
 }
 
@@ -434,35 +509,63 @@ void EMGaussianMixtures::UpdateWeight(void)
 
 double EMGaussianMixtures::EvaluateLogLikelihood(void)
 {
-  double tmp1 = 0;
-  double tmp2 = 0;
-  if (m_setPriorFlag == 0)
-    {
-    for (int i = 0; i < m_numOfData; i++)
-      {
-      tmp1 = 0;
-      for (int j = 0; j < m_numOfGaussian; j++)
-        {
-        if(!m_gmm->GetGaussian(j)->isDeltaFunction())
-          tmp1 += m_weight[j] * exp(m_log_pdf[i][j]);
-        }
-      tmp2 += log(tmp1);
-      }
-    }
-  else
+  // Delta functions are excluded from the likelihood
+  std::vector<bool> isDelta(m_numOfGaussian);
+  for (int j = 0; j < m_numOfGaussian; j++)
+    isDelta[j] = m_gmm->GetGaussian(j)->isDeltaFunction();
+
+  // Per-block partial sums of log likelihood
+  double *block_ll = ResetBlockSums(1);
+  ParallelizeOverBlocks([this, &isDelta, block_ll](int b, int first, int n)
     {
-    for (int i = 0; i < m_numOfData; i++)
+    // Compute log(Sum_j[ w[j] * pdf[j] ]) using log-sum-exp
+    const double neg_inf = -std::numeric_limits<double>::infinity();
+    double *a = GetBlockScratch(b), *amax = a + n, *asum = amax + n;
+    std::fill(amax, amax + n, neg_inf);
+    std::fill(asum, asum + n, 0.0);
+    for (int pass = 0; pass < 2; pass++)
       {
-      tmp1 = 0;
       for (int j = 0; j < m_numOfGaussian; j++)
         {
-        if(!m_gmm->GetGaussian(j)->isDeltaFunction())
-          tmp1 += m_prior[i][j] * exp(m_log_pdf[i][j]);
+        if(isDelta[j])
+          continue;
+
+        const double *lp = m_log_pdf.data() + j * m_numOfData + first;
+        if (m_setPriorFlag == 0)
+          {
+          double lw = log(m_weight[j]);
+          for (int s = 0; s < n; s++)
+            a[s] = lw + lp[s];
+          }
+        else
+          {
+          for (int s = 0; s < n; s++)
+            a[s] = log(m_prior[first + s][j]) + lp[s];
+          }
+
+        if(pass == 0)
+          {
+          for (int s = 0; s < n; s++)
+            amax[s] = std::max(amax[s], a[s]);
+          }
+        else
+          {
+          for (int s = 0; s < n; s++)
+            asum[s] += (amax[s] > neg_inf) ? exp(a[s] - amax[s]) : 0.0;
+          }
         }
-      tmp2 += log(tmp1);
       }
-    }
-  return tmp1;
+
+    double ll = 0.0;
+    for (int s = 0; s < n; s++)
+      ll += (amax[s] > neg_inf) ? amax[s] + log(asum[s]) : neg_inf;
+    block_ll[b] = ll;
+    });
+
+  double ll = 0.0;
+  for (int b = 0; b < m_numOfBlocks; b++)
+    ll += block_ll[b];
+  return ll;
 }
 
 void EMGaussianMixtures::PrintParameters(void)
@@ -3,7 +3,17 @@
 
 #include "GaussianMixtureModel.h"
 #include "SNAPCommon.h"
+#include "itkMultiThreaderBase.h"
+#include <functional>
+#include <vector>
 
+/**
+ * Expectation-maximization for Gaussian mixtures. The samples passed in to
+ * the constructor are copied into a structure-of-arrays buffer (one contiguous
+ * array per component), and the E- and M-steps are computed in parallel over
+ * blocks of samples. Per-block partial sums are reduced in a fixed order, so
+ * the result does not depend on the number of threads.
+ */
 class EMGaussianMixtures
 {
 public:
@@ -15,6 +25,8 @@ public:
 
   void Reset(void);
   void SetMaxIteration(int maxIteration);
+
+  /** Set the tolerance on the change of the log likelihood per sample */
   void SetPrecision(double precision);
   void SetParameters(int index,
                      const VectorType &mean,
@@ -29,31 +41,68 @@ public:
   
   int GetMaxIteration(void);
 
-  double ** Update(void);
-  double ** UpdateOnce(void);
+  /** Number of iterations run by the last call to Update() */
+  int GetNumberOfIterations(void) const { return m_numOfIteration; }
+
+  /** Whether the log likelihood decreased between iterations */
+  bool IsFailed(void) const { return m_fail != 0; }
+
+  void Update(void);
+  void UpdateOnce(void);
   double EvaluateLogLikelihood(void);
   void PrintParameters(void);
 
   static double ComputePosterior(int nGauss, double *log_pdf, double *w, double *log_w, int j);
 
+  /** Posterior probability of the i-th sample belonging to the j-th Gaussian */
+  double GetLatent(int i, int j) const { return m_latent[j * m_numOfData + i]; }
+
 private:
   void EvaluatePDF(void);
   void UpdateLatent(void);
   void UpdateMean(void);
   void UpdateCovariance(void);
   void UpdateWeight(void);
-  
-  double **m_latent;
-  double **m_log_pdf;
+
+  // Check the change in the log likelihood between iterations, flag a
+  // decrease as a failure, and return whether EM has converged
+  bool CheckLogLikelihood(double previous, double current);
+
+  // Run a function over all blocks of samples in parallel. The arguments
+  // passed to the function are the block index, first sample and block size
+  typedef std::function<void(int, int, int)> BlockFunction;
+  void ParallelizeOverBlocks(const BlockFunction &f);
+
+  // Get pointers to the components of a block of samples
+  const double * const *GetBlockPointers(int block) const
+    { return m_blockPointers.data() + block * m_dimOfGaussian; }
+
+  // Get the scratch space of a block, which holds m_scratchPerBlock values
+  double *GetBlockScratch(int block)
+    { return m_blockScratch.data() + block * m_scratchPerBlock; }
+
+  // Clear and return the per-block partial sums, n values per block
+  double *ResetBlockSums(int n);
+
+  // Samples in structure-of-arrays layout (dimension-major)
+  std::vector<double> m_x;
+
+  // Log PDF and latent variables, Gaussian-major
+  std::vector<double> m_log_pdf;
+  std::vector<double> m_latent;
+
+  // Threader, block pointers and buffers, allocated once and reused by all
+  // the passes of all the iterations
+  SmartPtr<itk::MultiThreaderBase> m_threader;
+  std::vector<const double *> m_blockPointers;
+  std::vector<double> m_blockScratch;
+  std::vector<double> m_blockSum;
+  int m_scratchPerBlock;
+
   double **m_prior;
-  double **m_x;
-  double *m_probs;
-  double *m_probs2;
-  double *m_tmp1;
-  double *m_tmp2;
-  double *m_tmp3;
-  double *m_sum;
-  double *m_weight;
+  std::vector<double> m_sum;
+  std::vector<double> m_weight;
+  int m_numOfBlocks;
   double m_logLikelihood;
   int m_numOfGaussian;
   int m_dimOfGaussian;
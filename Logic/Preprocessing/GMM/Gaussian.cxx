@@ -95,6 +95,48 @@ double Gaussian::EvaluateLogPDF(VectorType &x, VectorType &xscratch)
   return 0.5 * logz;
 }
 
+void Gaussian::EvaluateLogPDF(const double * const *x, int n, double *out, double *zscratch) const
+{
+  // Clear the output
+  for(int s = 0; s < n; s++)
+    out[s] = 0.0;
+
+  // Same computation as above, but with the sample loop innermost, so that
+  // each pass over the block is over contiguous memory
+  for (int i = 0; i < m_dimension; i++)
+    {
+    // Project the mean-subtracted samples on the i-th eigenvector
+    for(int s = 0; s < n; s++)
+      zscratch[s] = 0.0;
+
+    for(int j = 0; j < m_dimension; j++)
+      {
+      const double *xj = x[j];
+      double vij = m_Vt(i,j), mj = m_mean_vector[j];
+      for(int s = 0; s < n; s++)
+        zscratch[s] += vij * (xj[s] - mj);
+      }
+
+    if(m_Lambda[i] == 0)
+      {
+      // Zero variance: p(z[i]) is 1 at z[i] == 0 and zero elsewhere
+      for(int s = 0; s < n; s++)
+        if(zscratch[s] != 0)
+          out[s] = -std::numeric_limits<double>::infinity();
+      }
+    else
+      {
+      double nfac = m_DiagNormFac[i], inv_lambda = 1.0 / m_Lambda[i];
+      for(int s = 0; s < n; s++)
+        out[s] -= nfac + zscratch[s] * zscratch[s] * inv_lambda;
+      }
+    }
+
+  // Final value needs to be divided by two
+  for(int s = 0; s < n; s++)
+    out[s] *= 0.5;
+}
+
 double Gaussian::EvaluatePDF(double *x)
 {
   // We got to exponentiate somewhere, so might as well do it here
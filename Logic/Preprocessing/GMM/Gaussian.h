@@ -26,6 +26,12 @@ public:
   // Evaluate log PDF with user-provided scratch buffer
   double EvaluateLogPDF(VectorType &x, VectorType &xscratch);
 
+  // Evaluate log PDF for a block of n samples stored in structure-of-arrays
+  // layout, i.e., x[d] points to n contiguous values of the d-th component.
+  // The scratch buffer must hold n values. This method does not modify the
+  // Gaussian and is safe to call from multiple threads.
+  void EvaluateLogPDF(const double * const *x, int n, double *out, double *zscratch) const;
+
   void PrintParameters();
 
   // Tests whether the Gaussian is a delta function (i.e., has zero total variance)
@@ -45,8 +45,9 @@ void UnsupervisedClustering::SetDataSource(SNAPImageData *imageData)
     m_DataSource = imageData;
     m_SamplesDirty = true;
 
+    // The EM is multithreaded, so we can afford a larger default sample
     int nvox = m_DataSource->GetMain()->GetNumberOfVoxels();
-    m_NumberOfSamples = (nvox > 10000) ? 10000 : nvox;
+    m_NumberOfSamples = (nvox > 100000) ? 100000 : nvox;
     }
 }
 
@@ -77,8 +77,7 @@ void RFClassificationEngine<TPixel,TLabel,VDim>:: TrainClassifier()
   itk::ImageRegion<3> reg = imgSeg->GetBufferedRegion();
   reg.ShrinkByRadius(m_PatchRadius);
 
-  // We need to iterate throught the label image once to determine the
-  // number of samples to allocate.
+  // Count the samples, so that the sample can be allocated up front
   unsigned long nSamples = 0;
   for(LabelIter lit(imgSeg, reg); !lit.IsAtEnd(); ++lit)
     if(lit.Value())
@@ -87,91 +86,27 @@ void RFClassificationEngine<TPixel,TLabel,VDim>:: TrainClassifier()
   // TODO: if the number of samples is greater than max number of training samples,
   // we should choose a random subset of samples.
 
-  // Compute the patch size
-  int patch_size = 1;
-  for(unsigned int i = 0; i < 3; i++)
-    patch_size *= m_PatchRadius[i] * 2 + 1;
-
-  // A structure holding information we need to sample from one layer
-  struct SampleData
-  {
-    ImageWrapperBase *layer;
-    ImageWrapperBase::PatchOffsetTable offset_table;
-    int n_comp, i_comp;
-    vnl_matrix<double> sample_matrix;
-  };
-
-  // Compute the offset tables and dimensions of the patches
-  int total_comp = 0;
-  std::vector<SampleData> sample_data;
-  for(auto it = m_DataSource->GetLayers(MAIN_ROLE | OVERLAY_ROLE); !it.IsAtEnd(); ++it)
-    {
-    // Compute the patch offset table
-    ImageWrapperBase::PatchOffsetTable offset_table = it.GetLayer()->GetPatchOffsetTable(m_PatchRadius);
-
-    // Number of components sampled per pixel from this image
-    int n_comp = it.GetLayer()->GetNumberOfComponents() * patch_size;
-
-    // Save the sample data structure
-    SampleData sd = { it.GetLayer(), offset_table, n_comp, total_comp };
-    sample_data.push_back(sd);
-
-    // Allocate the storage for the data
-    sample_data.back().sample_matrix.set_size(patch_size, it.GetLayer()->GetNumberOfComponents());
-
-    // Update total components
-    total_comp += n_comp;
-    }
-
-  // Allocate the patches
-  int nColumns = m_UseCoordinateFeatures ? total_comp + 3 : total_comp;
-
-  // Create a new sample
-  m_Sample = new SampleType(nSamples, nColumns);
-
-  // Allocate the sample storage and matrices that point to its storage
-  vnl_vector<double> current_sample(total_comp);
-
-  // Now fill out the samples
-  int iSample = 0;
+  // Create a new sample and fill in the labels and the locations of the samples
+  m_Sample = new SampleType(nSamples, this->GetNumberOfFeatures());
+  std::vector<itk::Index<3> > sample_index;
+  std::vector<float *> sample_rows;
+  sample_index.reserve(nSamples);
+  sample_rows.reserve(nSamples);
   for(LabelIter lit(imgSeg, reg); !lit.IsAtEnd(); ++lit)
     {
-    LabelType label = lit.Value();
-    if(label)
+    if(lit.Value())
       {
-      // Fill in the data
-      auto &column = m_Sample->data[iSample];
-
-      // Sample from each image
-      int k = 0;
-      for(auto &sd : sample_data)
-        {
-        // Sample this patch
-        double *p = sd.sample_matrix.data_block();
-        sd.layer->SamplePatchAsDouble(lit.GetIndex(), sd.offset_table, p);
-
-        // This in-place transpose operation is required because the RF classes expect the
-        // sample to be ordered first by component and then by patch location, but the
-        // SamplePatchAsDouble samples first by patch location, then by component
-        if(sd.sample_matrix.rows() > 1)
-          sd.sample_matrix.inplace_transpose();
-
-        // Copy data to actual sample
-        for(unsigned int i = 0; i < sd.n_comp; i++)
-          column[k++] = (float) p[i];
-        }
-
-      // Add the coordinate features if used
-      if(m_UseCoordinateFeatures)
-        for(int d = 0; d < 3; d++)
-          column[k++] = lit.GetIndex()[d];
-
-      // Fill in the label
-      m_Sample->label[iSample] = label;
-      ++iSample;
+      m_Sample->label[sample_index.size()] = lit.Value();
+      sample_rows.push_back(&m_Sample->data[sample_index.size()][0]);
+      sample_index.push_back(lit.GetIndex());
       }
     }
 
+  // Sample the features from all layers. The patches are ordered first by
+  // component and then by patch location, as the RF classes expect, so they
+  // are written to the sample directly
+  this->SampleFeatures(sample_index, sample_rows.data());
+
   // Check that the sample has at least two distinct labels
   bool isValidSample = false;
   for(int iSample = 1; iSample < m_Sample->Size(); iSample++)
@@ -274,6 +209,49 @@ void RFClassificationEngine<TPixel,TLabel,VDim>:: TrainClassifier()
   out_file.close();
 }
 
+template <class TPixel, class TLabel, int VDim>
+int RFClassificationEngine<TPixel,TLabel,VDim>::GetNumberOfFeatures() const
+{
+  // Compute the patch size
+  int patch_size = 1;
+  for(unsigned int i = 0; i < 3; i++)
+    patch_size *= m_PatchRadius[i] * 2 + 1;
+
+  // Each component of each layer contributes a patch, followed by the coordinates
+  int n_features = this->GetNumberOfComponents() * patch_size;
+  return m_UseCoordinateFeatures ? n_features + 3 : n_features;
+}
+
+template <class TPixel, class TLabel, int VDim>
+void RFClassificationEngine<TPixel,TLabel,VDim>::SampleFeatures(
+    const std::vector<itk::Index<3> > &voxels, float * const *out_rows) const
+{
+  if(voxels.empty())
+    return;
+
+  // Compute the patch size
+  int patch_size = 1;
+  for(unsigned int i = 0; i < 3; i++)
+    patch_size *= m_PatchRadius[i] * 2 + 1;
+
+  // Sample all the patches of each layer with one call
+  size_t k = 0;
+  for(auto it = m_DataSource->GetLayers(MAIN_ROLE | OVERLAY_ROLE); !it.IsAtEnd(); ++it)
+    {
+    ImageWrapperBase::PatchOffsetTable offset_table = it.GetLayer()->GetPatchOffsetTable(m_PatchRadius);
+    it.GetLayer()->SamplePatchesAsFloat(voxels, offset_table, out_rows, k);
+    k += it.GetLayer()->GetNumberOfComponents() * patch_size;
+    }
+
+  // Add the coordinate features if used
+  if(m_UseCoordinateFeatures)
+    {
+    for(size_t i = 0; i < voxels.size(); i++)
+      for(int d = 0; d < 3; d++)
+        out_rows[i][k + d] = voxels[i][d];
+    }
+}
+
 template <class TPixel, class TLabel, int VDim>
 void RFClassificationEngine<TPixel,TLabel,VDim>::SetClassifier(ClassifierType *rf)
 {
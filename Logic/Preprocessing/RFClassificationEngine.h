@@ -5,6 +5,8 @@
 #include <itkObjectFactory.h>
 #include "SNAPCommon.h"
 #include <itkSize.h>
+#include <itkIndex.h>
+#include <vector>
 
 template <class TPixel, class TLabel, int VDim> class RandomForestClassifier;
 template <class TData, class TLabel> class MLData;
@@ -62,12 +64,19 @@ public:
   /** Get the number of components passed to the classifier */
   int GetNumberOfComponents() const;
 
-
 protected:
 
   RFClassificationEngine();
   virtual ~RFClassificationEngine();
 
+  // Get the number of features sampled for each voxel
+  int GetNumberOfFeatures() const;
+
+  // Sample the features of a list of voxels from all layers, writing the
+  // features of the i-th voxel to out_rows[i]
+  void SampleFeatures(const std::vector<itk::Index<3> > &voxels,
+                      float * const *out_rows) const;
+
   // The trained classifier
   SmartPtr<ClassifierType> m_Classifier;
 
@@ -4,6 +4,13 @@
 #include "SNAPCommon.h"
 #include "itkDataObject.h"
 #include "itkObjectFactory.h"
+#include "itkImageRegion.h"
+#include "itkProcessObject.h"
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class ImageWrapperBase;
 class ScalarImageWrapperBase;
@@ -11,10 +18,6 @@ class ScalarImageWrapperBase;
 template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
 class AdaptiveSlicingPipeline;
 
-namespace itk {
-  template<class TIn, class TOut> class StreamingImageFilter;
-}
-
 class SNAPImageData;
 
 /**
@@ -38,9 +41,32 @@ public:
   /** Enter preview mode */
   virtual void SetPreviewMode(bool mode) = 0;
 
-  /** Compute the output volume (corresponds to the 'Apply' operation) */
+  /**
+    Compute the output volume (corresponds to the 'Apply' operation). The
+    slices through the streaming focus are computed before this returns, and
+    the rest of the volume is filled in the background.
+    */
   virtual void ComputeOutputVolume(itk::Command *progress) = 0;
 
+  /**
+    Set the voxel (usually the cursor) whose slices are computed first. The
+    background fill works outwards from this voxel, and follows it if it
+    changes while the fill is running.
+    */
+  virtual void SetStreamingFocus(const Vector3ui &focus) = 0;
+
+  /**
+    Make the part of the output volume filled in the background so far
+    visible. Returns true while the background fill is still running.
+    */
+  virtual bool UpdateOutputVolume() = 0;
+
+  /** Block until the background fill of the output volume is finished */
+  virtual void WaitForOutputVolume() = 0;
+
+  /** Stop the background fill, leaving the rest of the volume out of date */
+  virtual void CancelOutputVolume() = 0;
+
   /** Select the active scalar layer (for filters that operate on only one) */
   virtual void SetActiveScalarLayer(ScalarImageWrapperBase *layer) = 0;
 
@@ -100,6 +126,12 @@ protected:
 
   The user can also ask this wrapper to apply the filter to generate the
   entire speed image volume. This can be done in or out of preview mode.
+  The volume is computed in bricks. The three slices through the streaming
+  focus are computed right away, and the bricks are then filled by a
+  background thread, nearest to the focus first. Changing the inputs or the
+  parameters cancels the fill. While it runs, the output wrapper displays
+  the output buffer rather than the preview filters, and detaching the
+  wrapper only detaches the volume filter once the fill is over.
 
   The filter is smart enough to know when the whole volume is up to date. If
   the parameters of the preview filters have not been changed since the last
@@ -161,21 +193,94 @@ public:
   /** Compute the output volume (corresponds to the 'Apply' operation) */
   void ComputeOutputVolume(itk::Command *progress) ITK_OVERRIDE;
 
+  /** Set the voxel whose slices are computed first */
+  void SetStreamingFocus(const Vector3ui &focus) ITK_OVERRIDE;
+
+  /** Show the bricks filled so far, true while the fill is running */
+  bool UpdateOutputVolume() ITK_OVERRIDE;
+
+  /** Block until the output volume is filled */
+  void WaitForOutputVolume() ITK_OVERRIDE;
+
+  /** Stop filling the output volume */
+  void CancelOutputVolume() ITK_OVERRIDE;
+
+  /** Set the size of the bricks in which the volume is computed */
+  void SetBrickSize(unsigned int size);
+
 protected:
 
   SlicePreviewFilterWrapper();
-  ~SlicePreviewFilterWrapper() {}
+  ~SlicePreviewFilterWrapper();
 
   void UpdatePipeline();
 
   OutputWrapperType *m_OutputWrapper;
 
-  // Streamer - to allow reduced memory footprint
-  typedef itk::StreamingImageFilter<OutputImageType, OutputImageType> Streamer;
+  typedef typename OutputImageType::RegionType RegionType;
 
   SmartPtr<FilterType> m_PreviewFilter[3];
   SmartPtr<FilterType> m_VolumeFilter;
-  SmartPtr<Streamer> m_VolumeStreamer;
+
+  // Brick grid over the output volume and the up-to-date flag of each brick
+  unsigned int m_BrickSize;
+  itk::Size<3> m_BrickGridSize;
+  std::vector<bool> m_BrickValid;
+
+  // State used to decide whether the bricks are still up to date. The target
+  // m-time is that of the output wrapper's 4D image.
+  OutputImageType *m_BrickTarget;
+  itk::ModifiedTimeType m_BrickPipelineMTime, m_BrickTargetMTime;
+
+  // Reset the bricks if the pipeline or the output have been modified
+  void CheckBrickValidity();
+
+  // Get the region of the output corresponding to a brick
+  RegionType GetBrickRegion(const itk::Index<3> &brick) const;
+
+  // Get the position of a brick in m_BrickValid
+  size_t GetBrickOffset(const itk::Index<3> &brick) const;
+
+  // Find the out-of-date brick closest to the streaming focus
+  bool FindNearestInvalidBrick(itk::Index<3> &brick) const;
+
+  // Run the volume filter over a region and copy the result into the target
+  void ComputeRegion(const RegionType &region, OutputImageType *target);
+
+  // Voxel whose slices are computed first
+  Vector3ui m_StreamingFocus;
+
+  // Background fill of the remaining bricks. The mutex guards m_BrickValid
+  // and m_StreamingFocus while the fill thread is running.
+  std::thread m_FillThread;
+  std::mutex m_FillMutex;
+  std::atomic<bool> m_FillCancel, m_FillDone;
+  std::atomic<size_t> m_FilledBricks;
+  size_t m_ShownBricks;
+  std::exception_ptr m_FillError;
+
+  // The output and the upstream filters are held on to while the fill runs,
+  // so that detaching the inputs does not pull the pipeline from under it
+  SmartPtr<OutputWrapperType> m_FillOutputWrapper;
+  SmartPtr<OutputImageType> m_FillTarget;
+  std::vector<SmartPtr<itk::ProcessObject> > m_FillUpstream;
+
+  // Inputs from which to detach the volume filter once the fill is over
+  InputDataType *m_PendingDetach;
+
+  // Body of the fill thread
+  void FillBricks();
+
+  // Join the fill thread and release what it held on to
+  void EndFill();
+
+  // Show the bricks filled so far in the output wrapper
+  void ShowFilledBricks();
+
+  // Hold on to the filters upstream of a process object
+  void KeepUpstreamAlive(itk::ProcessObject *filter);
+
+  bool IsFilling() const { return m_FillThread.joinable(); }
 
   // So we can loop over all four filters
   FilterType *GetNthFilter(int);
@@ -5,10 +5,12 @@
 
 #include "SmoothBinaryThresholdImageFilter.h"
 #include "EdgePreprocessingImageFilter.h"
-#include "itkStreamingImageFilter.h"
+#include "AllPurposeProgressAccumulator.h"
+#include "itkImageAlgorithm.h"
 #include <AdaptiveSlicingPipeline.h>
 #include <ColorMap.h>
 #include <itkTimeProbe.h>
+#include <algorithm>
 
 
 template <class TFilterConfigTraits>
@@ -24,12 +26,21 @@ SlicePreviewFilterWrapper<TFilterConfigTraits>
   for(int i = 0; i < 3; i++)
     m_PreviewFilter[i] = FilterType::New();
 
-  // Allocate the streamer and attach to the volume filter
-  m_VolumeStreamer = Streamer::New();
-  m_VolumeStreamer->SetInput(m_VolumeFilter->GetOutput());
-
-  // Set up a streaming filter to reduce the memory footprint during execution
-  m_VolumeStreamer->SetNumberOfStreamDivisions(9);
+  // The volume is computed in bricks to reduce the memory footprint during
+  // execution. No bricks have been computed yet.
+  m_BrickSize = 128;
+  m_BrickGridSize.Fill(0);
+  m_BrickTarget = NULL;
+  m_BrickPipelineMTime = 0;
+  m_BrickTargetMTime = 0;
+
+  // No background fill is running
+  m_StreamingFocus.fill(0);
+  m_FillCancel = false;
+  m_FillDone = false;
+  m_FilledBricks = 0;
+  m_ShownBricks = 0;
+  m_PendingDetach = NULL;
 
   // No active layer by default
   m_ActiveScalarLayer = NULL;
@@ -38,11 +49,24 @@ SlicePreviewFilterWrapper<TFilterConfigTraits>
   m_OutputWrapper = NULL;
 }
 
+template <class TFilterConfigTraits>
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::~SlicePreviewFilterWrapper()
+{
+  // The inputs may be gone by now, so just stop the thread
+  m_FillCancel = true;
+  if(m_FillThread.joinable())
+    m_FillThread.join();
+}
+
 template <class TFilterConfigTraits>
 void
 SlicePreviewFilterWrapper<TFilterConfigTraits>
 ::SetParameters(ParameterType *param)
 {
+  // The bricks being filled are computed with the old parameters
+  this->CancelOutputVolume();
+
   // Set the parameters of all the filters
   for(int i = 0; i < 4; i++)
     Traits::SetParameters(param, this->GetNthFilter(i), i);
@@ -68,6 +92,9 @@ void
 SlicePreviewFilterWrapper<TFilterConfigTraits>
 ::AttachInputs(InputDataType *sid)
 {
+  // The bricks being filled are computed from the old inputs
+  this->CancelOutputVolume();
+
   // Get the default scalar layer for the traits. If this is NULL, the method
   // does not expect an active layer to be specified (acts on all inputs)
   m_ActiveScalarLayer = Traits::GetDefaultScalarLayer(sid);
@@ -98,7 +125,9 @@ SlicePreviewFilterWrapper<TFilterConfigTraits>
 ::AttachOutputWrapper(OutputWrapperType *wrapper)
 {
   // The slice preview filters need to be attached to the slicer
+  this->CancelOutputVolume();
   m_OutputWrapper = wrapper;
+  m_BrickValid.clear();
   this->UpdatePipeline();
 }
 
@@ -114,19 +143,29 @@ SlicePreviewFilterWrapper<TFilterConfigTraits>
       // Disconnect wrapper from this pipeline
       m_OutputWrapper->GetSlicer(i)->SetPreviewImage(NULL);
       }
-
-    // Undo the graft
-    m_VolumeStreamer->GraftOutput(m_VolumeStreamer->GetOutput());
     }
 
   m_OutputWrapper = NULL;
 
-  for(unsigned int i = 0; i < 4; i++)
+  for(unsigned int i = 1; i < 4; i++)
     {
     // Disconnect wrapper from this pipeline
     Traits::DetachInputs(sid, this->GetNthFilter(i));
     }
 
+  // The volume filter is still in use while the volume is being filled, and
+  // is detached when the fill is over
+  if(this->IsFilling())
+    {
+    m_PendingDetach = sid;
+    }
+  else
+    {
+    Traits::DetachInputs(sid, m_VolumeFilter);
+    m_BrickValid.clear();
+    m_BrickTarget = NULL;
+    }
+
   m_ActiveScalarLayer = NULL;
 }
 
@@ -137,7 +176,8 @@ SlicePreviewFilterWrapper<TFilterConfigTraits>
 {
   if(m_OutputWrapper)
     {
-    if(m_PreviewMode)
+    // While the volume is being filled, the output buffer is displayed
+    if(m_PreviewMode && !this->IsFilling())
       {
       // Attach the pipeline filters
       m_OutputWrapper->AttachPreviewPipeline(
@@ -152,37 +192,342 @@ SlicePreviewFilterWrapper<TFilterConfigTraits>
     }
 }
 
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::SetBrickSize(unsigned int size)
+{
+  if(size > 0 && size != m_BrickSize)
+    {
+    this->CancelOutputVolume();
+    m_BrickSize = size;
+    m_BrickValid.clear();
+    }
+}
+
+template <class TFilterConfigTraits>
+typename SlicePreviewFilterWrapper<TFilterConfigTraits>::RegionType
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::GetBrickRegion(const itk::Index<3> &brick) const
+{
+  RegionType lpr = m_BrickTarget->GetLargestPossibleRegion();
+  RegionType region;
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    itk::IndexValueType start = brick[d] * m_BrickSize;
+    itk::IndexValueType end = std::min(start + (itk::IndexValueType) m_BrickSize,
+                                       (itk::IndexValueType) lpr.GetSize(d));
+    region.SetIndex(d, lpr.GetIndex(d) + start);
+    region.SetSize(d, end - start);
+    }
+  return region;
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::CheckBrickValidity()
+{
+  // Bring the pipeline information up to date, so that its m-time reflects
+  // any changes to the inputs or to the filter parameters
+  m_VolumeFilter->UpdateOutputInformation();
+  itk::ModifiedTimeType pipeline_mtime = m_VolumeFilter->GetOutput()->GetPipelineMTime();
+
+  // Compute the brick grid for the current output
+  OutputImageType *target = m_OutputWrapper->GetModifiableImage();
+  itk::Size<3> grid;
+  for(unsigned int d = 0; d < 3; d++)
+    grid[d] = (target->GetLargestPossibleRegion().GetSize(d) + m_BrickSize - 1) / m_BrickSize;
+
+  // Any change to the pipeline, the grid, or the target image invalidates
+  // all of the bricks that have been computed so far
+  if(pipeline_mtime != m_BrickPipelineMTime || grid != m_BrickGridSize
+     || target != m_BrickTarget
+     || m_OutputWrapper->GetImage4DBase()->GetMTime() != m_BrickTargetMTime
+     || m_BrickValid.size() != grid[0] * grid[1] * grid[2])
+    {
+    m_BrickGridSize = grid;
+    m_BrickTarget = target;
+    m_BrickPipelineMTime = pipeline_mtime;
+    m_BrickTargetMTime = m_OutputWrapper->GetImage4DBase()->GetMTime();
+    m_BrickValid.assign(grid[0] * grid[1] * grid[2], false);
+    }
+}
+
+template <class TFilterConfigTraits>
+size_t
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::GetBrickOffset(const itk::Index<3> &brick) const
+{
+  return brick[0] + m_BrickGridSize[0] * (brick[1] + m_BrickGridSize[1] * brick[2]);
+}
+
+template <class TFilterConfigTraits>
+bool
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::FindNearestInvalidBrick(itk::Index<3> &brick) const
+{
+  // Distances are measured from the focus to the brick centers, in voxels
+  bool found = false;
+  double best_dist = 0.0;
+  itk::Index<3> b;
+  for(b[2] = 0; b[2] < (itk::IndexValueType) m_BrickGridSize[2]; b[2]++)
+    for(b[1] = 0; b[1] < (itk::IndexValueType) m_BrickGridSize[1]; b[1]++)
+      for(b[0] = 0; b[0] < (itk::IndexValueType) m_BrickGridSize[0]; b[0]++)
+        {
+        if(m_BrickValid[this->GetBrickOffset(b)])
+          continue;
+
+        double dist = 0.0;
+        for(unsigned int d = 0; d < 3; d++)
+          {
+          double delta = (b[d] + 0.5) * m_BrickSize - m_StreamingFocus[d];
+          dist += delta * delta;
+          }
+
+        if(!found || dist < best_dist)
+          {
+          found = true;
+          best_dist = dist;
+          brick = b;
+          }
+        }
+
+  return found;
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::ComputeRegion(const RegionType &region, OutputImageType *target)
+{
+  OutputImageType *output = m_VolumeFilter->GetOutput();
+  output->SetRequestedRegion(region);
+  m_VolumeFilter->Update();
+  itk::ImageAlgorithm::Copy(output, target, region, region);
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::SetStreamingFocus(const Vector3ui &focus)
+{
+  std::lock_guard<std::mutex> lock(m_FillMutex);
+  m_StreamingFocus = focus;
+}
+
 template <class TFilterConfigTraits>
 void
 SlicePreviewFilterWrapper<TFilterConfigTraits>
 ::ComputeOutputVolume(itk::Command *progress)
 {
-  // Attach the progress monitor
-  unsigned long tag = 0;
+  // Stop the fill that may still be running. The bricks it has completed
+  // are kept if nothing has changed since.
+  this->CancelOutputVolume();
 
-  if(progress)
-    tag = m_VolumeStreamer->AddObserver(itk::ProgressEvent(), progress);
+  // Reset the bricks if anything has changed since they were computed
+  this->CheckBrickValidity();
+
+  // Nothing to do if the volume is already up to date
+  if(std::find(m_BrickValid.begin(), m_BrickValid.end(), false) == m_BrickValid.end())
+    return;
 
-  // Temporarily graft the target volume as output of the filter
-  m_VolumeStreamer->GraftOutput(m_OutputWrapper->GetModifiableImage());
+  OutputImageType *target = m_OutputWrapper->GetModifiableImage();
+  RegionType lpr = target->GetLargestPossibleRegion();
 
-  // Execute the preprocessing on the whole image extent
-  // itk::TimeProbe probe;
-  // probe.Start();
-  m_VolumeStreamer->UpdateLargestPossibleRegion();
-  // probe.Stop();
-  // std::cout << "Time Elapsed: " << probe.GetTotal() << std::endl;
+  // The slices through the focus are the ones on display, so they are
+  // computed right away
+  RegionType slices[3];
+  double total_voxels = 0.0;
+  for(unsigned int i = 0; i < 3; i++)
+    {
+    slices[i] = lpr;
+    itk::IndexValueType pos = std::min((itk::IndexValueType) m_StreamingFocus[i],
+                                       (itk::IndexValueType) lpr.GetSize(i) - 1);
+    slices[i].SetIndex(i, lpr.GetIndex(i) + pos);
+    slices[i].SetSize(i, 1);
+    total_voxels += slices[i].GetNumberOfPixels();
+    }
 
-  // Remove the progress monitor
+  // Attach the progress monitor
+  SmartPtr<TrivalProgressSource> tracker = TrivalProgressSource::New();
   if(progress)
-    m_VolumeStreamer->RemoveObserver(tag);
+    tracker->AddObserverToProgressEvents(progress);
+
+  tracker->StartProgress(total_voxels);
+  for(unsigned int i = 0; i < 3; i++)
+    {
+    this->ComputeRegion(slices[i], target);
+    tracker->AddProgress(slices[i].GetNumberOfPixels());
+    }
+  tracker->EndProgress();
+
+  // The output buffer, not the preview filters, is displayed from now on
+  m_OutputWrapper->DetachPreviewPipeline();
+  target->DisconnectPipeline();
+
+  // Fill the rest of the volume in the background
+  m_FillOutputWrapper = m_OutputWrapper;
+  m_FillTarget = target;
+  m_FillUpstream.clear();
+  this->KeepUpstreamAlive(m_VolumeFilter);
+  m_FillCancel = false;
+  m_FillDone = false;
+  m_FilledBricks = 0;
+  m_ShownBricks = 0;
+  m_FillThread = std::thread(&Self::FillBricks, this);
+
+  // Show the slices
+  this->ShowFilledBricks();
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::KeepUpstreamAlive(itk::ProcessObject *filter)
+{
+  itk::ProcessObject::DataObjectPointerArray inputs = filter->GetInputs();
+  for(unsigned int i = 0; i < inputs.size(); i++)
+    {
+    if(!inputs[i])
+      continue;
+
+    SmartPtr<itk::ProcessObject> source = inputs[i]->GetSource();
+    if(source && std::find(m_FillUpstream.begin(), m_FillUpstream.end(), source) == m_FillUpstream.end())
+      {
+      m_FillUpstream.push_back(source);
+      this->KeepUpstreamAlive(source);
+      }
+    }
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::FillBricks()
+{
+  try
+    {
+    while(!m_FillCancel)
+      {
+      // Take the brick closest to the focus, which may have moved
+      itk::Index<3> brick;
+        {
+        std::lock_guard<std::mutex> lock(m_FillMutex);
+        if(!this->FindNearestInvalidBrick(brick))
+          break;
+        }
+
+      this->ComputeRegion(this->GetBrickRegion(brick), m_FillTarget);
+
+        {
+        std::lock_guard<std::mutex> lock(m_FillMutex);
+        m_BrickValid[this->GetBrickOffset(brick)] = true;
+        }
+      ++m_FilledBricks;
+      }
+
+    // Release the memory held by the last brick
+    m_VolumeFilter->GetOutput()->ReleaseData();
+    }
+  catch(...)
+    {
+    m_FillError = std::current_exception();
+    }
+
+  m_FillDone = true;
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::ShowFilledBricks()
+{
+  // Update the m-time of the output image, and remember it so that our own
+  // modification does not invalidate the bricks. The m-time of the 4D image
+  // changes whenever anyone else (e.g., another preprocessing mode) writes
+  // to the output wrapper.
+  m_ShownBricks = m_FilledBricks;
+  m_FillOutputWrapper->PixelsModified();
+  if(m_FillOutputWrapper == m_OutputWrapper)
+    m_BrickTargetMTime = m_OutputWrapper->GetImage4DBase()->GetMTime();
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::EndFill()
+{
+  m_FillThread.join();
+  this->ShowFilledBricks();
+
+  m_FillOutputWrapper = NULL;
+  m_FillTarget = NULL;
+  m_FillUpstream.clear();
+
+  // Finish detaching the wrapper, or bring back the preview
+  if(m_PendingDetach)
+    {
+    Traits::DetachInputs(m_PendingDetach, m_VolumeFilter);
+    m_PendingDetach = NULL;
+    m_BrickValid.clear();
+    m_BrickTarget = NULL;
+    }
+  else
+    {
+    this->UpdatePipeline();
+    }
+}
+
+template <class TFilterConfigTraits>
+bool
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::UpdateOutputVolume()
+{
+  if(!this->IsFilling())
+    return false;
+
+  if(!m_FillDone)
+    {
+    if(m_FilledBricks != m_ShownBricks)
+      this->ShowFilledBricks();
+    return true;
+    }
+
+  this->WaitForOutputVolume();
+  return false;
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::WaitForOutputVolume()
+{
+  if(!this->IsFilling())
+    return;
+
+  this->EndFill();
 
-  // Undo the graft
-  m_VolumeStreamer->GraftOutput(m_VolumeStreamer->GetOutput());
+  // Pass on the error that stopped the fill, if any
+  if(m_FillError)
+    {
+    std::exception_ptr error = m_FillError;
+    m_FillError = nullptr;
+    std::rethrow_exception(error);
+    }
+}
+
+template <class TFilterConfigTraits>
+void
+SlicePreviewFilterWrapper<TFilterConfigTraits>
+::CancelOutputVolume()
+{
+  if(!this->IsFilling())
+    return;
 
-  // Update the m-time of the output image
-  m_OutputWrapper->GetModifiableImage()->DisconnectPipeline();
-  m_OutputWrapper->PixelsModified();
+  m_FillCancel = true;
+  this->EndFill();
+  m_FillError = nullptr;
 }
 
 template <class TFilterConfigTraits>
@@ -199,6 +544,7 @@ void
 SlicePreviewFilterWrapper<TFilterConfigTraits>
 ::SetActiveScalarLayer(ScalarImageWrapperBase *layer)
 {
+  this->CancelOutputVolume();
   m_ActiveScalarLayer = layer;
   for(int i = 0; i < 4; i++)
     Traits::SetActiveScalarLayer(m_ActiveScalarLayer, this->GetNthFilter(i), i);
@@ -49,6 +49,7 @@
 #include "IRISSlicer.h"
 #include "NonOrthogonalSlicer.h"
 #include "SNAPCommon.h"
+#include "TraceRecorder.h"
 
 class ImageCoordinateTransform;
 
@@ -171,6 +171,8 @@ void
 AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
 ::GenerateData()
 {
+  SNAP_TRACE_SCOPE("slicing", m_UseOrthogonalSlicing ? "OrthogonalSlice" : "ObliqueSlice");
+
   // Get the outer filter's output
   OutputImageType *output = this->GetOutput();
 
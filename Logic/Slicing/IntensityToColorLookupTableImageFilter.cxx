@@ -7,6 +7,7 @@
 #include "itkVectorImage.h"
 #include "VectorToScalarImageAccessor.h"
 #include "itkMultiThreaderBase.h"
+#include "TraceRecorder.h"
 
 /* ===============================================================
     AbstractLookupTableImageFilter implementation
@@ -83,6 +84,8 @@ void
 IntensityToColorLookupTableImageFilter<TInputImage, TColorMapTraits>
 ::GenerateData()
 {
+  SNAP_TRACE_SCOPE("display", "ComputeColorLookupTable");
+
   // Allocate the image output
   this->AllocateOutputs();
 
@@ -2,6 +2,7 @@
 #include "RLEImageRegionIterator.h"
 #include <itkRGBAPixel.h>
 #include "ColorLookupTable.h"
+#include "TraceRecorder.h"
 
 template<class TInputImage, class TOutputImage>
 LookupTableIntensityMappingFilter<TInputImage, TOutputImage>
@@ -17,6 +18,8 @@ void
 LookupTableIntensityMappingFilter<TInputImage, TOutputImage>
 ::DynamicThreadedGenerateData(const OutputRegionType &region)
 {
+  SNAP_TRACE_SCOPE("display", "LookupTableIntensityMapping");
+
   // Get the input and output images
   const InputImageType *input = this->GetInput();
   OutputImageType *output = this->GetOutput(0);
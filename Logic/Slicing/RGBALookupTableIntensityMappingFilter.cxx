@@ -1,6 +1,7 @@
 #include "RGBALookupTableIntensityMappingFilter.h"
 #include "RLEImageRegionIterator.h"
 #include "ColorLookupTable.h"
+#include "TraceRecorder.h"
 
 template<class TInputImage>
 RGBALookupTableIntensityMappingFilter<TInputImage>
@@ -16,6 +17,8 @@ void
 RGBALookupTableIntensityMappingFilter<TInputImage>
 ::DynamicThreadedGenerateData(const OutputImageRegionType &region)
 {
+  SNAP_TRACE_SCOPE("display", "RGBALookupTableIntensityMapping");
+
   // Get all the inputs
   std::vector<const InputImageType *> inputs(3);
   for(int d = 0; d < 3; d++)
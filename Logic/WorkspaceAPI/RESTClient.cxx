@@ -2,6 +2,9 @@
 #include <sstream>
 #include <fstream>
 #include <cstdarg>
+#include <chrono>
+#include <cmath>
+#include <thread>
 #include "IRISException.h"
 #include "itksys/SystemTools.hxx"
 #include "itksys/MD5.h"
@@ -57,6 +60,9 @@ RESTClient::RESTClient()
   m_MessageBuffer[0] = 0;
   m_OutputFile = NULL;
   m_ReceiveCookieMode = false;
+  m_Verbose = false;
+  m_RetryDelay = 1.0;
+  m_MaxRetryDelay = 30.0;
 
   m_CallbackInfo.first = NULL;
   m_CallbackInfo.second = NULL;
@@ -64,6 +70,12 @@ RESTClient::RESTClient()
 
 RESTClient::~RESTClient()
 {
+  for(unsigned int i = 0; i < m_TransferQueue.size(); i++)
+    {
+    this->EndTransfer(m_TransferQueue[i]);
+    delete m_TransferQueue[i];
+    }
+
   curl_easy_cleanup(m_Curl);
   curl_share_cleanup((CURLSH *)m_Share);
   delete m_ErrorBuffer;
@@ -71,9 +83,17 @@ RESTClient::~RESTClient()
 
 void RESTClient::SetVerbose(bool verbose)
 {
+  // Also applies to the handles created for queued transfers
+  m_Verbose = verbose;
   curl_easy_setopt(m_Curl, CURLOPT_VERBOSE, (long) verbose);
 }
 
+void RESTClient::SetRetryDelay(double delay, double max_delay)
+{
+  m_RetryDelay = delay;
+  m_MaxRetryDelay = max_delay;
+}
+
 void RESTClient::SetOutputFile(FILE *outfile)
 {
   m_OutputFile = outfile;
@@ -391,6 +411,400 @@ const char *RESTClient::GetUploadStatistics()
   return m_UploadMessageBuffer;
 }
 
+struct RESTClient::Transfer
+{
+  RESTClient *client;
+
+  // What to transfer
+  bool upload;
+  std::string url, filename;
+  std::vector<std::pair<std::string, std::string> > fields;
+
+  // The handles for the current attempt
+  CURL *curl;
+  FILE *file;
+  struct curl_httppost *formpost;
+  struct curl_slist *headerlist;
+
+  // For downloads, the number of bytes already written to the file, and
+  // the number written when the current attempt started
+  curl_off_t offset, start_offset;
+
+  // Progress of the current attempt
+  double fraction;
+
+  // Outcome
+  std::string output;
+  long http_code;
+  CURLcode result;
+  unsigned int attempts;
+  bool done;
+  double upload_size;
+
+  Transfer(RESTClient *c, bool up)
+    : client(c), upload(up), curl(NULL), file(NULL), formpost(NULL), headerlist(NULL),
+      offset(0), start_offset(0), fraction(0.0), http_code(0L), result(CURLE_OK),
+      attempts(0), done(false), upload_size(0.0) {}
+};
+
+void RESTClient::QueueDownload(const char *filename, const char *rel_url, ...)
+{
+  std::va_list args;
+  va_start(args, rel_url);
+  char url_buffer[4096];
+  vsnprintf(url_buffer, 4096, rel_url, args);
+  va_end(args);
+
+  Transfer *t = new Transfer(this, false);
+  t->url = this->GetServerURL() + "/" + url_buffer;
+  t->filename = filename;
+  m_TransferQueue.push_back(t);
+}
+
+void RESTClient::QueueUpload(const char *filename, const char *rel_url,
+                             std::map<std::string, std::string> extra_fields, ...)
+{
+  // Expand the URL and the fields with the same arguments, as in UploadFile.
+  // A va_list can only be traversed once, so each expansion uses a copy
+  std::va_list args, args_copy;
+  va_start(args, extra_fields);
+  char url_buffer[4096];
+  va_copy(args_copy, args);
+  vsnprintf(url_buffer, 4096, rel_url, args_copy);
+  va_end(args_copy);
+
+  Transfer *t = new Transfer(this, true);
+  t->url = this->GetServerURL() + "/" + url_buffer;
+  t->filename = SystemTools::CollapseFullPath(filename);
+
+  for(std::map<string,string>::const_iterator it = extra_fields.begin();
+      it != extra_fields.end(); ++it)
+    {
+    char post_buffer[4096];
+    va_copy(args_copy, args);
+    vsnprintf(post_buffer, 4096, it->second.c_str(), args_copy);
+    va_end(args_copy);
+    t->fields.push_back(make_pair(it->first, string(post_buffer)));
+    }
+
+  va_end(args);
+  m_TransferQueue.push_back(t);
+}
+
+void RESTClient::StartTransfer(Transfer *t)
+{
+  t->curl = curl_easy_init();
+  t->file = NULL;
+  t->formpost = NULL;
+  t->headerlist = NULL;
+  t->fraction = 0.0;
+  t->output.clear();
+  t->http_code = 0L;
+  t->start_offset = t->offset;
+  t->attempts++;
+
+  CURL *curl = t->curl;
+  curl_easy_setopt(curl, CURLOPT_URL, t->url.c_str());
+  curl_easy_setopt(curl, CURLOPT_SHARE, m_Share);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, t);
+  curl_easy_setopt(curl, CURLOPT_VERBOSE, (long) m_Verbose);
+
+  // The cookie JAR
+  string cookie_jar = this->GetCookieFile();
+  curl_easy_setopt(curl, CURLOPT_COOKIEFILE, cookie_jar.c_str());
+
+  // Output goes to the file or, for uploads and errors, to the output string
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, RESTClient::TransferWriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, t);
+
+  // Progress is tracked for each transfer and combined
+  curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, RESTClient::TransferProgressCallback);
+  curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, t);
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+  if(t->upload)
+    {
+    string fn_name = SystemTools::GetFilenameName(t->filename);
+    struct curl_httppost *lastptr = NULL;
+
+    curl_formadd(&t->formpost, &lastptr,
+                 CURLFORM_COPYNAME, "myfile",
+                 CURLFORM_FILE, t->filename.c_str(),
+                 CURLFORM_END);
+
+    curl_formadd(&t->formpost, &lastptr,
+                 CURLFORM_COPYNAME, "filename",
+                 CURLFORM_COPYCONTENTS, fn_name.c_str(),
+                 CURLFORM_END);
+
+    curl_formadd(&t->formpost, &lastptr,
+                 CURLFORM_COPYNAME, "submit",
+                 CURLFORM_COPYCONTENTS, "send",
+                 CURLFORM_END);
+
+    for(unsigned int i = 0; i < t->fields.size(); i++)
+      curl_formadd(&t->formpost, &lastptr,
+                   CURLFORM_COPYNAME, t->fields[i].first.c_str(),
+                   CURLFORM_COPYCONTENTS, t->fields[i].second.c_str(),
+                   CURLFORM_END);
+
+    t->headerlist = curl_slist_append(t->headerlist, "Expect:");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, t->headerlist);
+    curl_easy_setopt(curl, CURLOPT_HTTPPOST, t->formpost);
+    }
+  else
+    {
+    // Continue an interrupted download where it left off
+    t->file = fopen(t->filename.c_str(), t->offset > 0 ? "ab" : "wb");
+    if(!t->file)
+      throw IRISException("Unable to open file %s for writing", t->filename.c_str());
+    if(t->offset > 0)
+      curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, t->offset);
+    }
+}
+
+void RESTClient::EndTransfer(Transfer *t)
+{
+  if(t->curl)
+    curl_easy_cleanup(t->curl);
+  if(t->file)
+    fclose(t->file);
+  if(t->formpost)
+    curl_formfree(t->formpost);
+  if(t->headerlist)
+    curl_slist_free_all(t->headerlist);
+
+  t->curl = NULL;
+  t->file = NULL;
+  t->formpost = NULL;
+  t->headerlist = NULL;
+}
+
+size_t RESTClient::TransferWriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+  Transfer *t = static_cast<Transfer *>(userp);
+  size_t n = size * nmemb;
+
+  long code = 0L;
+  curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &code);
+
+  // Error messages and upload responses are kept in memory
+  if(t->upload || (code != 200L && code != 206L))
+    {
+    t->output.append((char *) contents, n);
+    return n;
+    }
+
+  // If the server ignored the range request, start the file over
+  if(code == 200L && t->offset > 0)
+    {
+    t->file = freopen(t->filename.c_str(), "wb", t->file);
+    t->offset = 0;
+    t->start_offset = 0;
+    if(!t->file)
+      return 0;
+    }
+
+  size_t written = fwrite(contents, 1, n, t->file);
+  t->offset += written;
+  return written;
+}
+
+int RESTClient::TransferProgressCallback(void *clientp, double dltotal, double dlnow,
+                                         double ultotal, double ulnow)
+{
+  Transfer *t = static_cast<Transfer *>(clientp);
+
+  // Sometimes this is called with zeros
+  double total = dltotal + ultotal;
+  if(total == 0)
+    return 0;
+
+  // A resumed download only reports the bytes that remain
+  double base = t->upload ? 0.0 : t->start_offset;
+  t->fraction = (base + dlnow + ulnow) / (base + total);
+  t->client->UpdateTransferProgress();
+  return 0;
+}
+
+void RESTClient::UpdateTransferProgress()
+{
+  if(!m_CallbackInfo.second || m_TransferQueue.empty())
+    return;
+
+  double sum = 0.0;
+  for(unsigned int i = 0; i < m_TransferQueue.size(); i++)
+    sum += m_TransferQueue[i]->done ? 1.0 : m_TransferQueue[i]->fraction;
+
+  m_CallbackInfo.second(m_CallbackInfo.first, sum / m_TransferQueue.size());
+}
+
+bool RESTClient::PerformQueuedTransfers(unsigned int max_concurrent, unsigned int max_retries)
+{
+  // Releases the transfers and the multi handle when this method returns or
+  // throws. Transfers still in progress are removed from the multi handle
+  // before their easy handles are cleaned up
+  struct QueueCleanup
+  {
+    RESTClient *client;
+    CURLM *multi;
+
+    ~QueueCleanup()
+    {
+      for(unsigned int i = 0; i < client->m_TransferQueue.size(); i++)
+        {
+        Transfer *t = client->m_TransferQueue[i];
+        if(t->curl)
+          curl_multi_remove_handle(multi, t->curl);
+        client->EndTransfer(t);
+        delete t;
+        }
+      client->m_TransferQueue.clear();
+      curl_multi_cleanup(multi);
+    }
+  } cleanup = { this, curl_multi_init() };
+  CURLM *multi = cleanup.multi;
+
+  bool success = true;
+  m_FailedTransferFile.clear();
+
+  // Start the first batch of transfers
+  unsigned int next = 0, active = 0;
+  for(; next < m_TransferQueue.size() && active < max_concurrent; next++, active++)
+    {
+    this->StartTransfer(m_TransferQueue[next]);
+    curl_multi_add_handle(multi, m_TransferQueue[next]->curl);
+    }
+
+  // Transfers waiting to be retried, and when to retry them
+  typedef std::chrono::steady_clock Clock;
+  std::vector<std::pair<Clock::time_point, Transfer *> > waiting;
+
+  while(active > 0)
+    {
+    // Restart the transfers whose retry delay is over
+    Clock::time_point now = Clock::now();
+    for(unsigned int i = 0; i < waiting.size(); )
+      {
+      if(waiting[i].first <= now)
+        {
+        this->StartTransfer(waiting[i].second);
+        curl_multi_add_handle(multi, waiting[i].second->curl);
+        waiting.erase(waiting.begin() + i);
+        }
+      else i++;
+      }
+
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    // Handle the transfers that have finished
+    CURLMsg *msg;
+    int msgs_left;
+    while((msg = curl_multi_info_read(multi, &msgs_left)))
+      {
+      if(msg->msg != CURLMSG_DONE)
+        continue;
+
+      Transfer *t = NULL;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &t);
+      curl_multi_remove_handle(multi, t->curl);
+
+      t->result = msg->data.result;
+      curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &t->http_code);
+      curl_easy_getinfo(t->curl, CURLINFO_SIZE_UPLOAD, &t->upload_size);
+      this->EndTransfer(t);
+
+      // Connection problems are retried, resuming downloads where possible.
+      // An upload is a POST, which is not idempotent, so it is only retried
+      // if the connection could not be made and nothing was sent
+      bool retry = false;
+      switch(t->result)
+        {
+        case CURLE_COULDNT_CONNECT:
+          retry = t->attempts <= max_retries;
+          break;
+        case CURLE_PARTIAL_FILE:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_GOT_NOTHING:
+          retry = !t->upload && t->attempts <= max_retries;
+          break;
+        default:
+          break;
+        }
+
+      // Wait before retrying, twice as long after each failed attempt, so
+      // that a struggling server is not flooded with requests
+      if(retry)
+        {
+        double delay = std::min(m_MaxRetryDelay, m_RetryDelay * std::pow(2.0, t->attempts - 1.0));
+        waiting.push_back(std::make_pair(
+                            Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                              std::chrono::duration<double>(delay)), t));
+        continue;
+        }
+
+      t->done = true;
+      active--;
+
+      // Record the first failure, but let the other transfers finish. A
+      // resumed download succeeds with a partial content code
+      bool ok = t->result == CURLE_OK
+          && (t->http_code == 200L || (!t->upload && t->http_code == 206L));
+      if(success && !ok)
+        {
+        success = false;
+        m_FailedTransferFile = t->filename;
+        m_HTTPCode = t->http_code;
+        m_Output = (t->result != CURLE_OK) ? curl_easy_strerror(t->result) : t->output;
+        }
+
+      // Start the next transfer in the queue
+      if(next < m_TransferQueue.size())
+        {
+        this->StartTransfer(m_TransferQueue[next]);
+        curl_multi_add_handle(multi, m_TransferQueue[next]->curl);
+        next++;
+        active++;
+        }
+
+      this->UpdateTransferProgress();
+      }
+
+    // Wait for activity on any of the transfers, or until the next retry
+    // is due. If all of them are waiting to be retried, there is nothing for
+    // CURL to wait on, so we sleep instead
+    if(active > 0)
+      {
+      Clock::duration timeout = std::chrono::seconds(1);
+      for(unsigned int i = 0; i < waiting.size(); i++)
+        timeout = std::min(timeout, waiting[i].first - Clock::now());
+      int timeout_ms = std::max(0, (int) std::chrono::duration_cast<
+                                  std::chrono::milliseconds>(timeout).count());
+
+      if(waiting.size() < active)
+        curl_multi_wait(multi, NULL, 0, timeout_ms, NULL);
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+      }
+    }
+
+  // Summarize the uploads
+  double upload_size = 0.0;
+  for(unsigned int i = 0; i < m_TransferQueue.size(); i++)
+    upload_size += m_TransferQueue[i]->upload_size;
+  snprintf(m_UploadMessageBuffer, sizeof(m_UploadMessageBuffer), "%.1f Mb", upload_size / 1.0e6);
+
+  return success;
+}
+
+const char *RESTClient::GetFailedTransferFile()
+{
+  return m_FailedTransferFile.c_str();
+}
+
 string RESTClient::GetDataDirectory()
 {
   // Compute the platform-independent home directory
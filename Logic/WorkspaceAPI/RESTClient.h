@@ -4,6 +4,7 @@
 #include <string>
 #include <cstdarg>
 #include <map>
+#include <vector>
 
 /**
  * This class encapsulates the client side of the ALFABIS RESTful API.
@@ -17,8 +18,16 @@ public:
 
   ~RESTClient();
 
+  /** Print CURL diagnostics, for single requests and queued transfers */
   void SetVerbose(bool verbose);
 
+  /**
+   * Set how long PerformQueuedTransfers waits before retrying a transfer,
+   * in seconds. The delay doubles after each failed attempt, up to the
+   * maximum. The defaults are 1 and 30 seconds.
+   */
+  void SetRetryDelay(double delay, double max_delay);
+
   /**
    * Set a FILE * to which to write the output of the Get/Post. This overrides
    * the default behaviour to capture the output in a string that can be accessed
@@ -84,6 +93,37 @@ public:
 
   const char *GetUploadStatistics();
 
+  /**
+   * Queue a file to be downloaded by PerformQueuedTransfers. The relative URL
+   * can have printf-like expressions
+   */
+  void QueueDownload(const char *filename, const char *rel_url, ...);
+
+  /**
+   * Queue a file to be uploaded by PerformQueuedTransfers, as in UploadFile.
+   * The relative URL and the values of the extra fields can have printf-like
+   * expressions, which are evaluated with the same arguments
+   */
+  void QueueUpload(const char *filename, const char *rel_url,
+                   std::map<std::string,std::string> extra_fields, ...);
+
+  /**
+   * Perform all queued transfers, running up to max_concurrent of them at
+   * a time. Downloads that fail because of a connection problem are retried
+   * up to max_retries times, with a growing delay (see SetRetryDelay), and
+   * resume from the last byte received if the server supports range
+   * requests. Uploads are only retried if the connection could not be
+   * established, since a POST is not idempotent. Returns true if all
+   * transfers received HTTP code 200. Otherwise GetResponseText() describes
+   * the first failed transfer and GetFailedTransferFile() gives its file.
+   * The queue is cleared in either case.
+   */
+  bool PerformQueuedTransfers(unsigned int max_concurrent = 4,
+                              unsigned int max_retries = 5);
+
+  /** File involved in the failed transfer, after PerformQueuedTransfers */
+  const char *GetFailedTransferFile();
+
 protected:
 
   /** The CURL handle */
@@ -112,6 +152,12 @@ protected:
 
   bool m_ReceiveCookieMode;
 
+  /** Verbose flag, applied to the handles of queued transfers */
+  bool m_Verbose;
+
+  /** Delay before the first retry of a queued transfer, and its maximum */
+  double m_RetryDelay, m_MaxRetryDelay;
+
   /** Callback stuff */
   std::pair<void *, ProgressCallbackFunction> m_CallbackInfo;
 
@@ -127,6 +173,28 @@ protected:
 
   static size_t WriteToFileCallback(void *contents, size_t size, size_t nmemb, void *userp);
 
+  /** A queued upload or download */
+  struct Transfer;
+
+  /** Queued transfers */
+  std::vector<Transfer *> m_TransferQueue;
+
+  /** File involved in the first failed queued transfer */
+  std::string m_FailedTransferFile;
+
+  /** Set up the CURL handle for the next attempt of a transfer */
+  void StartTransfer(Transfer *t);
+
+  /** Release the resources of the current attempt of a transfer */
+  void EndTransfer(Transfer *t);
+
+  /** Report the combined progress of the queued transfers */
+  void UpdateTransferProgress();
+
+  static size_t TransferWriteCallback(void *contents, size_t size, size_t nmemb, void *userp);
+
+  static int TransferProgressCallback(void *clientp, double dltotal, double dlnow,
+                                      double ultotal, double ulnow);
 
 
 };
@@ -11,6 +11,14 @@
 #include "RESTClient.h"
 #include "itkCommand.h"
 #include "GuidedMeshIO.h"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
 
 using namespace std;
 using itksys::SystemTools;
@@ -1096,6 +1104,199 @@ string WorkspaceAPI::GetTempDirName()
 
 #include "AllPurposeProgressAccumulator.h"
 
+// Cache of exported layers, keyed by file path, modification time, size and
+// IO hints, so that unchanged layers do not need to be decoded again when the
+// same workspace is exported repeatedly
+struct ExportCacheKey
+{
+  string path;
+  long int mtime;
+  unsigned long size;
+  string io_hints;
+
+  bool operator < (const ExportCacheKey &other) const
+    {
+    return std::tie(path, mtime, size, io_hints)
+        < std::tie(other.path, other.mtime, other.size, other.io_hints);
+    }
+};
+
+// The content hash of a layer, and the file it was last exported to, which
+// can be copied as long as it has not been touched since
+struct ExportCacheEntry
+{
+  string hash;
+  string fn_exported;
+  long int mtime_exported;
+  unsigned long size_exported;
+
+  ExportCacheEntry() : mtime_exported(0), size_exported(0) {}
+};
+
+static std::map<ExportCacheKey, ExportCacheEntry> export_cache;
+static std::mutex export_cache_mutex;
+
+// A layer to be exported, and the result of exporting it
+struct ExportLayerJob
+{
+  string fn_layer, fn_layer_basename, fn_layer_new;
+  Registry io_hints;
+  std::exception_ptr error;
+};
+
+static ExportCacheKey GetExportCacheKey(ExportLayerJob &job)
+{
+  ExportCacheKey key;
+  key.path = job.fn_layer;
+  key.mtime = SystemTools::ModifiedTime(job.fn_layer);
+  key.size = SystemTools::FileLength(job.fn_layer);
+
+  std::ostringstream oss;
+  job.io_hints.Print(oss);
+  key.io_hints = oss.str();
+  return key;
+}
+
+// Check if the file exported earlier is still there and unchanged
+static bool IsExportCacheFileValid(const ExportCacheEntry &entry, const string &extension)
+{
+  return !entry.fn_exported.empty()
+      && SystemTools::StringEndsWith(entry.fn_exported, extension.c_str())
+      && SystemTools::FileExists(entry.fn_exported, true)
+      && SystemTools::ModifiedTime(entry.fn_exported) == entry.mtime_exported
+      && SystemTools::FileLength(entry.fn_exported) == entry.size_exported;
+}
+
+// Compute the MD5 hash of the bytes of a file
+static string GetFileMD5Hash(const string &fn)
+{
+  std::ifstream ifs(fn.c_str(), std::ios::binary);
+  if(!ifs.good())
+    throw IRISException("Unable to read file %s", fn.c_str());
+
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+
+  std::vector<char> buffer(1 << 20);
+  while(ifs)
+    {
+    ifs.read(buffer.data(), buffer.size());
+    if(ifs.gcount())
+      itksysMD5_Append(md5, (unsigned char *) buffer.data(), (int) ifs.gcount());
+    }
+
+  char hex_code[33];
+  hex_code[32] = 0;
+  itksysMD5_FinalizeHex(md5, hex_code);
+  itksysMD5_Delete(md5);
+  return string(hex_code);
+}
+
+// Check if the layer is stored in a NIFTI file that can be copied as is,
+// and return the extension of that file
+static bool IsExportPassthroughLayer(ExportLayerJob &job, string &extension)
+{
+  string fn_lower = SystemTools::LowerCase(job.fn_layer);
+  if(SystemTools::StringEndsWith(fn_lower, ".nii.gz"))
+    extension = ".nii.gz";
+  else if(SystemTools::StringEndsWith(fn_lower, ".nii"))
+    extension = ".nii";
+  else
+    return false;
+
+  // The hints must not ask for the file to be read as something else
+  GuidedNativeImageIO::FileFormat fmt =
+      GuidedNativeImageIO::GetFileFormat(job.io_hints, GuidedNativeImageIO::FORMAT_NIFTI);
+  if(fmt != GuidedNativeImageIO::FORMAT_NIFTI)
+    return false;
+
+  return GuidedNativeImageIO::GuessFormatForFileName(job.fn_layer, true)
+      == GuidedNativeImageIO::FORMAT_NIFTI;
+}
+
+static void ExportLayer(ExportLayerJob &job, int index, const string &wsdir, bool scramble_filenames)
+{
+  // NIFTI files are copied byte for byte rather than decoded and encoded
+  string extension = ".nii.gz";
+  bool passthrough = IsExportPassthroughLayer(job, extension);
+  if(!passthrough)
+    extension = ".nii.gz";
+
+  // See what we know about the layer from earlier exports
+  ExportCacheKey key = GetExportCacheKey(job);
+  ExportCacheEntry entry;
+    {
+    std::lock_guard<std::mutex> lock(export_cache_mutex);
+    std::map<ExportCacheKey, ExportCacheEntry>::const_iterator it = export_cache.find(key);
+    if(it != export_cache.end())
+      entry = it->second;
+    }
+
+  // A re-encoded layer can be copied from where it was exported last time
+  bool reuse = !passthrough && IsExportCacheFileValid(entry, extension);
+
+  // The native image IO object, only created if we need to read the image
+  SmartPtr<GuidedNativeImageIO> io;
+
+  // Use the hash of the image data as the filename when scrambling. For the
+  // files that are copied, the hash of the file is used, so that they need
+  // not be decoded at all.
+  string fn_layer_basename = job.fn_layer_basename;
+  if(scramble_filenames)
+    {
+    if(entry.hash.empty())
+      {
+      if(passthrough)
+        {
+        entry.hash = GetFileMD5Hash(job.fn_layer);
+        }
+      else
+        {
+        io = GuidedNativeImageIO::New();
+        io->ReadNativeImage(job.fn_layer.c_str(), job.io_hints);
+        entry.hash = io->GetNativeImageMD5Hash();
+        }
+      }
+    fn_layer_basename = entry.hash;
+    }
+
+  // Create a filename that combines the layer index with the hash code
+  char fn_layer_new[4096];
+  snprintf(fn_layer_new, 4096, "%s/layer_%03d_%s%s", wsdir.c_str(), index,
+           fn_layer_basename.c_str(), extension.c_str());
+  job.fn_layer_new = fn_layer_new;
+
+  if(passthrough || reuse)
+    {
+    const string &fn_source = reuse ? entry.fn_exported : job.fn_layer;
+    if(!SystemTools::CopyFileAlways(fn_source, job.fn_layer_new))
+      throw IRISException("Failed to copy %s to %s",
+                          fn_source.c_str(), job.fn_layer_new.c_str());
+    }
+  else
+    {
+    // Load the header of the image and the image data
+    if(!io)
+      {
+      io = GuidedNativeImageIO::New();
+      io->ReadNativeImage(job.fn_layer.c_str(), job.io_hints);
+      }
+
+    // Save the layer there. Since we are saving as a NIFTI, we don't need to
+    // provide any hints
+    Registry dummy_hints;
+    io->SaveNativeImage(job.fn_layer_new.c_str(), dummy_hints);
+
+    // Remember the exported file for next time
+    entry.fn_exported = job.fn_layer_new;
+    entry.mtime_exported = SystemTools::ModifiedTime(job.fn_layer_new);
+    entry.size_exported = SystemTools::FileLength(job.fn_layer_new);
+    }
+
+  std::lock_guard<std::mutex> lock(export_cache_mutex);
+  export_cache[key] = entry;
+}
+
 void WorkspaceAPI::ExportWorkspace(const char *new_workspace,
                                    CommandType *cmd_progress,
                                    bool scramble_filenames) const
@@ -1124,53 +1325,84 @@ void WorkspaceAPI::ExportWorkspace(const char *new_workspace,
   // Report progress
   progress->StartProgress(n_layers);
 
-  // Load all of the layers in the current project
+  // Collect the information about each layer. This is done here rather than
+  // in the worker threads, since the registry is not thread-safe
+  std::vector<ExportLayerJob> jobs(n_layers);
   for(int i = 0; i < n_layers; i++)
     {
     // Get the folder corresponding to the layer
     Registry &f_layer = wsexp.GetLayerFolder(i);
 
     // The the (possibly moved) absolute filename
-    string fn_layer = wsexp.GetLayerActualPath(f_layer);
+    jobs[i].fn_layer = wsexp.GetLayerActualPath(f_layer);
 
     // Get the current layer base filename
-    string fn_layer_basename = SystemTools::GetFilenameWithoutExtension(fn_layer);
+    jobs[i].fn_layer_basename = SystemTools::GetFilenameWithoutExtension(jobs[i].fn_layer);
 
     // The IO hints for the file
-    Registry io_hints, *layer_io_hints;
+    Registry *layer_io_hints;
     if((layer_io_hints = wsexp.GetLayerIOHints(f_layer)))
-      io_hints.Update(*layer_io_hints);
+      jobs[i].io_hints.Update(*layer_io_hints);
+    }
 
-    // Create a native image IO object for this image
-    SmartPtr<GuidedNativeImageIO> io = GuidedNativeImageIO::New();
+  // Export the layers concurrently. The worker threads take the next layer
+  // from a shared counter, and progress is reported from this thread
+  std::atomic<int> next_job(0);
+  int n_done = 0;
+  std::mutex done_mutex;
+  std::condition_variable done_cv;
+
+  // Each thread may hold a whole decoded layer in memory, so only a couple
+  // of layers are exported at a time
+  int n_threads = std::max(1, std::min(n_layers, 2));
+  std::vector<std::thread> workers;
+  for(int t = 0; t < n_threads; t++)
+    {
+    workers.push_back(std::thread([&]()
+      {
+      int i;
+      while((i = next_job++) < n_layers)
+        {
+        try
+          {
+          ExportLayer(jobs[i], i, wsdir, scramble_filenames);
+          }
+        catch(...)
+          {
+          jobs[i].error = std::current_exception();
+          }
+
+        std::lock_guard<std::mutex> lock(done_mutex);
+        n_done++;
+        done_cv.notify_one();
+        }
+      }));
+    }
 
-    // Load the header of the image and the image data
-    io->ReadNativeImage(fn_layer.c_str(), io_hints);
+  for(int n_reported = 0; n_reported < n_layers; )
+    {
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&]() { return n_done > n_reported; });
+    int n_new = n_done - n_reported;
+    n_reported = n_done;
+    lock.unlock();
 
     // Report progress
-    progress->AddProgress(0.5);
-
-    // Compute the hash of the image data to generate filename
-    if(scramble_filenames)
-      {
-      // Use the hash as the basename
-      fn_layer_basename = io->GetNativeImageMD5Hash();
-      }
-
-    // Create a filename that combines the layer index with the hash code
-    char fn_layer_new[4096];
-    snprintf(fn_layer_new, 4096, "%s/layer_%03d_%s.nii.gz", wsdir.c_str(), i, fn_layer_basename.c_str());
+    progress->AddProgress(n_new);
+    }
 
-    // Save the layer there. Since we are saving as a NIFTI, we don't need to
-    // provide any hints
-    Registry dummy_hints;
-    io->SaveNativeImage(fn_layer_new, dummy_hints);
+  for(unsigned int t = 0; t < workers.size(); t++)
+    workers[t].join();
 
-    // Report progress
-    progress->AddProgress(0.5);
+  for(int i = 0; i < n_layers; i++)
+    {
+    // Pass on the first error encountered
+    if(jobs[i].error)
+      std::rethrow_exception(jobs[i].error);
 
     // Update the layer folder with the new path
-    f_layer["AbsolutePath"] << fn_layer_new;
+    Registry &f_layer = wsexp.GetLayerFolder(i);
+    f_layer["AbsolutePath"] << jobs[i].fn_layer_new;
 
     // There are no hints necessary for NIFTI
     f_layer.Folder("IOHints").Clear();
@@ -1223,30 +1455,26 @@ void WorkspaceAPI::UploadWorkspace(const char *url, int ticket_id,
 
   cout << "Exported workspace to " << ws_fname_buffer << endl;
 
-  // Create a source for transfer progress
-  void *transfer_progress_src = accum_upload->RegisterGenericSource(fn_to_upload.size(), 1.0);
-
-  // For each of the files in the directory upload it
-  for(int i = 0; i < fn_to_upload.size(); i++)
-    {
-    const char *fn = fn_to_upload[i].c_str();
-
-    RESTClient rcu;
+  // Create a source for transfer progress. The files are uploaded together,
+  // so they report combined progress in a single run
+  void *transfer_progress_src = accum_upload->RegisterGenericSource(1, 1.0);
 
-    // Set progress callback
-    rcu.SetProgressCallback(transfer_progress_src,
-                            AllPurposeProgressAccumulator::GenericProgressCallback);
+  RESTClient rcu;
+  rcu.SetProgressCallback(transfer_progress_src,
+                          AllPurposeProgressAccumulator::GenericProgressCallback);
 
-    // TODO: this is disgraceful!
-    std::map<string, string> empty_map;
-    if(!rcu.UploadFile(url, fn, empty_map, ticket_id))
-      throw IRISException("Failed up upload file %s (%s)", fn, rcu.GetResponseText());
+  // Queue each of the files in the directory for upload
+  std::map<string, string> empty_map;
+  for(int i = 0; i < fn_to_upload.size(); i++)
+    rcu.QueueUpload(fn_to_upload[i].c_str(), url, empty_map, ticket_id);
 
-    // Reset progress counter for next run
-    accum_upload->StartNextRun(transfer_progress_src);
+  // Upload the files concurrently
+  if(!rcu.PerformQueuedTransfers())
+    throw IRISException("Failed up upload file %s (%s)",
+                        rcu.GetFailedTransferFile(), rcu.GetResponseText());
 
-    cout << "Upload " << fn << " (" << rcu.GetUploadStatistics() << ")" << endl;
-    }
+  cout << "Uploaded " << fn_to_upload.size() << " files ("
+       << rcu.GetUploadStatistics() << ")" << endl;
 
   // Finish with the progress
   accum_upload->UnregisterAllSources();
@@ -1325,8 +1553,9 @@ string WorkspaceAPI::DownloadTicketFiles(
   if(!SystemTools::MakeDirectory(outdir))
     throw IRISException("Unable to create output directory %s", outdir);
 
-  // Progress source
-  void *transfer_progress_src = accum->RegisterGenericSource(ft.Rows(), 1.0);
+  // Progress source. The files are downloaded together, so they report
+  // combined progress in a single run
+  void *transfer_progress_src = accum->RegisterGenericSource(1, 1.0);
   rc.SetProgressCallback(transfer_progress_src,
                          AllPurposeProgressAccumulator::GenericProgressCallback);
 
@@ -1348,23 +1577,18 @@ string WorkspaceAPI::DownloadTicketFiles(
     // Make it into a full path
     string file_path = SystemTools::CollapseFullPath(file_name.c_str(), outdir);
 
-    // Create a file handle
-    FILE *fout = fopen(file_path.c_str(), "wb");
-    rc.SetOutputFile(fout);
-
-    if(!rc.Get("%s/tickets/%d/files/%s/%d", url_base, ticket_id, area, file_index))
-      throw IRISException("Failed to download file %s for ticket %d (%s)",
-        file_name.c_str(), ticket_id, rc.GetResponseText());
-
-    rc.SetOutputFile(NULL);
-    fclose(fout);
-
-    // Start next run of uploading
-    accum->StartNextRun(transfer_progress_src);
+    // Queue the file for download
+    rc.QueueDownload(file_path.c_str(), "%s/tickets/%d/files/%s/%d",
+                     url_base, ticket_id, area, file_index);
 
     oss << file_path << endl;
     }
 
+  // Download the files concurrently
+  if(!rc.PerformQueuedTransfers())
+    throw IRISException("Failed to download file %s for ticket %d (%s)",
+      rc.GetFailedTransferFile(), ticket_id, rc.GetResponseText());
+
   accum->UnregisterAllSources();
 
   return oss.str();
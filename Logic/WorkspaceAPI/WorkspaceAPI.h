@@ -251,7 +251,13 @@ public:
   /** Cross-platform way of getting a temporary path */
   static std::string GetTempDirName();
 
-  /** Export the workspace */
+  /**
+   * Export the workspace. Two layers are exported at a time. Layers already
+   * stored as NIFTI are copied rather than re-encoded, and are given their
+   * file hash as the name when the filenames are scrambled. For unchanged
+   * files read with the same IO hints, the content hashes and the files
+   * exported earlier are reused.
+   */
   void ExportWorkspace(const char *new_workspace, CommandType *cmd_progress = NULL, bool scramble_filenames = true) const;
 
   /** Upload the workspace */
@@ -0,0 +1,478 @@
+/**
+ * Benchmarks for the main performance-critical code paths in the ITK-SNAP
+ * logic layer. Synthetic images of a configurable size are generated, loaded
+ * into IRISApplication, and each operation is timed over several repetitions.
+ * The timings are reported as JSON so that they can be compared between
+ * versions to catch performance regressions.
+ */
+#include "IRISApplication.h"
+#include "HeadlessSystemInfoDelegate.h"
+#include "GenericImageData.h"
+#include "LayerIterator.h"
+#include "ImageWrapperBase.h"
+#include "LabelImageWrapper.h"
+#include "SegmentationUpdateIterator.h"
+#include "SegmentationStatistics.h"
+#include "MultiLabelMeshPipeline.h"
+#include "ScalarImageHistogram.h"
+#include "TDigestImageFilter.h"
+#include "IRISException.h"
+#include "itkImage.h"
+#include "itkVectorImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageFileWriter.h"
+#include "itkAffineTransform.h"
+#include "itkCommand.h"
+#include "itksys/SystemTools.hxx"
+#include "json/json.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+
+using namespace std;
+using itksys::SystemTools;
+
+/**
+ * Times operations and collects the results as JSON
+ */
+class BenchmarkRunner
+{
+public:
+
+  BenchmarkRunner(int reps, const string &filter)
+    : m_Repetitions(reps), m_Filter(filter) {}
+
+  /**
+   * Run the benchmark. The setup function, if provided, is called before
+   * each repetition and is not timed. The number of operations performed
+   * by each repetition is used to report the time per operation.
+   */
+  void Run(const string &name, int ops_per_rep,
+           std::function<void()> op,
+           std::function<void()> setup = std::function<void()>())
+  {
+    if(m_Filter.size() && name.find(m_Filter) == string::npos)
+      return;
+
+    vector<double> times;
+    for(int i = 0; i < m_Repetitions; i++)
+      {
+      if(setup)
+        setup();
+
+      auto t0 = std::chrono::steady_clock::now();
+      op();
+      auto t1 = std::chrono::steady_clock::now();
+      times.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+      }
+
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for(double t : times)
+      sum += t;
+
+    Json::Value res;
+    res["name"] = name;
+    res["repetitions"] = m_Repetitions;
+    res["ops_per_repetition"] = ops_per_rep;
+    res["min_ms"] = times.front();
+    res["median_ms"] = times[times.size() / 2];
+    res["mean_ms"] = sum / times.size();
+    res["max_ms"] = times.back();
+    res["median_ms_per_op"] = times[times.size() / 2] / ops_per_rep;
+    m_Results.append(res);
+
+    cerr << name << " : " << times[times.size() / 2] << " ms" << endl;
+  }
+
+  const Json::Value &GetResults() const { return m_Results; }
+
+protected:
+  int m_Repetitions;
+  string m_Filter;
+  Json::Value m_Results = Json::Value(Json::arrayValue);
+};
+
+typedef itk::Image<short, 3> GreyImageType;
+typedef itk::Image<LabelType, 3> LabelImageType;
+typedef itk::VectorImage<unsigned char, 3> VectorImageType;
+
+/** Smooth intensity pattern with noise */
+void WriteSyntheticGrey(const string &fn, const itk::Size<3> &sz, std::mt19937 &rng)
+{
+  GreyImageType::Pointer img = GreyImageType::New();
+  img->SetRegions(sz);
+  img->Allocate();
+
+  std::normal_distribution<double> noise(0.0, 20.0);
+  for(itk::ImageRegionIteratorWithIndex<GreyImageType> it(img, img->GetBufferedRegion());
+      !it.IsAtEnd(); ++it)
+    {
+    itk::Index<3> idx = it.GetIndex();
+    double v = 500.0
+        + 300.0 * sin(idx[0] * 0.05) * cos(idx[1] * 0.07)
+        + 200.0 * sin(idx[2] * 0.11);
+    it.Set((short) (v + noise(rng)));
+    }
+
+  itk::ImageFileWriter<GreyImageType>::Pointer w = itk::ImageFileWriter<GreyImageType>::New();
+  w->SetInput(img);
+  w->SetFileName(fn.c_str());
+  w->Update();
+}
+
+/** Overlapping spheres of different labels */
+void WriteSyntheticLabels(const string &fn, const itk::Size<3> &sz, int n_labels, std::mt19937 &rng)
+{
+  LabelImageType::Pointer img = LabelImageType::New();
+  img->SetRegions(sz);
+  img->Allocate();
+  img->FillBuffer(0);
+
+  double rmax = std::min(sz[0], std::min(sz[1], sz[2])) / 4.0;
+  for(int l = 1; l <= n_labels; l++)
+    {
+    double c[3], r = std::uniform_real_distribution<double>(rmax / 4, rmax)(rng);
+    for(int d = 0; d < 3; d++)
+      c[d] = std::uniform_real_distribution<double>(0, sz[d])(rng);
+
+    for(itk::ImageRegionIteratorWithIndex<LabelImageType> it(img, img->GetBufferedRegion());
+        !it.IsAtEnd(); ++it)
+      {
+      itk::Index<3> idx = it.GetIndex();
+      double d2 = 0;
+      for(int d = 0; d < 3; d++)
+        d2 += (idx[d] - c[d]) * (idx[d] - c[d]);
+      if(d2 < r * r)
+        it.Set((LabelType) l);
+      }
+    }
+
+  itk::ImageFileWriter<LabelImageType>::Pointer w = itk::ImageFileWriter<LabelImageType>::New();
+  w->SetInput(img);
+  w->SetFileName(fn.c_str());
+  w->Update();
+}
+
+/** Three component image */
+void WriteSyntheticVector(const string &fn, const itk::Size<3> &sz)
+{
+  VectorImageType::Pointer img = VectorImageType::New();
+  img->SetRegions(sz);
+  img->SetNumberOfComponentsPerPixel(3);
+  img->Allocate();
+
+  itk::VariableLengthVector<unsigned char> px(3);
+  for(itk::ImageRegionIteratorWithIndex<VectorImageType> it(img, img->GetBufferedRegion());
+      !it.IsAtEnd(); ++it)
+    {
+    itk::Index<3> idx = it.GetIndex();
+    for(int d = 0; d < 3; d++)
+      px[d] = (unsigned char) ((idx[d] * 255) / sz[d]);
+    it.Set(px);
+    }
+
+  itk::ImageFileWriter<VectorImageType>::Pointer w = itk::ImageFileWriter<VectorImageType>::New();
+  w->SetInput(img);
+  w->SetFileName(fn.c_str());
+  w->Update();
+}
+
+/** Update the slices that feed into the display slice, but not the mapping */
+void UpdateSlices(ImageWrapperBase *layer, unsigned int dim)
+{
+  ImageWrapperBase::DisplaySlicePointer ds = layer->GetDisplaySlice(dim);
+  itk::ProcessObject *mapper = ds->GetSource();
+  for(itk::DataObject *input : mapper->GetInputs())
+    if(input)
+      input->Update();
+}
+
+/** Force the display mapping of the current slice to execute */
+void UpdateDisplayMapping(ImageWrapperBase *layer, unsigned int dim)
+{
+  ImageWrapperBase::DisplaySlicePointer ds = layer->GetDisplaySlice(dim);
+  ds->GetSource()->Modified();
+  ds->Update();
+}
+
+/** Paint a spherical brush stroke into the segmentation */
+void PaintSphere(LabelImageWrapper *seg, const itk::Index<3> &center, int radius, LabelType label)
+{
+  itk::ImageRegion<3> region;
+  for(int d = 0; d < 3; d++)
+    {
+    region.SetIndex(d, center[d] - radius);
+    region.SetSize(d, 2 * radius + 1);
+    }
+  region.Crop(seg->GetBufferedRegion());
+
+  SegmentationUpdateIterator it(seg, region, label, DrawOverFilter());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    itk::Index<3> idx = it.GetIndex();
+    long d2 = 0;
+    for(int d = 0; d < 3; d++)
+      d2 += (idx[d] - center[d]) * (idx[d] - center[d]);
+    if(d2 <= radius * radius)
+      it.PaintAsForeground();
+    }
+  it.Finalize("Benchmark brush");
+}
+
+void usage()
+{
+  cout << "snap_benchmarks: time performance-critical operations in the ITK-SNAP logic layer" << endl;
+  cout << "usage: " << endl;
+  cout << "  snap_benchmarks [options]" << endl;
+  cout << "options: " << endl;
+  cout << "  -s NX NY NZ       : Size of the synthetic images (default 256 256 160)" << endl;
+  cout << "  -r N              : Number of repetitions of each benchmark (default 5)" << endl;
+  cout << "  -l N              : Number of labels in the synthetic segmentation (default 8)" << endl;
+  cout << "  -o FILE           : Write JSON results to FILE (default: standard output)" << endl;
+  cout << "  -f STRING         : Only run benchmarks whose name contains STRING" << endl;
+  cout << "  -t DIR            : Directory for temporary files" << endl;
+  cout << "  -h                : Print this message" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+  // Parse the options
+  itk::Size<3> sz = {{256, 256, 160}};
+  int reps = 5, n_labels = 8;
+  string fn_out, filter;
+  string tmpdir = SystemTools::GetCurrentWorkingDirectory() + "/snap_benchmarks_tmp";
+
+  for(int i = 1; i < argc; i++)
+    {
+    string arg = argv[i];
+    if(arg == "-s" && i + 3 < argc)
+      {
+      for(int d = 0; d < 3; d++)
+        sz[d] = atoi(argv[++i]);
+      }
+    else if(arg == "-r" && i + 1 < argc)
+      reps = std::max(1, atoi(argv[++i]));
+    else if(arg == "-l" && i + 1 < argc)
+      n_labels = std::max(1, atoi(argv[++i]));
+    else if(arg == "-o" && i + 1 < argc)
+      fn_out = argv[++i];
+    else if(arg == "-f" && i + 1 < argc)
+      filter = argv[++i];
+    else if(arg == "-t" && i + 1 < argc)
+      tmpdir = argv[++i];
+    else
+      {
+      usage();
+      return arg == "-h" ? 0 : -1;
+      }
+    }
+
+  try
+    {
+    SystemTools::MakeDirectory(tmpdir);
+    HeadlessSystemInfoDelegate sidel(argv[0], tmpdir);
+    SystemInterface::SetSystemInfoDelegate(&sidel);
+
+    // Generate the synthetic data
+    std::mt19937 rng(1234);
+    string fn_grey = tmpdir + "/grey.nii";
+    string fn_seg = tmpdir + "/seg.nii";
+    string fn_vec = tmpdir + "/rgb.nii";
+    string fn_seg_out = tmpdir + "/seg_out.nii";
+    WriteSyntheticGrey(fn_grey, sz, rng);
+    WriteSyntheticLabels(fn_seg, sz, n_labels, rng);
+    WriteSyntheticVector(fn_vec, sz);
+
+    IRISApplication::Pointer app = IRISApplication::New();
+    IRISWarningList wl;
+    BenchmarkRunner bench(reps, filter);
+
+    // NIfTI loading (the last loaded image stays loaded)
+    bench.Run("nifti/load_main", 1, [&]() {
+      app->OpenImage(fn_grey.c_str(), MAIN_ROLE, wl);
+    });
+
+    app->OpenImage(fn_seg.c_str(), LABEL_ROLE, wl);
+    app->OpenImage(fn_grey.c_str(), OVERLAY_ROLE, wl);
+    app->OpenImage(fn_vec.c_str(), OVERLAY_ROLE, wl);
+
+    GenericImageData *id = app->GetCurrentImageData();
+    LabelImageWrapper *seg = app->GetSelectedSegmentationLayer();
+    ImageWrapperBase *main = id->GetMain();
+    std::list<ImageWrapperBase *> overlays = id->FindLayersByRole(OVERLAY_ROLE);
+    ImageWrapperBase *ovl_grey = overlays.front(), *ovl_vec = overlays.back();
+
+    std::vector<std::pair<string, ImageWrapperBase *> > layers;
+    layers.push_back(make_pair(string("grey"), main));
+    layers.push_back(make_pair(string("label"), (ImageWrapperBase *) seg));
+    layers.push_back(make_pair(string("rgb"), ovl_vec));
+
+    // Orthogonal slicing through evenly spaced slices along each axis
+    const int n_slices = 32;
+    Vector3ui center((unsigned int) sz[0] / 2, (unsigned int) sz[1] / 2, (unsigned int) sz[2] / 2);
+    for(auto &layer : layers)
+      {
+      for(unsigned int d = 0; d < 3; d++)
+        {
+        unsigned int axis = layer.second->GetDisplaySliceImageAxis(d);
+        bench.Run("slice/orthogonal/" + layer.first + "/" + to_string(d), n_slices, [&]() {
+          for(int k = 0; k < n_slices; k++)
+            {
+            Vector3ui cursor = center;
+            cursor[axis] = (unsigned int) ((k * sz[axis]) / n_slices);
+            app->SetCursorPosition(cursor);
+            UpdateSlices(layer.second, d);
+            }
+        });
+        }
+      }
+
+    // Oblique slicing of the overlays, which are rotated relative to the main image
+    typedef itk::AffineTransform<double, 3> AffineTransform;
+    AffineTransform::Pointer rotation = AffineTransform::New();
+    AffineTransform::InputPointType rot_center;
+    for(int d = 0; d < 3; d++)
+      rot_center[d] = main->GetImageBase()->GetOrigin()[d] + 0.5 * sz[d] * main->GetImageBase()->GetSpacing()[d];
+    AffineTransform::OutputVectorType rot_axis;
+    rot_axis[0] = 1.0; rot_axis[1] = 1.0; rot_axis[2] = 0.0;
+    rotation->SetCenter(rot_center);
+    rotation->Rotate3D(rot_axis, 0.3);
+
+    std::vector<std::pair<string, ImageWrapperBase *> > oblique_layers;
+    oblique_layers.push_back(make_pair(string("grey"), ovl_grey));
+    oblique_layers.push_back(make_pair(string("rgb"), ovl_vec));
+    for(auto &layer : oblique_layers)
+      {
+      layer.second->SetITKTransform(layer.second->GetReferenceSpace(), rotation);
+      for(unsigned int d = 0; d < 3; d++)
+        {
+        unsigned int axis = main->GetDisplaySliceImageAxis(d);
+        bench.Run("slice/oblique/" + layer.first + "/" + to_string(d), n_slices, [&]() {
+          for(int k = 0; k < n_slices; k++)
+            {
+            Vector3ui cursor = center;
+            cursor[axis] = (unsigned int) ((k * sz[axis]) / n_slices);
+            app->SetCursorPosition(cursor);
+            UpdateSlices(layer.second, d);
+            }
+        });
+        }
+      layer.second->SetITKTransform(layer.second->GetReferenceSpace(), AffineTransform::New());
+      }
+
+    // Mapping of the current slice through the lookup tables
+    const int n_maps = 32;
+    app->SetCursorPosition(center);
+    for(auto &layer : layers)
+      {
+      for(unsigned int d = 0; d < 3; d++)
+        {
+        UpdateSlices(layer.second, d);
+        bench.Run("display_mapping/" + layer.first + "/" + to_string(d), n_maps, [&]() {
+          for(int k = 0; k < n_maps; k++)
+            UpdateDisplayMapping(layer.second, d);
+        });
+        }
+      }
+
+    // Histogram and t-digest of the main image
+    bench.Run("tdigest/grey", 1, [&]() {
+      main->GetTDigest()->Update();
+    }, [&]() {
+      main->GetTDigest()->Modified();
+      main->GetImageBase()->Modified();
+    });
+
+    SmartPtr<ScalarImageHistogram> hist = ScalarImageHistogram::New();
+    const int n_hist = 100;
+    bench.Run("histogram/grey", n_hist, [&]() {
+      for(int k = 0; k < n_hist; k++)
+        hist->ComputeFromTDigest(main->GetTDigest(), 256);
+    });
+
+    // Segmentation statistics
+    bench.Run("statistics/compute", 1, [&]() {
+      SegmentationStatistics stats;
+      stats.Compute(app);
+    });
+
+    // Meshes for all labels, computed from scratch
+    SmartPtr<itk::CStyleCommand> no_progress = itk::CStyleCommand::New();
+    bench.Run("mesh/update_meshes", 1, [&]() {
+      SmartPtr<MultiLabelMeshPipeline> mesher = MultiLabelMeshPipeline::New();
+      mesher->SetImage(seg->GetImage());
+      mesher->UpdateMeshes(no_progress);
+    });
+
+    // Paintbrush strokes, each creating an undo point
+    const int n_strokes = 50, radius = 8;
+    std::uniform_int_distribution<int> udist[3] = {
+      std::uniform_int_distribution<int>(0, sz[0] - 1),
+      std::uniform_int_distribution<int>(0, sz[1] - 1),
+      std::uniform_int_distribution<int>(0, sz[2] - 1) };
+    bench.Run("paintbrush/sphere", n_strokes, [&]() {
+      for(int k = 0; k < n_strokes; k++)
+        {
+        itk::Index<3> c = {{ udist[0](rng), udist[1](rng), udist[2](rng) }};
+        PaintSphere(seg, c, radius, (LabelType) (1 + k % n_labels));
+        }
+    });
+
+    // Undo and redo the strokes painted above
+    const int n_undo = std::min(n_strokes, 20);
+    bench.Run("undo", n_undo, [&]() {
+      for(int k = 0; k < n_undo && app->IsUndoPossible(); k++)
+        app->Undo();
+    });
+    bench.Run("redo", n_undo, [&]() {
+      for(int k = 0; k < n_undo && app->IsRedoPossible(); k++)
+        app->Redo();
+    }, [&]() {
+      for(int k = 0; k < n_undo && app->IsUndoPossible(); k++)
+        app->Undo();
+    });
+
+    // NIfTI saving of the segmentation
+    bench.Run("nifti/save_segmentation", 1, [&]() {
+      Registry hints;
+      seg->WriteToFile(fn_seg_out.c_str(), hints);
+    });
+
+    // Write the results
+    Json::Value root;
+    root["benchmark"] = "snap_benchmarks";
+    root["size"] = Json::Value(Json::arrayValue);
+    for(int d = 0; d < 3; d++)
+      root["size"].append((int) sz[d]);
+    root["labels"] = n_labels;
+    root["results"] = bench.GetResults();
+
+    Json::StyledStreamWriter writer;
+    if(fn_out.size())
+      {
+      std::ofstream ofs(fn_out.c_str());
+      writer.write(ofs, root);
+      }
+    else
+      {
+      writer.write(cout, root);
+      }
+
+    app = NULL;
+    SystemTools::RemoveADirectory(tmpdir);
+    }
+  catch(std::exception &exc)
+    {
+    cerr << "Exception caught: " << exc.what() << endl;
+    return -1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+#include "AxisAlignedResampleImageFilter.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkIdentityTransform.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkResampleImageFilter.h"
+#include <cmath>
+#include <iostream>
+
+typedef itk::Image<float, 3> ImageType;
+typedef AxisAlignedResampleImageFilter<ImageType, ImageType> FilterType;
+typedef itk::ResampleImageFilter<ImageType, ImageType> ResampleFilterType;
+typedef itk::IdentityTransform<double, 3> TransformType;
+
+const int SIZE = 8, OUT_SIZE = 23;
+
+// The output grid starts within the half voxel before the first input voxel
+// and samples the image at a finer spacing, so the region of interest
+// touches the border of the image
+const double OUT_ORIGIN = -0.3, OUT_SPACING = 0.35;
+
+ImageType::Pointer makeImage()
+{
+    ImageType::Pointer img = ImageType::New();
+    ImageType::RegionType region;
+    for (int d = 0; d < 3; d++)
+        region.SetSize(d, SIZE);
+    img->SetRegions(region);
+    img->Allocate();
+
+    itk::ImageRegionIteratorWithIndex<ImageType> it(img, region);
+    for (; !it.IsAtEnd(); ++it)
+    {
+        ImageType::IndexType idx = it.GetIndex();
+        it.Set(10.0f + idx[0] * idx[0] + 3 * idx[1] - 2 * idx[2] + ((idx[0] + idx[2]) % 3));
+    }
+    return img;
+}
+
+// Resample with the axis-aligned filter, from the image or its coefficients
+ImageType::Pointer resampleAxisAligned(const ImageType *sampled, FilterType::KernelType kernel)
+{
+    FilterType::PointType origin;
+    FilterType::SpacingType spacing;
+    FilterType::SizeType size;
+    FilterType::DirectionType direction;
+    origin.Fill(OUT_ORIGIN);
+    spacing.Fill(OUT_SPACING);
+    size.Fill(OUT_SIZE);
+    direction.SetIdentity();
+
+    FilterType::ContinuousIndexType start;
+    FilterType::StepType step;
+    TransformType::Pointer transform = TransformType::New();
+    if (!FilterType::ComputeSampling(sampled, transform, origin, spacing, direction, start, step))
+        return NULL;
+
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput(sampled);
+    filter->SetKernel(kernel);
+    filter->SetSamplingStart(start);
+    filter->SetSamplingStep(step);
+    filter->SetOutputSize(size);
+    filter->SetOutputSpacing(spacing);
+    filter->SetOutputOrigin(origin);
+    filter->SetOutputDirection(direction);
+    filter->Update();
+    return filter->GetOutput();
+}
+
+// Resample the same grid with itk::ResampleImageFilter
+ImageType::Pointer resampleReference(ImageType *image, ResampleFilterType::InterpolatorType *interp)
+{
+    ResampleFilterType::Pointer filter = ResampleFilterType::New();
+    ImageType::PointType origin;
+    ImageType::SpacingType spacing;
+    ResampleFilterType::SizeType size;
+    origin.Fill(OUT_ORIGIN);
+    spacing.Fill(OUT_SPACING);
+    size.Fill(OUT_SIZE);
+    filter->SetInput(image);
+    filter->SetInterpolator(interp);
+    filter->SetTransform(TransformType::New());
+    filter->SetOutputOrigin(origin);
+    filter->SetOutputSpacing(spacing);
+    filter->SetSize(size);
+    filter->SetDefaultPixelValue(0);
+    filter->Update();
+    return filter->GetOutput();
+}
+
+bool sameImages(const ImageType *a, const ImageType *b, double tol)
+{
+    if (!a || !b || a->GetBufferedRegion() != b->GetBufferedRegion())
+        return false;
+
+    size_t n = a->GetBufferedRegion().GetNumberOfPixels();
+    for (size_t i = 0; i < n; i++)
+        if (fabs(a->GetBufferPointer()[i] - b->GetBufferPointer()[i]) > tol)
+            return false;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int n_failed = 0;
+    ImageType::Pointer image = makeImage();
+
+    typedef itk::NearestNeighborInterpolateImageFunction<ImageType, double> NNInterpolatorType;
+    if (!sameImages(resampleAxisAligned(image, FilterType::NEAREST_NEIGHBOR),
+                    resampleReference(image, NNInterpolatorType::New()), 1e-6))
+    {
+        std::cout << "Nearest neighbor resampling differs" << std::endl;
+        n_failed++;
+    }
+
+    // Samples in the half voxel before the first voxel take its value
+    typedef itk::LinearInterpolateImageFunction<ImageType, double> LinearInterpolatorType;
+    if (!sameImages(resampleAxisAligned(image, FilterType::LINEAR),
+                    resampleReference(image, LinearInterpolatorType::New()), 1e-4))
+    {
+        std::cout << "Linear resampling differs" << std::endl;
+        n_failed++;
+    }
+
+    // Cubic interpolation samples the cached coefficients
+    typedef itk::BSplineInterpolateImageFunction<ImageType, double> CubicInterpolatorType;
+    BSplineCoefficientCache::Pointer cache = BSplineCoefficientCache::New();
+    ImageType *coeff = cache->GetCoefficients(image.GetPointer());
+    if (!sameImages(resampleAxisAligned(coeff, FilterType::CUBIC_BSPLINE),
+                    resampleReference(image, CubicInterpolatorType::New()), 1e-3))
+    {
+        std::cout << "Cubic B-spline resampling differs" << std::endl;
+        n_failed++;
+    }
+
+    // Coefficients are reused until the image is modified
+    if (cache->GetCoefficients(image.GetPointer()) != coeff)
+    {
+        std::cout << "Coefficients were not reused" << std::endl;
+        n_failed++;
+    }
+
+    std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+    if (n_failed)
+        std::cout << n_failed;
+    std::cout << std::endl;
+    return n_failed ? 1 : 0;
+}
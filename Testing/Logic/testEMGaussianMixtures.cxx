@@ -0,0 +1,189 @@
+#include "EMGaussianMixtures.h"
+#include "itkMultiThreaderBase.h"
+#include <vnl/vnl_inverse.h>
+#include <vnl/vnl_determinant.h>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+typedef EMGaussianMixtures::VectorType VectorType;
+typedef EMGaussianMixtures::MatrixType MatrixType;
+
+const int NDATA = 5000, NDIM = 2, NGAUSS = 2;
+
+// Samples from two Gaussians, using a fixed sequence of pseudo-random numbers
+std::vector<double> makeSamples()
+{
+  std::vector<double> x(NDATA * NDIM);
+  unsigned long long state = 12345;
+  auto uniform = [&state]()
+    {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return ((state >> 11) + 0.5) / 9007199254740992.0;
+    };
+
+  for (int i = 0; i < NDATA; i++)
+    {
+    double r = sqrt(-2.0 * log(uniform())), t = 2 * M_PI * uniform();
+    double z0 = r * cos(t), z1 = r * sin(t);
+    if (i % 3)
+      {
+      x[i * NDIM] = 10.0 + 2.0 * z0;
+      x[i * NDIM + 1] = -5.0 + 1.0 * z0 + 0.5 * z1;
+      }
+    else
+      {
+      x[i * NDIM] = -3.0 + 0.5 * z0;
+      x[i * NDIM + 1] = 4.0 + 1.5 * z1;
+      }
+    }
+  return x;
+}
+
+void initialize(EMGaussianMixtures &em)
+{
+  MatrixType cov(NDIM, NDIM);
+  cov.set_identity();
+  VectorType m0(NDIM), m1(NDIM);
+  m0[0] = 5.0; m0[1] = 0.0;
+  m1[0] = 0.0; m1[1] = 1.0;
+  em.SetParameters(0, m0, cov * 4.0, 0.5);
+  em.SetParameters(1, m1, cov, 0.5);
+}
+
+// One iteration of EM written out directly, as a reference
+void referenceIteration(const std::vector<double> &x, std::vector<VectorType> &mean,
+                        std::vector<MatrixType> &cov, std::vector<double> &weight)
+{
+  std::vector<double> latent(NDATA * NGAUSS);
+  for (int i = 0; i < NDATA; i++)
+    {
+    double sum = 0;
+    for (int j = 0; j < NGAUSS; j++)
+      {
+      VectorType d(NDIM);
+      for (int k = 0; k < NDIM; k++)
+        d[k] = x[i * NDIM + k] - mean[j][k];
+      double q = dot_product(d, vnl_inverse(cov[j]) * d);
+      double pdf = exp(-0.5 * q) / sqrt(pow(2 * M_PI, NDIM) * vnl_determinant(cov[j]));
+      latent[i * NGAUSS + j] = weight[j] * pdf;
+      sum += latent[i * NGAUSS + j];
+      }
+    for (int j = 0; j < NGAUSS; j++)
+      latent[i * NGAUSS + j] /= sum;
+    }
+
+  for (int j = 0; j < NGAUSS; j++)
+    {
+    double sum = 0;
+    VectorType m(NDIM, 0.0);
+    for (int i = 0; i < NDATA; i++)
+      {
+      sum += latent[i * NGAUSS + j];
+      for (int k = 0; k < NDIM; k++)
+        m[k] += latent[i * NGAUSS + j] * x[i * NDIM + k];
+      }
+    m /= sum;
+
+    MatrixType c(NDIM, NDIM, 0.0);
+    for (int i = 0; i < NDATA; i++)
+      for (int k = 0; k < NDIM; k++)
+        for (int l = 0; l < NDIM; l++)
+          c(k, l) += latent[i * NGAUSS + j] * (x[i * NDIM + k] - m[k]) * (x[i * NDIM + l] - m[l]);
+
+    mean[j] = m;
+    cov[j] = c / sum;
+    weight[j] = sum / NDATA;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+  int n_failed = 0;
+  std::vector<double> x = makeSamples();
+  std::vector<double *> xp(NDATA);
+  for (int i = 0; i < NDATA; i++)
+    xp[i] = &x[i * NDIM];
+
+  // A single iteration matches the reference computation
+  EMGaussianMixtures em(xp.data(), NDATA, NDIM, NGAUSS);
+  initialize(em);
+
+  std::vector<VectorType> mean(NGAUSS);
+  std::vector<MatrixType> cov(NGAUSS);
+  std::vector<double> weight(NGAUSS);
+  GaussianMixtureModel *gmm = em.GetGaussianMixtureModel();
+  for (int j = 0; j < NGAUSS; j++)
+    {
+    mean[j] = gmm->GetMean(j);
+    cov[j] = gmm->GetCovariance(j);
+    weight[j] = gmm->GetWeight(j);
+    }
+
+  em.UpdateOnce();
+  referenceIteration(x, mean, cov, weight);
+  for (int j = 0; j < NGAUSS; j++)
+    {
+    if ((gmm->GetMean(j) - mean[j]).inf_norm() > 1e-8
+        || (gmm->GetCovariance(j) - cov[j]).absolute_value_max() > 1e-8
+        || fabs(gmm->GetWeight(j) - weight[j]) > 1e-10)
+      {
+      std::cout << "EM iteration differs from reference for class " << j << std::endl;
+      n_failed++;
+      }
+    }
+
+  // The posteriors of each sample sum to one
+  for (int i = 0; i < NDATA; i++)
+    {
+    if (fabs(em.GetLatent(i, 0) + em.GetLatent(i, 1) - 1.0) > 1e-12)
+      {
+      std::cout << "Posteriors do not sum to one at sample " << i << std::endl;
+      n_failed++;
+      break;
+      }
+    }
+
+  // Running to convergence gives the same result regardless of the number
+  // of threads, and finds the true means. The log likelihood grows with each
+  // iteration and converges well before the maximum number of iterations.
+  std::vector<VectorType> result[2];
+  int threads[2] = { 1, 4 };
+  for (int t = 0; t < 2; t++)
+    {
+    itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(threads[t]);
+    EMGaussianMixtures emt(xp.data(), NDATA, NDIM, NGAUSS);
+    initialize(emt);
+    emt.SetMaxIteration(100);
+    emt.Update();
+    if (emt.IsFailed() || emt.GetNumberOfIterations() >= 100)
+      {
+      std::cout << "EM failed or did not converge with " << threads[t] << " threads" << std::endl;
+      n_failed++;
+      }
+    for (int j = 0; j < NGAUSS; j++)
+      result[t].push_back(emt.GetGaussianMixtureModel()->GetMean(j));
+    }
+
+  for (int j = 0; j < NGAUSS; j++)
+    {
+    if (result[0][j] != result[1][j])
+      {
+      std::cout << "Result depends on the number of threads" << std::endl;
+      n_failed++;
+      }
+    }
+
+  if (fabs(result[0][0][0] - 10.0) > 0.2 || fabs(result[0][0][1] + 5.0) > 0.2
+      || fabs(result[0][1][0] + 3.0) > 0.2 || fabs(result[0][1][1] - 4.0) > 0.2)
+    {
+    std::cout << "EM did not recover the means of the mixture" << std::endl;
+    n_failed++;
+    }
+
+  std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+  if (n_failed)
+    std::cout << n_failed;
+  std::cout << std::endl;
+  return n_failed ? 1 : 0;
+}
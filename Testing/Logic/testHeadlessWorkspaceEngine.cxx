@@ -0,0 +1,154 @@
+#include "HeadlessWorkspaceEngine.h"
+#include "IRISApplication.h"
+#include "IRISException.h"
+#include "WorkspaceAPI.h"
+#include "GenericImageData.h"
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itksys/SystemTools.hxx"
+#include <iostream>
+
+using namespace std;
+using itksys::SystemTools;
+
+typedef itk::Image<short, 3> GreyImageType;
+typedef itk::Image<unsigned short, 3> LabelImageType;
+
+const int SIZE = 16;
+
+template <class TImage>
+void writeImage(const string &fn, bool label)
+{
+    typename TImage::Pointer img = TImage::New();
+    typename TImage::RegionType region;
+    for (int d = 0; d < 3; d++)
+        region.SetSize(d, SIZE);
+    img->SetRegions(region);
+    img->Allocate();
+
+    // Label 1 in a 4x4x4 cube, label 2 in a slab; the grey image is a ramp
+    itk::ImageRegionIteratorWithIndex<TImage> it(img, region);
+    for (; !it.IsAtEnd(); ++it)
+    {
+        typename TImage::IndexType idx = it.GetIndex();
+        if (!label)
+            it.Set(idx[0] + idx[1] + idx[2]);
+        else if (idx[0] >= 2 && idx[0] < 6 && idx[1] >= 2 && idx[1] < 6 && idx[2] >= 2 && idx[2] < 6)
+            it.Set(1);
+        else if (idx[2] == 10)
+            it.Set(2);
+        else
+            it.Set(0);
+    }
+
+    typedef itk::ImageFileWriter<TImage> WriterType;
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetInput(img);
+    writer->SetFileName(fn);
+    writer->Update();
+}
+
+size_t countLabel(const string &fn, unsigned short label)
+{
+    typedef itk::ImageFileReader<LabelImageType> ReaderType;
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(fn);
+    reader->Update();
+
+    size_t n = 0;
+    itk::ImageRegionIteratorWithIndex<LabelImageType> it(
+        reader->GetOutput(), reader->GetOutput()->GetBufferedRegion());
+    for (; !it.IsAtEnd(); ++it)
+        if (it.Get() == label)
+            n++;
+    return n;
+}
+
+int main(int argc, char* argv[])
+{
+    int n_failed = 0;
+
+    string tmpdir = WorkspaceAPI::GetTempDirName();
+    SystemTools::MakeDirectory(tmpdir);
+    string fn_main = tmpdir + "/main.nii.gz", fn_seg = tmpdir + "/seg.nii.gz";
+    writeImage<GreyImageType>(fn_main, false);
+    writeImage<LabelImageType>(fn_seg, true);
+
+    try
+    {
+        WorkspaceAPI ws;
+        ws.SetLayer("MainRole", fn_main);
+        ws.SetLayer("SegmentationRole", fn_seg);
+        ws.SaveAsXMLFile((tmpdir + "/test.itksnap").c_str());
+
+        // The workspace is loaded into the logic layer
+        HeadlessWorkspaceEngine engine(argv[0]);
+        engine.LoadWorkspace(ws);
+        if (!engine.IsLoaded() || !engine.GetDriver()->IsMainImageLoaded()
+            || engine.GetDriver()->GetCurrentImageData()->GetMain()->GetSize()[0] != SIZE)
+        {
+            cout << "Workspace was not loaded" << endl;
+            n_failed++;
+        }
+
+        // Edits are applied to the segmentation and saved
+        size_t n_replaced = engine.ReplaceLabel(2, 3);
+        string fn_seg_out = tmpdir + "/seg_out.nii.gz";
+        engine.SaveSegmentation(fn_seg_out);
+        if (n_replaced != SIZE * SIZE || countLabel(fn_seg_out, 3) != SIZE * SIZE
+            || countLabel(fn_seg_out, 2) != 0 || countLabel(fn_seg_out, 1) != 64)
+        {
+            cout << "Label replacement was not saved" << endl;
+            n_failed++;
+        }
+
+        // Statistics are exported
+        string fn_stats = tmpdir + "/stats.txt";
+        engine.ExportStatistics(fn_stats);
+        if (SystemTools::FileLength(fn_stats) == 0)
+        {
+            cout << "Statistics were not exported" << endl;
+            n_failed++;
+        }
+
+        // The exported workspace has scrambled layer names and can be loaded
+        string fn_export = tmpdir + "/export/exported.itksnap";
+        SystemTools::MakeDirectory(tmpdir + "/export");
+        ws.ExportWorkspace(fn_export.c_str(), NULL, true);
+
+        WorkspaceAPI wsexp;
+        wsexp.ReadFromXMLFile(fn_export.c_str());
+        string fn_seg_exp = wsexp.GetLayerActualPath(wsexp.GetLayerFolder(1));
+        if (wsexp.GetNumberOfLayers() != 2
+            || SystemTools::GetFilenameName(fn_seg_exp).find("layer_001_") != 0
+            || SystemTools::GetFilenameName(fn_seg_exp).find("seg") != string::npos
+            || countLabel(fn_seg_exp, 2) != SIZE * SIZE)
+        {
+            cout << "Workspace was not exported correctly" << endl;
+            n_failed++;
+        }
+
+        engine.LoadWorkspace(wsexp);
+        if (!engine.IsLoaded() || !engine.GetDriver()->IsMainImageLoaded())
+        {
+            cout << "Exported workspace could not be loaded" << endl;
+            n_failed++;
+        }
+        engine.Unload();
+    }
+    catch (exception &exc)
+    {
+        cout << "Exception: " << exc.what() << endl;
+        n_failed++;
+    }
+
+    SystemTools::RemoveADirectory(tmpdir);
+
+    cout << (n_failed ? "Tests failed: " : "All tests passed");
+    if (n_failed)
+        cout << n_failed;
+    cout << endl;
+    return n_failed ? 1 : 0;
+}
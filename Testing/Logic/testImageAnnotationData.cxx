@@ -0,0 +1,196 @@
+#include "ImageAnnotationData.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+
+typedef ImageAnnotationData::AnnotationVector AnnotationVector;
+typedef annot::AbstractAnnotation AbstractAnnotation;
+
+double randomCoord(double extent)
+{
+  return extent * rand() / RAND_MAX;
+}
+
+// A line segment lying in a slice of its plane, visible in that plane only
+SmartPtr<annot::LineSegmentAnnotation> makeLine(int plane, double extent)
+{
+  annot::LineSegment seg;
+  int slice = rand() % 20;
+  for(int d = 0; d < 3; d++)
+    {
+    seg.first[d] = (d == plane) ? slice : randomCoord(extent);
+    seg.second[d] = (d == plane) ? slice : randomCoord(extent);
+    }
+
+  SmartPtr<annot::LineSegmentAnnotation> line = annot::LineSegmentAnnotation::New();
+  line->SetSegment(seg);
+  line->SetPlane(plane);
+  line->SetVisibleInAllPlanes(false);
+  line->SetVisibleInAllSlices(rand() % 8 == 0);
+  return line;
+}
+
+SmartPtr<annot::LandmarkAnnotation> makeLandmark(int plane, double extent)
+{
+  annot::Landmark lm;
+  lm.Text = "landmark";
+  lm.Offset = Vector2d(rand() % 10, rand() % 10);
+  for(int d = 0; d < 3; d++)
+    lm.Pos[d] = (d == plane) ? rand() % 20 : randomCoord(extent);
+
+  SmartPtr<annot::LandmarkAnnotation> landmark = annot::LandmarkAnnotation::New();
+  landmark->SetLandmark(lm);
+  landmark->SetPlane(plane);
+  landmark->SetVisibleInAllPlanes(rand() % 4 == 0);
+  landmark->SetVisibleInAllSlices(rand() % 8 == 0);
+  return landmark;
+}
+
+// The annotations visible in a slice, found by going through the whole list
+AnnotationVector visibleInSlice(ImageAnnotationData *data, int plane, int slice)
+{
+  AnnotationVector out;
+  for(auto it = data->GetAnnotations().begin(); it != data->GetAnnotations().end(); ++it)
+    if((*it)->IsVisible(plane, slice))
+      out.push_back(*it);
+  return out;
+}
+
+// Whether the bounding box of an annotation overlaps a box in the plane
+bool overlapsInPlane(AbstractAnnotation *a, int plane, const Vector3d &xmin, const Vector3d &xmax)
+{
+  Vector3d amin, amax;
+  a->GetBoundingBox(amin, amax);
+  for(int d = 0; d < 3; d++)
+    if(d != plane && (amax[d] < xmin[d] || amin[d] > xmax[d]))
+      return false;
+  return true;
+}
+
+// Check the queries of a collection against a search of the whole list in a
+// number of random slices and boxes
+int checkQueries(ImageAnnotationData *data, double extent, const char *what)
+{
+  int n_failed = 0;
+  for(int trial = 0; trial < 200; trial++)
+    {
+    int plane = rand() % 3, slice = rand() % 20;
+    AnnotationVector expected = visibleInSlice(data, plane, slice), in_slice, near;
+
+    data->GetAnnotationsInSlice(plane, slice, in_slice);
+    if(in_slice != expected)
+      {
+      std::cout << what << ": wrong annotations in plane " << plane
+                << ", slice " << slice << std::endl;
+      n_failed++;
+      }
+
+    // Boxes range from a fraction of a grid cell to the whole extent
+    Vector3d xmin, xmax;
+    double size = (trial % 4 == 0) ? extent : randomCoord(extent / 4);
+    for(int d = 0; d < 3; d++)
+      {
+      xmin[d] = randomCoord(extent) - size / 2;
+      xmax[d] = xmin[d] + size;
+      }
+    data->GetAnnotationsInSliceNear(plane, slice, xmin, xmax, near);
+
+    // The result is in list order, is a subset of the annotations in the
+    // slice and leaves out none of those in the box
+    size_t k = 0;
+    bool in_order = true, complete = true;
+    for(AbstractAnnotation *a : near)
+      {
+      while(k < expected.size() && expected[k] != a)
+        {
+        complete = complete && !overlapsInPlane(expected[k], plane, xmin, xmax);
+        k++;
+        }
+      if(k == expected.size())
+        in_order = false;
+      else
+        k++;
+      }
+    for(; k < expected.size(); k++)
+      complete = complete && !overlapsInPlane(expected[k], plane, xmin, xmax);
+
+    if(!in_order || !complete)
+      {
+      std::cout << what << ": wrong annotations near a box in plane " << plane
+                << ", slice " << slice << (in_order ? "" : " (not in list order)")
+                << (complete ? "" : " (missing annotations)") << std::endl;
+      n_failed++;
+      }
+    }
+  return n_failed;
+}
+
+int main(int argc, char* argv[])
+{
+  int n_failed = 0;
+  double extent = 200.0;
+  srand(1234);
+
+  SmartPtr<ImageAnnotationData> data = ImageAnnotationData::New();
+  for(int i = 0; i < 300; i++)
+    {
+    int plane = rand() % 3;
+    if(i % 2)
+      data->AddAnnotation(makeLine(plane, extent));
+    else
+      data->AddAnnotation(makeLandmark(plane, extent));
+    }
+
+  // A few long segments, which cover many cells of the grid
+  for(int i = 0; i < 5; i++)
+    {
+    SmartPtr<annot::LineSegmentAnnotation> line = makeLine(i % 3, extent);
+    annot::LineSegment seg = line->GetSegment();
+    seg.first[(i + 1) % 3] = 0;
+    seg.second[(i + 1) % 3] = extent;
+    line->SetSegment(seg);
+    data->AddAnnotation(line);
+    }
+
+  n_failed += checkQueries(data, extent, "Initial annotations");
+
+  // Moving annotations after a query makes the index out of date
+  int n = 0;
+  for(auto it = data->GetAnnotations().begin(); it != data->GetAnnotations().end(); ++it, ++n)
+    {
+    if(n % 3 == 0)
+      (*it)->MoveBy(Vector3d(randomCoord(60) - 30, randomCoord(60) - 30, 0.0));
+    if(n % 7 == 0)
+      (*it)->SetVisibleInAllSlices(!(*it)->GetVisibleInAllSlices());
+    }
+  n_failed += checkQueries(data, extent, "Moved annotations");
+
+  // Changes to the annotations of another collection
+  SmartPtr<ImageAnnotationData> other = ImageAnnotationData::New();
+  for(int i = 0; i < 50; i++)
+    other->AddAnnotation(makeLandmark(rand() % 3, extent));
+  n_failed += checkQueries(other, extent, "Second collection");
+  for(auto it = other->GetAnnotations().begin(); it != other->GetAnnotations().end(); ++it)
+    (*it)->MoveBy(Vector3d(5.0, 5.0, 0.0));
+  n_failed += checkQueries(data, extent, "First collection");
+  n_failed += checkQueries(other, extent, "Moved annotations of the second collection");
+
+  // Editing the list directly, followed by a call to Modified()
+  ImageAnnotationData::AnnotationList &list = data->GetAnnotations();
+  for(auto it = list.begin(); it != list.end(); )
+    it = (rand() % 4 == 0) ? list.erase(it) : std::next(it);
+  list.push_front(makeLandmark(0, extent).GetPointer());
+  data->Modified();
+  n_failed += checkQueries(data, extent, "Edited list");
+
+  // An annotation placed in the list directly is adopted by the collection
+  list.front()->MoveBy(Vector3d(0.0, 40.0, 40.0));
+  n_failed += checkQueries(data, extent, "Annotation placed in the list");
+
+  std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+  if(n_failed)
+    std::cout << n_failed;
+  std::cout << std::endl;
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+#include "ScalarImageWrapper.h"
+#include "VectorImageWrapper.h"
+#include "ImageWrapperTraits.h"
+#include <vnl/vnl_matrix.h>
+#include <iostream>
+
+typedef ImageWrapperTraits<short>::ScalarTraits::WrapperType ScalarWrapperType;
+typedef ImageWrapperTraits<short>::VectorTraits::WrapperType VectorWrapperType;
+typedef ImageWrapperBase::PatchOffsetTable PatchOffsetTable;
+typedef itk::Index<3> IndexType;
+
+const int SIZE = 10;
+
+short pixelValue(int offset, int c)
+{
+  return (short)((offset * 7 + c * 31) % 251 - 100);
+}
+
+template <class TImage4D>
+typename TImage4D::Pointer makeImage(int nc)
+{
+  typename TImage4D::Pointer img = TImage4D::New();
+  typename TImage4D::RegionType region;
+  for(int d = 0; d < 3; d++)
+    region.SetSize(d, SIZE);
+  region.SetSize(3, 1);
+  img->SetRegions(region);
+  img->SetNumberOfComponentsPerPixel(nc);
+  img->Allocate();
+
+  short *p = img->GetBufferPointer();
+  for(int i = 0; i < SIZE * SIZE * SIZE; i++)
+    for(int c = 0; c < nc; c++)
+      *p++ = pixelValue(i, c);
+  return img;
+}
+
+// Sample one patch as the classifier did before patches were sampled in
+// batches: by location and component, then transposed in place
+vnl_matrix<double> samplePatch(ImageWrapperBase *layer, const IndexType &idx,
+                               const PatchOffsetTable &offset_table, int patch_size)
+{
+  vnl_matrix<double> m(patch_size, layer->GetNumberOfComponents());
+  layer->SamplePatchAsDouble(idx, offset_table, m.data_block());
+  if(m.rows() > 1)
+    m.inplace_transpose();
+  return m;
+}
+
+bool matchesSinglePatch(const float *row, const vnl_matrix<double> &ref)
+{
+  for(unsigned int i = 0; i < ref.size(); i++)
+    if(row[i] != (float) ref.data_block()[i])
+      return false;
+  return true;
+}
+
+// Check the batched sampling against the single patch sampling
+int checkLayer(ImageWrapperBase *layer, const char *name)
+{
+  int n_failed = 0;
+  itk::Size<3> radius;
+  radius[0] = 1; radius[1] = 2; radius[2] = 1;
+  int patch_size = 3 * 5 * 3;
+  int n_cols = patch_size * layer->GetNumberOfComponents();
+  PatchOffsetTable offset_table = layer->GetPatchOffsetTable(radius);
+
+  std::vector<IndexType> voxels;
+  for(int i = 0; i < 20; i++)
+    {
+    IndexType idx;
+    idx[0] = 1 + (i * 3) % 8;
+    idx[1] = 2 + (i * 5) % 6;
+    idx[2] = 1 + (i * 7) % 8;
+    voxels.push_back(idx);
+    }
+
+  // Rows that are not adjacent, with the patches written after some columns
+  // that must be left untouched
+  const int column = 2;
+  std::vector<std::vector<float> > rows(voxels.size(), std::vector<float>(column + n_cols + 3, -1000.0f));
+  std::vector<float *> out_rows;
+  for(unsigned int i = 0; i < rows.size(); i++)
+    out_rows.push_back(rows[i].data());
+
+  layer->SamplePatchesAsFloat(voxels, offset_table, out_rows.data(), column);
+  for(unsigned int i = 0; i < voxels.size(); i++)
+    {
+    const std::vector<float> &row = rows[i];
+    bool untouched = row[0] == -1000.0f && row[1] == -1000.0f;
+    for(int j = column + n_cols; j < (int) row.size(); j++)
+      untouched = untouched && row[j] == -1000.0f;
+
+    if(!untouched || !matchesSinglePatch(&row[column], samplePatch(layer, voxels[i], offset_table, patch_size)))
+      {
+      std::cout << name << ": wrong patch at voxel " << voxels[i] << std::endl;
+      n_failed++;
+      break;
+      }
+    }
+
+  return n_failed;
+}
+
+int main(int argc, char* argv[])
+{
+  int n_failed = 0;
+
+  ScalarWrapperType::Pointer scalar = ScalarWrapperType::New();
+  scalar->SetImage4D(makeImage<ScalarWrapperType::Image4DType>(1));
+  n_failed += checkLayer(scalar, "Scalar image");
+
+  VectorWrapperType::Pointer vector = VectorWrapperType::New();
+  vector->SetImage4D(makeImage<VectorWrapperType::Image4DType>(3));
+  n_failed += checkLayer(vector, "Vector image");
+
+  std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+  if(n_failed)
+    std::cout << n_failed;
+  std::cout << std::endl;
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+#include "LabelInterpolationSlicePlan.h"
+#include <iostream>
+
+typedef LabelInterpolationSlicePlan::SliceRange SliceRange;
+
+const int N_SLICES = 14;
+
+// Flag the listed slices, up to the first negative value
+std::vector<bool> slices(const int *list)
+{
+    std::vector<bool> flags(N_SLICES, false);
+    for (; *list >= 0; list++)
+        flags[*list] = true;
+    return flags;
+}
+
+// Check the ranges of the plan against a list of first, last pairs
+bool sameRanges(const LabelInterpolationSlicePlan &plan, const int *list)
+{
+    const std::vector<SliceRange> &ranges = plan.GetRanges();
+    size_t i = 0;
+    for (; *list >= 0; list += 2, i++)
+        if (i >= ranges.size() || ranges[i] != SliceRange(list[0], list[1]))
+            return false;
+    return i == ranges.size();
+}
+
+int main(int argc, char* argv[])
+{
+    int n_failed = 0;
+
+    // Slices 6 and 7 are next to each other, so there is no gap between them
+    const int key[] = { 1, 4, 6, 7, 11, -1 };
+    LabelInterpolationSlicePlan plan;
+
+    // Each gap is interpolated separately with the contours only
+    plan.Initialize(slices(key));
+    plan.ComputeRanges(false);
+    const int gaps[] = { 1, 4, 4, 6, 7, 11, -1 };
+    if (!sameRanges(plan, gaps) || plan.IsIncremental()
+        || plan.GetKeepSlices().size() || plan.GetClearSlices().size())
+    {
+        std::cout << "Wrong gaps between the key slices" << std::endl;
+        n_failed++;
+    }
+
+    // Only the gaps that share a key slice are merged, not those that are
+    // merely next to each other
+    plan.ComputeRanges(true);
+    const int merged[] = { 1, 6, 7, 11, -1 };
+    if (!sameRanges(plan, merged))
+    {
+        std::cout << "Wrong merged gaps" << std::endl;
+        n_failed++;
+    }
+
+    // The checksums and voxel counts after the interpolation, which filled in
+    // the label between the key slices
+    std::vector<unsigned long> last_signature(N_SLICES, 0), count(N_SLICES, 0);
+    for (int s = 1; s <= 11; s++)
+    {
+        last_signature[s] = 100 + s;
+        count[s] = 10;
+    }
+
+    // Nothing has changed, so there is nothing to interpolate
+    plan.InitializeIncremental(last_signature, count, last_signature, slices(key));
+    plan.ComputeRanges(true);
+    if (plan.GetRanges().size() || plan.GetKeySlices() != slices(key)
+        || plan.GetClearSlices() != std::vector<bool>(N_SLICES, false))
+    {
+        std::cout << "Unchanged slices interpolated again" << std::endl;
+        n_failed++;
+    }
+
+    // A key slice is edited and a slice that was filled in is drawn over.
+    // Only the gaps next to these are interpolated again, and what was filled
+    // in there before is replaced.
+    std::vector<unsigned long> signature = last_signature;
+    signature[4] = 1;
+    signature[9] = 2;
+    plan.InitializeIncremental(signature, count, last_signature, slices(key));
+    plan.ComputeRanges(false);
+    const int new_key[] = { 1, 4, 6, 7, 9, 11, -1 };
+    const int changed_gaps[] = { 1, 4, 4, 6, 7, 9, 9, 11, -1 };
+    const int cleared[] = { 2, 3, 5, 8, 10, -1 };
+    if (!sameRanges(plan, changed_gaps) || !plan.IsIncremental()
+        || plan.GetKeySlices() != slices(new_key) || plan.GetKeepSlices() != slices(new_key)
+        || plan.GetClearSlices() != slices(cleared))
+    {
+        std::cout << "Wrong gaps after editing the slices" << std::endl;
+        n_failed++;
+    }
+
+    // An erased key slice is no longer a key slice, and the gap around it is
+    // interpolated again
+    signature = last_signature;
+    signature[6] = 0;
+    count[6] = 0;
+    plan.InitializeIncremental(signature, count, last_signature, slices(key));
+    plan.ComputeRanges(true);
+    const int erased_key[] = { 1, 4, 7, 11, -1 };
+    const int erased_gaps[] = { 4, 7, -1 };
+    const int erased_cleared[] = { 5, 6, -1 };
+    if (!sameRanges(plan, erased_gaps) || plan.GetKeySlices() != slices(erased_key)
+        || plan.GetClearSlices() != slices(erased_cleared))
+    {
+        std::cout << "Wrong gaps after erasing a key slice" << std::endl;
+        n_failed++;
+    }
+
+    std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+    if (n_failed)
+        std::cout << n_failed;
+    std::cout << std::endl;
+    return n_failed ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+#include "LabelOccupancyIndex.h"
+#include "RLEImageRegionIterator.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+typedef LabelOccupancyIndex::ImageType LabelImageType;
+typedef LabelOccupancyIndex::RegionType RegionType;
+
+// A few blobs of different labels, sized so that the edge bricks are partial
+LabelImageType::Pointer makeImage()
+{
+  LabelImageType::Pointer image = LabelImageType::New();
+  LabelImageType::SizeType size = {{ 83, 70, 45 }};
+  image->SetRegions(RegionType(size));
+  image->Allocate();
+  image->FillBuffer(0);
+
+  itk::ImageRegionIteratorWithIndex<LabelImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+    {
+    LabelImageType::IndexType idx = it.GetIndex();
+    if (idx[0] >= 10 && idx[0] < 40 && idx[1] >= 5 && idx[1] < 20 && idx[2] >= 3 && idx[2] < 9)
+      it.Set(1);
+    else if ((idx[0] - 60) * (idx[0] - 60) + (idx[1] - 50) * (idx[1] - 50) < 100 && idx[2] > 30)
+      it.Set(2);
+    else if (idx[0] == 82 && idx[1] == 69 && idx[2] == 44)
+      it.Set(7);
+    }
+  return image;
+}
+
+// Compare the summaries of the index with a voxel by voxel scan of the image
+int checkIndex(LabelImageType *image, LabelOccupancyIndex *index, const char *step)
+{
+  std::map<LabelType, unsigned long> counts;
+  std::map<LabelType, RegionType> boxes;
+  RegionType::SizeType one = {{ 1, 1, 1 }};
+  itk::ImageRegionConstIteratorWithIndex<LabelImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+    {
+    LabelType label = it.Get();
+    RegionType voxel(it.GetIndex(), one);
+    if (counts[label]++ == 0)
+      boxes[label] = voxel;
+    else
+      {
+      for (int d = 0; d < 3; d++)
+        {
+        long i0 = std::min(boxes[label].GetIndex(d), voxel.GetIndex(d));
+        long i1 = std::max(boxes[label].GetUpperIndex()[d], voxel.GetIndex(d));
+        boxes[label].SetIndex(d, i0);
+        boxes[label].SetSize(d, i1 - i0 + 1);
+        }
+      }
+    }
+
+  int n_failed = 0;
+  if (index->GetLabelSummaries().size() != counts.size())
+    {
+    std::cout << step << ": index has " << index->GetLabelSummaries().size()
+      << " labels, image has " << counts.size() << std::endl;
+    n_failed++;
+    }
+
+  for (auto &c : counts)
+    {
+    RegionType bbox;
+    if (index->GetLabelVoxelCount(c.first) != c.second
+        || !index->GetLabelBoundingBox(c.first, bbox) || bbox != boxes[c.first])
+      {
+      std::cout << step << ": wrong count or bounding box for label " << c.first << std::endl;
+      n_failed++;
+      }
+    }
+  return n_failed;
+}
+
+int main(int argc, char* argv[])
+{
+  int n_failed = 0;
+
+  LabelImageType::Pointer image = makeImage();
+  LabelOccupancyIndex::Pointer index = LabelOccupancyIndex::New();
+  index->Update(image);
+  n_failed += checkIndex(image, index, "Build");
+
+  // The single voxel of label 7 is in the last brick
+  std::vector<RegionType> bricks = index->GetOccupiedBrickRegions(7);
+  if (bricks.size() != 1 || bricks[0].GetIndex(0) != 64 || bricks[0].GetSize(0) != 19)
+    {
+    std::cout << "Wrong bricks for label 7" << std::endl;
+    n_failed++;
+    }
+
+  // Paint over a region straddling several bricks and update incrementally
+  RegionType::IndexType paintIndex = {{ 25, 15, 5 }};
+  RegionType::SizeType paintSize = {{ 20, 20, 30 }};
+  RegionType paint(paintIndex, paintSize);
+  itk::ImageRegionIteratorWithIndex<LabelImageType> it(image, paint);
+  for (; !it.IsAtEnd(); ++it)
+    it.Set(it.GetIndex()[2] % 2 ? 3 : 0);
+
+  unsigned long checksum = index->GetLabelSummaries().at(1).CheckSum;
+  index->UpdateRegion(image, paint);
+  image->Modified();
+  index->AcceptModification(image);
+  itk::ModifiedTimeType mtime = index->GetMTime();
+  index->Update(image);
+  n_failed += checkIndex(image, index, "Incremental update");
+  if (index->GetMTime() != mtime)
+    {
+    std::cout << "Index rebuilt after an incremental update" << std::endl;
+    n_failed++;
+    }
+
+  // The checksum of a modified label changes, and matches a rebuilt index
+  LabelOccupancyIndex::Pointer rebuilt = LabelOccupancyIndex::New();
+  rebuilt->Update(image);
+  if (index->GetLabelSummaries().at(1).CheckSum == checksum
+      || index->GetLabelSummaries().at(1).CheckSum != rebuilt->GetLabelSummaries().at(1).CheckSum
+      || index->GetLabelSummaries().at(3).CheckSum != rebuilt->GetLabelSummaries().at(3).CheckSum)
+    {
+    std::cout << "Checksums of the incremental update differ from the rebuilt index" << std::endl;
+    n_failed++;
+    }
+
+  // A modification that is not reported causes a rebuild
+  LabelImageType::IndexType origin = {{ 0, 0, 0 }};
+  image->SetPixel(origin, 9);
+  image->Modified();
+  index->Update(image);
+  n_failed += checkIndex(image, index, "Rebuild");
+
+  // So does one that follows a reported modification before the next
+  // update, such as a replacement of the pixel data
+  RegionType::IndexType cornerIndex = {{ 70, 60, 40 }};
+  RegionType::SizeType cornerSize = {{ 13, 10, 5 }};
+  RegionType corner(cornerIndex, cornerSize);
+  for (itk::ImageRegionIteratorWithIndex<LabelImageType> ic(image, corner); !ic.IsAtEnd(); ++ic)
+    ic.Set(4);
+  index->UpdateRegion(image, corner);
+  image->Modified();
+  index->AcceptModification(image);
+  image->SetPixel(origin, 5);
+  image->Modified();
+  index->Update(image);
+  n_failed += checkIndex(image, index, "Rebuild after an incremental update");
+
+  // A modification reported while the index is out of date clears it, and
+  // no bricks are reported until it is rebuilt
+  image->SetPixel(origin, 6);
+  image->Modified();
+  index->UpdateRegion(image, corner);
+  if (index->GetOccupiedBrickRegions(4).size() || index->GetLabelSummaries().size())
+    {
+    std::cout << "Out of date index reported contents" << std::endl;
+    n_failed++;
+    }
+  index->Update(image);
+  n_failed += checkIndex(image, index, "Rebuild after an out of date modification");
+
+  std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+  if (n_failed)
+    std::cout << n_failed;
+  std::cout << std::endl;
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+#include "LevelSetCheckpointRing.h"
+#include "itkImageRegionIterator.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+typedef LevelSetCheckpointRing::FloatImageType FloatImageType;
+
+const int SIZE = 40;
+
+// Signed distance to a sphere, negative inside. If clamp is set, the values
+// beyond the layers of the sparse field solver are set to the background
+FloatImageType::Pointer makeLevelSet(double radius, bool clamp)
+{
+    FloatImageType::Pointer img = FloatImageType::New();
+    FloatImageType::RegionType region;
+    for (int d = 0; d < 3; d++)
+        region.SetSize(d, SIZE);
+    img->SetRegions(region);
+    img->Allocate();
+
+    itk::ImageRegionIterator<FloatImageType> it(img, region);
+    for (; !it.IsAtEnd(); ++it)
+    {
+        double r2 = 0;
+        for (int d = 0; d < 3; d++)
+            r2 += (it.GetIndex()[d] - 19.5) * (it.GetIndex()[d] - 19.5);
+        float v = (float)(sqrt(r2) - radius);
+        if (clamp && fabs(v) > 3.5f)
+            v = v < 0 ? -4.0f : 4.0f;
+        it.Set(v);
+    }
+    return img;
+}
+
+bool restoresExactly(LevelSetCheckpointRing &ring, unsigned int iteration, FloatImageType *ref)
+{
+    FloatImageType::Pointer img = makeLevelSet(0.0, false);
+    img->FillBuffer(0.0f);
+    if (!ring.Restore(iteration, img))
+        return false;
+
+    size_t n = ref->GetBufferedRegion().GetNumberOfPixels();
+    return std::equal(ref->GetBufferPointer(), ref->GetBufferPointer() + n, img->GetBufferPointer());
+}
+
+int main(int argc, char* argv[])
+{
+    int n_failed = 0;
+
+    // Level sets of the sparse field solver are stored exactly and compactly
+    LevelSetCheckpointRing ring;
+    ring.SetInterval(10);
+    FloatImageType::Pointer sparse = makeLevelSet(8.0, true);
+    ring.Store(sparse, 10);
+    size_t nBytes = SIZE * SIZE * SIZE * sizeof(float);
+    if (!restoresExactly(ring, 10, sparse) || ring.GetMemoryUsage() > nBytes / 2)
+    {
+        std::cout << "Sparse field level set not stored exactly and compactly" << std::endl;
+        n_failed++;
+    }
+
+    // Level sets of the dense solver are not clamped, and are stored exactly
+    FloatImageType::Pointer dense = makeLevelSet(10.0, false);
+    ring.Store(dense, 20);
+    if (!restoresExactly(ring, 20, dense) || !restoresExactly(ring, 10, sparse))
+    {
+        std::cout << "Dense level set not stored exactly" << std::endl;
+        n_failed++;
+    }
+
+    // Checkpoints are due once per interval
+    if (ring.IsCheckpointDue(25) || !ring.IsCheckpointDue(30))
+    {
+        std::cout << "Wrong checkpoint schedule" << std::endl;
+        n_failed++;
+    }
+
+    // Rewinding removes the later checkpoints
+    ring.DiscardAfter(15);
+    std::vector<unsigned int> iter = ring.GetCheckpointIterations();
+    if (iter.size() != 1 || iter[0] != 10 || ring.Restore(20, dense))
+    {
+        std::cout << "DiscardAfter did not remove the later checkpoints" << std::endl;
+        n_failed++;
+    }
+
+    // The oldest checkpoints are dropped to stay within the memory budget,
+    // but the newest one is always kept
+    ring.SetMemoryBudget(nBytes + nBytes / 2);
+    ring.Store(dense, 20);
+    ring.Store(makeLevelSet(12.0, false), 30);
+    iter = ring.GetCheckpointIterations();
+    if (iter.size() != 1 || iter[0] != 30)
+    {
+        std::cout << "Memory budget not enforced" << std::endl;
+        n_failed++;
+    }
+
+    ring.SetMemoryBudget(0);
+    ring.Store(dense, 40);
+    iter = ring.GetCheckpointIterations();
+    if (iter.size() != 1 || !restoresExactly(ring, 40, dense))
+    {
+        std::cout << "Newest checkpoint not kept" << std::endl;
+        n_failed++;
+    }
+
+    std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+    if (n_failed)
+        std::cout << n_failed;
+    std::cout << std::endl;
+    return n_failed ? 1 : 0;
+}
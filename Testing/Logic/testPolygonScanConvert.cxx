@@ -0,0 +1,252 @@
+#include "PolygonScanConvert.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include <vtkPoints.h>
+#include <vtkPolygon.h>
+#include <vtkSmartPointer.h>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+typedef itk::Image<unsigned char, 2> ImageType;
+typedef std::array<double, 2> Vertex;
+typedef std::vector<Vertex> Polygon;
+typedef PolygonScanConvert<ImageType, Vertex, Polygon::const_iterator> ScanConvert;
+
+ImageType::Pointer makeImage(long x0, long y0, unsigned long nx, unsigned long ny)
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::IndexType index = {{ x0, y0 }};
+  ImageType::SizeType size = {{ nx, ny }};
+  image->SetRegions(ImageType::RegionType(index, size));
+  image->Allocate();
+  return image;
+}
+
+ImageType::Pointer rasterize(const Polygon &poly, ImageType *like, bool nonzero_winding = false)
+{
+  ImageType::RegionType region = like->GetBufferedRegion();
+  ImageType::Pointer image = makeImage(region.GetIndex()[0], region.GetIndex()[1],
+                                       region.GetSize()[0], region.GetSize()[1]);
+  ScanConvert::RasterizeFilled(poly.begin(), poly.size(), image, nonzero_winding);
+  return image;
+}
+
+// The test of each pixel center against a vtkPolygon that was used before
+// the scanline fill, which implements the even-odd rule
+ImageType::Pointer rasterizeWithVTK(const Polygon &poly, ImageType *like)
+{
+  vtkSmartPointer<vtkPolygon> polygon = vtkSmartPointer<vtkPolygon>::New();
+  for(const Vertex &v : poly)
+    polygon->GetPoints()->InsertNextPoint(v[0], v[1], 0.0);
+
+  double *point_data =
+      static_cast<double*>(polygon->GetPoints()->GetData()->GetVoidPointer(0));
+  int np = polygon->GetPoints()->GetNumberOfPoints();
+  double normal[3], bounds[6];
+  polygon->ComputeNormal(np, point_data, normal);
+  polygon->GetPoints()->GetBounds(bounds);
+
+  ImageType::Pointer image = rasterize(Polygon(), like);
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    double x[3] = { it.GetIndex()[0] + 0.5, it.GetIndex()[1] + 0.5, 0.0 };
+    it.Set(polygon->PointInPolygon(x, np, point_data, bounds, normal) == 1 ? 1 : 0);
+    }
+  return image;
+}
+
+// Distance from a point to the outline of the polygon
+double distanceToOutline(const Polygon &poly, double x, double y)
+{
+  double dmin = 1e100;
+  for(size_t i = 0; i < poly.size(); i++)
+    {
+    const Vertex &a = poly[i], &b = poly[(i + 1) % poly.size()];
+    double ex = b[0] - a[0], ey = b[1] - a[1];
+    double len2 = ex * ex + ey * ey;
+    double t = len2 > 0 ? ((x - a[0]) * ex + (y - a[1]) * ey) / len2 : 0;
+    t = std::max(0.0, std::min(1.0, t));
+    double dx = a[0] + t * ex - x, dy = a[1] + t * ey - y;
+    dmin = std::min(dmin, std::sqrt(dx * dx + dy * dy));
+    }
+  return dmin;
+}
+
+// The winding number of the polygon around a point, counting the edges that
+// cross the horizontal line through the point at or left of it
+int windingNumber(const Polygon &poly, double x, double y)
+{
+  int winding = 0;
+  for(size_t i = 0; i < poly.size(); i++)
+    {
+    const Vertex &a = poly[i], &b = poly[(i + 1) % poly.size()];
+    if((a[1] <= y) != (b[1] <= y))
+      {
+      double xc = a[0] + (y - a[1]) * (b[0] - a[0]) / (b[1] - a[1]);
+      if(xc <= x)
+        winding += (a[1] < b[1]) ? 1 : -1;
+      }
+    }
+  return winding;
+}
+
+// Count the pixels where two images differ, ignoring the pixels whose centers
+// are within tol of the outline, where the result depends on rounding
+int countDifferences(ImageType *a, ImageType *b, const Polygon &poly, double tol)
+{
+  int n = 0;
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it(a, a->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    double x = it.GetIndex()[0] + 0.5, y = it.GetIndex()[1] + 0.5;
+    if(it.Get() != b->GetPixel(it.GetIndex()) && distanceToOutline(poly, x, y) > tol)
+      n++;
+    }
+  return n;
+}
+
+// Check an image against the winding number of each pixel center
+int countWindingErrors(ImageType *image, const Polygon &poly, bool nonzero_winding)
+{
+  int n = 0;
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    double x = it.GetIndex()[0] + 0.5, y = it.GetIndex()[1] + 0.5;
+    int w = windingNumber(poly, x, y);
+    bool inside = nonzero_winding ? w != 0 : (w & 1) != 0;
+    if(it.Get() != (inside ? 1 : 0) && distanceToOutline(poly, x, y) > 1e-6)
+      n++;
+    }
+  return n;
+}
+
+unsigned long countFilled(ImageType *image)
+{
+  unsigned long n = 0;
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    n += it.Get();
+  return n;
+}
+
+Polygon makePolygon(std::initializer_list<Vertex> v)
+{
+  return Polygon(v);
+}
+
+int main(int argc, char* argv[])
+{
+  int n_failed = 0;
+  ImageType::Pointer image = makeImage(0, 0, 64, 48);
+
+  // Pixels whose centers lie on the left or bottom edge are inside, those on
+  // the right or top edge are outside, so polygons that share an edge do not
+  // overlap or leave a gap between them
+  Polygon left = makePolygon({{ 0.5, 0.5 }, { 3.5, 0.5 }, { 3.5, 3.5 }, { 0.5, 3.5 }});
+  Polygon right = makePolygon({{ 3.5, 0.5 }, { 6.5, 0.5 }, { 6.5, 3.5 }, { 3.5, 3.5 }});
+  ImageType::Pointer img_left = rasterize(left, image), img_right = rasterize(right, image);
+  ImageType::IndexType corner = {{ 0, 0 }}, outside = {{ 3, 3 }};
+  if(countFilled(img_left) != 9 || !img_left->GetPixel(corner) || img_left->GetPixel(outside))
+    {
+    std::cout << "Wrong pixels on the boundary of a square" << std::endl;
+    n_failed++;
+    }
+
+  unsigned long n_overlap = 0;
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it(img_left, img_left->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    n_overlap += it.Get() && img_right->GetPixel(it.GetIndex());
+  if(n_overlap || countFilled(img_right) != 9)
+    {
+    std::cout << "Squares sharing an edge overlap or leave a gap" << std::endl;
+    n_failed++;
+    }
+
+  // A concave L shape, clockwise, covering 20 x 10 plus 10 x 10 pixels
+  Polygon ell = makePolygon({{ 2, 2 }, { 2, 22 }, { 12, 22 }, { 12, 12 }, { 22, 12 }, { 22, 2 }});
+  ImageType::Pointer img_ell = rasterize(ell, image);
+  if(countFilled(img_ell) != 300 || countWindingErrors(img_ell, ell, false))
+    {
+    std::cout << "Wrong pixels for a concave polygon" << std::endl;
+    n_failed++;
+    }
+
+  // A pentagram is self-intersecting. Its central pentagon has a winding
+  // number of two, so it is outside by the even-odd rule and inside by the
+  // non-zero winding rule
+  Polygon star;
+  for(int i = 0; i < 5; i++)
+    {
+    double a = M_PI / 2 + i * 4 * M_PI / 5;
+    star.push_back(Vertex{{ 32.1 + 20 * cos(a), 24.1 + 20 * sin(a) }});
+    }
+  ImageType::Pointer star_eo = rasterize(star, image, false);
+  ImageType::Pointer star_nz = rasterize(star, image, true);
+  ImageType::IndexType center = {{ 32, 24 }};
+  if(star_eo->GetPixel(center) || !star_nz->GetPixel(center)
+     || countWindingErrors(star_eo, star, false) || countWindingErrors(star_nz, star, true)
+     || countFilled(star_nz) <= countFilled(star_eo))
+    {
+    std::cout << "Wrong fill rule for a self-intersecting polygon" << std::endl;
+    n_failed++;
+    }
+
+  // The two rules agree for a simple polygon, whatever its orientation
+  Polygon ell_ccw(ell.rbegin(), ell.rend());
+  if(countDifferences(rasterize(ell_ccw, image, true), img_ell, ell, 0.0))
+    {
+    std::cout << "Non-zero winding differs for a simple polygon" << std::endl;
+    n_failed++;
+    }
+
+  // The image region need not start at the origin. Pixel centers are at
+  // the index plus one half, and the polygon is clipped to the region
+  ImageType::Pointer offset = makeImage(10, 5, 20, 30);
+  ImageType::Pointer img_offset = rasterize(ell, offset);
+  if(countFilled(img_offset) != 12 * 7 + 2 * 10 || countWindingErrors(img_offset, ell, false))
+    {
+    std::cout << "Wrong pixels for an image region with an offset" << std::endl;
+    n_failed++;
+    }
+
+  // Degenerate input leaves the image empty
+  Polygon segment = makePolygon({{ 1, 1 }, { 10, 10 }});
+  if(countFilled(rasterize(segment, image)) || countFilled(rasterize(Polygon(), image)))
+    {
+    std::cout << "Degenerate polygon was filled" << std::endl;
+    n_failed++;
+    }
+
+  // Random polygons, which are usually concave and self-intersecting, give
+  // the same result as the winding number of each pixel, and as the test
+  // against a vtkPolygon away from the outline
+  srand(1234);
+  for(int trial = 0; trial < 50; trial++)
+    {
+    Polygon poly;
+    int n = 3 + rand() % 12;
+    for(int i = 0; i < n; i++)
+      poly.push_back(Vertex{{ -8 + 80.0 * rand() / RAND_MAX, -8 + 64.0 * rand() / RAND_MAX }});
+
+    ImageType::Pointer eo = rasterize(poly, image, false);
+    ImageType::Pointer nz = rasterize(poly, image, true);
+    int n_err = countWindingErrors(eo, poly, false) + countWindingErrors(nz, poly, true);
+    int n_vtk = countDifferences(eo, rasterizeWithVTK(poly, image), poly, 1e-3);
+    if(n_err || n_vtk)
+      {
+      std::cout << "Random polygon " << trial << ": " << n_err << " pixels differ from the "
+                << "winding number, " << n_vtk << " from vtkPolygon" << std::endl;
+      n_failed++;
+      }
+    }
+
+  std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+  if(n_failed)
+    std::cout << n_failed;
+  std::cout << std::endl;
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,265 @@
+#include "RESTClient.h"
+#include "IRISException.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// A minimal HTTP server on the loopback interface that handles one request
+// per connection, and can simulate connections that drop mid-transfer
+class LocalServer
+{
+public:
+  std::atomic<int> n_downloads, n_uploads;
+  std::string file_data;
+
+  // Path and body of the last upload received
+  std::string GetLastUploadPath()
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_LastUploadPath;
+    }
+
+  std::string GetLastUploadBody()
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_LastUploadBody;
+    }
+
+  LocalServer() : n_downloads(0), n_uploads(0)
+    {
+    for (int i = 0; i < 100000; i++)
+      file_data.push_back((char)('a' + (i * 7) % 26));
+    }
+
+  int Start()
+    {
+    m_Socket = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(m_Socket, (sockaddr *)&addr, sizeof(addr)) || listen(m_Socket, 16))
+      return 0;
+
+    socklen_t len = sizeof(addr);
+    getsockname(m_Socket, (sockaddr *)&addr, &len);
+    std::thread(&LocalServer::Serve, this).detach();
+    return ntohs(addr.sin_port);
+    }
+
+private:
+  int m_Socket;
+  std::mutex m_Mutex;
+  std::string m_LastUploadPath, m_LastUploadBody;
+
+  void Send(int fd, const std::string &s)
+    {
+    size_t sent = 0;
+    while (sent < s.size())
+      {
+      ssize_t n = send(fd, s.data() + sent, s.size() - sent, 0);
+      if (n <= 0)
+        return;
+      sent += n;
+      }
+    }
+
+  void Serve()
+    {
+    int fd;
+    while ((fd = accept(m_Socket, NULL, NULL)) >= 0)
+      {
+      Handle(fd);
+      close(fd);
+      }
+    }
+
+  void Handle(int fd)
+    {
+    // Read the headers and the body
+    std::string req;
+    char buf[4096];
+    size_t body_start = std::string::npos, content_length = 0;
+    while (body_start == std::string::npos || req.size() < body_start + content_length)
+      {
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0)
+        return;
+      req.append(buf, n);
+      if (body_start == std::string::npos && (body_start = req.find("\r\n\r\n")) != std::string::npos)
+        {
+        body_start += 4;
+        size_t pos = req.find("Content-Length: ");
+        if (pos != std::string::npos && pos < body_start)
+          content_length = atol(req.c_str() + pos + 16);
+        }
+      }
+
+    std::string path = req.substr(req.find(' ') + 1);
+    path = path.substr(0, path.find(' '));
+
+    if (path == "/download")
+      {
+      // The first attempt drops the connection after 30000 bytes, the
+      // second attempt must ask for the rest
+      int attempt = n_downloads++;
+      std::ostringstream oss;
+      size_t pos = req.find("Range: bytes=");
+      if (attempt == 0)
+        {
+        oss << "HTTP/1.1 200 OK\r\nContent-Length: " << file_data.size()
+          << "\r\nConnection: close\r\n\r\n" << file_data.substr(0, 30000);
+        }
+      else if (pos != std::string::npos)
+        {
+        size_t first = atol(req.c_str() + pos + 13);
+        oss << "HTTP/1.1 206 Partial Content\r\nContent-Length: " << file_data.size() - first
+          << "\r\nContent-Range: bytes " << first << "-" << file_data.size() - 1
+          << "/" << file_data.size() << "\r\nConnection: close\r\n\r\n"
+          << file_data.substr(first);
+        }
+      else
+        {
+        oss << "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Length: 0\r\n"
+          << "Connection: close\r\n\r\n";
+        }
+      Send(fd, oss.str());
+      }
+    else if (path == "/upload/drop")
+      {
+      // Close the connection without a response, after the request
+      // has been received in full
+      n_uploads++;
+      }
+    else
+      {
+        {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_LastUploadPath = path;
+        m_LastUploadBody = req.substr(body_start);
+        }
+      n_uploads++;
+      Send(fd, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nOK");
+      }
+    }
+};
+
+std::string readFile(const std::string &fn)
+{
+  std::ifstream ifs(fn.c_str(), std::ios::binary);
+  std::ostringstream oss;
+  oss << ifs.rdbuf();
+  return oss.str();
+}
+
+int main(int argc, char* argv[])
+{
+  int n_failed = 0;
+
+  LocalServer server;
+  int port = server.Start();
+  if (!port)
+    {
+    std::cout << "Could not start the local server" << std::endl;
+    return 1;
+    }
+
+  char url[256];
+  snprintf(url, sizeof(url), "ITKSNAP_WT_DSS_SERVER=http://127.0.0.1:%d", port);
+  putenv(url);
+
+  std::string fn_download = "testRESTClient_download.bin";
+  std::string fn_upload = "testRESTClient_upload.txt";
+  std::ofstream(fn_upload.c_str()) << "upload contents";
+
+  try
+    {
+    // An interrupted download is resumed from the last byte received,
+    // after waiting for the retry delay
+    RESTClient rc;
+    rc.SetRetryDelay(0.3, 1.0);
+    rc.QueueDownload(fn_download.c_str(), "%s", "download");
+    auto t_start = std::chrono::steady_clock::now();
+    if (!rc.PerformQueuedTransfers() || server.n_downloads != 2
+      || readFile(fn_download) != server.file_data)
+      {
+      std::cout << "Interrupted download was not resumed" << std::endl;
+      n_failed++;
+      }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t_start;
+    if (elapsed.count() < 0.25)
+      {
+      std::cout << "Download was retried without a delay" << std::endl;
+      n_failed++;
+      }
+
+    // The URL and each of the fields of an upload are expanded with the
+    // same arguments
+    std::map<std::string, std::string> fields;
+    fields["first"] = "alpha_%d";
+    fields["second"] = "beta_%d";
+    rc.QueueUpload(fn_upload.c_str(), "upload/%d", fields, 7);
+    bool ok = rc.PerformQueuedTransfers();
+    std::string body = server.GetLastUploadBody();
+    if (!ok || server.GetLastUploadPath() != "/upload/7"
+      || body.find("alpha_7") == std::string::npos
+      || body.find("beta_7") == std::string::npos
+      || body.find("upload contents") == std::string::npos)
+      {
+      std::cout << "Upload fields not expanded correctly" << std::endl;
+      n_failed++;
+      }
+
+    // An upload that reached the server is not sent again when the
+    // connection drops, since the server may have acted on it
+    int n_before = server.n_uploads;
+    rc.QueueUpload(fn_upload.c_str(), "upload/drop", std::map<std::string, std::string>());
+    if (rc.PerformQueuedTransfers() || server.n_uploads != n_before + 1
+      || std::string(rc.GetFailedTransferFile()).find(fn_upload) == std::string::npos)
+      {
+      std::cout << "Failed upload was retried or not reported" << std::endl;
+      n_failed++;
+      }
+    }
+  catch (IRISException &exc)
+    {
+    std::cout << "Exception: " << exc.what() << std::endl;
+    n_failed++;
+    }
+
+  remove(fn_download.c_str());
+  remove(fn_upload.c_str());
+
+  std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+  if (n_failed)
+    std::cout << n_failed;
+  std::cout << std::endl;
+  return n_failed ? 1 : 0;
+}
+
+#else
+
+int main(int argc, char* argv[])
+{
+  // The local server uses POSIX sockets
+  std::cout << "All tests passed" << std::endl;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "SNAPLevelSetDriver.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreaderBase.h"
+#include <cmath>
+#include <iostream>
+
+typedef SNAPLevelSetDriver2d DriverType;
+typedef DriverType::FloatImageType FloatImageType;
+typedef DriverType::ShortImageType ShortImageType;
+
+const int SIZE = 64;
+
+template <class TImage>
+typename TImage::Pointer makeImage()
+{
+    typename TImage::Pointer img = TImage::New();
+    typename TImage::RegionType region;
+    region.SetSize(0, SIZE);
+    region.SetSize(1, SIZE);
+    img->SetRegions(region);
+    img->Allocate();
+    return img;
+}
+
+// Signed distance to a circle in the middle of the image, negative inside
+FloatImageType::Pointer makeLevelSet()
+{
+    FloatImageType::Pointer img = makeImage<FloatImageType>();
+    itk::ImageRegionIterator<FloatImageType> it(img, img->GetBufferedRegion());
+    for (; !it.IsAtEnd(); ++it)
+    {
+        double dx = it.GetIndex()[0] - 31.5, dy = it.GetIndex()[1] - 31.5;
+        it.Set((float)(sqrt(dx * dx + dy * dy) - 8.0));
+    }
+    return img;
+}
+
+ShortImageType::Pointer makeSpeed()
+{
+    ShortImageType::Pointer img = makeImage<ShortImageType>();
+    img->FillBuffer(0x4000);
+    return img;
+}
+
+SnakeParameters makeParameters()
+{
+    SnakeParameters p = SnakeParameters::GetDefaultInOutParameters();
+    p.SetSolver(SnakeParameters::PARALLEL_SPARSE_FIELD_SOLVER);
+    p.SetMultiResolutionLevels(3);
+    p.SetMultiResolutionIterations(10);
+    return p;
+}
+
+int countInside(FloatImageType *img)
+{
+    int n = 0;
+    itk::ImageRegionIterator<FloatImageType> it(img, img->GetBufferedRegion());
+    for (; !it.IsAtEnd(); ++it)
+        if (it.Get() < 0)
+            n++;
+    return n;
+}
+
+bool sameImage(FloatImageType *a, FloatImageType *b)
+{
+    itk::ImageRegionIterator<FloatImageType> ia(a, a->GetBufferedRegion());
+    itk::ImageRegionIterator<FloatImageType> ib(b, b->GetBufferedRegion());
+    for (; !ia.IsAtEnd(); ++ia, ++ib)
+        if (fabs(ia.Get() - ib.Get()) > 1e-5)
+            return false;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int n_failed = 0;
+    itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(1);
+
+    ShortImageType::Pointer speed = makeSpeed();
+    SnakeParameters p = makeParameters();
+    FloatImageType::Pointer ls1 = makeLevelSet(), ls2 = makeLevelSet();
+    int nInitial = countInside(ls1);
+
+    // Both drivers start at the coarsest of the three levels
+    DriverType step(ls1, speed, p), batch(ls2, speed, p);
+
+    // Running one iteration at a time refreshes the display every four
+    // iterations at the coarsest level, so after seven iterations the
+    // display still shows the level set after five iterations
+    for (int i = 0; i < 7; i++)
+        step.Run(1);
+    batch.Run(7);
+
+    if (step.GetElapsedIterations() != 7 || batch.GetElapsedIterations() != 7)
+    {
+        std::cout << "Wrong number of elapsed iterations at a coarse level" << std::endl;
+        n_failed++;
+    }
+
+    if (sameImage(step.GetPreviewOutput(), batch.GetOutput()))
+    {
+        std::cout << "Display was refreshed on every iteration" << std::endl;
+        n_failed++;
+    }
+
+    // The output is brought up to date on request, in the same image
+    FloatImageType *preview = step.GetPreviewOutput();
+    if (step.GetOutput() != preview || !sameImage(step.GetOutput(), batch.GetOutput()))
+    {
+        std::cout << "Output at a coarse level is not up to date" << std::endl;
+        n_failed++;
+    }
+
+    // Finish the coarse levels and continue at full resolution
+    for (int i = 7; i < 25; i++)
+        step.Run(1);
+    batch.Run(18);
+
+    if (step.GetElapsedIterations() != 25 || batch.GetElapsedIterations() != 25)
+    {
+        std::cout << "Wrong number of elapsed iterations at full resolution" << std::endl;
+        n_failed++;
+    }
+
+    if (!sameImage(step.GetPreviewOutput(), batch.GetPreviewOutput()))
+    {
+        std::cout << "Output at full resolution depends on the iteration steps" << std::endl;
+        n_failed++;
+    }
+
+    if (countInside(step.GetOutput()) == nInitial)
+    {
+        std::cout << "Level set did not evolve" << std::endl;
+        n_failed++;
+    }
+
+    std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+    if (n_failed)
+        std::cout << n_failed;
+    std::cout << std::endl;
+    return n_failed ? 1 : 0;
+}
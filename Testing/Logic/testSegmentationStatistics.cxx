@@ -0,0 +1,152 @@
+#include "HeadlessWorkspaceEngine.h"
+#include "SegmentationStatistics.h"
+#include "IRISApplication.h"
+#include "WorkspaceAPI.h"
+#include "itkImage.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itksys/SystemTools.hxx"
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+using itksys::SystemTools;
+
+typedef itk::Image<short, 3> GreyImageType;
+typedef itk::Image<unsigned short, 3> LabelImageType;
+
+const int SIZE = 16;
+
+template <class TImage>
+void writeImage(const string &fn, bool label)
+{
+  typename TImage::Pointer img = TImage::New();
+  typename TImage::RegionType region;
+  for(int d = 0; d < 3; d++)
+    region.SetSize(d, SIZE);
+  img->SetRegions(region);
+  img->Allocate();
+
+  // Label 1 in a 4x4x4 cube, label 2 in a slab; the grey image is a ramp
+  itk::ImageRegionIteratorWithIndex<TImage> it(img, region);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    typename TImage::IndexType idx = it.GetIndex();
+    if(!label)
+      it.Set(idx[0] + idx[1] + idx[2]);
+    else if(idx[0] >= 2 && idx[0] < 6 && idx[1] >= 2 && idx[1] < 6 && idx[2] >= 2 && idx[2] < 6)
+      it.Set(1);
+    else if(idx[2] == 10)
+      it.Set(2);
+    else
+      it.Set(0);
+    }
+
+  typedef itk::ImageFileWriter<TImage> WriterType;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(img);
+  writer->SetFileName(fn);
+  writer->Update();
+}
+
+unsigned long count(const SegmentationStatistics &stats, LabelType label)
+{
+  SegmentationStatistics::EntryMap::const_iterator it = stats.GetStats().find(label);
+  return it == stats.GetStats().end() ? 0 : it->second.count;
+}
+
+// The exact statistics of the test images
+bool isExact(const SegmentationStatistics &stats)
+{
+  SegmentationStatistics::EntryMap::const_iterator it = stats.GetStats().find(2);
+  return !stats.IsApproximate() && count(stats, 1) == 64
+      && count(stats, 2) == SIZE * SIZE && it->second.mean.size() == 1
+      && fabs(it->second.mean[0] - 25.0) < 1e-6;
+}
+
+int main(int argc, char* argv[])
+{
+  int n_failed = 0;
+
+  string tmpdir = WorkspaceAPI::GetTempDirName();
+  SystemTools::MakeDirectory(tmpdir);
+  string fn_main = tmpdir + "/main.nii.gz", fn_seg = tmpdir + "/seg.nii.gz";
+  writeImage<GreyImageType>(fn_main, false);
+  writeImage<LabelImageType>(fn_seg, true);
+
+  try
+    {
+    WorkspaceAPI ws;
+    ws.SetLayer("MainRole", fn_main);
+    ws.SetLayer("SegmentationRole", fn_seg);
+    ws.SaveAsXMLFile((tmpdir + "/test.itksnap").c_str());
+
+    HeadlessWorkspaceEngine engine(argv[0]);
+    engine.LoadWorkspace(ws);
+
+    SegmentationStatistics stats;
+    stats.Compute(engine.GetDriver());
+    if(!isExact(stats))
+      {
+      cout << "Wrong exact statistics" << endl;
+      n_failed++;
+      }
+
+    // The snapshot is released once the exact statistics are known
+    if(stats.HasSnapshot())
+      {
+      cout << "Snapshot kept after the exact statistics were computed" << endl;
+      n_failed++;
+      }
+
+    // Every 4th line is sampled and the counts are scaled up. The labels
+    // are aligned with the sampled lines, so the estimates are exact
+    stats.Initialize(engine.GetDriver());
+    if(!stats.ComputeFromSnapshot(4) || !stats.IsApproximate()
+       || count(stats, 1) != 64 || count(stats, 2) != SIZE * SIZE)
+      {
+      cout << "Wrong statistics with a stride" << endl;
+      n_failed++;
+      }
+
+    // A cancelled computation keeps the previous statistics, and the snapshot
+    // is kept for refining the approximate statistics
+    std::atomic<bool> cancel(true);
+    if(stats.ComputeFromSnapshot(1, &cancel) || !stats.IsApproximate() || !stats.HasSnapshot())
+      {
+      cout << "Cancelled computation changed the statistics" << endl;
+      n_failed++;
+      }
+
+    // Releasing the snapshot keeps the statistics
+    stats.ReleaseSnapshot();
+    if(stats.HasSnapshot() || count(stats, 1) != 64)
+      {
+      cout << "Releasing the snapshot changed the statistics" << endl;
+      n_failed++;
+      }
+
+    // The snapshot is not affected by unloading the layers
+    stats.Initialize(engine.GetDriver());
+    engine.Unload();
+    if(!stats.ComputeFromSnapshot(1) || !isExact(stats) || stats.HasSnapshot())
+      {
+      cout << "Snapshot changed when the layers were unloaded" << endl;
+      n_failed++;
+      }
+    }
+  catch(exception &exc)
+    {
+    cout << "Exception: " << exc.what() << endl;
+    n_failed++;
+    }
+
+  SystemTools::RemoveADirectory(tmpdir);
+
+  cout << (n_failed ? "Tests failed: " : "All tests passed");
+  if(n_failed)
+    cout << n_failed;
+  cout << endl;
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+#include "VectorImageWrapper.h"
+#include "ImageWrapperTraits.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include <cmath>
+#include <iostream>
+
+typedef ImageWrapperTraits<short>::VectorTraits::WrapperType VectorWrapperType;
+typedef VectorWrapperType::Image4DType Image4DType;
+typedef ImageWrapperTraits<short>::MagnitudeTraits::WrapperType MagnitudeWrapperType;
+typedef MagnitudeWrapperType::ImageType MagnitudeImageType;
+
+const int SIZE = 8, NT = 2, NC = 3;
+
+// Component values of each voxel, with larger values at the second time point
+short componentValue(int offset, int t, int c)
+{
+    return (short)((offset % 17) * (c + 1) + t * 100);
+}
+
+double expectedMagnitude(int offset, int t)
+{
+    double sum = 0;
+    for (int c = 0; c < NC; c++)
+        sum += componentValue(offset, t, c) * componentValue(offset, t, c);
+    return sqrt(sum);
+}
+
+Image4DType::Pointer makeImage()
+{
+    Image4DType::Pointer img = Image4DType::New();
+    Image4DType::RegionType region;
+    for (int d = 0; d < 3; d++)
+        region.SetSize(d, SIZE);
+    region.SetSize(3, NT);
+    img->SetRegions(region);
+    img->SetNumberOfComponentsPerPixel(NC);
+    img->Allocate();
+
+    short *p = img->GetBufferPointer();
+    for (int t = 0; t < NT; t++)
+        for (int i = 0; i < SIZE * SIZE * SIZE; i++)
+            for (int c = 0; c < NC; c++)
+                *p++ = componentValue(i, t, c);
+    return img;
+}
+
+// Check the magnitude image of a time point against the expected values
+bool checkMagnitude(MagnitudeImageType *img, int t)
+{
+    itk::ImageRegionConstIterator<MagnitudeImageType> it(img, img->GetBufferedRegion());
+    for (int i = 0; !it.IsAtEnd(); ++it, ++i)
+        if (fabs(it.Get() - expectedMagnitude(i, t)) > 1e-3)
+            return false;
+    return true;
+}
+
+bool hasReadyValues(MagnitudeImageType *img)
+{
+    auto values = img->GetPixelAccessor().GetMaterializedValues();
+    return values && values->Ready;
+}
+
+int main(int argc, char* argv[])
+{
+    int n_failed = 0;
+
+    VectorWrapperType::Pointer wrapper = VectorWrapperType::New();
+    wrapper->SetImage4D(makeImage());
+    MagnitudeWrapperType *mag = dynamic_cast<MagnitudeWrapperType *>(
+        wrapper->GetScalarRepresentation(SCALAR_REP_MAGNITUDE));
+
+    // Materialization is opt-in
+    if (wrapper->GetMaterializeDerivedQuantities()
+        || mag->GetImageByTimePoint(0)->GetPixelAccessor().GetMaterializedValues())
+    {
+        std::cout << "Derived quantities materialized by default" << std::endl;
+        n_failed++;
+    }
+
+    wrapper->SetMaterializeDerivedQuantities(true);
+    wrapper->WaitForMaterializedDerivedQuantities();
+    if (!hasReadyValues(mag->GetImageByTimePoint(0)) || !checkMagnitude(mag->GetImageByTimePoint(0), 0))
+    {
+        std::cout << "Wrong materialized values at the first time point" << std::endl;
+        n_failed++;
+    }
+
+    // The 4D image spans both time points and does not use the values of the
+    // current time point, so the maximum comes from the second time point
+    double max_expected = 0;
+    for (int i = 0; i < SIZE * SIZE * SIZE; i++)
+        max_expected = std::max(max_expected, expectedMagnitude(i, 1));
+    if (fabs(mag->GetImageMaxAsDouble() - max_expected) > 1e-3)
+    {
+        std::cout << "Wrong maximum over all time points" << std::endl;
+        n_failed++;
+    }
+
+    // After a time point switch, values are correct while they are computed
+    // in the background, and the previous time point no longer holds values
+    wrapper->SetTimePointIndex(1);
+    if (!checkMagnitude(mag->GetImageByTimePoint(1), 1)
+        || mag->GetImageByTimePoint(0)->GetPixelAccessor().GetMaterializedValues())
+    {
+        std::cout << "Wrong values during the time point switch" << std::endl;
+        n_failed++;
+    }
+
+    wrapper->WaitForMaterializedDerivedQuantities();
+    if (!hasReadyValues(mag->GetImageByTimePoint(1)) || !checkMagnitude(mag->GetImageByTimePoint(1), 1))
+    {
+        std::cout << "Wrong materialized values at the second time point" << std::endl;
+        n_failed++;
+    }
+
+    // Turning materialization off releases the values
+    wrapper->SetMaterializeDerivedQuantities(false);
+    if (mag->GetImageByTimePoint(1)->GetPixelAccessor().GetMaterializedValues()
+        || !checkMagnitude(mag->GetImageByTimePoint(1), 1))
+    {
+        std::cout << "Values not released" << std::endl;
+        n_failed++;
+    }
+
+    std::cout << (n_failed ? "Tests failed: " : "All tests passed");
+    if (n_failed)
+        std::cout << n_failed;
+    std::cout << std::endl;
+    return n_failed ? 1 : 0;
+}
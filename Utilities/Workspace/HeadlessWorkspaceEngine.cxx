@@ -0,0 +1,248 @@
+#include "HeadlessWorkspaceEngine.h"
+#include "IRISApplication.h"
+#include "IRISException.h"
+#include "WorkspaceAPI.h"
+#include "HeadlessSystemInfoDelegate.h"
+#include "ImageIODelegates.h"
+#include "GenericImageData.h"
+#include "SegmentationUpdateIterator.h"
+#include "MeshExportSettings.h"
+#include "GuidedMeshIO.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkMorphologicalContourInterpolator.h"
+#include "itksys/Process.h"
+#include "itksys/SystemTools.hxx"
+
+using namespace std;
+using itksys::SystemTools;
+
+HeadlessWorkspaceEngine::HeadlessWorkspaceEngine(const char *argv0)
+{
+  // The delegate must exist before the logic layer is created. Its data
+  // directory is temporary and is removed with the engine
+  m_DataDir = WorkspaceAPI::GetTempDirName();
+  SystemTools::MakeDirectory(m_DataDir);
+  m_Delegate = new HeadlessSystemInfoDelegate(argv0, m_DataDir);
+  SystemInterface::SetSystemInfoDelegate(m_Delegate);
+}
+
+HeadlessWorkspaceEngine::~HeadlessWorkspaceEngine()
+{
+  this->Unload();
+  SystemInterface::SetSystemInfoDelegate(NULL);
+  delete m_Delegate;
+  SystemTools::RemoveADirectory(m_DataDir);
+}
+
+void HeadlessWorkspaceEngine::LoadWorkspace(const WorkspaceAPI &ws)
+{
+  this->Unload();
+
+  // The workspace may have been modified by earlier commands, so it is
+  // written with absolute paths to a temporary file that the logic layer
+  // can read
+  m_TempDir = WorkspaceAPI::GetTempDirName();
+  SystemTools::MakeDirectory(m_TempDir);
+  string ws_file = m_TempDir + "/headless.itksnap";
+
+  WorkspaceAPI ws_copy = ws;
+  ws_copy.SaveAsXMLFile(ws_file.c_str());
+
+  m_Driver = IRISApplication::New();
+
+  IRISWarningList warnings;
+  m_Driver->OpenProject(ws_file, warnings);
+
+  for(unsigned int i = 0; i < warnings.size(); i++)
+    cerr << "WARNING: " << warnings[i].what() << endl;
+}
+
+void HeadlessWorkspaceEngine::Unload()
+{
+  m_Driver = NULL;
+  if(m_TempDir.size())
+    {
+    SystemTools::RemoveADirectory(m_TempDir);
+    m_TempDir.clear();
+    }
+}
+
+bool HeadlessWorkspaceEngine::IsLoaded() const
+{
+  return m_Driver.IsNotNull();
+}
+
+IRISApplication *HeadlessWorkspaceEngine::GetDriver() const
+{
+  return m_Driver;
+}
+
+void HeadlessWorkspaceEngine::CheckLoaded() const
+{
+  if(!this->IsLoaded() || !m_Driver->IsMainImageLoaded())
+    throw IRISException("No workspace with a main image has been loaded");
+}
+
+void HeadlessWorkspaceEngine::ExportStatistics(const std::string &file)
+{
+  this->CheckLoaded();
+  m_Driver->ExportSegmentationStatistics(file.c_str());
+}
+
+void HeadlessWorkspaceEngine::ExportMesh(const std::string &file, LabelType label)
+{
+  this->CheckLoaded();
+
+  MeshExportSettings sets;
+  sets.SetMeshFileName(file);
+  sets.SetFlagSingleLabel(label != 0);
+  sets.SetFlagSingleScene(label == 0);
+  sets.SetExportLabel(label);
+
+  // The mesh format is determined by the extension
+  GuidedMeshIO::FileFormat fmt = GuidedMeshIO::GetFormatByFilename(file.c_str());
+  if(fmt == GuidedMeshIO::FORMAT_COUNT)
+    throw IRISException("Unknown mesh format for file %s", file.c_str());
+
+  Registry format;
+  GuidedMeshIO::SetFileFormat(format, fmt);
+  sets.SetMeshFormat(format);
+
+  m_Driver->ExportSegmentationMesh(sets, NULL);
+}
+
+size_t HeadlessWorkspaceEngine::ReplaceLabel(LabelType label_old, LabelType label_new)
+{
+  this->CheckLoaded();
+  return m_Driver->ReplaceLabel(label_new, label_old);
+}
+
+void HeadlessWorkspaceEngine::InterpolateLabel(LabelType label)
+{
+  this->CheckLoaded();
+
+  typedef GenericImageData::LabelImageType LabelImageType;
+  LabelImageWrapper *liw = m_Driver->GetSelectedSegmentationLayer();
+
+  typedef itk::MorphologicalContourInterpolator<LabelImageType> MCIType;
+  SmartPtr<MCIType> mci = MCIType::New();
+
+  // To interpolate a single label, it is first extracted from the segmentation
+  typedef itk::BinaryThresholdImageFilter<LabelImageType, LabelImageType> ThresholdType;
+  SmartPtr<ThresholdType> thresh = ThresholdType::New();
+  if(label)
+    {
+    thresh->SetInput(liw->GetImage());
+    thresh->SetLowerThreshold(label);
+    thresh->SetUpperThreshold(label);
+    thresh->SetInsideValue(label);
+    thresh->SetOutsideValue(0);
+    mci->SetInput(thresh->GetOutput());
+    mci->SetLabel(label);
+    }
+  else
+    {
+    mci->SetInput(liw->GetImage());
+    }
+
+  mci->Update();
+
+  // Apply the interpolation to the segmentation. A single label is only
+  // painted where the interpolation produced it
+  SegmentationUpdateIterator it_trg(liw, liw->GetBufferedRegion(), label, DrawOverFilter());
+  itk::ImageRegionConstIterator<LabelImageType>
+      it_src(mci->GetOutput(), mci->GetOutput()->GetBufferedRegion());
+
+  for(; !it_trg.IsAtEnd(); ++it_trg, ++it_src)
+    {
+    if(!label)
+      it_trg.PaintLabel(it_src.Get());
+    else if(it_src.Get() == label)
+      it_trg.PaintAsForeground();
+    }
+
+  it_trg.Finalize("Interpolate label");
+}
+
+void HeadlessWorkspaceEngine::SaveSegmentation(const std::string &file)
+{
+  this->CheckLoaded();
+
+  LabelImageWrapper *liw = m_Driver->GetSelectedSegmentationLayer();
+  string fn = file.size() ? file : liw->GetFileName();
+  if(fn.empty())
+    throw IRISException("The segmentation has no filename; specify one");
+
+  Registry hints;
+  liw->WriteToFile(fn.c_str(), hints);
+}
+
+int HeadlessWorkspaceEngine::RunBatch(const char *argv0, int n_jobs,
+                                      const std::vector<std::string> &workspaces,
+                                      const std::vector<std::string> &commands)
+{
+  // A running child process and the workspace it is processing
+  typedef std::pair<itksysProcess *, std::string> Job;
+  std::vector<Job> running;
+  int n_failed = 0;
+
+  for(unsigned int next = 0; next < workspaces.size() || running.size(); )
+    {
+    // Start new jobs while there are free slots
+    while(next < workspaces.size() && (int) running.size() < std::max(n_jobs, 1))
+      {
+      const string &ws = workspaces[next++];
+      string ws_name = SystemTools::GetFilenameWithoutLastExtension(
+            SystemTools::GetFilenameName(ws));
+
+      // Child command line: load the workspace, then run the commands
+      std::vector<string> args;
+      args.push_back(argv0);
+      args.push_back("-i");
+      args.push_back(ws);
+      for(unsigned int i = 0; i < commands.size(); i++)
+        {
+        string cmd = commands[i];
+        for(size_t pos; (pos = cmd.find("{}")) != string::npos; )
+          cmd.replace(pos, 2, ws_name);
+        args.push_back(cmd);
+        }
+
+      std::vector<const char *> argv;
+      for(unsigned int i = 0; i < args.size(); i++)
+        argv.push_back(args[i].c_str());
+      argv.push_back(NULL);
+
+      // The child writes directly to our output
+      itksysProcess *proc = itksysProcess_New();
+      itksysProcess_SetCommand(proc, &argv[0]);
+      itksysProcess_SetPipeShared(proc, itksysProcess_Pipe_STDOUT, 1);
+      itksysProcess_SetPipeShared(proc, itksysProcess_Pipe_STDERR, 1);
+      itksysProcess_Execute(proc);
+      running.push_back(make_pair(proc, ws));
+      }
+
+    // Wait for any of the running jobs to finish
+    for(unsigned int i = 0; i < running.size(); )
+      {
+      double timeout = 0.1;
+      if(itksysProcess_WaitForExit(running[i].first, &timeout))
+        {
+        itksysProcess *proc = running[i].first;
+        bool ok = itksysProcess_GetState(proc) == itksysProcess_State_Exited
+            && itksysProcess_GetExitValue(proc) == 0;
+        if(!ok)
+          {
+          cerr << "ERROR: processing failed for workspace " << running[i].second << endl;
+          n_failed++;
+          }
+        itksysProcess_Delete(proc);
+        running.erase(running.begin() + i);
+        }
+      else
+        i++;
+      }
+    }
+
+  return n_failed;
+}
@@ -0,0 +1,87 @@
+#ifndef HEADLESSWORKSPACEENGINE_H
+#define HEADLESSWORKSPACEENGINE_H
+
+#include "SNAPCommon.h"
+#include <string>
+#include <vector>
+
+class IRISApplication;
+class WorkspaceAPI;
+class HeadlessSystemInfoDelegate;
+
+/**
+ * This class loads a workspace into the ITK-SNAP logic layer (IRISApplication)
+ * without a GUI, so that operations that normally require the GUI, such as
+ * computing statistics, exporting meshes, or editing the segmentation, can be
+ * performed from the command line on machines without a display.
+ */
+class HeadlessWorkspaceEngine
+{
+public:
+
+  HeadlessWorkspaceEngine(const char *argv0);
+
+  ~HeadlessWorkspaceEngine();
+
+  /** Load the contents of a workspace into the logic layer */
+  void LoadWorkspace(const WorkspaceAPI &ws);
+
+  /** Release the loaded workspace */
+  void Unload();
+
+  /** Whether a workspace has been loaded */
+  bool IsLoaded() const;
+
+  /** Export volume and intensity statistics for the segmentation labels */
+  void ExportStatistics(const std::string &file);
+
+  /**
+   * Export meshes of the segmentation. If label is zero, all labels are
+   * exported into a single scene, otherwise just the specified label.
+   */
+  void ExportMesh(const std::string &file, LabelType label);
+
+  /** Replace one label by another in the segmentation. Returns voxel count */
+  size_t ReplaceLabel(LabelType label_old, LabelType label_new);
+
+  /**
+   * Interpolate the segmentation between the slices where it has been drawn
+   * using morphological contour interpolation. If label is zero, all labels
+   * are interpolated.
+   */
+  void InterpolateLabel(LabelType label);
+
+  /** Save the segmentation, to its own file if the filename is empty */
+  void SaveSegmentation(const std::string &file);
+
+  /** Get the logic layer */
+  IRISApplication *GetDriver() const;
+
+  /**
+   * Run itksnap-wt with a list of commands on each of the workspaces in a list
+   * as separate processes, with up to n_jobs processes at a time. The string
+   * '{}' in the commands is replaced by the workspace name without the
+   * extension. Returns the number of workspaces for which processing failed.
+   */
+  static int RunBatch(const char *argv0, int n_jobs,
+                      const std::vector<std::string> &workspaces,
+                      const std::vector<std::string> &commands);
+
+protected:
+
+  // The logic layer
+  SmartPtr<IRISApplication> m_Driver;
+
+  // Temporary directory where the workspace is written for loading
+  std::string m_TempDir;
+
+  // System info delegate for the logic layer, and its temporary directory
+  // for user data, which are owned by the engine
+  HeadlessSystemInfoDelegate *m_Delegate;
+  std::string m_DataDir;
+
+  // Throw an exception if no workspace is loaded
+  void CheckLoaded() const;
+};
+
+#endif // HEADLESSWORKSPACEENGINE_H
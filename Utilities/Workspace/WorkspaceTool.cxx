@@ -35,6 +35,7 @@
 #include <fstream>
 #include <string>
 #include <cstdarg>
+#include <memory>
 
 #include "CSVParser.h"
 #include "WorkspaceAPI.h"
@@ -51,6 +52,7 @@
 #include "ColorLabelTable.h"
 
 #include "IRISApplication.h"
+#include "HeadlessWorkspaceEngine.h"
 #include "AffineTransformHelper.h"
 #include "itkTransform.h"
 
@@ -135,6 +137,17 @@ int usage(int rc)
   cout << "                                      renaming with C printf pattern (e.g. 'left %s')" << endl;
   cout << "Annotation object commands" << endl;
   cout << "  -annot-list                       : List all annotations in the workspace" << endl;
+  cout << "Headless processing commands (load the workspace into ITK-SNAP without a display): " << endl;
+  cout << "  -stats-export <file>              : Export segmentation volume and intensity statistics" << endl;
+  cout << "  -mesh-export <file> [label]       : Export the segmentation mesh for a label, or for all" << endl;
+  cout << "                                      labels as a single scene if no label is given" << endl;
+  cout << "  -relabel <old> <new>              : Replace label 'old' with label 'new' in the segmentation" << endl;
+  cout << "  -interpolate [label]              : Interpolate a label (or all labels) between drawn slices" << endl;
+  cout << "  -seg-save [file]                  : Save the segmentation, to its own file if none is given" << endl;
+  cout << "  -batch <n> <list> <cmd...>        : Run the commands that follow on each workspace listed in" << endl;
+  cout << "                                      the text file 'list', running 'n' workspaces in parallel." << endl;
+  cout << "                                      '{}' in the commands is replaced by the workspace name." << endl;
+  cout << "                                      This must be the last command." << endl;
   cout << "Distributed segmentation server (DSS) user commands: " << endl;
   cout << "  -dss-auth <url> [user] [passwd]   : Sign in to the server. This will create a token" << endl;
   cout << "                                      that may be used in future -dss calls" << endl;
@@ -364,6 +377,9 @@ int main(int argc, char *argv[])
   // Current workspace object
   WorkspaceAPI ws;
 
+  // Logic layer for the headless commands, created by the first of them
+  std::unique_ptr<HeadlessWorkspaceEngine> engine;
+
   // Currently selected layer folder
   string layer_folder;
 
@@ -404,6 +420,8 @@ int main(int argc, char *argv[])
       if(arg == "-i")
         {
         ws.ReadFromXMLFile(cl.read_existing_filename().c_str());
+        if(engine)
+          engine->Unload();
         }
 
       else if(arg == "-o")
@@ -1171,6 +1189,70 @@ int main(int argc, char *argv[])
                          pname.c_str(), githash.c_str());
         }
 
+      // Headless processing commands. The workspace is loaded into the logic
+      // layer by the first of these commands
+      else if(arg == "-stats-export" || arg == "-mesh-export" || arg == "-relabel"
+              || arg == "-interpolate" || arg == "-seg-save")
+        {
+        if(!engine)
+          engine.reset(new HeadlessWorkspaceEngine(argv[0]));
+        if(!engine->IsLoaded())
+          engine->LoadWorkspace(ws);
+
+        if(arg == "-stats-export")
+          {
+          engine->ExportStatistics(cl.read_output_filename());
+          }
+        else if(arg == "-mesh-export")
+          {
+          string fn = cl.read_output_filename();
+          LabelType label = cl.command_arg_count() > 0 ? cl.read_integer() : 0;
+          engine->ExportMesh(fn, label);
+          }
+        else if(arg == "-relabel")
+          {
+          LabelType label_old = cl.read_integer();
+          LabelType label_new = cl.read_integer();
+          size_t n = engine->ReplaceLabel(label_old, label_new);
+          cout << prefix << n << endl;
+          }
+        else if(arg == "-interpolate")
+          {
+          LabelType label = cl.command_arg_count() > 0 ? cl.read_integer() : 0;
+          engine->InterpolateLabel(label);
+          }
+        else
+          {
+          string fn = cl.command_arg_count() > 0 ? cl.read_output_filename() : string();
+          engine->SaveSegmentation(fn);
+          }
+        }
+
+      // Run the remaining commands on a list of workspaces in parallel
+      else if(arg == "-batch")
+        {
+        int n_jobs = cl.read_integer();
+        string fn_list = cl.read_existing_filename();
+
+        std::vector<string> workspaces;
+        ifstream ifs(fn_list.c_str());
+        for(string line; getline(ifs, line); )
+          {
+          line = SystemTools::TrimWhitespace(line);
+          if(line.size())
+            workspaces.push_back(line);
+          }
+
+        std::vector<string> commands;
+        while(!cl.is_at_end())
+          commands.push_back(cl.read_string());
+
+        int n_failed = HeadlessWorkspaceEngine::RunBatch(argv[0], n_jobs, workspaces, commands);
+        if(n_failed)
+          throw IRISException("Processing failed for %d of %d workspaces",
+                              n_failed, (int) workspaces.size());
+        }
+
       else
         throw IRISException("Unknown command %s", arg.c_str());
       }